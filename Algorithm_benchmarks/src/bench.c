@@ -0,0 +1,108 @@
+/*! \file bench.c
+	\brief The micro-benchmark harness of the navigation algorithm.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup bench
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+/// Number of untimed warm-up batches.
+#define BENCH_WARMUP_BATCHES 2
+
+static inline uint64_t read_cycles(void){
+#if BENCH_HAS_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static inline double read_time(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+1e-9*ts.tv_nsec;
+}
+
+int bench_has_cycle_counter(void){
+	return BENCH_HAS_TSC;
+}
+
+void bench_run(bench_result_t *result, const bench_case_t *c, double min_time, uint32_t repetitions){
+	double sum=0, sum2=0;
+	uint64_t total_cycles=0;
+
+	result->name=c->name;
+	result->calls=0;
+	result->repetitions=repetitions;
+	result->ns_min=INFINITY;
+
+	for(uint32_t i=0; i<BENCH_WARMUP_BATCHES; i++){
+		if(c->prepare)
+			c->prepare(c->arg);
+		c->body(c->arg);
+	}
+
+	for(uint32_t r=0; r<repetitions; r++){
+		double time=0;
+		uint64_t calls=0;
+
+		// At least one batch per repetition, also when the minimum time is zero.
+		do{
+			if(c->prepare)
+				c->prepare(c->arg);
+
+			double t0=read_time();
+			uint64_t c0=read_cycles();
+			c->body(c->arg);
+			uint64_t c1=read_cycles();
+			double t1=read_time();
+
+			time+=t1-t0;
+			total_cycles+=c1-c0;
+			calls+=c->calls_per_batch;
+		}while(time<min_time/repetitions);
+
+		double ns=1e9*time/calls;
+		sum+=ns;
+		sum2+=ns*ns;
+		if(ns<result->ns_min)
+			result->ns_min=ns;
+		result->calls+=calls;
+	}
+
+	result->ns_mean=sum/repetitions;
+	result->ns_stddev=repetitions>1 ? sqrt(fmax(0.0,(sum2-sum*sum/repetitions)/(repetitions-1))) : 0.0;
+	result->cycles_mean=BENCH_HAS_TSC ? (double)total_cycles/result->calls : 0.0;
+}
+
+void bench_print_header(FILE *f){
+	fprintf(f,"%-36s %10s %10s %10s %7s %10s %12s\n","Benchmark","Time[ns]","StdDev[ns]","Min[ns]","CV[%]","Cycles","Calls");
+	fprintf(f,"----------------------------------------------------------------------------------------------------------\n");
+}
+
+void bench_print_result(FILE *f, const bench_result_t *r){
+	fprintf(f,"%-36s %10.1f %10.2f %10.1f %7.2f ",r->name,r->ns_mean,r->ns_stddev,r->ns_min,
+			r->ns_mean>0 ? 100*r->ns_stddev/r->ns_mean : 0.0);
+	if(BENCH_HAS_TSC)
+		fprintf(f,"%10.1f ",r->cycles_mean);
+	else
+		fprintf(f,"%10s ","n/a");
+	fprintf(f,"%12llu\n",(unsigned long long)r->calls);
+}
+
+//@}
@@ -0,0 +1,83 @@
+/*! \file bench.h
+	\brief Header file for the micro-benchmark harness of the navigation algorithm.
+
+	\details A benchmark case consists of a \a prepare function, which restores the inputs of the case and which is
+	not timed, and a \a body function, which makes a fixed number of calls to the function under test and which is
+	timed. As in Google Benchmark, a case is run in a number of repetitions, each repeating the body in batches until
+	its share of the minimum run time has passed. The time per call of each repetition is one observation, from which
+	the mean, standard deviation and minimum are calculated.
+
+	The cycle counts are read from the time stamp counter on x86, which runs at a constant reference frequency
+	rather than the actual core clock. With frequency scaling or turbo the numbers should be read as reference
+	cycles.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/**
+	\defgroup bench Algorithm benchmarks
+	\brief Host micro-benchmarks of the processing stages of the navigation algorithm.
+	@{
+*/
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// Result of one benchmark case.
+typedef struct {
+	/// Name of the case.
+	const char *name;
+	/// Number of timed calls.
+	uint64_t calls;
+	/// Number of repetitions (observations).
+	uint32_t repetitions;
+	/// Mean time per call [ns].
+	double ns_mean;
+	/// Standard deviation of the time per call between the repetitions [ns].
+	double ns_stddev;
+	/// Minimum time per call of any repetition [ns].
+	double ns_min;
+	/// Mean number of (time stamp counter) cycles per call, 0 if not available.
+	double cycles_mean;
+} bench_result_t;
+
+/// Benchmark case.
+typedef struct {
+	/// Name of the case.
+	const char *name;
+	/// Restores the inputs of the case before each batch (not timed). May be NULL.
+	void (*prepare)(void *arg);
+	/// Makes \a calls_per_batch calls to the function under test (timed).
+	void (*body)(void *arg);
+	/// Argument of \a prepare and \a body.
+	void *arg;
+	/// Number of calls made by one call of \a body.
+	uint32_t calls_per_batch;
+} bench_case_t;
+
+/// Returns non-zero if cycle counts are available on this host.
+int bench_has_cycle_counter(void);
+
+/*! \brief Runs a benchmark case.
+
+	 @param[out] result		The result of the case.
+	 @param[in]	 c			The benchmark case.
+	 @param[in]	 min_time		Minimum total time of the timed batches [s].
+	 @param[in]	 repetitions	Number of repetitions, at least 1.
+*/
+void bench_run(bench_result_t *result, const bench_case_t *c, double min_time, uint32_t repetitions);
+
+/// Prints the header of the result table.
+void bench_print_header(FILE *f);
+
+/// Prints a result as a row of the result table.
+void bench_print_result(FILE *f, const bench_result_t *result);
+
+#endif /* BENCH_H_ */
+
+//@}
@@ -0,0 +1,583 @@
+/*! \file main.c
+	\brief The main file of the host micro-benchmarks of the navigation algorithm.
+
+	\details Times each processing stage of nav_eq.c on the host, corresponding to the clock_cycles_vec timings of
+	the Algorithm_test_framework but without the board and without MATLAB streaming the data over USB.
+
+	The inputs of the benchmarks are snapshots of the filter context taken while replaying a recorded session. The
+	snapshots are spread evenly over the session after the initial alignment and are taken after the ZUPT detector,
+	i.e., at the point in the process sequence where zupt_update would be called. The snapshots of the measurement
+	update stages are only taken at samples where the detector signaled a ZUPT, and the gain matrix is already
+	calculated in them. Since the stages update the filter context in place, the snapshots are copied to working
+	contexts before each timed batch.
+
+	The step benchmarks process one sample of each of a number of filters, each replaying the session from its own
+	offset, either filter by filter with the functions of nav_eq.c or in lockstep with the batched engine of
+	nav_batch.c. Their times are per filter and sample.
+
+	The UD stages run on copies of the snapshots with the covariance already factorized, such that their times can
+	be compared with those of time_up_data and of gain_matrix plus measurement_update.
+
+	The window size of the zero-velocity detector can be changed with -w, e.g. to check that the cost of the
+	detector and of the buffer update does not depend on it.
+
+	The output state benchmarks time one call of the state output assembly of the runtime framework
+	(assemble_output_data in external_interface.c), with the first -s states of the state ID table enabled at
+	divider 1. output_states_scan is a copy of the original loop, which scans rate divider and counter arrays over the
+	whole state ID space, and output_states_list a copy of the ordered list of the enabled states which replaced it.
+
+	\verbatim
+	Usage: nav_bench [-n snapshots] [-f filters] [-t min_time] [-r repetitions] [-b filter] [-w window] [-s states] session
+	\endverbatim
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup bench
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "nav_batch.h"
+#include "nav_kernels.h"
+#include "replay.h"
+#include "session.h"
+
+///\cond
+// Variables used by the void(void) functions of nav_eq.c. The benchmarks only use filter contexts.
+vec3 accelerations_in;
+vec3 angular_rates_in;
+uint8_t error_signal;
+///\endcond
+
+/// Default number of snapshots of each input set.
+#define BENCH_DEFAULT_SNAPSHOTS 64
+
+/// Default number of filters of the step benchmarks.
+#define BENCH_DEFAULT_FILTERS 256
+
+/// Default minimum time of each benchmark case [s].
+#define BENCH_DEFAULT_MIN_TIME 0.5
+
+/// Default number of repetitions of each benchmark case.
+#define BENCH_DEFAULT_REPETITIONS 10
+
+/// Default number of enabled states of the output state benchmarks.
+#define BENCH_DEFAULT_OUTPUT_STATES 4
+
+/// Set of filter snapshots used as inputs.
+typedef struct {
+	/// The snapshots.
+	nav_filter_t *snapshots;
+	/// Working contexts, restored from the snapshots before each batch.
+	nav_filter_t *work;
+	/// Number of snapshots.
+	uint32_t nr_of_snapshots;
+} input_set_t;
+
+/// Input sets of the benchmark cases.
+enum {
+	/// Snapshots at all samples after the initial alignment.
+	INPUT_ALL,
+	/// Snapshots at the ZUPT instants, with the gain matrix calculated.
+	INPUT_ZUPT,
+	/// The snapshots of \ref INPUT_ALL with the covariance factorized.
+	INPUT_ALL_UD,
+	/// The snapshots of \ref INPUT_ZUPT with the covariance factorized.
+	INPUT_ZUPT_UD,
+	NR_OF_INPUT_SETS
+};
+
+/// Benchmarked processing stage.
+typedef struct {
+	/// Name of the stage.
+	const char *name;
+	/// The stage.
+	void (*stage)(nav_filter_t *filter);
+	/// Input set of the stage.
+	int input;
+} stage_case_t;
+
+/// Buffer update stage, feeds the current out data of the snapshot back as the new sample.
+static void update_imu_data_buffers_stage(nav_filter_t *filter){
+	nav_update_imu_data_buffers(filter,filter->accelerations_out,filter->angular_rates_out);
+}
+
+static const stage_case_t stage_cases[] = {
+	{"update_imu_data_buffers",				update_imu_data_buffers_stage,			INPUT_ALL},
+	{"strapdown_mechanisation_equations",	nav_strapdown_mechanisation_equations,	INPUT_ALL},
+	{"time_up_data",						nav_time_up_data,						INPUT_ALL},
+	{"ZUPT_detector",						nav_ZUPT_detector,						INPUT_ALL},
+	{"MV_detector",							nav_MV_detector,						INPUT_ALL},
+	{"MAG_detector",						nav_MAG_detector,						INPUT_ALL},
+	{"ARE_detector",						nav_ARE_detector,						INPUT_ALL},
+	{"gain_matrix",							nav_gain_matrix,						INPUT_ZUPT},
+	{"correct_navigation_states",			nav_correct_navigation_states,			INPUT_ZUPT},
+	{"measurement_update",					nav_measurement_update,					INPUT_ZUPT},
+	{"time_up_data_UD",						nav_time_up_data_UD,					INPUT_ALL_UD},
+	{"measurement_update_UD",				nav_measurement_update_UD,				INPUT_ZUPT_UD},
+};
+
+#define NR_OF_STAGE_CASES (sizeof(stage_cases)/sizeof(stage_cases[0]))
+
+/// Argument of the benchmark functions of a stage.
+typedef struct {
+	const stage_case_t *c;
+	input_set_t *input;
+} stage_arg_t;
+
+static void stage_prepare(void *arg){
+	input_set_t *in=((stage_arg_t*)arg)->input;
+	memcpy(in->work,in->snapshots,in->nr_of_snapshots*sizeof(nav_filter_t));
+}
+
+static void stage_body(void *arg){
+	const stage_arg_t *a=arg;
+	void (*stage)(nav_filter_t*)=a->c->stage;
+	nav_filter_t *work=a->input->work;
+	for(uint32_t i=0; i<a->input->nr_of_snapshots; i++)
+		stage(&work[i]);
+}
+
+/// Argument of the step benchmarks.
+typedef struct {
+	const session_data_t *data;
+	/// Scalar filter contexts.
+	nav_filter_t *filters;
+	/// Batched filters.
+	nav_batch_t batch;
+	uint32_t nr_of_filters;
+	/// Sample index of each filter.
+	uint32_t *sample;
+	/// IMU data of the current step.
+	vec3 *accelerations;
+	vec3 *angular_rates;
+} step_arg_t;
+
+/// Gathers the next IMU sample of each filter.
+static void step_read_samples(step_arg_t *a){
+	const float *const *ch=a->data->channels;
+
+	for(uint32_t i=0; i<a->nr_of_filters; i++){
+		uint32_t k=a->sample[i];
+		a->accelerations[i][0]=ch[IMU_REC_ACC_X][k];
+		a->accelerations[i][1]=ch[IMU_REC_ACC_Y][k];
+		a->accelerations[i][2]=ch[IMU_REC_ACC_Z][k];
+		a->angular_rates[i][0]=ch[IMU_REC_GYRO_X][k];
+		a->angular_rates[i][1]=ch[IMU_REC_GYRO_Y][k];
+		a->angular_rates[i][2]=ch[IMU_REC_GYRO_Z][k];
+		a->sample[i]=(k+1<a->data->nr_of_samples) ? k+1 : 0;
+	}
+}
+
+static void step_scalar_body(void *arg){
+	step_arg_t *a=arg;
+
+	step_read_samples(a);
+	for(uint32_t i=0; i<a->nr_of_filters; i++){
+		nav_filter_t *f=&a->filters[i];
+		nav_update_imu_data_buffers(f,a->accelerations[i],a->angular_rates[i]);
+		if(f->initialize_flag){
+			nav_initialize_navigation_algorithm(f,a->accelerations[i]);
+			continue;
+		}
+		nav_strapdown_mechanisation_equations(f);
+		nav_time_up_data(f);
+		nav_ZUPT_detector(f);
+		nav_zupt_update(f);
+	}
+}
+
+static void step_batch_body(void *arg){
+	step_arg_t *a=arg;
+
+	step_read_samples(a);
+	nav_batch_step(&a->batch,a->accelerations,a->angular_rates);
+}
+
+/// Step benchmark cases.
+static const struct {
+	const char *name;
+	void (*body)(void *arg);
+} step_cases[] = {
+	{"filter_step",		step_scalar_body},
+	{"batch_step",		step_batch_body},
+};
+
+#define NR_OF_STEP_CASES (sizeof(step_cases)/sizeof(step_cases[0]))
+
+///\name Output state benchmarks
+///  Host copies of the state output assembly of external_interface.c, before and after the ordered list of the
+///  output states.
+//@{
+
+/// Size of the state ID space, SID_LIMIT of control_tables.h.
+#define OUTPUT_SID_LIMIT 0xFF
+
+/// Maximum number of states which can be output at the same time, MAX_OUTPUT_STATES of external_interface.c.
+#define OUTPUT_MAX_STATES 32
+
+/// Number of times the assembly is called by one call of the benchmark body.
+#define OUTPUT_CALLS_PER_BATCH 1024
+
+/// IDs of the states of the state ID table of the runtime framework.
+static const uint8_t output_state_ids[] = {0x01,0x02,0x03,0x04,0x05,0x11,0x12,0x13,0x14,0x21,0x22,0x23,0x24,0x25,0x35};
+
+#define NR_OF_OUTPUT_STATE_IDS (sizeof(output_state_ids)/sizeof(output_state_ids[0]))
+
+/// Information struct of a state, the fields of state_t_info used by the assembly.
+typedef struct {
+	uint8_t id;
+	void *state_p;
+	int state_size;
+} output_state_info_t;
+
+/// Entry of the ordered list of the output states.
+typedef struct {
+	output_state_info_t *info;
+	uint16_t rate_divider;
+	uint16_t rate_counter;
+} output_state_t;
+
+/// Argument of the output state benchmarks.
+typedef struct {
+	output_state_info_t infos[NR_OF_OUTPUT_STATE_IDS];
+	output_state_info_t *info_by_id[OUTPUT_SID_LIMIT];
+	float states[NR_OF_OUTPUT_STATE_IDS][3];
+	/// Rate control of the original scan.
+	uint16_t rate_divider[OUTPUT_SID_LIMIT];
+	uint16_t rate_counter[OUTPUT_SID_LIMIT];
+	/// Rate control of the ordered list.
+	output_state_t list[OUTPUT_MAX_STATES];
+	uint8_t nr_of_states;
+	/// Transmission buffer.
+	uint8_t buffer[NR_OF_OUTPUT_STATE_IDS*sizeof(vec3)];
+} output_arg_t;
+
+/// Enables the first \a nr_of_states states of the table at divider 1 in both versions.
+static void output_init(output_arg_t *a, uint32_t nr_of_states){
+	memset(a,0,sizeof(output_arg_t));
+	for(uint32_t i=0; i<NR_OF_OUTPUT_STATE_IDS; i++){
+		output_state_info_t *info=&a->infos[i];
+		info->id=output_state_ids[i];
+		info->state_p=a->states[i];
+		info->state_size=sizeof(a->states[i]);
+		a->info_by_id[info->id]=info;
+		if(i<nr_of_states){
+			a->rate_divider[info->id]=1;
+			a->list[a->nr_of_states].info=info;
+			a->list[a->nr_of_states].rate_divider=1;
+			a->nr_of_states++;
+		}
+	}
+}
+
+/// The original assembly loop, scanning the whole state ID space.
+static void output_scan_body(void *arg){
+	output_arg_t *a=arg;
+	for(uint32_t k=0; k<OUTPUT_CALLS_PER_BATCH; k++){
+		uint8_t *write_position=a->buffer;
+		for(int i=0; i<OUTPUT_SID_LIMIT; i++){
+			if(a->rate_divider[i]){
+				if(a->rate_counter[i]==0){
+					a->rate_counter[i]=a->rate_divider[i];
+					memcpy(write_position,a->info_by_id[i]->state_p,a->info_by_id[i]->state_size);
+					write_position+=a->info_by_id[i]->state_size;
+				}
+				a->rate_counter[i]--;
+			}
+		}
+	}
+}
+
+/// The assembly loop over the ordered list of the output states.
+static void output_list_body(void *arg){
+	output_arg_t *a=arg;
+	for(uint32_t k=0; k<OUTPUT_CALLS_PER_BATCH; k++){
+		uint8_t *write_position=a->buffer;
+		for(output_state_t *state=a->list; state<a->list+a->nr_of_states; state++){
+			if(state->rate_counter==0){
+				state->rate_counter=state->rate_divider;
+				memcpy(write_position,state->info->state_p,state->info->state_size);
+				write_position+=state->info->state_size;
+			}
+			state->rate_counter--;
+		}
+	}
+}
+
+/// Output state benchmark cases.
+static const struct {
+	const char *name;
+	void (*body)(void *arg);
+} output_cases[] = {
+	{"output_states_scan",	output_scan_body},
+	{"output_states_list",	output_list_body},
+};
+
+#define NR_OF_OUTPUT_CASES (sizeof(output_cases)/sizeof(output_cases[0]))
+//@}
+
+/*! \brief Sets up the filters of the step benchmarks.
+
+	Each filter starts at its own offset into the session, such that the ZUPT instants of the filters do not
+	coincide. The filters are run through the initial alignment before the benchmarks.
+*/
+static int step_init(step_arg_t *a, const session_data_t *data, const nav_params_t *params, uint32_t nr_of_filters){
+	a->data=data;
+	a->nr_of_filters=nr_of_filters;
+	a->filters=malloc(nr_of_filters*sizeof(nav_filter_t));
+	a->sample=malloc(nr_of_filters*sizeof(uint32_t));
+	a->accelerations=malloc(nr_of_filters*sizeof(vec3));
+	a->angular_rates=malloc(nr_of_filters*sizeof(vec3));
+	if(!a->filters || !a->sample || !a->accelerations || !a->angular_rates || nav_batch_init(&a->batch,nr_of_filters,params)!=0)
+		return -1;
+
+	for(uint32_t i=0; i<nr_of_filters; i++){
+		nav_filter_init(&a->filters[i]);
+		a->filters[i].params=*params;
+	}
+	for(int pass=0; pass<2; pass++){
+		for(uint32_t i=0; i<nr_of_filters; i++)
+			a->sample[i]=(uint32_t)(((uint64_t)i*data->nr_of_samples)/nr_of_filters);
+		for(uint32_t k=0; k<2*(uint32_t)params->nr_of_inital_alignment_samples; k++){
+			if(pass==0)
+				step_scalar_body(a);
+			else
+				step_batch_body(a);
+		}
+	}
+	return 0;
+}
+
+static void step_free(step_arg_t *a){
+	free(a->filters);
+	free(a->sample);
+	free(a->accelerations);
+	free(a->angular_rates);
+	nav_batch_free(&a->batch);
+}
+
+/*! \brief Replays a session and takes snapshots of the filter context.
+
+	The session is replayed twice, first to count the samples and the ZUPT instants, then to take the snapshots
+	evenly spread over the session. The snapshots of the UD input sets are copies with the covariance factorized.
+*/
+static void take_snapshots(input_set_t *sets, const session_data_t *data, const nav_params_t *params, uint32_t max_snapshots){
+	nav_filter_t *filter=malloc(sizeof(nav_filter_t));
+	uint32_t stride[NR_OF_INPUT_SETS];
+
+	const float *const *ch=data->channels;
+
+	for(int pass=0; pass<2; pass++){
+		uint32_t n[NR_OF_INPUT_SETS]={0};
+
+		nav_filter_init(filter);
+		filter->params=*params;
+		for(uint32_t k=0; k<data->nr_of_samples; k++){
+			const vec3 acc={ch[IMU_REC_ACC_X][k],ch[IMU_REC_ACC_Y][k],ch[IMU_REC_ACC_Z][k]};
+			const vec3 gyro={ch[IMU_REC_GYRO_X][k],ch[IMU_REC_GYRO_Y][k],ch[IMU_REC_GYRO_Z][k]};
+
+			nav_update_imu_data_buffers(filter,acc,gyro);
+			if(filter->initialize_flag){
+				nav_initialize_navigation_algorithm(filter,acc);
+				continue;
+			}
+			nav_strapdown_mechanisation_equations(filter);
+			nav_time_up_data(filter);
+			nav_ZUPT_detector(filter);
+
+			for(int s=INPUT_ALL; s<=INPUT_ZUPT; s++){
+				if(s==INPUT_ZUPT && !filter->zupt)
+					continue;
+				if(pass==1 && n[s]%stride[s]==0 && sets[s].nr_of_snapshots<max_snapshots){
+					nav_filter_t *snapshot=&sets[s].snapshots[sets[s].nr_of_snapshots++];
+					*snapshot=*filter;
+					if(s==INPUT_ZUPT)
+						nav_gain_matrix(snapshot);
+				}
+				n[s]++;
+			}
+
+			nav_zupt_update(filter);
+		}
+
+		if(pass==0){
+			for(int s=INPUT_ALL; s<=INPUT_ZUPT; s++){
+				stride[s]=n[s]>max_snapshots ? n[s]/max_snapshots : 1;
+				sets[s].nr_of_snapshots=0;
+			}
+		}
+	}
+	free(filter);
+
+	// The UD factorization is done outside of the timed batches
+	for(int s=INPUT_ALL; s<=INPUT_ZUPT; s++){
+		input_set_t *ud=&sets[s==INPUT_ALL ? INPUT_ALL_UD : INPUT_ZUPT_UD];
+		ud->nr_of_snapshots=sets[s].nr_of_snapshots;
+		for(uint32_t i=0; i<ud->nr_of_snapshots; i++){
+			ud->snapshots[i]=sets[s].snapshots[i];
+			nav_covariance_to_UD(&ud->snapshots[i]);
+		}
+	}
+}
+
+static void usage(const char *prog){
+	nav_params_t params;
+	replay_default_params(&params);
+	fprintf(stderr,"Usage: %s [-n snapshots] [-f filters] [-t min_time] [-r repetitions] [-b filter] [-w window] [-s states] session\n"
+				   "  session          Directory holding a " SESSION_DATA_FILE " or " SESSION_BINARY_FILE " file, or the file itself.\n"
+				   "  -n snapshots     Number of filter snapshots of each input set (default: %u).\n"
+				   "  -f filters       Number of filters of the step benchmarks (default: %u).\n"
+				   "  -t min_time      Minimum time of each benchmark [s] (default: %.1f).\n"
+				   "  -r repetitions   Number of repetitions of each benchmark (default: %u).\n"
+				   "  -b filter        Only run the benchmarks whose name contains filter.\n"
+				   "  -w window        Window size of the zero-velocity detector (default: %u).\n"
+				   "  -s states        Number of enabled states of the output state benchmarks, at most %u (default: %u).\n",
+				   prog,BENCH_DEFAULT_SNAPSHOTS,BENCH_DEFAULT_FILTERS,BENCH_DEFAULT_MIN_TIME,BENCH_DEFAULT_REPETITIONS,
+				   params.detector_Window_size,(unsigned)NR_OF_OUTPUT_STATE_IDS,BENCH_DEFAULT_OUTPUT_STATES);
+}
+
+int main(int argc, char **argv){
+	uint32_t max_snapshots=BENCH_DEFAULT_SNAPSHOTS;
+	uint32_t nr_of_filters=BENCH_DEFAULT_FILTERS;
+	double min_time=BENCH_DEFAULT_MIN_TIME;
+	uint32_t repetitions=BENCH_DEFAULT_REPETITIONS;
+	const char *filter=NULL;
+	uint32_t window_size=0;
+	uint32_t nr_of_output_states=BENCH_DEFAULT_OUTPUT_STATES;
+	output_arg_t *output;
+	input_set_t sets[NR_OF_INPUT_SETS];
+	step_arg_t step;
+	session_data_t data;
+	nav_params_t params;
+	int opt;
+
+	while((opt=getopt(argc,argv,"n:f:t:r:b:w:s:h"))!=-1){
+		switch(opt){
+			case 'n':
+				max_snapshots=(uint32_t)strtoul(optarg,NULL,0);
+				break;
+			case 'f':
+				nr_of_filters=(uint32_t)strtoul(optarg,NULL,0);
+				break;
+			case 't':
+				min_time=atof(optarg);
+				break;
+			case 'r':
+				repetitions=(uint32_t)strtoul(optarg,NULL,0);
+				break;
+			case 'b':
+				filter=optarg;
+				break;
+			case 'w':
+				window_size=(uint32_t)strtoul(optarg,NULL,0);
+				if(window_size==0 || window_size>=UINT8_MAX){
+					fprintf(stderr,"Invalid window size %s\n",optarg);
+					return 1;
+				}
+				break;
+			case 's':
+				nr_of_output_states=(uint32_t)strtoul(optarg,NULL,0);
+				if(nr_of_output_states>NR_OF_OUTPUT_STATE_IDS){
+					fprintf(stderr,"Invalid number of output states %s\n",optarg);
+					return 1;
+				}
+				break;
+			default:
+				usage(argv[0]);
+				return opt=='h' ? 0 : 1;
+		}
+	}
+	if(optind!=argc-1 || max_snapshots==0 || nr_of_filters==0 || repetitions==0){
+		usage(argv[0]);
+		return 1;
+	}
+
+	if(session_load(&data,argv[optind])!=0)
+		return 1;
+
+	for(int s=0; s<NR_OF_INPUT_SETS; s++){
+		sets[s].snapshots=malloc(max_snapshots*sizeof(nav_filter_t));
+		sets[s].work=malloc(max_snapshots*sizeof(nav_filter_t));
+		sets[s].nr_of_snapshots=0;
+		if(!sets[s].snapshots || !sets[s].work){
+			fprintf(stderr,"Out of memory\n");
+			return 1;
+		}
+	}
+
+	replay_default_params(&params);
+	if(window_size)
+		params.detector_Window_size=(uint8_t)window_size;
+	take_snapshots(sets,&data,&params,max_snapshots);
+	output=malloc(sizeof(output_arg_t));
+	if(step_init(&step,&data,&params,nr_of_filters)!=0 || !output){
+		fprintf(stderr,"Out of memory\n");
+		return 1;
+	}
+
+	printf("Session:   %s (%u samples)\n",argv[optind],data.nr_of_samples);
+	printf("Snapshots: %u at all samples, %u at ZUPT instants\n",sets[INPUT_ALL].nr_of_snapshots,sets[INPUT_ZUPT].nr_of_snapshots);
+	printf("Filters:   %u in the step benchmarks, %u lanes per block\n",nr_of_filters,NAV_BATCH_LANES);
+	printf("Detector:  window of %u samples\n",params.detector_Window_size);
+	printf("Outputs:   %u states enabled in the output state benchmarks\n",nr_of_output_states);
+	printf("Kernel:    %s\n",NAV_KERNEL_NAME);
+	printf("Cycles:    %s\n\n",bench_has_cycle_counter() ? "time stamp counter (reference cycles)" : "not available");
+	bench_print_header(stdout);
+
+	for(size_t i=0; i<NR_OF_STAGE_CASES; i++){
+		const stage_case_t *c=&stage_cases[i];
+		stage_arg_t arg={c,&sets[c->input]};
+		bench_case_t bc={c->name,stage_prepare,stage_body,&arg,sets[c->input].nr_of_snapshots};
+		bench_result_t result;
+
+		if(filter && !strstr(c->name,filter))
+			continue;
+		if(sets[c->input].nr_of_snapshots==0){
+			printf("%-36s no inputs in the session\n",c->name);
+			continue;
+		}
+		bench_run(&result,&bc,min_time,repetitions);
+		bench_print_result(stdout,&result);
+	}
+
+	for(size_t i=0; i<NR_OF_STEP_CASES; i++){
+		bench_case_t bc={step_cases[i].name,NULL,step_cases[i].body,&step,nr_of_filters};
+		bench_result_t result;
+
+		if(filter && !strstr(bc.name,filter))
+			continue;
+		bench_run(&result,&bc,min_time,repetitions);
+		bench_print_result(stdout,&result);
+	}
+
+	output_init(output,nr_of_output_states);
+	for(size_t i=0; i<NR_OF_OUTPUT_CASES; i++){
+		bench_case_t bc={output_cases[i].name,NULL,output_cases[i].body,output,OUTPUT_CALLS_PER_BATCH};
+		bench_result_t result;
+
+		if(filter && !strstr(bc.name,filter))
+			continue;
+		bench_run(&result,&bc,min_time,repetitions);
+		bench_print_result(stdout,&result);
+	}
+
+	free(output);
+	step_free(&step);
+	for(int s=0; s<NR_OF_INPUT_SETS; s++){
+		free(sets[s].snapshots);
+		free(sets[s].work);
+	}
+	session_free(&data);
+	return 0;
+}
+
+//@}
@@ -18,55 +18,11 @@
 #include "nav_eq.h"
 
 
-// Constants
-extern precision latitude;						//Rough latitude of the system [degrees]. (Used to calculate the magnitude of the gravity vector)	
-extern precision altitude;						//Rough altitude of the system [m]. (Used to calculate the magnitude of the gravity vector)
-extern precision g;								//Gravity acceleration [m/s^2]
-extern precision dt;							//Sampling period [s]
-
-
-
-// Filter settings
-extern precision sigma_acceleration;						//Accelerometer process noise STD [m/s^2]
-extern precision sigma_gyroscope;							//Gyroscope process noise STD [rad/s]
-extern vec3 sigma_velocity;								//ZUPT measurement noise STD [m/s]
-extern vec3  sigma_initial_position;			      //STD of the initial position uncertainty [m]
-extern vec3  sigma_initial_velocity;		         //STD of the initial velocity uncertainty [m/s]
-extern vec3  sigma_initial_attitude;				//STD of the initial attitude uncertainty [rad]
-
-//Navigation states 
-extern vec3 position;					//Vector holding the position (North,East,Down) [m]
-extern vec3 velocity;					//Vector holding the velocity (North,East,Down) [m/s]
-extern quat_vec quaternions;			//Vector holding the attitude (quaternions)
-extern mat3 Rb2t;						//Rotation matrix used as an "aiding" variable in the filter algorithm 
-extern vec3 accelerations_out;				//Accelerations outputted from the IMU data buffer [m/s^2]	
-extern vec3 angular_rates_out;			    //Angular rates outputted from the IMU data buffer [rad/s]
+// The navigation algorithm parameters and states are held in the global filter context nav_filter (nav_eq.h)
 volatile vec3 accelerations_in;		//Accelerations read from the IMU [m/s^2]. These are written into the IMU data buffer.	
 volatile vec3 angular_rates_in;		//Angular rates read from the IMU [rad/s]. These are written into the IMU data buffer.
 
 
-//Filter state variables
-extern mat9sym cov_vector;				//Vector holding the error covariance in the filter.
-extern mat9by3 kalman_gain;			//Vector holding the Kalman filter gain
-extern mat3sym Re;						//Innovation covariance matrix
-extern mat3sym invRe;					//Inverse of the innovation covariance matrix
-
-// Initial navigation state settings  
-extern Bool initialize_flag;						//Flag controlling if the navigation algorithm should be initialized
-extern uint8_t nr_of_inital_alignment_samples;		      //Number of samples used in the initial alignment
-extern vec3 acceleration_mean;							//Mean acceleration vector, used in the initial alignment [m/s^2] 
-extern precision initial_heading;							//Initial attitude (roll,pitch,heading) [rad]
-extern vec3 initial_pos;							   //Initial position (North, East, Down) [m] 
-
-// ZUPT detector settings
-extern precision sigma_acc_det;							//Accelerometer noise STD used in the ZUPT detector [m/s^2]
-extern precision sigma_gyro_det;						//Gyroscope noise STD used in the ZUPT detector [rad/s] 	
-extern volatile uint8_t detector_Window_size;					//The data window size used in the ZUPT detector (OBS! Must be a odd number)
-extern precision detector_threshold;					//Threshold used int ZUPT detector
-extern Bool zupt;									//Flag that indicates if a zero-velocity update should be done.
-extern precision Test_statistics;					//Variable holding the test statistics for the likelihood test	
-
-
 
 //Accelerometer calibration variables
 extern vec3 accelerometer_biases;								//Vector holding the accelerometer biases (x,y,z-axis) [m/s^2]; 		
@@ -151,14 +107,14 @@ int main (void)
 		
 		// If the initialization flag is true run the initialization, else
 		// run the navigation algorithm. 
-		if(initialize_flag)
+		if(nav_filter.initialize_flag)
 		{	
 			
 			// Call the initialization function.	
 			initialize_navigation_algorithm();
 		
 			//Send the result of the initialization to Matlab
-			if(initialize_flag==false){
+			if(nav_filter.initialize_flag==false){
 				write_nav_data_to_matlab();
 				write_cov_vector_data_to_matlab();
 				write_zupt_flag_to_matlab();
@@ -200,7 +156,7 @@ int main (void)
 	
 		/****** MEASUREMENT UPDATE *******/
 		
-		if(zupt)
+		if(nav_filter.zupt)
 		{
 	
 			// Calculate the Kalman filter gain
@@ -287,21 +243,21 @@ void write_nav_data_to_matlab(void){
 	uint8_t data_ctr=0;
 	
 		// Position data
-	    for(data_ctr=0; data_ctr < (sizeof(position)/sizeof(precision));data_ctr++)
+	    for(data_ctr=0; data_ctr < (sizeof(nav_filter.position)/sizeof(precision));data_ctr++)
 		{
-		udi_cdc_write_buf((int*)(position+data_ctr),sizeof(precision));	  	
+		udi_cdc_write_buf((int*)(nav_filter.position+data_ctr),sizeof(precision));	  	
 		}
 		
 		// Velocity data
-	    for(data_ctr=0; data_ctr < (sizeof(velocity)/sizeof(precision));data_ctr++)
+	    for(data_ctr=0; data_ctr < (sizeof(nav_filter.velocity)/sizeof(precision));data_ctr++)
 		{
-		udi_cdc_write_buf((int*)(velocity+data_ctr),sizeof(precision));	  	
+		udi_cdc_write_buf((int*)(nav_filter.velocity+data_ctr),sizeof(precision));	  	
 		}
 		
 		// Quaternions data
-	    for(data_ctr=0; data_ctr <(sizeof(quaternions)/sizeof(precision));data_ctr++)
+	    for(data_ctr=0; data_ctr <(sizeof(nav_filter.quaternions)/sizeof(precision));data_ctr++)
 		{
-		udi_cdc_write_buf((int*)(quaternions+data_ctr),sizeof(precision));	  	
+		udi_cdc_write_buf((int*)(nav_filter.quaternions+data_ctr),sizeof(precision));	  	
 		}
 	
 }
@@ -310,9 +266,9 @@ void write_cov_vector_data_to_matlab(void){
 	uint8_t data_ctr=0;
 	
 		// Position data
-	    for(data_ctr=0; data_ctr <(sizeof(cov_vector)/sizeof(precision));data_ctr++)
+	    for(data_ctr=0; data_ctr <(sizeof(nav_filter.cov_vector)/sizeof(precision));data_ctr++)
 		{
-		udi_cdc_write_buf((int*)(cov_vector+data_ctr),sizeof(precision));	  	
+		udi_cdc_write_buf((int*)(nav_filter.cov_vector+data_ctr),sizeof(precision));	  	
 		}
 		
 }
@@ -344,26 +300,26 @@ udi_cdc_putc((int)sizeof(precision));
 /************* GENERAL PARAMETERS ******************/
 
 // Initial position [m]
-udi_cdc_read_buf((int*)(initial_pos),sizeof(initial_pos));       
+udi_cdc_read_buf((int*)(nav_filter.params.initial_pos),sizeof(nav_filter.params.initial_pos));       
 
 //Initial heading [rad] 
-udi_cdc_read_buf((int*)(&initial_heading),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.initial_heading),sizeof(precision));
 
 // Latitude [deg]
-udi_cdc_read_buf((int*)(&latitude),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.latitude),sizeof(precision));
 
 // Altitude [m]
-udi_cdc_read_buf((int*)(&altitude),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.altitude),sizeof(precision));
 
 //Sampling period [s]
-udi_cdc_read_buf((int*)(&dt),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.dt),sizeof(precision));
 
 
 	
 /************* ALIGNMENT PARAMETERS   **************/         
 
 //Number of samples used in the initial alignment 
-udi_cdc_read_buf((int*)(&nr_of_inital_alignment_samples),1);
+udi_cdc_read_buf((int*)(&nav_filter.params.nr_of_inital_alignment_samples),1);
 
 
 
@@ -371,46 +327,46 @@ udi_cdc_read_buf((int*)(&nr_of_inital_alignment_samples),1);
 /*********** Detector Settings ************/
 
 // Accelerometer noise std used in the ZUPT detector [m/s^2]
-udi_cdc_read_buf((int*)(&sigma_acc_det),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.sigma_acc_det),sizeof(precision));
 
 // Gyroscope noise std used in the ZUPT detector [rad/s]
-udi_cdc_read_buf((int*)(&sigma_gyro_det),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.sigma_gyro_det),sizeof(precision));
 
 // Window size used in the ZUPT detector [samples]
-udi_cdc_read_buf((int*)(&detector_Window_size),1);
+udi_cdc_read_buf((int*)(&nav_filter.params.detector_Window_size),1);
 
 // Threshold used in the ZUPT detector 
-udi_cdc_read_buf((int*)(&detector_threshold),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.detector_threshold),sizeof(precision));
 
 
 
 /************ FILTER PARAMETERS ************/
 
 // Accelerometer process noise std [m/s^2]
-udi_cdc_read_buf((int*)(&sigma_acceleration),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.sigma_acceleration),sizeof(precision));
 
 
 // Gyroscope process noise std [rad/s]
-udi_cdc_read_buf((int*)(&sigma_gyroscope),sizeof(precision));
+udi_cdc_read_buf((int*)(&nav_filter.params.sigma_gyroscope),sizeof(precision));
 
 
 // Zero velocity update pseudo measurement noise std [m/s] 
-udi_cdc_read_buf((int*)(sigma_velocity),sizeof(sigma_velocity));
+udi_cdc_read_buf((int*)(nav_filter.params.sigma_velocity),sizeof(nav_filter.params.sigma_velocity));
 
 
 // Initial position uncertainty (standard deviations) [m]  
-udi_cdc_read_buf((int*)(sigma_initial_position),sizeof(sigma_initial_position));
+udi_cdc_read_buf((int*)(nav_filter.params.sigma_initial_position),sizeof(nav_filter.params.sigma_initial_position));
 
 	
 // Initial velocity uncertainty (standard deviations) [m/s] 
-udi_cdc_read_buf((int*)(sigma_initial_velocity),sizeof(sigma_initial_velocity));
+udi_cdc_read_buf((int*)(nav_filter.params.sigma_initial_velocity),sizeof(nav_filter.params.sigma_initial_velocity));
 
 // Initial attitude uncertainty (standard deviations) [rad/s]  
-udi_cdc_read_buf((int*)(sigma_initial_attitude),sizeof(sigma_initial_attitude));
+udi_cdc_read_buf((int*)(nav_filter.params.sigma_initial_attitude),sizeof(nav_filter.params.sigma_initial_attitude));
 }
 
 void write_zupt_flag_to_matlab(void){
 	
 // write the state of the zupt_flag to matlab
-udi_cdc_write_buf((int*)(&zupt),1);	
+udi_cdc_write_buf((int*)(&nav_filter.zupt),1);	
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+%> @file
+%> @brief Matlab function decoding a dump of the flash log of raw IMU data.
+%>
+%> @details Without USB the OpenShoe system can log the raw burst read
+%> words of the IMU to its internal flash (command FLASH_LOGGING, 0x17
+%> divider). The command DUMP_FLASH_LOG (0x18) streams the log, after the
+%> ack, as a header ['L' 'G' number of pages (2)] followed by the pages of
+%> 512 bytes, oldest first. This function decodes the delta-encoded frames
+%> of the pages, see flash_log.c. Pages which are erased or have a bad
+%> checksum are skipped.
+%>
+%> @param dump      Bytes of the dump starting with the header, e.g. read
+%>                  with fread(com,4+512*N,'uint8').
+%> @return words    Raw words, 11xN, which can be converted with
+%>                  decode_raw_imu_data.m.
+%> @return counter  Interrupt counter of the frames, 1xN.
+%>
+%> 	\authors John-Olof Nilsson, Isaac Skog
+%>	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+
+%> @addtogroup os_matlab_scripts
+%> @{
+
+function [words, counter] = decode_flash_log(dump)
+
+PAGE_SIZE = 512;
+HEADER_BYTES = 12;
+NR_WORDS = 11;
+
+dump = double(dump(:));
+if dump(1)~=double('L') || dump(2)~=double('G')
+    error('Not a flash log dump');
+end
+nr_pages = 256*dump(3) + dump(4);
+
+words = zeros(NR_WORDS,0);
+counter = zeros(1,0);
+for page = 1:nr_pages
+    p = dump(4 + (page-1)*PAGE_SIZE + (1:PAGE_SIZE));
+    if all(p(1:4)==255)
+        continue;
+    end
+    ts = [2^24 2^16 2^8 1]*p(5:8);
+    nr_frames = 256*p(9) + p(10);
+    checksum = 256*p(11) + p(12);
+    
+    page_words = zeros(NR_WORDS,nr_frames);
+    page_counter = zeros(1,nr_frames);
+    w = zeros(NR_WORDS,1);
+    pos = HEADER_BYTES+1;
+    for frame = 1:nr_frames
+        [delta, pos] = read_varint(p,pos);
+        ts = ts + delta;
+        for i = 1:NR_WORDS
+            [zigzag, pos] = read_varint(p,pos);
+            % Undo the zigzag mapping and add the difference modulo 2^16
+            delta = (1-2*mod(zigzag,2))*floor((zigzag+1)/2);
+            w(i) = mod(w(i)+delta, 2^16);
+        end
+        page_words(:,frame) = w;
+        page_counter(frame) = ts;
+    end
+    if mod(sum(p(HEADER_BYTES+1:pos-1)),2^16)==checksum
+        words = [words page_words];
+        counter = [counter page_counter];
+    end
+end
+
+end
+
+% Reads a variable length number of 7 bits per byte, least significant first.
+function [value, pos] = read_varint(p,pos)
+value = 0;
+shift = 1;
+while p(pos)>=128
+    value = value + shift*(p(pos)-128);
+    shift = shift*128;
+    pos = pos+1;
+end
+value = value + shift*p(pos);
+pos = pos+1;
+end
+
+%> @}
@@ -0,0 +1,50 @@
+%> @file
+%> @brief Matlab function converting raw IMU data to SI units.
+%>
+%> @details In the raw IMU logging mode (command RAW_IMU_LOGGING,
+%> 0x14 divider) the OpenShoe system outputs the raw burst read words of
+%> the IMU (state 0x05) without converting them. This function does the
+%> conversion of imu_interface.c on the host: the status bits are shifted
+%> out and the words are scaled to SI units.
+%>
+%> @param words     Raw words, 11xN (supply, x/y/z gyro, x/y/z acc,
+%>                  x/y/z temperature, aux ADC), e.g. read with
+%>                  fread(file,[11 N],'uint16',0,'b').
+%> @return gyro     Angular rates [rad/s], 3xN.
+%> @return acc      Specific force [m/s^2], 3xN.
+%> @return temp     Temperatures [C], 3xN.
+%> @return supply   Supply voltage [V], 1xN.
+%> @return status   Status bits (two most significant bits) of the gyro and
+%>                  accelerometer words, 6xN.
+%>
+%> 	\authors John-Olof Nilsson, Isaac Skog
+%>	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+
+%> @addtogroup os_matlab_scripts
+%> @{
+
+function [gyro, acc, temp, supply, status] = decode_raw_imu_data(words)
+
+% Scaling of IMU raw data (imu_interface.c)
+SUPPLY_SCALE = 0.000151125;
+GYRO_SCALE = 0.00087266;
+ACC_SCALE = 0.0081643275;
+TEMP_SCALE = 0.0085;
+
+words = double(words);
+inertial = words(2:7,:);
+status = floor(inertial/2^14);
+% Shift out status bits, keeping the result as a 16-bit two's complement number
+inertial = mod(inertial*4, 2^16);
+inertial = inertial - 2^16*(inertial>=2^15);
+gyro = GYRO_SCALE*inertial(1:3,:);
+acc = ACC_SCALE*inertial(4:6,:);
+
+temp = mod(words(8:10,:)*16, 2^16);
+temp = temp - 2^16*(temp>=2^15);
+temp = TEMP_SCALE*temp + 25;
+supply = SUPPLY_SCALE*mod(words(1,:)*16, 2^16);
+
+end
+
+%> @}
@@ -0,0 +1,107 @@
+%> @file
+%> @brief Matlab function decoding a stream of state output frames.
+%>
+%> @details The state output of an interrupt is sent in one or more frames
+%> [0xAA][sequence number (2)][fragment][time stamp (4)][payload size]
+%> [payload][checksum (2)], big-endian, where the high and low nibbles of
+%> the fragment byte are the index of the frame and the number of frames of
+%> the output. The payload of an output holds the states which are output
+%> at that interrupt, in the order of their state IDs, each in the encoding
+%> given by its state output description (see
+%> decode_state_output_description.m). With different rate dividers, the
+%> outputs must be synchronized (commands ADD_SYNC_OUTPUT or SYNC_OUTPUT),
+%> such that the states of an output are those with a rate divider up to
+%> some value, which is found from the payload size. Bytes which are not
+%> part of a frame with a valid checksum, e.g. acks, are skipped.
+%>
+%> @param rx            Received bytes.
+%> @param descriptions  Struct array of the state output descriptions of
+%>                      the states which are output.
+%> @return outputs      Struct array with the fields sid, values (elements
+%>                      x outputs) and time_stamps (interrupt counter of
+%>                      the outputs), one per state which is output.
+%> @return lost_frames  Number of frames missing from the sequence numbers.
+%>
+%> 	\authors John-Olof Nilsson, Isaac Skog
+%>	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+
+%> @addtogroup os_matlab_scripts
+%> @{
+
+function [outputs, lost_frames] = decode_state_frames(rx, descriptions)
+
+FRAME_OVERHEAD = 11;
+
+% The states which are output, in the order of the payload
+descriptions = descriptions([descriptions.divider]>0);
+[~, order] = sort([descriptions.sid]);
+descriptions = descriptions(order);
+outputs = struct('sid', num2cell([descriptions.sid]), 'values', [], 'time_stamps', []);
+for k = 1:length(outputs)
+    outputs(k).values = zeros(0,0);
+    outputs(k).time_stamps = zeros(1,0);
+end
+
+rx = double(rx(:));
+lost_frames = 0;
+last_sequence_number = -1;
+payload = zeros(0,1);
+next_fragment = 0;
+i = 1;
+while i+FRAME_OVERHEAD-1<=length(rx)
+    nrb = FRAME_OVERHEAD + rx(i+8);
+    if rx(i)~=170 || i+nrb-1>length(rx) || ...
+       mod(sum(rx(i:i+nrb-3)),65536)~=256*rx(i+nrb-2)+rx(i+nrb-1)
+        i = i+1; % Not a frame, skip a byte
+        continue;
+    end
+    frame = rx(i:i+nrb-1);
+    i = i+nrb;
+    
+    sequence_number = 256*frame(2) + frame(3);
+    if last_sequence_number>=0
+        lost_frames = lost_frames + mod(sequence_number-last_sequence_number-1,65536);
+    end
+    last_sequence_number = sequence_number;
+    
+    % Collect the fragments of an output, an output with a lost fragment is dropped
+    fragment = floor(frame(4)/16);
+    nr_fragments = mod(frame(4),16);
+    if fragment==0
+        payload = zeros(0,1);
+        next_fragment = 0;
+    end
+    if fragment~=next_fragment
+        continue;
+    end
+    payload = [payload; frame(10:end-2)];
+    next_fragment = next_fragment+1;
+    if next_fragment<nr_fragments
+        continue;
+    end
+    time_stamp = [2^24 2^16 2^8 1]*frame(5:8);
+    
+    % The states of the output are those with a rate divider up to some value
+    output = [];
+    for divider = unique([descriptions.divider])
+        if sum([descriptions([descriptions.divider]<=divider).size])==length(payload)
+            output = find([descriptions.divider]<=divider);
+            break;
+        end
+    end
+    if isempty(output)
+        warning('Output at time stamp %d does not match the state output descriptions', time_stamp);
+        continue;
+    end
+    pos = 0;
+    for k = output
+        d = descriptions(k);
+        outputs(k).values(:,end+1) = decode_state_output(payload(pos+(1:d.size)), d.encoding, d.scale);
+        outputs(k).time_stamps(end+1) = time_stamp;
+        pos = pos+d.size;
+    end
+end
+
+end
+
+%> @}
@@ -0,0 +1,56 @@
+%> @file
+%> @brief Matlab function decoding a state output in any of the state
+%> output encodings.
+%>
+%> @details States made of floats can be output as 32-bit floats (raw),
+%> as fixed-point int16 or int32 values, or as half precision floats with
+%> the command OUTPUT_STATE_ENCODED (0x27 state_id divider encoding). This
+%> function converts the bytes of such a state output back to the values
+%> of its elements. The encoding and the scale factor of the fixed-point
+%> encodings are those of the state output description replied by the
+%> command, see decode_state_output_description.m.
+%>
+%> @param bytes     Bytes of the state in the frame payload.
+%> @param encoding  0 (raw), 1 (int16), 2 (int32), or 3 (half precision).
+%> @param scale     Scale factor of the fixed-point encodings.
+%> @return values   Values of the elements of the state (column vector).
+%>
+%> 	\authors John-Olof Nilsson, Isaac Skog
+%>	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+
+%> @addtogroup os_matlab_scripts
+%> @{
+
+function values = decode_state_output(bytes, encoding, scale)
+
+bytes = uint8(bytes(:));
+switch encoding
+    case 0
+        values = double(big_endian(bytes, 4, 'single'));
+    case 1
+        values = double(big_endian(bytes, 2, 'int16'))/scale;
+    case 2
+        values = double(big_endian(bytes, 4, 'int32'))/scale;
+    case 3
+        half = double(big_endian(bytes, 2, 'uint16'));
+        sign = 1 - 2*floor(half/32768);
+        exponent = mod(floor(half/1024), 32);
+        mantissa = mod(half, 1024);
+        values = sign.*(1 + mantissa/1024).*2.^(exponent-15);
+        subnormal = exponent==0;
+        values(subnormal) = sign(subnormal).*mantissa(subnormal)*2^-24;
+        special = exponent==31;
+        values(special & mantissa==0) = sign(special & mantissa==0)*Inf;
+        values(special & mantissa~=0) = NaN;
+    otherwise
+        error('Unknown state output encoding %d', encoding);
+end
+
+end
+
+% Converts big-endian bytes to values of the given type
+function values = big_endian(bytes, width, type)
+values = typecast(reshape(flipud(reshape(bytes, width, [])), [], 1), type);
+end
+
+%> @}
@@ -0,0 +1,39 @@
+%> @file
+%> @brief Matlab function decoding the state output description replied
+%> by the command OUTPUT_STATE_ENCODED.
+%>
+%> @details The command OUTPUT_STATE_ENCODED (0x27 state_id divider
+%> encoding) is answered by its ack followed by the description
+%> [0xA2][state ID][rate divider (2)][encoding][output size (2)]
+%> [scale factor (4)][checksum (2)] of the resulting output of the state,
+%> big-endian, where the scale factor is a 32-bit float. The descriptions
+%> of all states which are output are what decode_state_frames.m needs to
+%> decode the state output frames.
+%>
+%> @param reply         The 13 bytes of the description, e.g. read with
+%>                      fread(com,13,'uint8') after the 4 bytes of the ack.
+%> @return description  Struct with the fields sid, divider (0 if the state
+%>                      is not output), encoding, size (bytes in the
+%>                      payload) and scale.
+%>
+%> 	\authors John-Olof Nilsson, Isaac Skog
+%>	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+
+%> @addtogroup os_matlab_scripts
+%> @{
+
+function description = decode_state_output_description(reply)
+
+reply = double(reply(:));
+if length(reply)~=13 || reply(1)~=162 || mod(sum(reply(1:11)),65536)~=256*reply(12)+reply(13)
+    error('Not a valid state output description');
+end
+description.sid = reply(2);
+description.divider = 256*reply(3) + reply(4);
+description.encoding = reply(5);
+description.size = 256*reply(6) + reply(7);
+description.scale = double(typecast(uint8(flipud(reply(8:11))), 'single'));
+
+end
+
+%> @}
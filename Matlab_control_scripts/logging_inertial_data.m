@@ -27,9 +27,15 @@ fopen(com);
 % Open binary file for saving inertial data
 file = fopen('imu_data.bin', 'w');
 
-% Tell OpenShoe to output inertial data at every interrupt
-fwrite(com,[34 1 0 35],'uint8');
+% Tell OpenShoe to output the specific force (state ID 1) and the angular rate
+% (state ID 2) at every interrupt as floats (OUTPUT_STATE_ENCODED). The two
+% commands are sent together, such that their acks and the descriptions of
+% the outputs come before the output starts.
+fwrite(com,[39 1 1 0 0 41 39 2 1 0 0 42],'uint8');
 fread(com,4,'uint8');
+descriptions = decode_state_output_description(fread(com,13,'uint8'));
+fread(com,4,'uint8');
+descriptions(2) = decode_state_output_description(fread(com,13,'uint8'));
 
 % Open dummy figure with pushbutton such that logging can be aborted
 abort = 0;
@@ -56,25 +62,14 @@ fclose(file);
 
 % OPEN AND DISPLAY DATA
 file = fopen('imu_data.bin','r');
-
-% rx = fread(file,'uint8');
-% disp(rx')
-% fseek(file,0,'bof');
-
-nr_inertial = floor(nr_bytes/28);
-
-headers_and_plc = zeros(1,ceil(nr_inertial));
-inertial_data = zeros(6,ceil(nr_inertial));
-checksums = zeros(1,ceil(nr_inertial));
-i=1;
-while i<=nr_inertial
-    headers_and_plc(i) = fread(file,1,'uint16');
-    inertial_data(:,i) = fread(file,6,'float',0,'b');
-    checksums(i) = fread(file,1,'uint16');
-    i=i+1;
-end
+rx = fread(file,inf,'uint8');
 fclose(file);
 
+[outputs, lost_frames] = decode_state_frames(rx, descriptions);
+time_stamps = outputs(1).time_stamps;
+inertial_data = [outputs(1).values; outputs(2).values];
+disp(['Lost frames: ' num2str(lost_frames)]);
+
 figure(1);
 plot(inertial_data(1:3,:)');
 title('Accelerometer readings');
@@ -93,7 +88,7 @@ for i=1:32
 end
 fprintf(file,'\r\n');
 for i=1:size(inertial_data,2)
-    fprintf(file,'%x  %f %f %f  %f %f %f  %i %x  %i  %f %f %f  %f  %f %f %f\r\n',[0 inertial_data(:,i)' 0 0 0 0 0 0 0 0 0 0]);
+    fprintf(file,'%x  %f %f %f  %f %f %f  %i %x  %i  %f %f %f  %f  %f %f %f\r\n',[time_stamps(i) inertial_data(:,i)' 0 0 0 0 0 0 0 0 0 0]);
 end
 
 %> @}
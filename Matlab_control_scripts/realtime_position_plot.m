@@ -48,9 +48,18 @@ fread(com,4,'uint8'); % Read ack
 alt_flag = 0;
 nav_state = zeros(2,10);
 counter = 0;
+last_sequence_number = -1;
+lost_frames = 0;
 while abort_flag==0
-    if(com.BytesAvailable>47)
+    if(com.BytesAvailable>54)
         fread(com,1,'uint8'); % Header
+        sequence_number = fread(com,1,'uint16');
+        if(last_sequence_number>=0 && sequence_number~=mod(last_sequence_number+1,65536))
+            lost_frames = lost_frames + mod(sequence_number-last_sequence_number-1,65536);
+        end
+        last_sequence_number = sequence_number;
+        fread(com,1,'uint8'); % Fragment index and number of fragments
+        fread(com,1,'uint32'); % Time stamp
         fread(com,1,'uint8'); % Payload size
         nav_state(alt_flag+1,:) = fread(com,10,'float');
         fread(com,1,'uint32'); % Timer
@@ -68,6 +77,7 @@ end
 
 % Stop output
 fwrite(com,[33 0 33],'uint8');
+disp(['Lost frames: ' num2str(lost_frames)]);
 
 fclose(com);
 
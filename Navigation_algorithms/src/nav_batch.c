@@ -0,0 +1,269 @@
+/*! \file nav_batch.c
+	\brief The batched (multi-filter) version of the OpenShoe navigation algorithm.
+
+	\details The block functions are built from the same covariance expressions as nav_time_up_data(),
+	nav_gain_matrix() and nav_measurement_update() of nav_eq.c, see nav_cov_expressions.h, with the elements being
+	vectors of lanes instead of scalars.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup nav_batch
+//@{
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "nav_batch.h"
+#include "nav_cov_expressions.h"
+#include "nav_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+///\cond
+// The lane masks are bit masks of the same width as the elements.
+typedef char nav_batch_precision_check[sizeof(precision)==sizeof(int32_t) ? 1 : -1];
+///\endcond
+
+/// Selects the lanes of \a a where \a mask is set and the lanes of \a b elsewhere.
+static inline nav_lane_t lane_select(nav_lane_mask_t mask, nav_lane_t a, nav_lane_t b){
+	return (nav_lane_t)(((nav_lane_mask_t)a & mask) | ((nav_lane_mask_t)b & ~mask));
+}
+
+
+
+//******************* BLOCK FUNCTIONS ******************************//
+
+/*! \brief Time update of the covariance matrices of a block, see nav_time_up_data().
+
+	The update is done for all lanes. Lanes that have not finished the initial alignment are overwritten when they
+	do, and unused lanes of the last block are never read.
+ */
+static void block_time_up_data(nav_batch_block_t *block, const nav_params_t *params){
+
+	// Filter states and parameters
+	nav_lane_t *cov_vector=block->cov_vector;
+	const nav_lane_t *s=block->s;
+	const precision dt=params->dt;
+	const precision sigma_acceleration=params->sigma_acceleration;
+	const precision sigma_gyroscope=params->sigma_gyroscope;
+
+	//Working variables
+	uint8_t ctr=0;
+	precision dt2_sigma2_acc= (dt*dt)*(sigma_acceleration*sigma_acceleration);
+	precision dt2_sigma2_gyro=(dt*dt)*(sigma_gyroscope*sigma_gyroscope);
+	nav_lane_t ppvec[45];		//Temporary vectors holding the update covariances
+
+
+// Update the covariance matrices, see nav_cov_expressions.h
+NAV_TIME_UP_DATA_EXPRESSIONS(ppvec,cov_vector,s,dt,dt2_sigma2_acc,dt2_sigma2_gyro);
+
+
+// Copy the temporary vectors to the covariance vectors
+for(ctr=0;ctr<45;ctr++){
+cov_vector[ctr]=ppvec[ctr];
+}
+}
+
+
+
+/*! \brief Kalman gains of a block, see nav_gain_matrix().
+
+	The gains are calculated for all lanes, but are only meaningful in the lanes of the ZUPT mask.
+
+	 @param[in,out]	block		The block.
+	 @param[in]		params		Filter parameters.
+	 \return Mask of the lanes where the innovation covariance was close to singular.
+ */
+static nav_lane_mask_t block_gain_matrix(nav_batch_block_t *block, const nav_params_t *params){
+
+const nav_lane_t *cov_vector=block->cov_vector;
+nav_lane_t *kalman_gain=block->kalman_gain;
+const precision *sigma_velocity=params->sigma_velocity;
+nav_lane_t Re[6];			//Innovation matrix
+nav_lane_t invRe[6];		//Inverse of the innovation matrix
+
+
+/************ Calculate the Kalman filter innovation matrix *******************/
+Re[0]=cov_vector[24]+sigma_velocity[0]*sigma_velocity[0];
+Re[1]=cov_vector[25];
+Re[2]=cov_vector[26];
+Re[3]=cov_vector[30]+sigma_velocity[1]*sigma_velocity[1];
+Re[4]=cov_vector[31];
+Re[5]=cov_vector[35]+sigma_velocity[2]*sigma_velocity[2];
+
+/************ Calculate the inverse of the innovation matrix *********/
+nav_lane_t det=-Re[2]*(Re[2]*Re[3]) + 2*Re[1]*(Re[2]*Re[4]) - Re[0]*(Re[4]*Re[4]) - Re[1]*(Re[1]*Re[5]) + Re[0]*(Re[3]*Re[5]);
+nav_lane_t min_det=(precision)0.000001*(Re[0]*(Re[3]*Re[5]));	// Relative to the diagonal as in invmat3sys()
+nav_lane_mask_t error=(det<=min_det) & (det>=-min_det);
+
+invRe[0]=(Re[3]*Re[5]-Re[4]*Re[4])/det;
+invRe[1]=(Re[2]*Re[4]-Re[1]*Re[5])/det;
+invRe[2]=(Re[1]*Re[4]-Re[2]*Re[3])/det;
+invRe[3]=(Re[0]*Re[5]-Re[2]*Re[2])/det;
+invRe[4]=(Re[1]*Re[2]-Re[0]*Re[4])/det;
+invRe[5]=(Re[0]*Re[3]-Re[1]*Re[1])/det;
+
+/******************* Calculate the Kalman filter gain **************************/
+
+NAV_GAIN_MATRIX_EXPRESSIONS(kalman_gain,cov_vector,invRe);
+
+return error;
+}
+
+
+
+/*! \brief Measurement update of the covariance matrices of a block, see nav_measurement_update().
+
+	Only the lanes of the ZUPT mask are updated.
+ */
+static void block_measurement_update(nav_batch_block_t *block){
+
+nav_lane_t *cov_vector=block->cov_vector;
+const nav_lane_t *kalman_gain=block->kalman_gain;
+const nav_lane_mask_t zupt=block->zupt;
+uint8_t ctr=0;
+nav_lane_t ppvec[45];		//Temporary vectors holding the update covariances
+
+
+// Update the covariance matrices, see nav_cov_expressions.h
+NAV_MEASUREMENT_UPDATE_EXPRESSIONS(ppvec,cov_vector,kalman_gain);
+
+
+// Copy the temporary vectors to the covariance vectors of the updated lanes
+for(ctr=0;ctr<45;ctr++){
+cov_vector[ctr]=lane_select(zupt,ppvec[ctr],cov_vector[ctr]);
+}
+}
+
+
+
+//******************* BATCH FUNCTIONS ******************************//
+
+int nav_batch_init(nav_batch_t *batch, uint32_t nr_of_filters, const nav_params_t *params){
+	void *blocks;
+
+	batch->nr_of_filters=nr_of_filters;
+	batch->nr_of_blocks=(nr_of_filters+NAV_BATCH_LANES-1)/NAV_BATCH_LANES;
+	batch->filters=malloc(nr_of_filters*sizeof(nav_filter_t));
+	if(posix_memalign(&blocks,sizeof(nav_lane_t),batch->nr_of_blocks*sizeof(nav_batch_block_t))!=0)
+		blocks=NULL;
+	batch->blocks=blocks;
+	if(!batch->filters || !batch->blocks){
+		nav_batch_free(batch);
+		return -1;
+	}
+
+	memset(batch->blocks,0,batch->nr_of_blocks*sizeof(nav_batch_block_t));
+	for(uint32_t i=0; i<nr_of_filters; i++){
+		nav_filter_init(&batch->filters[i]);
+		batch->filters[i].params=*params;
+	}
+	return 0;
+}
+
+void nav_batch_free(nav_batch_t *batch){
+	free(batch->filters);
+	free(batch->blocks);
+	batch->filters=NULL;
+	batch->blocks=NULL;
+	batch->nr_of_filters=0;
+	batch->nr_of_blocks=0;
+}
+
+void nav_batch_reset_filter(nav_batch_t *batch, uint32_t filter){
+	nav_filter_t *f=&batch->filters[filter];
+	nav_batch_block_t *block=&batch->blocks[filter/NAV_BATCH_LANES];
+	nav_params_t params=f->params;
+
+	nav_filter_init(f);
+	f->params=params;
+	block->active[filter%NAV_BATCH_LANES]=0;
+}
+
+void nav_batch_step(nav_batch_t *batch, const vec3 *accelerations_in, const vec3 *angular_rates_in){
+
+	for(uint32_t b=0; b<batch->nr_of_blocks; b++){
+		nav_batch_block_t *block=&batch->blocks[b];
+		nav_filter_t *filters=&batch->filters[b*NAV_BATCH_LANES];
+		const nav_params_t *params=&filters[0].params;
+		uint32_t nr_of_lanes=batch->nr_of_filters-b*NAV_BATCH_LANES;
+		uint32_t aligned_lanes=0;
+		uint32_t zupt_lanes=0;
+		uint32_t lane;
+
+		if(nr_of_lanes>NAV_BATCH_LANES)
+			nr_of_lanes=NAV_BATCH_LANES;
+
+		// Per-filter stages, lane by lane
+		for(lane=0; lane<nr_of_lanes; lane++){
+			nav_filter_t *f=&filters[lane];
+			const precision *acc=accelerations_in[b*NAV_BATCH_LANES+lane];
+			vec3 s;
+
+			nav_update_imu_data_buffers(f,acc,angular_rates_in[b*NAV_BATCH_LANES+lane]);
+			if(f->initialize_flag){
+				nav_initialize_navigation_algorithm(f,acc);
+				if(!f->initialize_flag)
+					aligned_lanes|=1u<<lane;
+				block->zupt[lane]=0;
+				continue;
+			}
+			nav_strapdown_mechanisation_equations(f);
+
+			// Specific force in the n-frame, used by the time update
+			mat3_vec3_mul(s,f->Rb2t,f->accelerations_out);
+			block->s[0][lane]=s[0];
+			block->s[1][lane]=s[1];
+			block->s[2][lane]=s[2];
+
+			nav_ZUPT_detector(f);
+			block->zupt[lane]=f->zupt ? -1 : 0;
+			if(f->zupt)
+				zupt_lanes|=1u<<lane;
+		}
+
+		// Covariance stages, all lanes at once
+		block_time_up_data(block,params);
+
+		if(zupt_lanes){
+			nav_lane_mask_t error=block_gain_matrix(block,params);
+			block_measurement_update(block);
+
+			// Correct the navigation states of the filters where the detector fired
+			for(lane=0; lane<nr_of_lanes; lane++){
+				if(!(zupt_lanes&(1u<<lane)))
+					continue;
+				nav_filter_t *f=&filters[lane];
+				for(uint8_t i=0; i<27; i++)
+					f->kalman_gain[i]=block->kalman_gain[i][lane];
+				if(error[lane])
+					f->error_signal=MATRIX_INVERSION_ERROR;
+				nav_correct_navigation_states(f);
+			}
+		}
+
+		// Filters that finished the initial alignment at this sample enter the covariance stages at the next
+		for(lane=0; lane<nr_of_lanes; lane++){
+			if(!(aligned_lanes&(1u<<lane)))
+				continue;
+			for(uint8_t i=0; i<45; i++)
+				block->cov_vector[i][lane]=filters[lane].cov_vector[i];
+			block->active[lane]=-1;
+		}
+	}
+}
+
+void nav_batch_get_covariance(const nav_batch_t *batch, uint32_t filter, mat9sym cov_vector){
+	const nav_batch_block_t *block=&batch->blocks[filter/NAV_BATCH_LANES];
+	uint32_t lane=filter%NAV_BATCH_LANES;
+
+	if(!block->active[lane]){
+		memcpy(cov_vector,batch->filters[filter].cov_vector,sizeof(mat9sym));
+		return;
+	}
+	for(uint8_t i=0; i<45; i++)
+		cov_vector[i]=block->cov_vector[i][lane];
+}
+
+//@}
@@ -0,0 +1,125 @@
+/*! \file nav_batch.h
+	\brief Header file for the batched (multi-filter) version of the OpenShoe navigation algorithm.
+
+	\details The batched engine steps a number of independent ZUPT aided INS filters in lockstep, e.g. one filter per
+	shoe on a server hosting many users. All filters share the same parameters (sampling rate, noise figures,
+	detector settings) but have their own states and IMU data.
+
+	The filters are grouped in blocks of \ref NAV_BATCH_LANES filters. Within a block the covariance matrices, the
+	Kalman gains and the specific forces are stored in structure-of-arrays layout, i.e., each of the 45 packed
+	covariance elements is a vector with one lane per filter. The time update, the Kalman gain and the measurement
+	update are calculated with the same closed-form expressions as in nav_eq.c, but on whole vectors, such that the
+	compiler emits AVX-512 (16 lanes), AVX/AVX2 (8 lanes) or SSE (4 lanes) instructions. The measurement update is
+	masked, only lanes whose zero-velocity detector fired are updated. The strapdown mechanisation, the detector and
+	the correction of the navigation states have per-filter branches and transcendental functions; they are run lane
+	by lane with the scalar functions of nav_eq.c on the nav_filter_t of each filter.
+
+	Since only the covariance part is vectorized, the gain is far below the lane count. With 16 lanes (AVX-512) the
+	batch_step benchmark of Algorithm_benchmarks takes about 150-235 ns per filter and sample, against 270-390 ns for
+	filter_step, i.e., a gain of about 1.7x. The buffer update, the strapdown mechanisation and the detector, which
+	are run lane by lane, take some 115 ns per sample by themselves and bound the gain to about 2x.
+
+	The engine uses the GCC vector extensions and dynamic memory and is only intended for host builds, it is not
+	part of the firmware projects.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/** \defgroup nav_batch Batched filtering
+	\brief Lockstep processing of many filters in SIMD lanes.
+	\ingroup nav_eq
+	@{
+*/
+
+#ifndef NAV_BATCH_H_
+#define NAV_BATCH_H_
+
+#include "nav_eq.h"
+
+
+//************* Definitions *************//
+
+/// Number of filters per block, i.e., the number of lanes of the widest vector unit available.
+#if defined(__AVX512F__)
+	#define NAV_BATCH_LANES 16
+#elif defined(__AVX__)
+	#define NAV_BATCH_LANES 8
+#else
+	#define NAV_BATCH_LANES 4
+#endif
+
+/// Vector with one element per lane.
+typedef precision nav_lane_t __attribute__((vector_size(NAV_BATCH_LANES*sizeof(precision))));
+
+/// Lane mask, -1 (all bits set) in the lanes that are selected and 0 in the others.
+typedef int32_t nav_lane_mask_t __attribute__((vector_size(NAV_BATCH_LANES*sizeof(int32_t))));
+
+
+//************* Type definitions *************//
+
+/// Covariance related states of a block of \ref NAV_BATCH_LANES filters, one lane per filter.
+typedef struct {
+	/// Vector representation of the covariance matrices, see nav_filter_t::cov_vector.
+	nav_lane_t cov_vector[45];
+	/// Vector representation of the Kalman gains, see nav_filter_t::kalman_gain.
+	nav_lane_t kalman_gain[27];
+	/// Specific force in the n-frame of the current sample [\f$m/s^2\f$].
+	nav_lane_t s[3];
+	/// Lanes that have finished the initial alignment.
+	nav_lane_mask_t active;
+	/// Lanes where the zero-velocity detector fired at the current sample.
+	nav_lane_mask_t zupt;
+} nav_batch_block_t;
+
+/// Batch of filters stepped in lockstep.
+typedef struct {
+	/// Number of filters of the batch.
+	uint32_t nr_of_filters;
+	/// Number of blocks, i.e., nr_of_filters rounded up to a multiple of \ref NAV_BATCH_LANES, divided by the same.
+	uint32_t nr_of_blocks;
+	/*! Filter contexts holding the navigation states, the IMU data buffers and the detector states of the filters.
+		The covariance matrices and the Kalman gains of the contexts are only used during the initial alignment,
+		after that the covariances are held by the blocks. */
+	nav_filter_t *filters;
+	/// Covariance related states of the filters.
+	nav_batch_block_t *blocks;
+} nav_batch_t;
+
+
+//************* Function declarations *************//
+
+/*! \brief Allocates a batch of filters and starts the initial alignment of all of them.
+
+	 @param[out] batch			The batch.
+	 @param[in]	 nr_of_filters	Number of filters.
+	 @param[in]	 params			Parameters shared by all filters.
+	 \return Zero on success, otherwise -1 (out of memory).
+*/
+int nav_batch_init(nav_batch_t *batch, uint32_t nr_of_filters, const nav_params_t *params);
+
+/// Frees the memory of a batch.
+void nav_batch_free(nav_batch_t *batch);
+
+/// Restarts the initial alignment of one filter, e.g. when a new user connects.
+void nav_batch_reset_filter(nav_batch_t *batch, uint32_t filter);
+
+/*! \brief Processes one IMU sample of every filter of the batch.
+
+	Corresponds to calling nav_update_imu_data_buffers() and nav_initialize_navigation_algorithm() during the initial
+	alignment, and nav_update_imu_data_buffers(), nav_strapdown_mechanisation_equations(), nav_time_up_data(),
+	nav_ZUPT_detector() and nav_zupt_update() after it, for each filter. A matrix inversion error in the gain
+	calculation of a filter is signaled in nav_filter_t::error_signal of that filter.
+
+	 @param[in,out] batch				The batch.
+	 @param[in]		accelerations_in	Accelerations of each filter [\f$m/s^2\f$].
+	 @param[in]		angular_rates_in	Angular rates of each filter [\f$rad/s\f$].
+*/
+void nav_batch_step(nav_batch_t *batch, const vec3 *accelerations_in, const vec3 *angular_rates_in);
+
+/// Copies the covariance matrix of one filter to \a cov_vector.
+void nav_batch_get_covariance(const nav_batch_t *batch, uint32_t filter, mat9sym cov_vector);
+
+#endif /* NAV_BATCH_H_ */
+
+//@}
@@ -0,0 +1,200 @@
+/*! \file
+	\brief Closed-form covariance expressions of the OpenShoe navigation algorithm.
+
+	\details The expressions of the time update, the Kalman gain and the measurement update of the covariance matrix
+	are written out element by element for the vector representation of the upper triangle (#mat9sym), see
+	nav_time_up_data(), nav_gain_matrix() and nav_measurement_update(). They are kept here as macros such that the
+	scalar filter of nav_eq.c and the batched filter of nav_batch.c, where each element is a vector of lanes, are
+	built from the same expressions. The macros only use the arithmetic operators and indexing, so the arguments may
+	be of any type for which these are defined.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/** \addtogroup nav_eq
+	@{
+*/
+
+#ifndef NAV_COV_EXPRESSIONS_H_
+#define NAV_COV_EXPRESSIONS_H_
+
+
+/*! \brief Time update of the covariance matrix.
+
+	@param[out]	ppvec				Vector representation of the updated covariance matrix (45 elements).
+	@param[in]	cov_vector			Vector representation of the covariance matrix.
+	@param[in]	s					Specific force in the n-frame.
+	@param[in]	dt					Sampling period [s].
+	@param[in]	dt2_sigma2_acc		Process noise of the velocity states, \f$(dt\,\sigma_{acc})^2\f$.
+	@param[in]	dt2_sigma2_gyro		Process noise of the attitude states, \f$(dt\,\sigma_{gyro})^2\f$.
+ */
+
+#define NAV_TIME_UP_DATA_EXPRESSIONS(ppvec,cov_vector,s,dt,dt2_sigma2_acc,dt2_sigma2_gyro) \
+	/* First row of the covariance matrix */ \
+	ppvec[0]=cov_vector[0]+dt*(2*cov_vector[3] + dt*cov_vector[24]); \
+	ppvec[1]=cov_vector[1]+dt*(cov_vector[4]+cov_vector[11]+dt*cov_vector[25]); \
+	ppvec[2]=cov_vector[2]+dt*(cov_vector[5]+cov_vector[18]+dt*cov_vector[26]); \
+	ppvec[3]=cov_vector[3] + dt*(cov_vector[24]+cov_vector[8]*s[1]+cov_vector[29]*(s[1]*dt) - s[2]*(cov_vector[7]+cov_vector[28]*dt)); \
+	ppvec[4]=cov_vector[4]+dt*cov_vector[25]+ (s[2]*dt)*(cov_vector[6] + dt*cov_vector[27]) - (s[0]*dt)*(cov_vector[8] + dt*cov_vector[29]); \
+	ppvec[5]=cov_vector[5]+dt*(cov_vector[26]+cov_vector[7]*s[0]+cov_vector[28]*(s[0]*dt)-s[1]*(cov_vector[6]+cov_vector[27]*dt)); \
+	ppvec[6]=cov_vector[6] + cov_vector[27]*dt; \
+	ppvec[7]=cov_vector[7] + cov_vector[28]*dt; \
+	ppvec[8]=cov_vector[8]+cov_vector[29]*dt; \
+	/* Second row of the covariance matrix */ \
+	ppvec[9]=cov_vector[9] + dt*(2*cov_vector[12] + cov_vector[30]*dt); \
+	ppvec[10]=cov_vector[10] + dt*(cov_vector[13] + cov_vector[19] + cov_vector[31]*dt); \
+	ppvec[11]=cov_vector[11] + dt*(cov_vector[25] + cov_vector[16]*s[1] + cov_vector[34]*(s[1]*dt) - s[2]*(cov_vector[15]+cov_vector[33]*dt)); \
+	ppvec[12]=cov_vector[12] + cov_vector[30]*dt + s[2]*dt*(cov_vector[14] + cov_vector[32]*dt)-(s[0]*dt)*( cov_vector[16]+cov_vector[34]*dt ); \
+	ppvec[13]=cov_vector[13] + dt*(cov_vector[31] + cov_vector[15]*s[0] + cov_vector[33]*(s[0]*dt) -s[1]*(cov_vector[14] + cov_vector[32]*dt) ); \
+	ppvec[14]=cov_vector[14] + cov_vector[32]*dt; \
+	ppvec[15]=cov_vector[15] + cov_vector[33]*dt; \
+	ppvec[16]=cov_vector[16] + cov_vector[34]*dt; \
+	/* Third row of the covariance matrix */ \
+	ppvec[17]=cov_vector[17] + dt*(2*cov_vector[20]+cov_vector[35]*dt); \
+	ppvec[18]=cov_vector[18] + dt*(cov_vector[26] + cov_vector[23]*s[1] + cov_vector[38]*s[1]*dt - s[2]*(cov_vector[22] + cov_vector[37]*dt)); \
+	ppvec[19]=cov_vector[19] + cov_vector[31]*dt + s[2]*dt*(cov_vector[21] + cov_vector[36]*dt) - (s[0]*dt)*(cov_vector[23] + cov_vector[38]*dt); \
+	ppvec[20]=cov_vector[20] + dt*(cov_vector[35] + cov_vector[22]*s[0] + cov_vector[37]*(s[0]*dt) - s[1]*(cov_vector[21] + cov_vector[36]*dt)); \
+	ppvec[21]=cov_vector[21] + cov_vector[36]*dt; \
+	ppvec[22]=cov_vector[22]+cov_vector[37]*dt; \
+	ppvec[23]=cov_vector[23]+cov_vector[38]*dt; \
+	/* Forth row of the covariance matrix */ \
+	ppvec[24]=cov_vector[24] + dt*(2*(cov_vector[29]*s[1])+(cov_vector[44]*s[1])*(s[1]*dt) + s[2]*(-2*cov_vector[28] - (2*cov_vector[43])*(s[1]*dt)+cov_vector[42]*(s[2]*dt)))+dt2_sigma2_acc; \
+	ppvec[25]=cov_vector[25] + dt*(-cov_vector[29]*s[0] + cov_vector[34]*s[1] - (cov_vector[44]*s[0])*(s[1]*dt) + s[2]*(cov_vector[27]-cov_vector[33]+cov_vector[43]*(s[0]*dt) + cov_vector[41]*(s[1]*dt) - cov_vector[40]*(s[2]*dt))); \
+	ppvec[26]=cov_vector[26] + cov_vector[38]*(s[1]*dt) - cov_vector[37]*(s[2]*dt) - (s[1]*dt)*(cov_vector[27] + cov_vector[41]*(s[1]*dt) - cov_vector[40]*(s[2]*dt)) + (s[0]*dt)*(cov_vector[28]+cov_vector[43]*(s[1]*dt) - cov_vector[42]*(s[2]*dt)); \
+	ppvec[27]=cov_vector[27]+cov_vector[41]*(s[1]*dt) - cov_vector[40]*(s[2]*dt); \
+	ppvec[28]=cov_vector[28] + cov_vector[43]*(s[1]*dt) - cov_vector[42]*(s[2]*dt); \
+	ppvec[29]=cov_vector[29] + cov_vector[44]*(s[1]*dt) - cov_vector[43]*(s[2]*dt); \
+	/* Fifth row of the covariance matrix */ \
+	ppvec[30]=cov_vector[30]+dt*(-2*(cov_vector[34]*s[0])+(cov_vector[44]*s[0])*(s[0]*dt) + s[2]*(2*cov_vector[32]-(2*cov_vector[41])*(s[0]*dt)+cov_vector[39]*(s[2]*dt)))+dt2_sigma2_acc; \
+	ppvec[31]=cov_vector[31] - cov_vector[38]*(s[0]*dt) + cov_vector[36]*(s[2]*dt) - (s[1]*dt)*(cov_vector[32] - cov_vector[41]*(s[0]*dt) + cov_vector[39]*(s[2]*dt)) + (s[0]*dt)*(cov_vector[33]-cov_vector[43]*s[0]*dt+cov_vector[40]*(s[2]*dt)); \
+	ppvec[32]=cov_vector[32] - cov_vector[41]*s[0]*dt + cov_vector[39]*(s[2]*dt); \
+	ppvec[33]=cov_vector[33] - cov_vector[43]*s[0]*dt + cov_vector[40]*(s[2]*dt); \
+	ppvec[34]=cov_vector[34]-cov_vector[44]*(s[0]*dt)+cov_vector[41]*(s[2]*dt); \
+	/* Sixth row of the covariance matrix */ \
+	ppvec[35]=cov_vector[35]+dt*(2*(cov_vector[37]*s[0])+(cov_vector[42]*s[0])*(s[0]*dt)+s[1]*(-2*cov_vector[36]-2*cov_vector[40]*s[0]*dt+cov_vector[39]*s[1]*dt))+dt2_sigma2_acc; \
+	ppvec[36]=cov_vector[36] + cov_vector[40]*s[0]*dt - cov_vector[39]*s[1]*dt; \
+	ppvec[37]=cov_vector[37] + cov_vector[42]*s[0]*dt - cov_vector[40]*s[1]*dt; \
+	ppvec[38]=cov_vector[38] + cov_vector[43]*s[0]*dt - cov_vector[41]*s[1]*dt; \
+	/* Seventh row of the covariance matrix */ \
+	ppvec[39]=cov_vector[39]+dt2_sigma2_gyro; \
+	ppvec[40]=cov_vector[40]; \
+	ppvec[41]=cov_vector[41]; \
+	/* Eight row of the covariance matrix */ \
+	ppvec[42]=cov_vector[42]+dt2_sigma2_gyro; \
+	ppvec[43]=cov_vector[43]; \
+	/* Ninth row of the covariance matrix */ \
+	ppvec[44]=cov_vector[44]+dt2_sigma2_gyro;
+
+
+/*! \brief Kalman gain of the zero-velocity update.
+
+	@param[out]	kalman_gain			Vector representation of the Kalman gain (27 elements).
+	@param[in]	cov_vector			Vector representation of the covariance matrix.
+	@param[in]	invRe				Vector representation of the inverse of the innovation covariance.
+ */
+#define NAV_GAIN_MATRIX_EXPRESSIONS(kalman_gain,cov_vector,invRe) \
+	/* First row of the gain matrix */ \
+	kalman_gain[0]=cov_vector[3]*invRe[0] + cov_vector[4]*invRe[1] + cov_vector[5]*invRe[2]; \
+	kalman_gain[1]=cov_vector[3]*invRe[1] + cov_vector[4]*invRe[3] + cov_vector[5]*invRe[4]; \
+	kalman_gain[2]=cov_vector[3]*invRe[2] + cov_vector[4]*invRe[4] + cov_vector[5]*invRe[5]; \
+	/* Second row of the gain matrix */ \
+	kalman_gain[3]=cov_vector[11]*invRe[0] + cov_vector[12]*invRe[1] + cov_vector[13]*invRe[2]; \
+	kalman_gain[4]=cov_vector[11]*invRe[1] + cov_vector[12]*invRe[3] + cov_vector[13]*invRe[4]; \
+	kalman_gain[5]=cov_vector[11]*invRe[2] + cov_vector[12]*invRe[4] + cov_vector[13]*invRe[5]; \
+	/* Third row of the gain matrix */ \
+	kalman_gain[6]=cov_vector[18]*invRe[0] + cov_vector[19]*invRe[1] + cov_vector[20]*invRe[2]; \
+	kalman_gain[7]=cov_vector[18]*invRe[1] + cov_vector[19]*invRe[3] + cov_vector[20]*invRe[4]; \
+	kalman_gain[8]=cov_vector[18]*invRe[2] + cov_vector[19]*invRe[4] + cov_vector[20]*invRe[5]; \
+	/* Forth row of the gain matrix */ \
+	kalman_gain[9]=cov_vector[24]*invRe[0] + cov_vector[25]*invRe[1] + cov_vector[26]*invRe[2]; \
+	kalman_gain[10]=cov_vector[24]*invRe[1] + cov_vector[25]*invRe[3] + cov_vector[26]*invRe[4]; \
+	kalman_gain[11]=cov_vector[24]*invRe[2] + cov_vector[25]*invRe[4] + cov_vector[26]*invRe[5]; \
+	/* Fifth row of the gain matrix */ \
+	kalman_gain[12]=cov_vector[25]*invRe[0] + cov_vector[30]*invRe[1] + cov_vector[31]*invRe[2]; \
+	kalman_gain[13]=cov_vector[25]*invRe[1] + cov_vector[30]*invRe[3] + cov_vector[31]*invRe[4]; \
+	kalman_gain[14]=cov_vector[25]*invRe[2] + cov_vector[30]*invRe[4] + cov_vector[31]*invRe[5]; \
+	/* Sixth row of the gain matrix */ \
+	kalman_gain[15]=cov_vector[26]*invRe[0] + cov_vector[31]*invRe[1] + cov_vector[35]*invRe[2]; \
+	kalman_gain[16]=cov_vector[26]*invRe[1] + cov_vector[31]*invRe[3] + cov_vector[35]*invRe[4]; \
+	kalman_gain[17]=cov_vector[26]*invRe[2] + cov_vector[31]*invRe[4] + cov_vector[35]*invRe[5]; \
+	/* Seventh row of the gain matrix */ \
+	kalman_gain[18]=cov_vector[27]*invRe[0] + cov_vector[32]*invRe[1] + cov_vector[36]*invRe[2]; \
+	kalman_gain[19]=cov_vector[27]*invRe[1] + cov_vector[32]*invRe[3] + cov_vector[36]*invRe[4]; \
+	kalman_gain[20]=cov_vector[27]*invRe[2] + cov_vector[32]*invRe[4] + cov_vector[36]*invRe[5]; \
+	/* Eight row of the gain matrix */ \
+	kalman_gain[21]=cov_vector[28]*invRe[0] + cov_vector[33]*invRe[1] + cov_vector[37]*invRe[2]; \
+	kalman_gain[22]=cov_vector[28]*invRe[1] + cov_vector[33]*invRe[3] + cov_vector[37]*invRe[4]; \
+	kalman_gain[23]=cov_vector[28]*invRe[2] + cov_vector[33]*invRe[4] + cov_vector[37]*invRe[5]; \
+	/* Ninth row of the gain matrix */ \
+	kalman_gain[24]=cov_vector[29]*invRe[0] + cov_vector[34]*invRe[1] + cov_vector[38]*invRe[2]; \
+	kalman_gain[25]=cov_vector[29]*invRe[1] + cov_vector[34]*invRe[3] + cov_vector[38]*invRe[4]; \
+	kalman_gain[26]=cov_vector[29]*invRe[2] + cov_vector[34]*invRe[4] + cov_vector[38]*invRe[5];
+
+
+/*! \brief Measurement update of the covariance matrix for the zero-velocity update.
+
+	@param[out]	ppvec				Vector representation of the updated covariance matrix (45 elements).
+	@param[in]	cov_vector			Vector representation of the covariance matrix.
+	@param[in]	kalman_gain			Vector representation of the Kalman gain.
+ */
+#define NAV_MEASUREMENT_UPDATE_EXPRESSIONS(ppvec,cov_vector,kalman_gain) \
+	/* First row */ \
+	ppvec[0]=cov_vector[0] - kalman_gain[0]*cov_vector[3] - kalman_gain[1]*cov_vector[4] - kalman_gain[2]*cov_vector[5]; \
+	ppvec[1]=cov_vector[1] - kalman_gain[0]* cov_vector[11] - kalman_gain[1]* cov_vector[12] - kalman_gain[2]* cov_vector[13]; \
+	ppvec[2]=cov_vector[2]-kalman_gain[0]* cov_vector[18] - kalman_gain[1]* cov_vector[19] - kalman_gain[2]* cov_vector[20]; \
+	ppvec[3]=cov_vector[3]-kalman_gain[0]* cov_vector[24] - kalman_gain[1]* cov_vector[25] - kalman_gain[2]* cov_vector[26]; \
+	ppvec[4]=cov_vector[4]-kalman_gain[0]* cov_vector[25] - kalman_gain[1]* cov_vector[30] - kalman_gain[2]* cov_vector[31]; \
+	ppvec[5]=cov_vector[5]-kalman_gain[0]* cov_vector[26] - kalman_gain[1]* cov_vector[31] - kalman_gain[2]* cov_vector[35]; \
+	ppvec[6]=cov_vector[6]-kalman_gain[0]* cov_vector[27] - kalman_gain[1]* cov_vector[32] - kalman_gain[2]* cov_vector[36]; \
+	ppvec[7]=cov_vector[7]-kalman_gain[0]* cov_vector[28] - kalman_gain[1]* cov_vector[33] - kalman_gain[2]* cov_vector[37]; \
+	ppvec[8]=cov_vector[8]-kalman_gain[0]* cov_vector[29] - kalman_gain[1]* cov_vector[34] - kalman_gain[2]* cov_vector[38]; \
+	/* Second row */ \
+	ppvec[9]=cov_vector[9]-kalman_gain[3]* cov_vector[11] - kalman_gain[4]* cov_vector[12] - kalman_gain[5]* cov_vector[13]; \
+	ppvec[10]=cov_vector[10]-kalman_gain[3]* cov_vector[18] - kalman_gain[4]* cov_vector[19] - kalman_gain[5]* cov_vector[20]; \
+	ppvec[11]=cov_vector[11]-kalman_gain[3]* cov_vector[24] - kalman_gain[4]* cov_vector[25] - kalman_gain[5]* cov_vector[26]; \
+	ppvec[12]=cov_vector[12]-kalman_gain[3]* cov_vector[25] - kalman_gain[4]* cov_vector[30] - kalman_gain[5]* cov_vector[31]; \
+	ppvec[13]=cov_vector[13]-kalman_gain[3]* cov_vector[26] - kalman_gain[4]* cov_vector[31] - kalman_gain[5]* cov_vector[35]; \
+	ppvec[14]=cov_vector[14]-kalman_gain[3]* cov_vector[27] - kalman_gain[4]* cov_vector[32] - kalman_gain[5]* cov_vector[36]; \
+	ppvec[15]=cov_vector[15]-kalman_gain[3]* cov_vector[28] - kalman_gain[4]* cov_vector[33] - kalman_gain[5]* cov_vector[37]; \
+	ppvec[16]=cov_vector[16]-kalman_gain[3]* cov_vector[29] - kalman_gain[4]* cov_vector[34] - kalman_gain[5]* cov_vector[38]; \
+	/* Third row */ \
+	ppvec[17]=cov_vector[17]-kalman_gain[6]* cov_vector[18] - kalman_gain[7]* cov_vector[19] - kalman_gain[8]* cov_vector[20]; \
+	ppvec[18]=cov_vector[18]-kalman_gain[6]* cov_vector[24] - kalman_gain[7]* cov_vector[25] - kalman_gain[8]* cov_vector[26]; \
+	ppvec[19]=cov_vector[19]-kalman_gain[6]* cov_vector[25] - kalman_gain[7]* cov_vector[30] - kalman_gain[8]* cov_vector[31]; \
+	ppvec[20]=cov_vector[20]-kalman_gain[6]* cov_vector[26] - kalman_gain[7]* cov_vector[31] - kalman_gain[8]* cov_vector[35]; \
+	ppvec[21]=cov_vector[21]-kalman_gain[6]* cov_vector[27] - kalman_gain[7]* cov_vector[32] - kalman_gain[8]* cov_vector[36]; \
+	ppvec[22]=cov_vector[22]-kalman_gain[6]* cov_vector[28] - kalman_gain[7]* cov_vector[33] - kalman_gain[8]* cov_vector[37]; \
+	ppvec[23]=cov_vector[23]-kalman_gain[6]* cov_vector[29] - kalman_gain[7]* cov_vector[34] - kalman_gain[8]* cov_vector[38]; \
+	/* Forth row */ \
+	ppvec[24]=cov_vector[24]-kalman_gain[9]* cov_vector[24] - kalman_gain[10]* cov_vector[25] - kalman_gain[11]* cov_vector[26]; \
+	ppvec[25]=cov_vector[25]-kalman_gain[9]* cov_vector[25] - kalman_gain[10]* cov_vector[30] - kalman_gain[11]* cov_vector[31]; \
+	ppvec[26]=cov_vector[26]-kalman_gain[9]* cov_vector[26] - kalman_gain[10]* cov_vector[31] - kalman_gain[11]* cov_vector[35]; \
+	ppvec[27]=cov_vector[27]-kalman_gain[9]* cov_vector[27] - kalman_gain[10]* cov_vector[32] - kalman_gain[11]* cov_vector[36]; \
+	ppvec[28]=cov_vector[28]-kalman_gain[9]* cov_vector[28] - kalman_gain[10]* cov_vector[33] - kalman_gain[11]* cov_vector[37]; \
+	ppvec[29]=cov_vector[29]-kalman_gain[9]* cov_vector[29] - kalman_gain[10]* cov_vector[34] - kalman_gain[11]* cov_vector[38]; \
+	/* Fifth row */ \
+	ppvec[30]=cov_vector[30]-kalman_gain[12]* cov_vector[25] - kalman_gain[13]* cov_vector[30] - kalman_gain[14]* cov_vector[31]; \
+	ppvec[31]=cov_vector[31]-kalman_gain[12]* cov_vector[26] - kalman_gain[13]* cov_vector[31] - kalman_gain[14]* cov_vector[35]; \
+	ppvec[32]=cov_vector[32]-kalman_gain[12]* cov_vector[27] - kalman_gain[13]* cov_vector[32] - kalman_gain[14]* cov_vector[36]; \
+	ppvec[33]=cov_vector[33]-kalman_gain[12]* cov_vector[28] - kalman_gain[13]* cov_vector[33] - kalman_gain[14]* cov_vector[37]; \
+	ppvec[34]=cov_vector[34]-kalman_gain[12]* cov_vector[29] - kalman_gain[13]* cov_vector[34] - kalman_gain[14]* cov_vector[38]; \
+	/* Sixth row */ \
+	ppvec[35]=cov_vector[35]-kalman_gain[15]* cov_vector[26] - kalman_gain[16]* cov_vector[31] - kalman_gain[17]* cov_vector[35]; \
+	ppvec[36]=cov_vector[36]-kalman_gain[15]* cov_vector[27] - kalman_gain[16]* cov_vector[32] - kalman_gain[17]* cov_vector[36]; \
+	ppvec[37]=cov_vector[37]-kalman_gain[15]* cov_vector[28] - kalman_gain[16]* cov_vector[33] - kalman_gain[17]* cov_vector[37]; \
+	ppvec[38]=cov_vector[38]-kalman_gain[15]* cov_vector[29] - kalman_gain[16]* cov_vector[34] - kalman_gain[17]* cov_vector[38]; \
+	/* Seventh row */ \
+	ppvec[39]=cov_vector[39]-kalman_gain[18]* cov_vector[27] - kalman_gain[19]* cov_vector[32] - kalman_gain[20]* cov_vector[36]; \
+	ppvec[40]=cov_vector[40]-kalman_gain[18]* cov_vector[28] - kalman_gain[19]* cov_vector[33] - kalman_gain[20]* cov_vector[37]; \
+	ppvec[41]=cov_vector[41]-kalman_gain[18]* cov_vector[29] - kalman_gain[19]* cov_vector[34] - kalman_gain[20]* cov_vector[38]; \
+	/* Eight row */ \
+	ppvec[42]=cov_vector[42]-kalman_gain[21]* cov_vector[28] - kalman_gain[22]* cov_vector[33] - kalman_gain[23]* cov_vector[37]; \
+	ppvec[43]=cov_vector[43]-kalman_gain[21]* cov_vector[29] - kalman_gain[22]* cov_vector[34] - kalman_gain[23]* cov_vector[38]; \
+	/* Ninth row */ \
+	ppvec[44]=cov_vector[44]-kalman_gain[24]* cov_vector[29] - kalman_gain[25]* cov_vector[34] - kalman_gain[26]* cov_vector[38];
+
+
+#endif /* NAV_COV_EXPRESSIONS_H_ */
+
+//@}
@@ -14,6 +14,9 @@
 //@{
 
 #include "nav_eq.h"
+#include "nav_cov_expressions.h"
+#include "nav_kernels.h"
+#include <string.h>
 
 
 /*!
@@ -51,191 +54,60 @@ Bool acc_calibration_finished_flag=false;
 
 
 /*!
-\name General control parameters.   
+\name General variables.   
 
-  Parameters controlling general settings of the navigation algorithm     
+  Variables shared between the navigation algorithm and the rest of the system.     
   
 */ 
 //@{
-	
-/// Rough latitude of the system [\f$degrees\f$]. (Used to calculate the magnitude of the gravity vector)	
-precision latitude=13;
-
-/// Rough altitude of the system [\f$m\f$]. (Used to calculate the magnitude of the gravity vector)								
-precision altitude=920;
-
-/// Magnitude of the local gravity acceleration [\f$m/s^2\f$]								
-precision g=9.782940329221166;	
-
-/// Sampling period [\f$s\f$]					
-precision dt=0.001220703125000;
 
 /// Error signaling vector. If zero no error has occurred.						
 extern uint8_t error_signal;	
 
-//@}
-
-
-/*!
-\name IMU data buffer variables.   
-
-  Vectors and variables related to the IMU data buffer.    
-  
-*/ 
-//@{
-
-/// Buffer for the x-axis accelerometer readings.							
-static precision acc_buffer_x_axis[UINT8_MAX];		
-
-/// Buffer for the y-axis accelerometer readings.
-static precision acc_buffer_y_axis[UINT8_MAX];		
-
-/// Buffer for the z-axis accelerometer readings.
-static precision acc_buffer_z_axis[UINT8_MAX];		
-
-/// Buffer for the x-axis gyroscope readings.
-static precision gyro_buffer_x_axis[UINT8_MAX];	
-
-/// Buffer for the y-axis gyroscope readings.	
-static precision gyro_buffer_y_axis[UINT8_MAX];	
-
-/// Buffer for the z-axis gyroscope readings.
-static precision gyro_buffer_z_axis[UINT8_MAX];    
-
 /// Accelerations read from the IMU [\f$m/s^2\f$]. These are written into the IMU data buffer.
 extern vec3 accelerations_in;			
 
 /// Angular rates read from the IMU [\f$rad/s\f$]. These are written into the IMU data buffer.
 extern vec3 angular_rates_in;		
-
-/// Accelerations outputted from the IMU data buffer [\f$m/s^2\f$].
-vec3 accelerations_out;					
-
-/// Angular rates outputted from the IMU data buffer [\f$rad/s\f$].
-vec3 angular_rates_out;			    
-//@}
-
-
-
-/*!
-\name Initialization control parameters   
-
-  Parameters controlling the initialization of the navigation algorithm, 
-  i.e., the initial states of the inertial navigation system equations 
-  and the initial Kalman filter covariance matrix.    
-  
-  
-*/ 
-//@{
-/// A flag that should be set to true when initialization is started and that becomes false when the initialization is finished.    
-Bool initialize_flag=true;
-	
-/// Number of samples used in the initial alignment.
-uint8_t nr_of_inital_alignment_samples=16;//4;  
-
-/// Initial heading [\f$rad\f$]							
-precision initial_heading=0;					
-
-/// Initial position (North, East, Down) [\f$m\f$] 
-vec3 initial_pos = {0, 0, 0};
-	
-/// Standard deviations in the initial position uncertainties [\f$m\f$].                   
-vec3 sigma_initial_position ={0.00001,0.00001,0.00001};      
-
-/// Standard deviations in the initial velocity uncertainties [\f$m/s\f$].
-vec3 sigma_initial_velocity ={0.01,0.01,0.01};		
-
-/// Standard deviations in the initial attitude uncertainties [\f$rad\f$].			
-vec3 sigma_initial_attitude ={0.00174,0.00174,0.00174};		
 //@}
 
-						  
-
-
-
-
-/*!
-\name Kalman filter control parameters   
-
-  Parameters controlling the behavior of the Kalman filter. 
-  The parameters can be changed while the filter is running 
-  to adapt the filter to the current motion dynamics.
-  
-  \note The default noise standard deviation figures are not set to 
-  reflect the true noise figures of the IMU sensors, but 
-  rather to model the sum of all the errors (biases, 
-  scale factors, nonlinearities, etc.) in the system and 
-  the measurement model.           		
-
-*/ 
-//@{
-/// Accelerometer process noise standard deviation [\f$m/s^2\f$]
-precision sigma_acceleration=0.7;				
-
-/// Gyroscope process noise standard deviation [\f$rad/s\f$]
-precision sigma_gyroscope=0.005235987755983;
-
-/// Pseudo zero-velocity measurement noise standard deviations (north, east, down) [\f$m/s\f$]	
-vec3 sigma_velocity={0.1,0.1,0.1};					
-//@}
-
-
-
-
-/*!
-\name Navigation and filter state variables.   
-
-  Vectors that holds the current navigation state estimate and the covariance and gain of the Kalman filter.     
-  
-*/ 
-//@{
-///  Position estimate (North,East,Down) [\f$m\f$].
-vec3 position;
-
-/// Velocity estimate (North,East,Down) [\f$m/s\f$]						
-vec3 velocity;						
-
-/// Attitude (quaternions) estimate
-quat_vec quaternions;				
-
-/// Rotation matrix used as an "aiding" variable in the filter algorithm. Holds the same information as the quaternions. 
-mat3 Rb2t;							 
-
-/// Vector representation of the Kalman filter covariance matrix.
-mat9sym cov_vector;
-
-/// Vector representation of the Kalman filter gain matrix. 				
-mat9by3 kalman_gain;			
-//@}
 
 
 /*!
-\name Zero-velocity detector control parameters   
+\name Filter contexts.   
 
-  Parameters controlling the behavior of the zero-velocity detector. All the detector 
-  control parameters, except the \a detector_Window_size may be changed will the navigation algorithm is running in 
-  order to adapt the behavior of the detector to the current motion dynamics.   
+  Default parameters of the navigation algorithm and the global filter context that the void(void) functions 
+  operate on. The parameters and states of the filter are described in nav_params_t and nav_filter_t.    
   
 */ 
 //@{
 
-/// Accelerometer noise standard deviation figure [\f$m/s^2\f$], which is used to control how much the detector should trusts the accelerometer data.  
-precision sigma_acc_det=0.035;//0.01;
-
-/// Gyroscope noise standard deviation figure [\f$rad/s\f$], which is used to control how much the detector should trusts the gyroscope data.  				
-precision sigma_gyro_det=0.006;//0.001745329251994;			
-
-/// The data window size used in the detector (OBS! Must be an odd number.).
-volatile uint8_t detector_Window_size=3;					
-
-/// Threshold used in the detector.
-precision detector_threshold=50000;
-
-/// Flag that is set to true if a zero-velocity update should be done.			
-bool zupt=false;								
-
-///Variable holding the test statistics for the generalized likelihood ratio test, i.e., the zero-velocity detector.	
-precision Test_statistics=0;					
+/// Initializer holding the default parameters of the navigation algorithm.
+#define NAV_DEFAULT_PARAMS { \
+	.latitude=13, \
+	.altitude=920, \
+	.g=9.782940329221166, \
+	.dt=0.001220703125000, \
+	.nr_of_inital_alignment_samples=16, \
+	.initial_heading=0, \
+	.initial_pos={0, 0, 0}, \
+	.sigma_initial_position={0.00001,0.00001,0.00001}, \
+	.sigma_initial_velocity={0.01,0.01,0.01}, \
+	.sigma_initial_attitude={0.00174,0.00174,0.00174}, \
+	.sigma_acceleration=0.7, \
+	.sigma_gyroscope=0.005235987755983, \
+	.sigma_velocity={0.1,0.1,0.1}, \
+	.sigma_acc_det=0.035, \
+	.sigma_gyro_det=0.006, \
+	.detector_Window_size=3, \
+	.detector_threshold=50000, \
+	.detector_threshold_MV=35, \
+	.detector_threshold_MAG=1500, \
+	.detector_threshold_ARE=35000 }
+
+const nav_params_t nav_default_params = NAV_DEFAULT_PARAMS;
+
+nav_filter_t nav_filter = { .params=NAV_DEFAULT_PARAMS, .initialize_flag=true };
 //@}
 
 
@@ -250,72 +122,21 @@ precision Test_statistics=0;
 	@{
 */
 
-/*! \brief Function for calculating the square root. 
-	
-
-	\details Function for calculating the square root using the hardware multipliers if the precision used is float, 
-	otherwise use the standard square root function.  
- */   
-inline precision sqrt_hf(precision arg){
-	
-	
-	if(sizeof(precision)==4)
-	{
-	float tmp1, tmp2, tmp3;
-	__asm__ __volatile__ ( "frsqrta.s %0, %1" : "=r" (tmp3) : "r" (arg));
-	tmp1 = tmp3*tmp3;
-	tmp2 = 3.0f - tmp1*arg;
-	tmp3 = 0.5f * (tmp2 * tmp3);
-	tmp1 = tmp3*tmp3;
-	tmp2 = 3.0f - tmp1*arg;
-	tmp3 = 0.5f * (tmp2 * tmp3);
-	tmp1 = tmp3*tmp3;
-	tmp2 = 3.0f - tmp1*arg;
-	tmp3 = 0.5f * (tmp2 * tmp3);
-	return tmp3*arg;
-	}
-	else
-	{
-	return sqrt(arg);			
-	}	
-	
-}
-
-
-/*! \brief Function that calculates the squared Euclidean norm of a vector.
-	
-	 @param[out] norm2				The squared Euclidean norm of the input vector. 
-	 @param[in] arg_vec				The input vectors 
-	 @param[in] len					The length of the input vector.
- */ 
-inline precision vecnorm2(precision *arg_vec, uint8_t len)
-{
-precision norm2=0;
-uint8_t ctr;
-
-	for (ctr=0; ctr<len; ctr++){
-	norm2=norm2+arg_vec[ctr]*arg_vec[ctr];
-	}
-
-return norm2;	
-} 
-
-
 /*! \brief Function that converts Euler angles ([roll,pitch,yaw]) into a rotation matrix \f$R_b^t\f$.
 	
 	 @param[out] rotmat				Vector representation of the rotation matrix. 
 	 @param[in] euler				Vector of euler angles.
  */    
-inline void euler2rotation(mat3 rotmat, const vec3 euler){
+static inline void euler2rotation(mat3 rotmat, const vec3 euler){
 
 
 // Trigonometric value variables	
-precision sin_phi = sin(euler[0]);
-precision cos_phi = cos(euler[0]);
-precision sin_theta =sin(euler[1]);
-precision cos_theta =cos(euler[1]);
-precision sin_psi = sin(euler[2]);
-precision cos_psi = cos(euler[2]);
+precision sin_phi = sin_hf(euler[0]);
+precision cos_phi = cos_hf(euler[0]);
+precision sin_theta =sin_hf(euler[1]);
+precision cos_theta =cos_hf(euler[1]);
+precision sin_psi = sin_hf(euler[2]);
+precision cos_psi = cos_hf(euler[2]);
 
 
 
@@ -337,7 +158,7 @@ rotmat[8]=cos_theta*cos_phi;								//Matrix element [3,3]
 	 @param[out] q					Vector of quaternions. 
 	 @param[in] rotmat				Vector of representation of the rotation matrix.
  */    
-inline void rotation2quat(quat_vec q,const mat3 rotmat){
+static inline void rotation2quat(quat_vec q,const mat3 rotmat){
 	
 	// For checking robustness of DCM, diagonal elements
 	precision T = 1 + rotmat[0] + rotmat[4]+rotmat[8];  // 1+diag(R)
@@ -392,7 +213,7 @@ inline void rotation2quat(quat_vec q,const mat3 rotmat){
 	 @param[in] q					Vector of quaternions. 
 	 
  */   
-inline void quat2rotation(mat3 rotmat,const quat_vec q){
+static inline void quat2rotation(mat3 rotmat,const quat_vec q){
 
 precision p[6];
 
@@ -446,13 +267,13 @@ rotmat[7]=p[5]+p[4];			//R(3,2)=p(6)+p(5);
 	@param[out] euler				Vector of euler angles.
 	@param[in] rotmat				Vector of representation of the rotation matrix.		 
  */	 
-inline void  rotation2euler(vec3 euler, const mat3 rotmat){
+static inline void  rotation2euler(vec3 euler, const mat3 rotmat){
 	
 
 	// Compute Euler angles [WARNING! check atan2]
-	euler[0] = atan2(rotmat[7],rotmat[8]);	//atan2( R(3,2), R(3,3) );
-	euler[1] = asin(-rotmat[6]);			//asin( -R(3,1) );
-	euler[2] = -atan2(rotmat[3],rotmat[0]);	//atan2( R(2,1), R(1,1));
+	euler[0] = atan2_hf(rotmat[7],rotmat[8]);	//atan2( R(3,2), R(3,3) );
+	euler[1] = asin_hf(-rotmat[6]);			//asin( -R(3,1) );
+	euler[2] = -atan2_hf(rotmat[3],rotmat[0]);	//atan2( R(2,1), R(1,1));
 }
 
 
@@ -462,9 +283,9 @@ inline void  rotation2euler(vec3 euler, const mat3 rotmat){
 	
 	@param[out] re		Vector representation of the innovation covariance matrix.
 	@param[in] pvec		Vector representation of the Kalman filter covariance matrix.
-	@param[in] sigma	Vector representation of pseudo zero-velocity measurement noise standard deviations.		 
+	@param[in] sigma_velocity	Vector representation of pseudo zero-velocity measurement noise standard deviations.		 
  */	
-inline void innovation_cov(mat3sym re,mat9sym pvec){
+static inline void innovation_cov(mat3sym re,const mat9sym pvec,const vec3 sigma_velocity){
 
 
 
@@ -482,20 +303,25 @@ re[5]=pvec[35]+sigma_velocity[2]*sigma_velocity[2];
 
 /*! \brief Function for inverting a 3 by 3 matrix hermitian matrix.
 	
+	\details The matrix is considered singular if its determinant is small relative to the product of its diagonal
+	elements, which is the determinant of the matrix scaled to a unit diagonal. Hence the check does not depend on
+	the units or the magnitude of the matrix, e.g. of the innovation covariance for small measurement noise.
+	
 	@param[out] ainv		Vector representation of the inverted matrix.
-	@param[out] error		Error signaling vector.
+	@param[out] error		Error signaling variable.
 	@param[in]	a			Vector representation of the matrix to be inverted.		 
  */	
-inline void invmat3sys(mat3sym ainv, mat3sym a){
+static inline void invmat3sys(mat3sym ainv, uint8_t *error, const mat3sym a){
 
 
 // Calculate the determinant of matrix  
 precision det=-a[2]*(a[2]*a[3]) + 2*a[1]*(a[2]*a[4]) - a[0]*(a[4]*a[4]) - a[1]*(a[1]*a[5]) + a[0]*(a[3]*a[5]);
 
-	// Check the size of the determinant and send a error message if it is to small. 
-	if(absf(det)<0.0000001)
+	// Check the size of the determinant relative to the diagonal and send a error message if it is to small. 
+	precision diag=a[0]*(a[3]*a[5]);
+	if(absf(det)<=0.000001*absf(diag))
 	{
-		error_signal=MATRIX_INVERSION_ERROR;
+		*error=MATRIX_INVERSION_ERROR;
 	}
 
 
@@ -510,24 +336,159 @@ ainv[5]=(a[0]*a[3]-a[1]*a[1])/det;
 
 
 
+/// Index of the first element of each row of a #mat9sym, i.e., the vector representation of the upper triangle.
+static const uint8_t mat9sym_row[9]={0,9,17,24,30,35,39,42,44};
+
+/// Index of element [i,j], i<=j, of a #mat9sym.
+#define MAT9SYM_INDEX(i,j) (mat9sym_row[i]+(j)-(i))
+
+
+
+
+/*! \brief Function that recalculates the running sums of the zero-velocity detector from the IMU data buffers.
+
+	The reference point of the acceleration sums is set to the mean acceleration of the window. 
+	
+	@param[in,out] filter		The filter context.
+ */
+static void detector_sums_reset(nav_filter_t *filter){
+
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+nav_detector_sums_t *sums=&filter->detector_sums;
+uint8_t ctr;
+vec3 d;
+
+sums->acc_ref[0]=0;
+sums->acc_ref[1]=0;
+sums->acc_ref[2]=0;
+for(ctr=0; ctr<detector_Window_size; ctr++){
+	sums->acc_ref[0]=sums->acc_ref[0]+filter->acc_buffer_x_axis[ctr];
+	sums->acc_ref[1]=sums->acc_ref[1]+filter->acc_buffer_y_axis[ctr];
+	sums->acc_ref[2]=sums->acc_ref[2]+filter->acc_buffer_z_axis[ctr];
+}
+sums->acc_ref[0]=sums->acc_ref[0]/detector_Window_size;
+sums->acc_ref[1]=sums->acc_ref[1]/detector_Window_size;
+sums->acc_ref[2]=sums->acc_ref[2]/detector_Window_size;
+
+sums->acc_sum[0]=0;
+sums->acc_sum[1]=0;
+sums->acc_sum[2]=0;
+sums->acc_sum2=0;
+sums->gyro_sum2=0;
+for(ctr=0; ctr<detector_Window_size; ctr++){
+	d[0]=filter->acc_buffer_x_axis[ctr]-sums->acc_ref[0];
+	d[1]=filter->acc_buffer_y_axis[ctr]-sums->acc_ref[1];
+	d[2]=filter->acc_buffer_z_axis[ctr]-sums->acc_ref[2];
+	sums->acc_sum[0]=sums->acc_sum[0]+d[0];
+	sums->acc_sum[1]=sums->acc_sum[1]+d[1];
+	sums->acc_sum[2]=sums->acc_sum[2]+d[2];
+	sums->acc_sum2=sums->acc_sum2+vecnorm2(d,3);
+	d[0]=filter->gyro_buffer_x_axis[ctr];
+	d[1]=filter->gyro_buffer_y_axis[ctr];
+	d[2]=filter->gyro_buffer_z_axis[ctr];
+	sums->gyro_sum2=sums->gyro_sum2+vecnorm2(d,3);
+}
+
+filter->detector_next_count=0;
+filter->detector_sums_window=detector_Window_size;
+}
+
+
+
+
+/*! \brief Function that adds a sample to the running sums of the zero-velocity detector.
+
+	The sample replaces the oldest sample of the window, which is still held in the IMU data buffers at 
+	\a in_data_buffer_index. In parallel, new sums are accumulated from scratch with the current mean acceleration 
+	as reference point. When they cover a full window they replace the running sums, such that the rounding errors 
+	of the running sums do not grow over time and the reference point follows the data.
+	
+	@param[in,out] filter				The filter context.
+	@param[in] in_data_buffer_index		The index of the IMU data buffers that the sample will be written to.
+	@param[in] accelerations_in			The acceleration sample.
+	@param[in] angular_rates_in			The angular rate sample.
+ */
+static inline void detector_sums_update(nav_filter_t *filter, uint8_t in_data_buffer_index, const vec3 accelerations_in, const vec3 angular_rates_in){
+
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+nav_detector_sums_t *sums=&filter->detector_sums;
+nav_detector_sums_t *next_sums=&filter->detector_next_sums;
+vec3 d_new;
+vec3 d_old;
+
+// The sums are recalculated if the window size has been changed.
+if(filter->detector_sums_window!=detector_Window_size){
+	detector_sums_reset(filter);
+}
+
+// Start new sums with the current mean acceleration as the reference point.
+if(filter->detector_next_count==0){
+	next_sums->acc_ref[0]=sums->acc_ref[0]+sums->acc_sum[0]/detector_Window_size;
+	next_sums->acc_ref[1]=sums->acc_ref[1]+sums->acc_sum[1]/detector_Window_size;
+	next_sums->acc_ref[2]=sums->acc_ref[2]+sums->acc_sum[2]/detector_Window_size;
+	next_sums->acc_sum[0]=0;
+	next_sums->acc_sum[1]=0;
+	next_sums->acc_sum[2]=0;
+	next_sums->acc_sum2=0;
+	next_sums->gyro_sum2=0;
+}
+
+// Replace the oldest sample by the new one in the running sums.
+d_new[0]=accelerations_in[0]-sums->acc_ref[0];
+d_new[1]=accelerations_in[1]-sums->acc_ref[1];
+d_new[2]=accelerations_in[2]-sums->acc_ref[2];
+d_old[0]=filter->acc_buffer_x_axis[in_data_buffer_index]-sums->acc_ref[0];
+d_old[1]=filter->acc_buffer_y_axis[in_data_buffer_index]-sums->acc_ref[1];
+d_old[2]=filter->acc_buffer_z_axis[in_data_buffer_index]-sums->acc_ref[2];
+sums->acc_sum[0]=sums->acc_sum[0]+d_new[0]-d_old[0];
+sums->acc_sum[1]=sums->acc_sum[1]+d_new[1]-d_old[1];
+sums->acc_sum[2]=sums->acc_sum[2]+d_new[2]-d_old[2];
+sums->acc_sum2=sums->acc_sum2+vecnorm2(d_new,3)-vecnorm2(d_old,3);
+d_old[0]=filter->gyro_buffer_x_axis[in_data_buffer_index];
+d_old[1]=filter->gyro_buffer_y_axis[in_data_buffer_index];
+d_old[2]=filter->gyro_buffer_z_axis[in_data_buffer_index];
+sums->gyro_sum2=sums->gyro_sum2+vecnorm2(angular_rates_in,3)-vecnorm2(d_old,3);
+
+// Add the new sample to the new sums.
+d_new[0]=accelerations_in[0]-next_sums->acc_ref[0];
+d_new[1]=accelerations_in[1]-next_sums->acc_ref[1];
+d_new[2]=accelerations_in[2]-next_sums->acc_ref[2];
+next_sums->acc_sum[0]=next_sums->acc_sum[0]+d_new[0];
+next_sums->acc_sum[1]=next_sums->acc_sum[1]+d_new[1];
+next_sums->acc_sum[2]=next_sums->acc_sum[2]+d_new[2];
+next_sums->acc_sum2=next_sums->acc_sum2+vecnorm2(d_new,3);
+next_sums->gyro_sum2=next_sums->gyro_sum2+vecnorm2(angular_rates_in,3);
+filter->detector_next_count=filter->detector_next_count+1;
+
+// When the new sums cover a full window, they replace the running sums. 
+if(filter->detector_next_count==detector_Window_size){
+	*sums=*next_sums;
+	filter->detector_next_count=0;
+}
+}
+
+
+
+
 /*! \brief	Function that calculates the maximum value of a vector and returns 
 			the max value and the index of the vector element holding the maximum value.  
 	
 	@param[out] max_v		Largest value of the input vector.
 	@param[out] index		Index of the vector element holding the largest value. 
 	@param[in]	arg_vec		The input vector.		 
+	@param[in]	length		Number of elements of the input vector.
  */	
-inline void max_value(precision *max_v,uint8_t *index, precision *arg_vec){
+static inline void max_value(precision *max_v,uint8_t *index, const precision *arg_vec, uint8_t length){
 
 // Set the initial max value and vector element index
 *max_v=arg_vec[0];
 *index=0;
 
 //Iterate through the vector
-	for(uint8_t ctr=1;ctr<(sizeof(arg_vec)/sizeof(arg_vec[0]));ctr++)
+	for(uint8_t ctr=1;ctr<length;ctr++)
 	{
-		//If the current element of the vector is larger than the previous element, update the max value and the index.
-		if(arg_vec[ctr]>arg_vec[ctr-1])
+		//If the current element of the vector is larger than the largest so far, update the max value and the index.
+		if(arg_vec[ctr]>*max_v)
 		{
 		
 			*max_v=arg_vec[ctr];
@@ -547,16 +508,17 @@ inline void max_value(precision *max_v,uint8_t *index, precision *arg_vec){
 
 /*! \brief Function that calculates the magnitude of the local gravity vector based upon the WGS84 gravity model. 
 	
-	 @param[out] g			The magnitude of the local gravity vector.
-	 @param[in] latitude	The latitude of the navigation system. 
-	 @param[in] altitude	The altitude of the navigation system. 
+	 @param[in,out] params	The parameters of the navigation algorithm. The magnitude of the local gravity vector \a g 
+							is calculated from the \a latitude and \a altitude. 
 	 
  */ 
-inline void gravity(void){
+static inline void gravity(nav_params_t *params){
 								
+	const precision latitude=params->latitude;
+	const precision altitude=params->altitude;
 	precision lambda=M_PI/180.0*latitude;  //latitude [rad]
 
-	g=9.780327*(1+0.0053024*(sin(lambda)*sin(lambda))-0.0000058*(sin(2*lambda)*sin(2*lambda)))-(0.0000030877-0.000000004*(sin(lambda)*sin(lambda)))*altitude+0.000000000000072*(altitude*altitude);
+	params->g=9.780327*(1+0.0053024*(sin_hf(lambda)*sin_hf(lambda))-0.0000058*(sin_hf(2*lambda)*sin_hf(2*lambda)))-(0.0000030877-0.000000004*(sin_hf(lambda)*sin_hf(lambda)))*altitude+0.000000000000072*(altitude*altitude);
 	
 } 
 
@@ -571,14 +533,26 @@ inline void gravity(void){
 
 //********************* ORDINARY FUNCTIONS *********************************//
  
-void update_imu_data_buffers(void){
+void nav_update_imu_data_buffers(nav_filter_t *filter, const vec3 accelerations_in, const vec3 angular_rates_in){
 
 // The index of the IMU data buffers which the data from the IMU should be written to.
-static uint8_t in_data_buffer_index;
+uint8_t in_data_buffer_index=filter->in_data_buffer_index;
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+precision *acc_buffer_x_axis=filter->acc_buffer_x_axis;
+precision *acc_buffer_y_axis=filter->acc_buffer_y_axis;
+precision *acc_buffer_z_axis=filter->acc_buffer_z_axis;
+precision *gyro_buffer_x_axis=filter->gyro_buffer_x_axis;
+precision *gyro_buffer_y_axis=filter->gyro_buffer_y_axis;
+precision *gyro_buffer_z_axis=filter->gyro_buffer_z_axis;
+precision *accelerations_out=filter->accelerations_out;
+precision *angular_rates_out=filter->angular_rates_out;
 
 // The index of the IMU data buffers which the out data should be read from.
 int16_t out_data_buffer_index;
 
+// Update the running sums of the zero-velocity detector before the oldest sample is overwritten.
+detector_sums_update(filter,in_data_buffer_index,accelerations_in,angular_rates_in);
+
 //Update the IMU data buffer with the latest read IMU data.
 acc_buffer_x_axis[in_data_buffer_index]=accelerations_in[0];
 acc_buffer_y_axis[in_data_buffer_index]=accelerations_in[1];
@@ -617,11 +591,12 @@ else
 {
 	in_data_buffer_index=in_data_buffer_index+1;	
 }
+filter->in_data_buffer_index=in_data_buffer_index;
 
 }
 
 
-void strapdown_mechanisation_equations(void){	
+void nav_strapdown_mechanisation_equations(nav_filter_t *filter){	
 	/*
 		The inputs and outputs are the following:
 		
@@ -644,6 +619,16 @@ void strapdown_mechanisation_equations(void){
 	
 
 	
+	// Filter states and parameters
+	precision *position=filter->position;
+	precision *velocity=filter->velocity;
+	precision *quaternions=filter->quaternions;
+	precision *Rb2t=filter->Rb2t;
+	const precision *accelerations_out=filter->accelerations_out;
+	const precision *angular_rates_out=filter->angular_rates_out;
+	const precision g=filter->params.g;
+	const precision dt=filter->params.dt;
+	
 	// Working variables
 	vec3 an_hat;				
     vec3 angular_rates_dt;
@@ -667,8 +652,8 @@ void strapdown_mechanisation_equations(void){
 	// Calculate the norm of the vector angular_rates_dt
 	precision v=( sqrt_hf( vecnorm2(angular_rates_dt, 3) ) );
 		
-	cos_v=cos(v/2);	
-	sin_v=(sin(v/2)/v);
+	cos_v=cos_hf(v/2);	
+	sin_v=(sin_hf(v/2)/v);
 	
 	// Time update of the quaternions 	
 	quat_tmp[0]=cos_v*quaternions[0]+sin_v*(angular_rates_dt[2]*quaternions[1]-angular_rates_dt[1]*quaternions[2]+angular_rates_dt[0]*quaternions[3]);	// w_tb(2)*quaternions(1)-w_tb(1)*quaternions(2)+w_tb(0)*quaternions(3)		
@@ -695,9 +680,8 @@ void strapdown_mechanisation_equations(void){
 	quat2rotation(Rb2t,quaternions);  //Rb2t
 
 	// Compute acceleration in navigation coordinate frame and subtract the acceleration due to the earth gravity force. 
-	an_hat[0]=Rb2t[0]*accelerations_out[0]+Rb2t[1]*accelerations_out[1]+Rb2t[2]*accelerations_out[2];
-	an_hat[1]=Rb2t[3]*accelerations_out[0]+Rb2t[4]*accelerations_out[1]+Rb2t[5]*accelerations_out[2];
-	an_hat[2]=Rb2t[6]*accelerations_out[0]+Rb2t[7]*accelerations_out[1]+Rb2t[8]*accelerations_out[2]+g;
+	mat3_vec3_mul(an_hat,Rb2t,accelerations_out);
+	an_hat[2]=an_hat[2]+g;
 	
 
 	// Integrate the acceleration to get the velocity
@@ -713,7 +697,15 @@ void strapdown_mechanisation_equations(void){
 }
 	 
 
-void time_up_data(void){
+void nav_time_up_data(nav_filter_t *filter){
+	
+	// Filter states and parameters
+	precision *cov_vector=filter->cov_vector;
+	const precision *Rb2t=filter->Rb2t;
+	const precision *accelerations_out=filter->accelerations_out;
+	const precision dt=filter->params.dt;
+	const precision sigma_acceleration=filter->params.sigma_acceleration;
+	const precision sigma_gyroscope=filter->params.sigma_gyroscope;
 	
 	//Working variables
 	uint8_t ctr=0;
@@ -724,111 +716,16 @@ void time_up_data(void){
 	
 	
 	// Calculate the acceleration (specific-force) vector "s" in the n-frame 
-	s[0]=Rb2t[0]*accelerations_out[0]+Rb2t[1]*accelerations_out[1]+Rb2t[2]*accelerations_out[2];
-	s[1]=Rb2t[3]*accelerations_out[0]+Rb2t[4]*accelerations_out[1]+Rb2t[5]*accelerations_out[2];
-	s[2]=Rb2t[6]*accelerations_out[0]+Rb2t[7]*accelerations_out[1]+Rb2t[8]*accelerations_out[2]; 	
+	mat3_vec3_mul(s,Rb2t,accelerations_out);
 	
+	// If the UD factorized covariance has been used, switch back to the covariance matrix.
+	if(filter->cov_UD_active){
+		nav_UD_to_covariance(filter);
+	}
 	
 	
-// First row of the covariance matrix
-ppvec[0]=cov_vector[0]+dt*(2*cov_vector[3] + dt*cov_vector[24]);
-
-ppvec[1]=cov_vector[1]+dt*(cov_vector[4]+cov_vector[11]+dt*cov_vector[25]);
-
-ppvec[2]=cov_vector[2]+dt*(cov_vector[5]+cov_vector[18]+dt*cov_vector[26]);
-      
-ppvec[3]=cov_vector[3] + dt*(cov_vector[24]+cov_vector[8]*s[1]+cov_vector[29]*(s[1]*dt) - s[2]*(cov_vector[7]+cov_vector[28]*dt));
-
-ppvec[4]=cov_vector[4]+dt*cov_vector[25]+ (s[2]*dt)*(cov_vector[6] + dt*cov_vector[27]) - (s[0]*dt)*(cov_vector[8] + dt*cov_vector[29]);
-
-ppvec[5]=cov_vector[5]+dt*(cov_vector[26]+cov_vector[7]*s[0]+cov_vector[28]*(s[0]*dt)-s[1]*(cov_vector[6]+cov_vector[27]*dt));
-
-ppvec[6]=cov_vector[6] + cov_vector[27]*dt;
-
-ppvec[7]=cov_vector[7] + cov_vector[28]*dt;
-
-ppvec[8]=cov_vector[8]+cov_vector[29]*dt;
-
-// Second row of the covariance matrix
-ppvec[9]=cov_vector[9] + dt*(2*cov_vector[12] + cov_vector[30]*dt);
-
-ppvec[10]=cov_vector[10] + dt*(cov_vector[13] + cov_vector[19] + cov_vector[31]*dt);
-
-ppvec[11]=cov_vector[11] + dt*(cov_vector[25] + cov_vector[16]*s[1] + cov_vector[34]*(s[1]*dt) - s[2]*(cov_vector[15]+cov_vector[33]*dt));
-
-ppvec[12]=cov_vector[12] + cov_vector[30]*dt + s[2]*dt*(cov_vector[14] + cov_vector[32]*dt)-(s[0]*dt)*( cov_vector[16]+cov_vector[34]*dt );
-
-ppvec[13]=cov_vector[13] + dt*(cov_vector[31] + cov_vector[15]*s[0] + cov_vector[33]*(s[0]*dt) -s[1]*(cov_vector[14] + cov_vector[32]*dt) );
-
-ppvec[14]=cov_vector[14] + cov_vector[32]*dt;
-
-ppvec[15]=cov_vector[15] + cov_vector[33]*dt;
-
-ppvec[16]=cov_vector[16] + cov_vector[34]*dt;
-
-// Third row of the covariance matrix
-ppvec[17]=cov_vector[17] + dt*(2*cov_vector[20]+cov_vector[35]*dt);
-
-ppvec[18]=cov_vector[18] + dt*(cov_vector[26] + cov_vector[23]*s[1] + cov_vector[38]*s[1]*dt - s[2]*(cov_vector[22] + cov_vector[37]*dt));
-
-ppvec[19]=cov_vector[19] + cov_vector[31]*dt + s[2]*dt*(cov_vector[21] + cov_vector[36]*dt) - (s[0]*dt)*(cov_vector[23] + cov_vector[38]*dt);
-
-ppvec[20]=cov_vector[20] + dt*(cov_vector[35] + cov_vector[22]*s[0] + cov_vector[37]*(s[0]*dt) - s[1]*(cov_vector[21] + cov_vector[36]*dt));
-
-
-ppvec[21]=cov_vector[21] + cov_vector[36]*dt;
-
-ppvec[22]=cov_vector[22]+cov_vector[37]*dt;
-
-ppvec[23]=cov_vector[23]+cov_vector[38]*dt;
-
-// Forth row of the covariance matrix
-ppvec[24]=cov_vector[24] + dt*(2*(cov_vector[29]*s[1])+(cov_vector[44]*s[1])*(s[1]*dt) + s[2]*(-2*cov_vector[28] - (2*cov_vector[43])*(s[1]*dt)+cov_vector[42]*(s[2]*dt)))+dt2_sigma2_acc;
-
-ppvec[25]=cov_vector[25] + dt*(-cov_vector[29]*s[0] + cov_vector[34]*s[1] - (cov_vector[44]*s[0])*(s[1]*dt) + s[2]*(cov_vector[27]-cov_vector[33]+cov_vector[43]*(s[0]*dt) + cov_vector[41]*(s[1]*dt) - cov_vector[40]*(s[2]*dt)));
-
-ppvec[26]=cov_vector[26] + cov_vector[38]*(s[1]*dt) - cov_vector[37]*(s[2]*dt) - (s[1]*dt)*(cov_vector[27] + cov_vector[41]*(s[1]*dt) - cov_vector[40]*(s[2]*dt)) + (s[0]*dt)*(cov_vector[28]+cov_vector[43]*(s[1]*dt) - cov_vector[42]*(s[2]*dt));
-
-ppvec[27]=cov_vector[27]+cov_vector[41]*(s[1]*dt) - cov_vector[40]*(s[2]*dt);
-
-ppvec[28]=cov_vector[28] + cov_vector[43]*(s[1]*dt) - cov_vector[42]*(s[2]*dt);
-
-ppvec[29]=cov_vector[29] + cov_vector[44]*(s[1]*dt) - cov_vector[43]*(s[2]*dt);
-
-// Fifth row of the covariance matrix
-ppvec[30]=cov_vector[30]+dt*(-2*(cov_vector[34]*s[0])+(cov_vector[44]*s[0])*(s[0]*dt) + s[2]*(2*cov_vector[32]-(2*cov_vector[41])*(s[0]*dt)+cov_vector[39]*(s[2]*dt)))+dt2_sigma2_acc;
-
-ppvec[31]=cov_vector[31] - cov_vector[38]*(s[0]*dt) + cov_vector[36]*(s[2]*dt) - (s[1]*dt)*(cov_vector[32] - cov_vector[41]*(s[0]*dt) + cov_vector[39]*(s[2]*dt)) + (s[0]*dt)*(cov_vector[33]-cov_vector[43]*s[0]*dt+cov_vector[40]*(s[2]*dt));
-
-ppvec[32]=cov_vector[32] - cov_vector[41]*s[0]*dt + cov_vector[39]*(s[2]*dt);
-
-ppvec[33]=cov_vector[33] - cov_vector[43]*s[0]*dt + cov_vector[40]*(s[2]*dt);
-
-ppvec[34]=cov_vector[34]-cov_vector[44]*(s[0]*dt)+cov_vector[41]*(s[2]*dt);
-
-// Sixth row of the covariance matrix
-ppvec[35]=cov_vector[35]+dt*(2*(cov_vector[37]*s[0])+(cov_vector[42]*s[0])*(s[0]*dt)+s[1]*(-2*cov_vector[36]-2*cov_vector[40]*s[0]*dt+cov_vector[39]*s[1]*dt))+dt2_sigma2_acc;
-
-ppvec[36]=cov_vector[36] + cov_vector[40]*s[0]*dt - cov_vector[39]*s[1]*dt;
-
-ppvec[37]=cov_vector[37] + cov_vector[42]*s[0]*dt - cov_vector[40]*s[1]*dt;
-
-ppvec[38]=cov_vector[38] + cov_vector[43]*s[0]*dt - cov_vector[41]*s[1]*dt;
-
-// Seventh row of the covariance matrix
-ppvec[39]=cov_vector[39]+dt2_sigma2_gyro;
-
-ppvec[40]=cov_vector[40];
-
-ppvec[41]=cov_vector[41];
-
-// Eight row of the covariance matrix
-ppvec[42]=cov_vector[42]+dt2_sigma2_gyro;
-
-ppvec[43]=cov_vector[43];
-
-// Ninth row of the covariance matrix
-ppvec[44]=cov_vector[44]+dt2_sigma2_gyro;
+// Update the covariance matrix, see nav_cov_expressions.h
+NAV_TIME_UP_DATA_EXPRESSIONS(ppvec,cov_vector,s,dt,dt2_sigma2_acc,dt2_sigma2_gyro);
 
 	
 // Copy the temporary vector to the global covariance vector	
@@ -839,289 +736,480 @@ cov_vector[ctr]=ppvec[ctr];
 
 
 
-void gain_matrix(void){
-
+void nav_gain_matrix(nav_filter_t *filter){
 
+const precision *cov_vector=filter->cov_vector;
+precision *kalman_gain=filter->kalman_gain;
 mat3sym Re;			//Innovation matrix
 mat3sym invRe;		//Inverse of the innovation matrix
 
+// If the UD factorized covariance has been used, switch back to the covariance matrix.
+if(filter->cov_UD_active){
+	nav_UD_to_covariance(filter);
+}
 
 /************ Calculate the Kalman filter innovation matrix *******************/
-innovation_cov(Re,cov_vector);
+innovation_cov(Re,cov_vector,filter->params.sigma_velocity);
 
 /************ Calculate the inverse of the innovation matrix *********/
-invmat3sys(invRe,Re);
+invmat3sys(invRe,&filter->error_signal,Re);
 
 /******************* Calculate the Kalman filter gain **************************/
 
-// First row of the gain matrix
-kalman_gain[0]=cov_vector[3]*invRe[0] + cov_vector[4]*invRe[1] + cov_vector[5]*invRe[2];
-kalman_gain[1]=cov_vector[3]*invRe[1] + cov_vector[4]*invRe[3] + cov_vector[5]*invRe[4];
-kalman_gain[2]=cov_vector[3]*invRe[2] + cov_vector[4]*invRe[4] + cov_vector[5]*invRe[5];
+NAV_GAIN_MATRIX_EXPRESSIONS(kalman_gain,cov_vector,invRe);
 
+}  
 
-// Second row of the gain matrix
-kalman_gain[3]=cov_vector[11]*invRe[0] + cov_vector[12]*invRe[1] + cov_vector[13]*invRe[2];
-kalman_gain[4]=cov_vector[11]*invRe[1] + cov_vector[12]*invRe[3] + cov_vector[13]*invRe[4];
-kalman_gain[5]=cov_vector[11]*invRe[2] + cov_vector[12]*invRe[4] + cov_vector[13]*invRe[5];
 
-// Third row of the gain matrix
-kalman_gain[6]=cov_vector[18]*invRe[0] + cov_vector[19]*invRe[1] + cov_vector[20]*invRe[2];
-kalman_gain[7]=cov_vector[18]*invRe[1] + cov_vector[19]*invRe[3] + cov_vector[20]*invRe[4];
-kalman_gain[8]=cov_vector[18]*invRe[2] + cov_vector[19]*invRe[4] + cov_vector[20]*invRe[5];
+void nav_measurement_update(nav_filter_t *filter){
 
+precision *cov_vector=filter->cov_vector;
+const precision *kalman_gain=filter->kalman_gain;
+uint8_t ctr=0;
+mat9sym ppvec;		//Temporary vector holding the update covariances 
 
-//Forth row of the gain matrix
-kalman_gain[9]=cov_vector[24]*invRe[0] + cov_vector[25]*invRe[1] + cov_vector[26]*invRe[2];
-kalman_gain[10]=cov_vector[24]*invRe[1] + cov_vector[25]*invRe[3] + cov_vector[26]*invRe[4];
-kalman_gain[11]=cov_vector[24]*invRe[2] + cov_vector[25]*invRe[4] + cov_vector[26]*invRe[5];
+// If the UD factorized covariance has been used, switch back to the covariance matrix.
+if(filter->cov_UD_active){
+	nav_UD_to_covariance(filter);
+}
 
+// Update the covariance matrix, see nav_cov_expressions.h
+NAV_MEASUREMENT_UPDATE_EXPRESSIONS(ppvec,cov_vector,kalman_gain);
 
-//Fifth row of the gain matrix
-kalman_gain[12]=cov_vector[25]*invRe[0] + cov_vector[30]*invRe[1] + cov_vector[31]*invRe[2];
-kalman_gain[13]=cov_vector[25]*invRe[1] + cov_vector[30]*invRe[3] + cov_vector[31]*invRe[4];
-kalman_gain[14]=cov_vector[25]*invRe[2] + cov_vector[30]*invRe[4] + cov_vector[31]*invRe[5];
 
+// Copy the temporary vector to the covariance vector	
+for(ctr=0;ctr<45;ctr++){
+cov_vector[ctr]=ppvec[ctr];
+}	
+}
 
-//Sixth row of the gain matrix
-kalman_gain[15]=cov_vector[26]*invRe[0] + cov_vector[31]*invRe[1] + cov_vector[35]*invRe[2];
-kalman_gain[16]=cov_vector[26]*invRe[1] + cov_vector[31]*invRe[3] + cov_vector[35]*invRe[4];
-kalman_gain[17]=cov_vector[26]*invRe[2] + cov_vector[31]*invRe[4] + cov_vector[35]*invRe[5];
 
 
-//Seventh row of the gain matrix
-kalman_gain[18]=cov_vector[27]*invRe[0] + cov_vector[32]*invRe[1] + cov_vector[36]*invRe[2];
-kalman_gain[19]=cov_vector[27]*invRe[1] + cov_vector[32]*invRe[3] + cov_vector[36]*invRe[4];
-kalman_gain[20]=cov_vector[27]*invRe[2] + cov_vector[32]*invRe[4] + cov_vector[36]*invRe[5];
+void nav_correct_navigation_states(nav_filter_t *filter){
+	
+precision *position=filter->position;
+precision *velocity=filter->velocity;
+const precision *Rb2t=filter->Rb2t;
+const precision *kalman_gain=filter->kalman_gain;
+vec3 velocity_tmp; // Temporary vector holding the corrected velocity state. 	
 
+// Correct the position and velocity 
+position[0]=position[0]-kalman_gain[0]*velocity[0]-kalman_gain[1]*velocity[1]-kalman_gain[2]*velocity[2];
+position[1]=position[1]-kalman_gain[3]*velocity[0]-kalman_gain[4]*velocity[1]-kalman_gain[5]*velocity[2];
+position[2]=position[2]-kalman_gain[6]*velocity[0]-kalman_gain[7]*velocity[1]-kalman_gain[8]*velocity[2];
+velocity_tmp[0]=velocity[0]-kalman_gain[9]*velocity[0]-kalman_gain[10]*velocity[1]-kalman_gain[11]*velocity[2];
+velocity_tmp[1]=velocity[1]-kalman_gain[12]*velocity[0]-kalman_gain[13]*velocity[1]-kalman_gain[14]*velocity[2];
+velocity_tmp[2]=velocity[2]-kalman_gain[15]*velocity[0]-kalman_gain[16]*velocity[1]-kalman_gain[17]*velocity[2];
 
-//Eight row of the gain matrix
-kalman_gain[21]=cov_vector[28]*invRe[0] + cov_vector[33]*invRe[1] + cov_vector[37]*invRe[2];
-kalman_gain[22]=cov_vector[28]*invRe[1] + cov_vector[33]*invRe[3] + cov_vector[37]*invRe[4];
-kalman_gain[23]=cov_vector[28]*invRe[2] + cov_vector[33]*invRe[4] + cov_vector[37]*invRe[5];
+precision delta_roll=kalman_gain[18]*velocity[0]+kalman_gain[19]*velocity[1]+kalman_gain[20]*velocity[2];
+precision delta_pitch=kalman_gain[21]*velocity[0]+kalman_gain[22]*velocity[1]+kalman_gain[23]*velocity[2];
+precision delta_yaw=kalman_gain[24]*velocity[0]+kalman_gain[25]*velocity[1]+kalman_gain[26]*velocity[2];
 
+//Update the velocity state with the temporary velocity state 
+velocity[0]=velocity_tmp[0];
+velocity[1]=velocity_tmp[1];
+velocity[2]=velocity_tmp[2];
 
-//Ninth row of the gain matrix
-kalman_gain[24]=cov_vector[29]*invRe[0] + cov_vector[34]*invRe[1] + cov_vector[38]*invRe[2];
-kalman_gain[25]=cov_vector[29]*invRe[1] + cov_vector[34]*invRe[3] + cov_vector[38]*invRe[4];
-kalman_gain[26]=cov_vector[29]*invRe[2] + cov_vector[34]*invRe[4] + cov_vector[38]*invRe[5];
 
-}  
+// Correct the rotation matrix
+mat3 new_rotmat;
 
+new_rotmat[0]=Rb2t[0]-delta_yaw*Rb2t[3] + delta_pitch*Rb2t[6];
+new_rotmat[1]=Rb2t[1]-delta_yaw*Rb2t[4] + delta_pitch*Rb2t[7];
+new_rotmat[2]=Rb2t[2]-delta_yaw*Rb2t[5] + delta_pitch*Rb2t[8];
+new_rotmat[3]=delta_yaw*Rb2t[0] + Rb2t[3] - delta_roll*Rb2t[6];
+new_rotmat[4]=delta_yaw*Rb2t[1] + Rb2t[4] - delta_roll*Rb2t[7];
+new_rotmat[5]=delta_yaw*Rb2t[2] + Rb2t[5] - delta_roll*Rb2t[8];
+new_rotmat[6]=-delta_pitch*Rb2t[0] + delta_roll*Rb2t[3] + Rb2t[6];
+new_rotmat[7]=-delta_pitch*Rb2t[1] + delta_roll*Rb2t[4] + Rb2t[7];
+new_rotmat[8]=-delta_pitch*Rb2t[2] + delta_roll*Rb2t[5] + Rb2t[8];
 
-void measurement_update(void){
 
-uint8_t ctr=0;
-mat9sym ppvec;		//Temporary vector holding the update covariances 
+// Calculate the corrected quaternions
+rotation2quat(filter->quaternions,new_rotmat);
+}
 
 
-// First row
-ppvec[0]=cov_vector[0] - kalman_gain[0]*cov_vector[3] - kalman_gain[1]*cov_vector[4] - kalman_gain[2]*cov_vector[5];
+void nav_ZUPT_detector(nav_filter_t *filter){
+	
+const nav_detector_sums_t *sums=&filter->detector_sums;
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+const precision g=filter->params.g;
+const precision sigma_acc_det=filter->params.sigma_acc_det;
+const precision sigma_gyro_det=filter->params.sigma_gyro_det;
+precision Test_statistics;
 
-ppvec[1]=cov_vector[1] - kalman_gain[0]* cov_vector[11] - kalman_gain[1]* cov_vector[12] - kalman_gain[2]* cov_vector[13];
+/************ Calculate the mean of the accelerations in the in-data buffer ***********/
+vec3 acceleration_mean;		//Mean acceleration within the data window
 
-ppvec[2]=cov_vector[2]-kalman_gain[0]* cov_vector[18] - kalman_gain[1]* cov_vector[19] - kalman_gain[2]* cov_vector[20];
+acceleration_mean[0]=sums->acc_ref[0]+sums->acc_sum[0]/detector_Window_size;
+acceleration_mean[1]=sums->acc_ref[1]+sums->acc_sum[1]/detector_Window_size;
+acceleration_mean[2]=sums->acc_ref[2]+sums->acc_sum[2]/detector_Window_size;
+	
+	
+	
+	
+/****************** Calculate the likelihood ratio  *******************************/ 
 
-ppvec[3]=cov_vector[3]-kalman_gain[0]* cov_vector[24] - kalman_gain[1]* cov_vector[25] - kalman_gain[2]* cov_vector[26];
+/* With d(k)=a(k)-acc_ref and e=g*mean/|mean|-acc_ref, the sum over the window of |a(k)-g*mean/|mean||^2 is
+   sum(|d(k)-e|^2) = acc_sum2 - 2*e'*acc_sum + W*|e|^2 */
+									
+precision acceleration_mean_norm = sqrt_hf(vecnorm2(acceleration_mean,3));
+precision sigma2_acc_det=sigma_acc_det*sigma_acc_det;
+precision sigma2_gyro_det=sigma_gyro_det*sigma_gyro_det;
+vec3 e;
 
-ppvec[4]=cov_vector[4]-kalman_gain[0]* cov_vector[25] - kalman_gain[1]* cov_vector[30] - kalman_gain[2]* cov_vector[31];
+e[0]=(g*acceleration_mean[0])/acceleration_mean_norm-sums->acc_ref[0];
+e[1]=(g*acceleration_mean[1])/acceleration_mean_norm-sums->acc_ref[1];
+e[2]=(g*acceleration_mean[2])/acceleration_mean_norm-sums->acc_ref[2];
 
-ppvec[5]=cov_vector[5]-kalman_gain[0]* cov_vector[26] - kalman_gain[1]* cov_vector[31] - kalman_gain[2]* cov_vector[35];
+precision acc_sum_sq=sums->acc_sum2-2*(e[0]*sums->acc_sum[0]+e[1]*sums->acc_sum[1]+e[2]*sums->acc_sum[2])+detector_Window_size*vecnorm2(e,3);
 
-ppvec[6]=cov_vector[6]-kalman_gain[0]* cov_vector[27] - kalman_gain[1]* cov_vector[32] - kalman_gain[2]* cov_vector[36];
+Test_statistics=(acc_sum_sq/sigma2_acc_det+sums->gyro_sum2/sigma2_gyro_det)/detector_Window_size;
+filter->Test_statistics=Test_statistics;
 
-ppvec[7]=cov_vector[7]-kalman_gain[0]* cov_vector[28] - kalman_gain[1]* cov_vector[33] - kalman_gain[2]* cov_vector[37];
 
-ppvec[8]=cov_vector[8]-kalman_gain[0]* cov_vector[29] - kalman_gain[1]* cov_vector[34] - kalman_gain[2]* cov_vector[38];
+	/******************** Check if the test statistics T are below or above the detector threshold ******************/
+	if(Test_statistics<filter->params.detector_threshold){
+	filter->zupt=true;
+	}  
+	else{
+	filter->zupt=false;	
+	}
+	
+}
 
-// Second row
-ppvec[9]=cov_vector[9]-kalman_gain[3]* cov_vector[11] - kalman_gain[4]* cov_vector[12] - kalman_gain[5]* cov_vector[13];
 
-ppvec[10]=cov_vector[10]-kalman_gain[3]* cov_vector[18] - kalman_gain[4]* cov_vector[19] - kalman_gain[5]* cov_vector[20];
+void nav_MV_detector(nav_filter_t *filter){
 
-ppvec[11]=cov_vector[11]-kalman_gain[3]* cov_vector[24] - kalman_gain[4]* cov_vector[25] - kalman_gain[5]* cov_vector[26];
+const nav_detector_sums_t *sums=&filter->detector_sums;
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+const precision sigma_acc_det=filter->params.sigma_acc_det;
+precision Test_statistics;
 
-ppvec[12]=cov_vector[12]-kalman_gain[3]* cov_vector[25] - kalman_gain[4]* cov_vector[30] - kalman_gain[5]* cov_vector[31];
+/* With d(k)=a(k)-acc_ref, the sum over the window of |a(k)-mean|^2 is sum(|d(k)|^2) - |sum(d(k))|^2/W */
+precision acc_sum_sq=sums->acc_sum2-vecnorm2(sums->acc_sum,3)/detector_Window_size;
 
-ppvec[13]=cov_vector[13]-kalman_gain[3]* cov_vector[26] - kalman_gain[4]* cov_vector[31] - kalman_gain[5]* cov_vector[35];
+Test_statistics=acc_sum_sq/(sigma_acc_det*sigma_acc_det*detector_Window_size);
+filter->Test_statistics=Test_statistics;
 
-ppvec[14]=cov_vector[14]-kalman_gain[3]* cov_vector[27] - kalman_gain[4]* cov_vector[32] - kalman_gain[5]* cov_vector[36];
+	/******************** Check if the test statistics T are below or above the detector threshold ******************/
+	if(Test_statistics<filter->params.detector_threshold_MV){
+	filter->zupt=true;
+	}  
+	else{
+	filter->zupt=false;	
+	}
 
-ppvec[15]=cov_vector[15]-kalman_gain[3]* cov_vector[28] - kalman_gain[4]* cov_vector[33] - kalman_gain[5]* cov_vector[37];
- 
-ppvec[16]=cov_vector[16]-kalman_gain[3]* cov_vector[29] - kalman_gain[4]* cov_vector[34] - kalman_gain[5]* cov_vector[38];
+}
 
-// Third row
-ppvec[17]=cov_vector[17]-kalman_gain[6]* cov_vector[18] - kalman_gain[7]* cov_vector[19] - kalman_gain[8]* cov_vector[20];
 
-ppvec[18]=cov_vector[18]-kalman_gain[6]* cov_vector[24] - kalman_gain[7]* cov_vector[25] - kalman_gain[8]* cov_vector[26];
+void nav_MAG_detector(nav_filter_t *filter){
 
-ppvec[19]=cov_vector[19]-kalman_gain[6]* cov_vector[25] - kalman_gain[7]* cov_vector[30] - kalman_gain[8]* cov_vector[31];
+const precision *acc_buffer_x_axis=filter->acc_buffer_x_axis;
+const precision *acc_buffer_y_axis=filter->acc_buffer_y_axis;
+const precision *acc_buffer_z_axis=filter->acc_buffer_z_axis;
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+const precision g=filter->params.g;
+const precision sigma_acc_det=filter->params.sigma_acc_det;
+precision Test_statistics;
+uint8_t ctr;
+vec3 acc;
+precision tmp;
 
-ppvec[20]=cov_vector[20]-kalman_gain[6]* cov_vector[26] - kalman_gain[7]* cov_vector[31] - kalman_gain[8]* cov_vector[35];
+/* The magnitudes cannot be calculated from the running sums, hence the window is looped over. */
+Test_statistics=0;
+for(ctr=0;ctr<detector_Window_size;ctr++){
+	
+	acc[0]=acc_buffer_x_axis[ctr];
+	acc[1]=acc_buffer_y_axis[ctr];
+	acc[2]=acc_buffer_z_axis[ctr];
+	
+	tmp=sqrt_hf(vecnorm2(acc,3))-g;
+	Test_statistics=Test_statistics+tmp*tmp;
+}
+Test_statistics=Test_statistics/(sigma_acc_det*sigma_acc_det*detector_Window_size);
+filter->Test_statistics=Test_statistics;
 
+	/******************** Check if the test statistics T are below or above the detector threshold ******************/
+	if(Test_statistics<filter->params.detector_threshold_MAG){
+	filter->zupt=true;
+	}  
+	else{
+	filter->zupt=false;	
+	}
 
-ppvec[21]=cov_vector[21]-kalman_gain[6]* cov_vector[27] - kalman_gain[7]* cov_vector[32] - kalman_gain[8]* cov_vector[36];
+}
 
-ppvec[22]=cov_vector[22]-kalman_gain[6]* cov_vector[28] - kalman_gain[7]* cov_vector[33] - kalman_gain[8]* cov_vector[37];
 
-ppvec[23]=cov_vector[23]-kalman_gain[6]* cov_vector[29] - kalman_gain[7]* cov_vector[34] - kalman_gain[8]* cov_vector[38];
+void nav_ARE_detector(nav_filter_t *filter){
 
-// Forth row
-ppvec[24]=cov_vector[24]-kalman_gain[9]* cov_vector[24] - kalman_gain[10]* cov_vector[25] - kalman_gain[11]* cov_vector[26];
+const nav_detector_sums_t *sums=&filter->detector_sums;
+const uint8_t detector_Window_size=filter->params.detector_Window_size;
+const precision sigma_gyro_det=filter->params.sigma_gyro_det;
+precision Test_statistics;
 
-ppvec[25]=cov_vector[25]-kalman_gain[9]* cov_vector[25] - kalman_gain[10]* cov_vector[30] - kalman_gain[11]* cov_vector[31];
+Test_statistics=sums->gyro_sum2/(sigma_gyro_det*sigma_gyro_det*detector_Window_size);
+filter->Test_statistics=Test_statistics;
 
-ppvec[26]=cov_vector[26]-kalman_gain[9]* cov_vector[26] - kalman_gain[10]* cov_vector[31] - kalman_gain[11]* cov_vector[35];
+	/******************** Check if the test statistics T are below or above the detector threshold ******************/
+	if(Test_statistics<filter->params.detector_threshold_ARE){
+	filter->zupt=true;
+	}  
+	else{
+	filter->zupt=false;	
+	}
 
-ppvec[27]=cov_vector[27]-kalman_gain[9]* cov_vector[27] - kalman_gain[10]* cov_vector[32] - kalman_gain[11]* cov_vector[36];
+}
 
-ppvec[28]=cov_vector[28]-kalman_gain[9]* cov_vector[28] - kalman_gain[10]* cov_vector[33] - kalman_gain[11]* cov_vector[37];
+//@}
 
-ppvec[29]=cov_vector[29]-kalman_gain[9]* cov_vector[29] - kalman_gain[10]* cov_vector[34] - kalman_gain[11]* cov_vector[38];
+/**
+	\defgroup ud_func UD factorized covariance
+	\brief Time and measurement updates of the covariance on UD factorized form.
+	
+	\details The covariance is factorized as \f$P=UDU^T\f$, where \f$U\f$ is a unit upper triangular matrix and 
+	\f$D\f$ a diagonal matrix, and the factors are updated instead of \f$P\f$. The time update is done with 
+	the modified weighted Gram-Schmidt orthogonalization of Thornton and the measurement update by processing the 
+	three velocity measurements one at a time with the update of Bierman. Since the elements of \f$D\f$ are formed 
+	from weighted sums of squares, the factorized covariance is symmetric and positive definite whatever the rounding 
+	errors, while the subtractions in nav_measurement_update() may make \a cov_vector indefinite when the position 
+	and heading uncertainties have grown large relative to the velocity uncertainty. In single precision, the Kalman 
+	gains of the two forms are equally accurate. The slowly growing position variances have per-sample increments 
+	close to the resolution of a float in both forms and drift by some percent over hours of walking. 
+	The factors are stored in nav_filter_t::cov_UD, see nav_filter_t::cov_UD_active for how the representations 
+	are switched.
+	
+	\li G. J. Bierman, Factorization Methods for Discrete Sequential Estimation, Academic Press, 1977.
+	
+	@{
+*/
 
-// Fifth row
-ppvec[30]=cov_vector[30]-kalman_gain[12]* cov_vector[25] - kalman_gain[13]* cov_vector[30] - kalman_gain[14]* cov_vector[31];
+void nav_covariance_to_UD(nav_filter_t *filter){
 
-ppvec[31]=cov_vector[31]-kalman_gain[12]* cov_vector[26] - kalman_gain[13]* cov_vector[31] - kalman_gain[14]* cov_vector[35];
+const precision *cov_vector=filter->cov_vector;
+precision *cov_UD=filter->cov_UD;
+int8_t i,j,k;
+precision tmp;
 
-ppvec[32]=cov_vector[32]-kalman_gain[12]* cov_vector[27] - kalman_gain[13]* cov_vector[32] - kalman_gain[14]* cov_vector[36];
+// Factorize column by column, starting with the last one.
+for(j=8;j>=0;j--){
+	
+	tmp=cov_vector[MAT9SYM_INDEX(j,j)];
+	for(k=j+1;k<9;k++){
+		tmp=tmp-cov_UD[MAT9SYM_INDEX(k,k)]*cov_UD[MAT9SYM_INDEX(j,k)]*cov_UD[MAT9SYM_INDEX(j,k)];
+	}
+	cov_UD[MAT9SYM_INDEX(j,j)]=tmp;
+	
+	for(i=0;i<j;i++){
+		tmp=cov_vector[MAT9SYM_INDEX(i,j)];
+		for(k=j+1;k<9;k++){
+			tmp=tmp-cov_UD[MAT9SYM_INDEX(k,k)]*cov_UD[MAT9SYM_INDEX(i,k)]*cov_UD[MAT9SYM_INDEX(j,k)];
+		}
+		cov_UD[MAT9SYM_INDEX(i,j)]=cov_UD[MAT9SYM_INDEX(j,j)]>0 ? tmp/cov_UD[MAT9SYM_INDEX(j,j)] : 0;
+	}
+}
 
-ppvec[33]=cov_vector[33]-kalman_gain[12]* cov_vector[28] - kalman_gain[13]* cov_vector[33] - kalman_gain[14]* cov_vector[37];
+filter->cov_UD_active=true;
+}
 
-ppvec[34]=cov_vector[34]-kalman_gain[12]* cov_vector[29] - kalman_gain[13]* cov_vector[34] - kalman_gain[14]* cov_vector[38];
 
-// Sixth row
-ppvec[35]=cov_vector[35]-kalman_gain[15]* cov_vector[26] - kalman_gain[16]* cov_vector[31] - kalman_gain[17]* cov_vector[35];
+void nav_UD_to_covariance(nav_filter_t *filter){
 
-ppvec[36]=cov_vector[36]-kalman_gain[15]* cov_vector[27] - kalman_gain[16]* cov_vector[32] - kalman_gain[17]* cov_vector[36];
+precision *cov_vector=filter->cov_vector;
+const precision *cov_UD=filter->cov_UD;
+uint8_t i,j,k;
+precision tmp;
 
-ppvec[37]=cov_vector[37]-kalman_gain[15]* cov_vector[28] - kalman_gain[16]* cov_vector[33] - kalman_gain[17]* cov_vector[37];
+// P[i,j]=sum_k U[i,k]*D[k]*U[j,k], where U[j,j]=1 and U[i,k]=0 for k<i.
+for(i=0;i<9;i++){
+	for(j=i;j<9;j++){
+		tmp=cov_UD[MAT9SYM_INDEX(j,j)];
+		if(i<j){
+			tmp=tmp*cov_UD[MAT9SYM_INDEX(i,j)];
+		}
+		for(k=j+1;k<9;k++){
+			tmp=tmp+cov_UD[MAT9SYM_INDEX(i,k)]*cov_UD[MAT9SYM_INDEX(k,k)]*cov_UD[MAT9SYM_INDEX(j,k)];
+		}
+		cov_vector[MAT9SYM_INDEX(i,j)]=tmp;
+	}
+}
 
-ppvec[38]=cov_vector[38]-kalman_gain[15]* cov_vector[29] - kalman_gain[16]* cov_vector[34] - kalman_gain[17]* cov_vector[38];
+filter->cov_UD_active=false;
+}
 
-// Seventh row
-ppvec[39]=cov_vector[39]-kalman_gain[18]* cov_vector[27] - kalman_gain[19]* cov_vector[32] - kalman_gain[20]* cov_vector[36];
 
-ppvec[40]=cov_vector[40]-kalman_gain[18]* cov_vector[28] - kalman_gain[19]* cov_vector[33] - kalman_gain[20]* cov_vector[37];
+void nav_time_up_data_UD(nav_filter_t *filter){
+
+// Filter states and parameters
+precision *cov_UD=filter->cov_UD;
+const precision *Rb2t=filter->Rb2t;
+const precision *accelerations_out=filter->accelerations_out;
+const precision dt=filter->params.dt;
+const precision sigma_acceleration=filter->params.sigma_acceleration;
+const precision sigma_gyroscope=filter->params.sigma_gyroscope;
+
+//Working variables
+int8_t i,j,k;
+precision w[9][15];		//The matrix [F*U I], where I holds the noise inputs of the velocity and attitude states.
+precision dw[15];		//Weights of the columns of w, i.e., the diagonal of D and the process noise variances.
+precision dw_wj[15];	//Weighted row j of w.
+precision d;
+precision d_inv;
+precision u;
+vec3 s;					//Specific accelerations vector in the n-frame.
+
+// Switch to the UD factorized covariance if the covariance matrix has been used.
+if(!filter->cov_UD_active){
+	nav_covariance_to_UD(filter);
+}
 
-ppvec[41]=cov_vector[41]-kalman_gain[18]* cov_vector[29] - kalman_gain[19]* cov_vector[34] - kalman_gain[20]* cov_vector[38];
+// Calculate the acceleration (specific-force) vector "s" in the n-frame 
+mat3_vec3_mul(s,Rb2t,accelerations_out);
 
-// Eight row
-ppvec[42]=cov_vector[42]-kalman_gain[21]* cov_vector[28] - kalman_gain[22]* cov_vector[33] - kalman_gain[23]* cov_vector[37];
 
-ppvec[43]=cov_vector[43]-kalman_gain[21]* cov_vector[29] - kalman_gain[22]* cov_vector[34] - kalman_gain[23]* cov_vector[38];
+/************************* Form the matrix [F*U I] ******************************/
 
-// Ninth row
-ppvec[44]=cov_vector[44]-kalman_gain[24]* cov_vector[29] - kalman_gain[25]* cov_vector[34] - kalman_gain[26]* cov_vector[38];
+// The unit upper triangular matrix U.
+for(i=0;i<9;i++){
+	for(k=0;k<i;k++){
+		w[i][k]=0;
+	}
+	w[i][i]=1;
+	for(k=i+1;k<9;k++){
+		w[i][k]=cov_UD[MAT9SYM_INDEX(i,k)];
+	}
+	for(k=9;k<15;k++){
+		w[i][k]=0;
+	}
+}
 
+// Multiply with the state transition matrix F=[I dt*I 0;0 I dt*[s]x;0 0 I], row by row from the top.
+for(k=0;k<9;k++){
+	w[0][k]=w[0][k]+dt*w[3][k];
+	w[1][k]=w[1][k]+dt*w[4][k];
+	w[2][k]=w[2][k]+dt*w[5][k];
+	w[3][k]=w[3][k]+dt*(s[1]*w[8][k]-s[2]*w[7][k]);
+	w[4][k]=w[4][k]+dt*(s[2]*w[6][k]-s[0]*w[8][k]);
+	w[5][k]=w[5][k]+dt*(s[0]*w[7][k]-s[1]*w[6][k]);
+}
 
-// Copy the temporary vector to the covariance vector	
-for(ctr=0;ctr<45;ctr++){
-cov_vector[ctr]=ppvec[ctr];
-}	
+// Process noise inputs of the velocity and attitude states.
+for(i=0;i<6;i++){
+	w[3+i][9+i]=1;
 }
 
+// Weights
+for(k=0;k<9;k++){
+	dw[k]=cov_UD[MAT9SYM_INDEX(k,k)];
+}
+for(k=9;k<12;k++){
+	dw[k]=(dt*dt)*(sigma_acceleration*sigma_acceleration);
+}
+for(k=12;k<15;k++){
+	dw[k]=(dt*dt)*(sigma_gyroscope*sigma_gyroscope);
+}
 
 
-void correct_navigation_states(void){
+/******************* Modified weighted Gram-Schmidt orthogonalization ***********/
+for(j=8;j>=0;j--){
 	
-vec3 velocity_tmp; // Temporary vector holding the corrected velocity state. 	
-
-// Correct the position and velocity 
-position[0]=position[0]-kalman_gain[0]*velocity[0]-kalman_gain[1]*velocity[1]-kalman_gain[2]*velocity[2];
-position[1]=position[1]-kalman_gain[3]*velocity[0]-kalman_gain[4]*velocity[1]-kalman_gain[5]*velocity[2];
-position[2]=position[2]-kalman_gain[6]*velocity[0]-kalman_gain[7]*velocity[1]-kalman_gain[8]*velocity[2];
-velocity_tmp[0]=velocity[0]-kalman_gain[9]*velocity[0]-kalman_gain[10]*velocity[1]-kalman_gain[11]*velocity[2];
-velocity_tmp[1]=velocity[1]-kalman_gain[12]*velocity[0]-kalman_gain[13]*velocity[1]-kalman_gain[14]*velocity[2];
-velocity_tmp[2]=velocity[2]-kalman_gain[15]*velocity[0]-kalman_gain[16]*velocity[1]-kalman_gain[17]*velocity[2];
+	d=0;
+	for(k=0;k<15;k++){
+		dw_wj[k]=dw[k]*w[j][k];
+		d=d+w[j][k]*dw_wj[k];
+	}
+	cov_UD[MAT9SYM_INDEX(j,j)]=d;
+	d_inv=d>0 ? 1/d : 0;
+	
+	for(i=0;i<j;i++){
+		u=0;
+		for(k=0;k<15;k++){
+			u=u+w[i][k]*dw_wj[k];
+		}
+		u=u*d_inv;
+		cov_UD[MAT9SYM_INDEX(i,j)]=u;
+		
+		for(k=0;k<15;k++){
+			w[i][k]=w[i][k]-u*w[j][k];
+		}
+	}
+}
+}
 
-precision delta_roll=kalman_gain[18]*velocity[0]+kalman_gain[19]*velocity[1]+kalman_gain[20]*velocity[2];
-precision delta_pitch=kalman_gain[21]*velocity[0]+kalman_gain[22]*velocity[1]+kalman_gain[23]*velocity[2];
-precision delta_yaw=kalman_gain[24]*velocity[0]+kalman_gain[25]*velocity[1]+kalman_gain[26]*velocity[2];
 
-//Update the velocity state with the temporary velocity state 
-velocity[0]=velocity_tmp[0];
-velocity[1]=velocity_tmp[1];
-velocity[2]=velocity_tmp[2];
+void nav_measurement_update_UD(nav_filter_t *filter){
 
+precision *cov_UD=filter->cov_UD;
+precision *kalman_gain=filter->kalman_gain;
+const precision *sigma_velocity=filter->params.sigma_velocity;
 
-// Correct the rotation matrix
-mat3 new_rotmat;
+//Working variables
+uint8_t i,j,m;
+precision f[9];		//f=U'*h, where h selects the measured velocity state.
+precision v[9];		//v=D*f
+precision b[9];		//Unnormalized Kalman gain of the scalar measurement.
+precision alpha;	//Innovation variance of the scalar measurement, accumulated state by state.
+precision alpha_new;
+precision p;
+precision u;
+precision tmp;
 
-new_rotmat[0]=Rb2t[0]-delta_yaw*Rb2t[3] + delta_pitch*Rb2t[6];
-new_rotmat[1]=Rb2t[1]-delta_yaw*Rb2t[4] + delta_pitch*Rb2t[7];
-new_rotmat[2]=Rb2t[2]-delta_yaw*Rb2t[5] + delta_pitch*Rb2t[8];
-new_rotmat[3]=delta_yaw*Rb2t[0] + Rb2t[3] - delta_roll*Rb2t[6];
-new_rotmat[4]=delta_yaw*Rb2t[1] + Rb2t[4] - delta_roll*Rb2t[7];
-new_rotmat[5]=delta_yaw*Rb2t[2] + Rb2t[5] - delta_roll*Rb2t[8];
-new_rotmat[6]=-delta_pitch*Rb2t[0] + delta_roll*Rb2t[3] + Rb2t[6];
-new_rotmat[7]=-delta_pitch*Rb2t[1] + delta_roll*Rb2t[4] + Rb2t[7];
-new_rotmat[8]=-delta_pitch*Rb2t[2] + delta_roll*Rb2t[5] + Rb2t[8];
-
-
-// Calculate the corrected quaternions
-rotation2quat(quaternions,new_rotmat);
+// Switch to the UD factorized covariance if the covariance matrix has been used.
+if(!filter->cov_UD_active){
+	nav_covariance_to_UD(filter);
 }
 
-
-void ZUPT_detector(void){
-	
-/************ Calculate the mean of the accelerations in the in-data buffer ***********/
-uint8_t ctr;
-vec3 acceleration_mean={0,0,0};		//Mean acceleration within the data window
-	
-for(ctr=0; ctr<detector_Window_size; ctr++){	
-	acceleration_mean[0]=acceleration_mean[0]+acc_buffer_x_axis[ctr];
-	acceleration_mean[1]=acceleration_mean[1]+acc_buffer_y_axis[ctr];
-	acceleration_mean[2]=acceleration_mean[2]+acc_buffer_z_axis[ctr];
+for(i=0;i<27;i++){
+	kalman_gain[i]=0;
 }
 
-acceleration_mean[0]=acceleration_mean[0]/detector_Window_size;
-acceleration_mean[1]=acceleration_mean[1]/detector_Window_size;
-acceleration_mean[2]=acceleration_mean[2]/detector_Window_size;
-	
+// Process the velocity measurements one at a time, which is possible since the measurement noise is uncorrelated.
+for(m=0;m<3;m++){
 	
+	/*********************** Bierman's scalar measurement update ****************/
 	
+	// The measurement only depends on state 3+m, hence f and v are zero before element 3+m.
+	alpha=sigma_velocity[m]*sigma_velocity[m];
+	for(j=0;j<9;j++){
+		b[j]=0;
+	}
 	
-/****************** Calculate the likelihood ratio  *******************************/ 
-
-									
-precision acceleration_mean_norm = sqrt_hf(vecnorm2(acceleration_mean,3));
-precision sigma2_acc_det=sigma_acc_det*sigma_acc_det;
-precision sigma2_gyro_det=sigma_gyro_det*sigma_gyro_det;
-vec3 acceleration_mean_normalized;
-vec3 tmp1;
-vec3 tmp2;
-
-acceleration_mean_normalized[0]=(g*acceleration_mean[0])/acceleration_mean_norm;
-acceleration_mean_normalized[1]=(g*acceleration_mean[1])/acceleration_mean_norm;
-acceleration_mean_normalized[2]=(g*acceleration_mean[2])/acceleration_mean_norm;
-
-Test_statistics=0;
-for(ctr=0;ctr<detector_Window_size;ctr++){
+	for(j=3+m;j<9;j++){
+		f[j]=(j==3+m) ? 1 : cov_UD[MAT9SYM_INDEX(3+m,j)];
+		v[j]=cov_UD[MAT9SYM_INDEX(j,j)]*f[j];
+	}
 	
-	tmp1[0]=acc_buffer_x_axis[ctr]-acceleration_mean_normalized[0];
-	tmp1[1]=acc_buffer_y_axis[ctr]-acceleration_mean_normalized[1];
-	tmp1[2]=acc_buffer_z_axis[ctr]-acceleration_mean_normalized[2];
+	for(j=3+m;j<9;j++){
+		alpha_new=alpha+f[j]*v[j];
+		cov_UD[MAT9SYM_INDEX(j,j)]=cov_UD[MAT9SYM_INDEX(j,j)]*(alpha/alpha_new);
+		b[j]=v[j];
+		p=-f[j]/alpha;
+		for(i=0;i<j;i++){
+			u=cov_UD[MAT9SYM_INDEX(i,j)];
+			cov_UD[MAT9SYM_INDEX(i,j)]=u+b[i]*p;
+			b[i]=b[i]+u*v[j];
+		}
+		alpha=alpha_new;
+	}
 	
-	tmp2[0]=gyro_buffer_x_axis[ctr];
-	tmp2[1]=gyro_buffer_y_axis[ctr];
-	tmp2[2]=gyro_buffer_z_axis[ctr];
+	/******************* Accumulate the gain of the joint update *****************/
 	
-	Test_statistics=Test_statistics+vecnorm2(tmp1,3)/sigma2_acc_det+vecnorm2(tmp2,3)/sigma2_gyro_det;	
-}
-Test_statistics=Test_statistics/detector_Window_size;
-
-
-	/******************** Check if the test statistics T are below or above the detector threshold ******************/
-	if(Test_statistics<detector_threshold){
-	zupt=true;
-	}  
-	else{
-	zupt=false;	
+	// The estimate after measurement m is x=x+k*(y[m]-x[3+m]) with the scalar gain k=b/alpha, which gives the 
+	// gain matrix of the three measurements processed jointly as K=K-k*K[3+m,:] followed by K[:,m]=K[:,m]+k. 
+	for(i=0;i<9;i++){
+		b[i]=b[i]/alpha;
 	}
-	
+	for(j=0;j<3;j++){
+		tmp=kalman_gain[3*(3+m)+j];
+		for(i=0;i<9;i++){
+			kalman_gain[3*i+j]=kalman_gain[3*i+j]-b[i]*tmp;
+		}
+	}
+	for(i=0;i<9;i++){
+		kalman_gain[3*i+m]=kalman_gain[3*i+m]+b[i];
+	}
+}
 }
 
 //@}
@@ -1133,15 +1221,19 @@ Test_statistics=Test_statistics/detector_Window_size;
 	@{
 */
 
-void initialize_navigation_algorithm(void){
+void nav_initialize_navigation_algorithm(nav_filter_t *filter, const vec3 accelerations_in){
 	
 	
+// Filter parameters
+const nav_params_t *params=&filter->params;
+const uint8_t nr_of_inital_alignment_samples=params->nr_of_inital_alignment_samples;
+
 // Counter that counts the number of initialization samples that have been processed.						
-static uint8_t initialize_sample_ctr;	
+uint8_t initialize_sample_ctr=filter->initialize_sample_ctr;	
 
 
 // Mean acceleration vector used in the initial alignment.      
-static vec3 acceleration_mean;	
+precision *acceleration_mean=filter->initialize_acceleration_mean;	
 
 // Reset the mean if we start a new initialization
 if (initialize_sample_ctr==0)
@@ -1178,11 +1270,11 @@ vec3 initial_attitude;
 
 
 	//Calculate the roll and pitch
-	initial_attitude[0]=atan2(-acceleration_mean[1],-acceleration_mean[2]);		//roll
-	initial_attitude[1]=atan2(acceleration_mean[0],sqrt_hf((acceleration_mean[1]*acceleration_mean[1])+(acceleration_mean[2]*acceleration_mean[2]))); //pitch
+	initial_attitude[0]=atan2_hf(-acceleration_mean[1],-acceleration_mean[2]);		//roll
+	initial_attitude[1]=atan2_hf(acceleration_mean[0],sqrt_hf((acceleration_mean[1]*acceleration_mean[1])+(acceleration_mean[2]*acceleration_mean[2]))); //pitch
 	
 	//Set the initial heading
-	initial_attitude[2]=initial_heading;
+	initial_attitude[2]=params->initial_heading;
 	
 	
 	// Calculate the initial rotation matrix, used as temporary variable in the calculation of the initial quaternions 
@@ -1192,49 +1284,52 @@ vec3 initial_attitude;
 	
 	
 	//Set the initial quaternions using the initial rotation matrix
-	rotation2quat(quaternions,initial_rotmat);
+	rotation2quat(filter->quaternions,initial_rotmat);
 	
 	//Set the initial velocity (must be zero)
-	velocity[0]=0;
-	velocity[1]=0;
-	velocity[2]=0;
+	filter->velocity[0]=0;
+	filter->velocity[1]=0;
+	filter->velocity[2]=0;
 	
 	//Set the initial position
-	position[0]=initial_pos[1];
-	position[1]=initial_pos[1];
-	position[2]=initial_pos[2];
+	filter->position[0]=params->initial_pos[1];
+	filter->position[1]=params->initial_pos[1];
+	filter->position[2]=params->initial_pos[2];
 	
 	
 	// Set the gravity magnitude based upon the latitude and height of the navigation platform. 
-	gravity();
+	gravity(&filter->params);
 	
 	/*************************************************************/
 	
 	
 	
 	/************** Initialize the filter covariance *************/ 
-	cov_vector[0]=sigma_initial_position[0]*sigma_initial_position[0];
-	cov_vector[9]=sigma_initial_position[1]*sigma_initial_position[1];
-	cov_vector[17]=sigma_initial_position[2]*sigma_initial_position[2];
+	filter->cov_vector[0]=params->sigma_initial_position[0]*params->sigma_initial_position[0];
+	filter->cov_vector[9]=params->sigma_initial_position[1]*params->sigma_initial_position[1];
+	filter->cov_vector[17]=params->sigma_initial_position[2]*params->sigma_initial_position[2];
 	
 
-	cov_vector[24]=sigma_initial_velocity[0]*sigma_initial_velocity[0];
-	cov_vector[30]=sigma_initial_velocity[1]*sigma_initial_velocity[1];
-	cov_vector[35]=sigma_initial_velocity[2]*sigma_initial_velocity[2];
+	filter->cov_vector[24]=params->sigma_initial_velocity[0]*params->sigma_initial_velocity[0];
+	filter->cov_vector[30]=params->sigma_initial_velocity[1]*params->sigma_initial_velocity[1];
+	filter->cov_vector[35]=params->sigma_initial_velocity[2]*params->sigma_initial_velocity[2];
+	
 	
+	filter->cov_vector[39]=params->sigma_initial_attitude[0]*params->sigma_initial_attitude[0];
+	filter->cov_vector[42]=params->sigma_initial_attitude[1]*params->sigma_initial_attitude[1];
+	filter->cov_vector[44]=params->sigma_initial_attitude[2]*params->sigma_initial_attitude[2];
 	
-	cov_vector[39]=sigma_initial_attitude[0]*sigma_initial_attitude[0];
-	cov_vector[42]=sigma_initial_attitude[1]*sigma_initial_attitude[1];
-	cov_vector[44]=sigma_initial_attitude[2]*sigma_initial_attitude[2];
+	filter->cov_UD_active=false;
 	/*************************************************************/
 	
 	//Reset the initialization ctr
 	initialize_sample_ctr=0;
 
 	//Turn of the initialization flag
-	initialize_flag=false;
+	filter->initialize_flag=false;
 }
 
+filter->initialize_sample_ctr=initialize_sample_ctr;
 
 }
 
@@ -1255,11 +1350,12 @@ void estimate_accelerometer_biases(void){
 	precision tmp3;				//Aiding variable
 	uint8_t index;				//Variable indicating the element index of the maximum value of a vector  		
 	precision maximum_value;	//The maximum value of a vector			
-	uint8_t orientation_check;	//Variable used in the check of the goodness of the user chosen orientations. 	
+	uint8_t orientation_check=0;	//Variable used in the check of the goodness of the user chosen orientations. 	
 	
 	
 	// Set the magnitude of the gravity magnitude based upon the latitude and height of the navigation system.
-	gravity();
+	gravity(&nav_filter.params);
+	const precision g=nav_filter.params.g;
 	
 	//*********************** Check if the excitation is sufficient *****************************************//
 	
@@ -1278,10 +1374,10 @@ void estimate_accelerometer_biases(void){
 		tmp1[1]=absf(acceleration_mean_matrix[1][orientation_ctr]);
 		tmp1[2]=absf(acceleration_mean_matrix[2][orientation_ctr]);
 	
-		max_value(&maximum_value,&index,tmp1);
+		max_value(&maximum_value,&index,tmp1,3);
 		
 		//Test if the absolute value of the largest element in the  acceleration mean vector at orientation given by "orientation_ctr" is within cos(pi/18) of g.  
-		if((maximum_value-cos(M_PI/18)*g)>0)
+		if((maximum_value-cos_hf(M_PI/18)*g)>0)
 		{
 			orientation_check|=(1<<index);						
 		}   
@@ -1423,21 +1519,148 @@ void calibrate_accelerometers(void){
 */
 
 /// Routine collecting the functions which need to be run to make a ZUPT update.
-void zupt_update(void){
-	if(zupt)
+void nav_zupt_update(nav_filter_t *filter){
+	if(filter->zupt)
 	{
 	
 		//Calculate the Kalman filter gain
-		gain_matrix();	
+		nav_gain_matrix(filter);	
 	
 		//Correct the navigation states
-		correct_navigation_states();	
+		nav_correct_navigation_states(filter);	
 	
 		//Update the covariance matrix
-		measurement_update();		
+		nav_measurement_update(filter);		
 	}
 }
 
+
+/// Routine collecting the functions which need to be run to make a ZUPT update with the UD factorized covariance.
+void nav_zupt_update_UD(nav_filter_t *filter){
+	if(filter->zupt)
+	{
+		
+		//Calculate the Kalman filter gain and update the covariance factors
+		nav_measurement_update_UD(filter);
+		
+		//Correct the navigation states
+		nav_correct_navigation_states(filter);
+	}
+}
+
+
+/// Routine resetting a filter context to the default parameters and starting a new initial alignment.
+void nav_filter_init(nav_filter_t *filter){
+	memset(filter,0,sizeof(nav_filter_t));
+	filter->params=nav_default_params;
+	filter->initialize_flag=true;
+}
+
+/// Routine copying the navigation states and the covariance of a filter context to a checkpoint.
+void nav_save_checkpoint(const nav_filter_t *filter, nav_checkpoint_t *checkpoint){
+	memcpy(checkpoint->position,filter->position,sizeof(vec3));
+	memcpy(checkpoint->velocity,filter->velocity,sizeof(vec3));
+	memcpy(checkpoint->quaternions,filter->quaternions,sizeof(quat_vec));
+	memcpy(checkpoint->cov,filter->cov_UD_active ? filter->cov_UD : filter->cov_vector,sizeof(mat9sym));
+	checkpoint->cov_UD_active=filter->cov_UD_active;
+}
+
+/**
+	\brief Routine resuming a filter context from a checkpoint instead of doing an initial alignment.
+
+	\details The rotation matrix and the gravity magnitude, which are otherwise set in the initial alignment, are
+	calculated from the checkpoint and the parameters. A running initial alignment is abandoned.
+*/
+void nav_resume_from_checkpoint(nav_filter_t *filter, const nav_checkpoint_t *checkpoint){
+	memcpy(filter->position,checkpoint->position,sizeof(vec3));
+	memcpy(filter->velocity,checkpoint->velocity,sizeof(vec3));
+	memcpy(filter->quaternions,checkpoint->quaternions,sizeof(quat_vec));
+	quat2rotation(filter->Rb2t,filter->quaternions);
+	memcpy(checkpoint->cov_UD_active ? filter->cov_UD : filter->cov_vector,checkpoint->cov,sizeof(mat9sym));
+	filter->cov_UD_active=checkpoint->cov_UD_active;
+	gravity(&filter->params);
+	filter->zupt=false;
+	filter->initialize_sample_ctr=0;
+	filter->initialize_flag=false;
+}
+
+//@}
+
+/**
+	\defgroup global_func Processing functions
+	\brief void(void) versions of the ZUPT aided INS functions operating on the global filter context #nav_filter. 
+	These are the functions that are called from the process sequence of the runtime framework.
+
+	@{
+*/
+
+/// Forward an error signaled by the global filter context to the system error signal.
+static inline void nav_filter_forward_error(void){
+	if(nav_filter.error_signal)
+	{
+		error_signal=nav_filter.error_signal;
+		nav_filter.error_signal=0;
+	}
+}
+
+void update_imu_data_buffers(void){
+	nav_update_imu_data_buffers(&nav_filter,accelerations_in,angular_rates_in);
+}
+
+void strapdown_mechanisation_equations(void){
+	nav_strapdown_mechanisation_equations(&nav_filter);
+}
+
+void time_up_data(void){
+	nav_time_up_data(&nav_filter);
+}
+
+void gain_matrix(void){
+	nav_gain_matrix(&nav_filter);
+	nav_filter_forward_error();
+}
+
+void measurement_update(void){
+	nav_measurement_update(&nav_filter);
+}
+
+void correct_navigation_states(void){
+	nav_correct_navigation_states(&nav_filter);
+}
+
+void ZUPT_detector(void){
+	nav_ZUPT_detector(&nav_filter);
+}
+
+void MV_detector(void){
+	nav_MV_detector(&nav_filter);
+}
+
+void MAG_detector(void){
+	nav_MAG_detector(&nav_filter);
+}
+
+void ARE_detector(void){
+	nav_ARE_detector(&nav_filter);
+}
+
+void initialize_navigation_algorithm(void){
+	nav_initialize_navigation_algorithm(&nav_filter,accelerations_in);
+}
+
+void zupt_update(void){
+	nav_zupt_update(&nav_filter);
+	nav_filter_forward_error();
+}
+
+void time_up_data_UD(void){
+	nav_time_up_data_UD(&nav_filter);
+}
+
+void zupt_update_UD(void){
+	nav_zupt_update_UD(&nav_filter);
+}
+
 //@}
 
 //@}
@@ -24,7 +24,14 @@
 #include "nav_types.h"
 #include <math.h>
 #include <stdint.h>
+
+#if defined(__AVR32__) || defined(__ICCAVR32__)
 #include "compiler.h"
+#else
+// Host build: provide the ASF boolean types without pulling in the AVR32 headers.
+#include <stdbool.h>
+typedef unsigned char Bool;
+#endif
 
 
 //************* Definitions *************//
@@ -55,6 +62,205 @@
 #define absf(a)(a>0 ? a:-a)
 
 
+//************* Type definitions *************//
+
+/*! \brief Running sums of the IMU data buffers used by the zero-velocity detector.
+
+	\details The accelerations are summed relative to a reference point close to the mean acceleration, which keeps
+	the cancellation in the test statistic small when the IMU is stationary.
+*/
+typedef struct {
+	/// Reference point of the acceleration sums [\f$m/s^2\f$].
+	vec3 acc_ref;
+	/// Sum of the accelerations minus the reference point [\f$m/s^2\f$].
+	vec3 acc_sum;
+	/// Sum of the squared norms of the accelerations minus the reference point [\f$(m/s^2)^2\f$].
+	precision acc_sum2;
+	/// Sum of the squared norms of the angular rates [\f$(rad/s)^2\f$].
+	precision gyro_sum2;
+} nav_detector_sums_t;
+
+/*! \brief Parameters controlling the behavior of one instance of the navigation algorithm.
+
+	\note The default noise standard deviation figures are not set to reflect the true noise figures of the IMU
+	sensors, but rather to model the sum of all the errors (biases, scale factors, nonlinearities, etc.) in the
+	system and the measurement model. All parameters, except the \a detector_Window_size, may be changed while the
+	navigation algorithm is running in order to adapt the filter and the detector to the current motion dynamics.
+*/
+typedef struct {
+	///\name General control parameters
+	//@{
+	/// Rough latitude of the system [\f$degrees\f$]. (Used to calculate the magnitude of the gravity vector)
+	precision latitude;
+	/// Rough altitude of the system [\f$m\f$]. (Used to calculate the magnitude of the gravity vector)
+	precision altitude;
+	/// Magnitude of the local gravity acceleration [\f$m/s^2\f$]
+	precision g;
+	/// Sampling period [\f$s\f$]
+	precision dt;
+	//@}
+
+	///\name Initialization control parameters
+	//@{
+	/// Number of samples used in the initial alignment.
+	uint8_t nr_of_inital_alignment_samples;
+	/// Initial heading [\f$rad\f$]
+	precision initial_heading;
+	/// Initial position (North, East, Down) [\f$m\f$]
+	vec3 initial_pos;
+	/// Standard deviations in the initial position uncertainties [\f$m\f$].
+	vec3 sigma_initial_position;
+	/// Standard deviations in the initial velocity uncertainties [\f$m/s\f$].
+	vec3 sigma_initial_velocity;
+	/// Standard deviations in the initial attitude uncertainties [\f$rad\f$].
+	vec3 sigma_initial_attitude;
+	//@}
+
+	///\name Kalman filter control parameters
+	//@{
+	/// Accelerometer process noise standard deviation [\f$m/s^2\f$]
+	precision sigma_acceleration;
+	/// Gyroscope process noise standard deviation [\f$rad/s\f$]
+	precision sigma_gyroscope;
+	/// Pseudo zero-velocity measurement noise standard deviations (north, east, down) [\f$m/s\f$]
+	vec3 sigma_velocity;
+	//@}
+
+	///\name Zero-velocity detector control parameters
+	//@{
+	/// Accelerometer noise standard deviation figure [\f$m/s^2\f$], which is used to control how much the detector should trusts the accelerometer data.
+	precision sigma_acc_det;
+	/// Gyroscope noise standard deviation figure [\f$rad/s\f$], which is used to control how much the detector should trusts the gyroscope data.
+	precision sigma_gyro_det;
+	/// The data window size used in the detector (OBS! Must be an odd number.).
+	uint8_t detector_Window_size;
+	/// Threshold used in the detector.
+	precision detector_threshold;
+	/// Threshold used in the acceleration moving variance detector, see MV_detector().
+	precision detector_threshold_MV;
+	/// Threshold used in the acceleration magnitude detector, see MAG_detector().
+	precision detector_threshold_MAG;
+	/// Threshold used in the angular rate energy detector, see ARE_detector().
+	precision detector_threshold_ARE;
+	//@}
+} nav_params_t;
+
+
+/*! \brief Context holding the complete state of one instance of the ZUPT aided INS.
+
+	\details All the filtering functions exist in a version taking a pointer to a context as their argument. Since a
+	context holds all the states and parameters of a filter, any number of filters can be run independently of each
+	other, e.g. from different threads. The void(void) functions operate on the global context #nav_filter.
+*/
+typedef struct {
+	/// Parameters of the filter.
+	nav_params_t params;
+
+	///\name Navigation and filter state variables
+	//@{
+	///  Position estimate (North,East,Down) [\f$m\f$].
+	vec3 position;
+	/// Velocity estimate (North,East,Down) [\f$m/s\f$]
+	vec3 velocity;
+	/// Attitude (quaternions) estimate
+	quat_vec quaternions;
+	/// Rotation matrix used as an "aiding" variable in the filter algorithm. Holds the same information as the quaternions.
+	mat3 Rb2t;
+	/// Vector representation of the Kalman filter covariance matrix.
+	mat9sym cov_vector;
+	/// Vector representation of the Kalman filter gain matrix.
+	mat9by3 kalman_gain;
+	/*! UD factors of the Kalman filter covariance matrix, \f$P=UDU^T\f$, stored as a #mat9sym with \f$D\f$ on 
+		the diagonal and the strictly upper triangular part of \f$U\f$ above it. See \ref ud_func. */
+	mat9sym cov_UD;
+	/*! True if the covariance is held by #cov_UD, false if it is held by #cov_vector. The routines of each 
+		representation convert the covariance if the other representation is active, so the time and 
+		measurement updates of the two representations may be switched between at any time. */
+	Bool cov_UD_active;
+	//@}
+
+	///\name IMU data buffer variables
+	//@{
+	/// Buffer for the x-axis accelerometer readings.
+	precision acc_buffer_x_axis[UINT8_MAX];
+	/// Buffer for the y-axis accelerometer readings.
+	precision acc_buffer_y_axis[UINT8_MAX];
+	/// Buffer for the z-axis accelerometer readings.
+	precision acc_buffer_z_axis[UINT8_MAX];
+	/// Buffer for the x-axis gyroscope readings.
+	precision gyro_buffer_x_axis[UINT8_MAX];
+	/// Buffer for the y-axis gyroscope readings.
+	precision gyro_buffer_y_axis[UINT8_MAX];
+	/// Buffer for the z-axis gyroscope readings.
+	precision gyro_buffer_z_axis[UINT8_MAX];
+	/// The index of the IMU data buffers which the data from the IMU should be written to.
+	uint8_t in_data_buffer_index;
+	/// Accelerations outputted from the IMU data buffer [\f$m/s^2\f$].
+	vec3 accelerations_out;
+	/// Angular rates outputted from the IMU data buffer [\f$rad/s\f$].
+	vec3 angular_rates_out;
+	//@}
+
+	///\name Initialization variables
+	//@{
+	/// A flag that should be set to true when initialization is started and that becomes false when the initialization is finished.
+	Bool initialize_flag;
+	/// Counter that counts the number of initialization samples that have been processed.
+	uint8_t initialize_sample_ctr;
+	/// Mean acceleration vector used in the initial alignment.
+	vec3 initialize_acceleration_mean;
+	//@}
+
+	///\name Zero-velocity detector variables
+	//@{
+	/// Flag that is set to true if a zero-velocity update should be done.
+	bool zupt;
+	///Variable holding the test statistics for the generalized likelihood ratio test, i.e., the zero-velocity detector.
+	precision Test_statistics;
+	/*! Running sums over the samples of the detector window, updated by nav_update_imu_data_buffers() such that
+		the test statistic is calculated in constant time. */
+	nav_detector_sums_t detector_sums;
+	/*! Sums accumulated from scratch since the last refresh. They replace #detector_sums when they cover a full
+		window, which bounds the rounding errors of the running sums. */
+	nav_detector_sums_t detector_next_sums;
+	/// Number of samples in #detector_next_sums.
+	uint8_t detector_next_count;
+	/// Window size that the sums were calculated for, the sums are recalculated if the window size is changed.
+	uint8_t detector_sums_window;
+	//@}
+
+	/// Error signaling variable of the filter. If zero no error has occurred.
+	uint8_t error_signal;
+} nav_filter_t;
+
+/*! \brief Navigation states and covariance of a filter from which it can be resumed without a new initial alignment.
+
+	\details See nav_save_checkpoint() and nav_resume_from_checkpoint(). The covariance is held in the representation
+	that was active in the filter.
+*/
+typedef struct {
+	///  Position estimate (North,East,Down) [\f$m\f$].
+	vec3 position;
+	/// Velocity estimate (North,East,Down) [\f$m/s\f$]
+	vec3 velocity;
+	/// Attitude (quaternions) estimate
+	quat_vec quaternions;
+	/// Covariance matrix, or its UD factors if #cov_UD_active.
+	mat9sym cov;
+	/// True if #cov holds the UD factors of the covariance matrix.
+	Bool cov_UD_active;
+} nav_checkpoint_t;
+
+
+//************* Global variables *************//
+
+/// Default parameters of the navigation algorithm.
+extern const nav_params_t nav_default_params;
+
+/// The filter context that the void(void) processing functions operate on.
+extern nav_filter_t nav_filter;
+
+
 //************* Function declarations  **************//
 
 
@@ -220,6 +426,24 @@ void strapdown_mechanisation_equations(void);
 void time_up_data(void);
 
 
+/*! \brief Function for doing a time update of the UD factorized Kalman filter state covariance.
+	
+
+	\details Does the same time update as time_up_data(), but on the UD factors of the covariance matrix stored in
+	\a cov_UD, using the modified weighted Gram-Schmidt orthogonalization. The factorization remains positive 
+	definite in single precision, at the cost of more operations than time_up_data(). Must be used together with 
+	zupt_update_UD().
+	
+	 @param[in,out] cov_UD			The UD factors of the Kalman filter covariance matrix. 
+	 @param[in] dt					The sampling period of the system.
+	 @param[in] sigma_acceleration	The standard deviation of the accelerometer process noise.
+	 @param[in] sigma_gyroscope		The standard deviation of the gyroscope process noise.	 
+	 @param[in] accelerations_out	The acceleration measurements used in the update of the inertial navigation system equations.
+	 @param[in] Rb2t				The vector current body to navigation coordinate system rotation matrix estimate.
+ */ 
+void time_up_data_UD(void);
+
+
 
 /*! \brief Function that updates the IMU data buffers with the latest values read from the IMU, and writes 
 	the IMU data to that should be process at the current iteration to the processing variables. 
@@ -249,6 +473,8 @@ void update_imu_data_buffers(void);
 	\li <A href="https://eeweb01.ee.kth.se/upload/publications/reports/2010/IR-EE-SB_2010_038.pdf">Zero-Velocity Detection -- An Algorithm Evaluation</A>                    
 	\li <A href="https://eeweb01.ee.kth.se/upload/publications/reports/2010/IR-EE-SB_2010_043.pdf">Evaluation of Zero-Velocity Detectors for Foot-Mounted Inertial Navigation Systems</A>                     
 	
+	The test statistic is calculated in constant time from running sums over the detector window, which are updated
+	by update_imu_data_buffers(). The cost of the detector therefore does not depend on the window size.
 	
 	 @param[out]	zupt					The zero-velocity detection flag 
 	 @param[in]		detector_Window_size	The window size of the zero-velocity detector.
@@ -259,6 +485,53 @@ void update_imu_data_buffers(void);
 */ 
 void ZUPT_detector(void);
 
+
+/*! \brief Acceleration moving variance (MV) zero-velocity detector.
+
+	\details Alternative to ZUPT_detector() which only uses the accelerometer data. The test statistic is the variance
+	of the accelerations within the detector window, normalized with \a sigma_acc_det, and the system is considered
+	stationary if it is below \a detector_threshold_MV. The test statistic is calculated in constant time from the
+	running sums of update_imu_data_buffers(). The detector is cheaper than the GLRT, but since the gyroscope data
+	is not used it is less reliable at slow motions. See the papers referenced in ZUPT_detector().
+	
+	 @param[out]	zupt					The zero-velocity detection flag 
+	 @param[in]		detector_Window_size	The window size of the zero-velocity detector.
+	 @param[in]		detector_threshold_MV	The threshold used in the detector.
+	 @param[in]		sigma_acc_det			The standard deviation figure of the accelerometer measurements.
+*/
+void MV_detector(void);
+
+
+/*! \brief Acceleration magnitude (MAG) zero-velocity detector.
+
+	\details Alternative to ZUPT_detector() which only uses the accelerometer data. The test statistic is the mean
+	squared difference between the magnitude of the accelerations within the detector window and \a g, normalized
+	with \a sigma_acc_det, and the system is considered stationary if it is below \a detector_threshold_MAG. The 
+	magnitudes are calculated for each sample of the window, so the cost grows with the window size.
+	
+	 @param[out]	zupt					The zero-velocity detection flag 
+	 @param[in]		detector_Window_size	The window size of the zero-velocity detector.
+	 @param[in]		detector_threshold_MAG	The threshold used in the detector.
+	 @param[in]		sigma_acc_det			The standard deviation figure of the accelerometer measurements.
+	 @param[in]		g						The magnitude of the local gravity vector.	 
+*/
+void MAG_detector(void);
+
+
+/*! \brief Angular rate energy (ARE) zero-velocity detector.
+
+	\details Alternative to ZUPT_detector() which only uses the gyroscope data. The test statistic is the mean
+	energy of the angular rates within the detector window, normalized with \a sigma_gyro_det, and the system is
+	considered stationary if it is below \a detector_threshold_ARE. The test statistic is taken directly from the
+	running sums of update_imu_data_buffers(), which makes it the cheapest of the detectors.
+	
+	 @param[out]	zupt					The zero-velocity detection flag 
+	 @param[in]		detector_Window_size	The window size of the zero-velocity detector.
+	 @param[in]		detector_threshold_ARE	The threshold used in the detector.
+	 @param[in]		sigma_gyro_det			The standard deviation figure of the gyroscope measurements.
+*/
+void ARE_detector(void);
+
    
 
 /*! \brief	Wrapper function that checks if a zero-velocity update should be done, and then calls all navigation algorithm 
@@ -276,6 +549,93 @@ void ZUPT_detector(void);
 void zupt_update(void);
 
 
+/*! \brief	Wrapper function for the zero-velocity update with the UD factorized covariance.   
+	
+
+	\details Same as zupt_update(), but if the flag \a zupt is set, the Kalman filter gain and the measurement 
+			update of the UD factors of the covariance are calculated together by nav_measurement_update_UD(), 
+			processing the three velocity measurements one at a time. Then correct_navigation_states is called.
+*/ 
+void zupt_update_UD(void);
+
+
+
+//************* Reentrant function declarations  **************//
+
+/*! \name Reentrant versions of the ZUPT aided INS functions.
+
+	\details The functions below do the same processing as the void(void) functions with the corresponding names, 
+	but operate on the filter context pointed to by \a filter rather than on the global context #nav_filter. 
+	No global variables are read or written, hence separate contexts can be processed concurrently. Errors 
+	are signaled in \a filter->error_signal. 
+*/
+//@{
+
+/// Resets the context \a filter to the default parameters and zero states, and sets the \a initialize_flag. 
+void nav_filter_init(nav_filter_t *filter);
+
+/// Copies the navigation states and the covariance of \a filter, which should have finished its initial alignment, to \a checkpoint.
+void nav_save_checkpoint(const nav_filter_t *filter, nav_checkpoint_t *checkpoint);
+
+/*! Restores the navigation states and the covariance of \a filter from \a checkpoint and ends the initial alignment, such
+	that the ZUPT aided INS can continue at the next sample. The parameters and the IMU data buffers are kept. */
+void nav_resume_from_checkpoint(nav_filter_t *filter, const nav_checkpoint_t *checkpoint);
+
+/// See update_imu_data_buffers(). The IMU data is taken from \a accelerations_in and \a angular_rates_in.
+void nav_update_imu_data_buffers(nav_filter_t *filter, const vec3 accelerations_in, const vec3 angular_rates_in);
+
+/// See initialize_navigation_algorithm(). The accelerometer data is taken from \a accelerations_in.
+void nav_initialize_navigation_algorithm(nav_filter_t *filter, const vec3 accelerations_in);
+
+/// See strapdown_mechanisation_equations().
+void nav_strapdown_mechanisation_equations(nav_filter_t *filter);
+
+/// See time_up_data().
+void nav_time_up_data(nav_filter_t *filter);
+
+/// See ZUPT_detector().
+void nav_ZUPT_detector(nav_filter_t *filter);
+
+/// See MV_detector().
+void nav_MV_detector(nav_filter_t *filter);
+
+/// See MAG_detector().
+void nav_MAG_detector(nav_filter_t *filter);
+
+/// See ARE_detector().
+void nav_ARE_detector(nav_filter_t *filter);
+
+/// See gain_matrix().
+void nav_gain_matrix(nav_filter_t *filter);
+
+/// See correct_navigation_states().
+void nav_correct_navigation_states(nav_filter_t *filter);
+
+/// See measurement_update().
+void nav_measurement_update(nav_filter_t *filter);
+
+/// See zupt_update().
+void nav_zupt_update(nav_filter_t *filter);
+
+/// See time_up_data_UD().
+void nav_time_up_data_UD(nav_filter_t *filter);
+
+/*! Calculates the Kalman filter gain \a kalman_gain and does the measurement update of the UD factors \a cov_UD.
+	The gain is that of the three velocity measurements processed jointly, such that nav_correct_navigation_states()
+	can be used for the correction. */
+void nav_measurement_update_UD(nav_filter_t *filter);
+
+/// See zupt_update_UD().
+void nav_zupt_update_UD(nav_filter_t *filter);
+
+/// Factorizes the covariance matrix \a cov_vector into \a cov_UD and sets \a cov_UD_active.
+void nav_covariance_to_UD(nav_filter_t *filter);
+
+/// Calculates the covariance matrix \a cov_vector from \a cov_UD and clears \a cov_UD_active.
+void nav_UD_to_covariance(nav_filter_t *filter);
+//@}
+
+
 #endif /* NAV_EQ_H_ */
 
 //@}
@@ -0,0 +1,212 @@
+/*! \file
+	\brief Math kernels used by the OpenShoe navigation algorithm.
+
+	\details This header collects the scalar and vector primitives (square root, reciprocal square root,
+	trigonometric functions and small vector operations) that the navigation algorithm is built upon. The
+	implementation is selected at compile time such that the same filter code can be built both for the
+	micro-controller and for a host computer:
+
+	\li AVR32 (\a __AVR32__ defined): The square roots are calculated with the \a frsqrta.s instruction of the
+		UC3C floating point unit refined with Newton-Raphson iterations. The trigonometric functions are taken from
+		the standard library.
+	\li SSE (x86 with \a __SSE__ defined): The square roots are calculated with the native SSE instructions and the
+		single precision versions of the standard library trigonometric functions are used. The vector primitives use
+		the SSE4.1 dot product instruction if available (e.g. when compiling with -march=native on an AVX machine).
+	\li Generic: Plain C implementation based upon the standard library. Can be forced by defining
+		\a NAV_KERNEL_GENERIC.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/** \defgroup nav_kernels Math kernels
+	\brief Scalar and vector primitives used by the navigation algorithm.
+	\ingroup nav_eq
+	@{
+*/
+
+#ifndef NAV_KERNELS_H_
+#define NAV_KERNELS_H_
+
+#include "nav_types.h"
+#include <math.h>
+#include <stdint.h>
+
+
+//************* Kernel selection *************//
+
+#if defined(NAV_KERNEL_GENERIC)
+	// Forced by the user, e.g. for comparison with the native kernels.
+#elif defined(__AVR32__) || defined(__ICCAVR32__)
+	#define NAV_KERNEL_AVR32
+#elif defined(__SSE__)
+	#define NAV_KERNEL_SSE
+	#include <immintrin.h>
+#else
+	#define NAV_KERNEL_GENERIC
+#endif
+
+/// Name of the selected kernel implementation.
+#if defined(NAV_KERNEL_AVR32)
+	#define NAV_KERNEL_NAME "avr32"
+#elif defined(NAV_KERNEL_SSE)
+	#define NAV_KERNEL_NAME "sse"
+#else
+	#define NAV_KERNEL_NAME "generic"
+#endif
+
+
+//************* Scalar kernels *************//
+
+/*! \brief Function for calculating the reciprocal square root.
+
+	\details On the AVR32 the reciprocal square root is approximated by the \a frsqrta.s instruction and refined
+	by three Newton-Raphson iterations. On x86 the \a rsqrtss approximation is refined by two iterations. If the
+	precision used is not float the standard square root function is used.
+ */
+static inline precision rsqrt_hf(precision arg){
+
+	if(sizeof(precision)==4)
+	{
+#if defined(NAV_KERNEL_AVR32)
+	float tmp1, tmp2, tmp3;
+	__asm__ __volatile__ ( "frsqrta.s %0, %1" : "=r" (tmp3) : "r" (arg));
+	tmp1 = tmp3*tmp3;
+	tmp2 = 3.0f - tmp1*arg;
+	tmp3 = 0.5f * (tmp2 * tmp3);
+	tmp1 = tmp3*tmp3;
+	tmp2 = 3.0f - tmp1*arg;
+	tmp3 = 0.5f * (tmp2 * tmp3);
+	tmp1 = tmp3*tmp3;
+	tmp2 = 3.0f - tmp1*arg;
+	tmp3 = 0.5f * (tmp2 * tmp3);
+	return tmp3;
+#elif defined(NAV_KERNEL_SSE)
+	float tmp1, tmp2, tmp3;
+	tmp3 = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(arg)));
+	tmp1 = tmp3*tmp3;
+	tmp2 = 3.0f - tmp1*arg;
+	tmp3 = 0.5f * (tmp2 * tmp3);
+	tmp1 = tmp3*tmp3;
+	tmp2 = 3.0f - tmp1*arg;
+	tmp3 = 0.5f * (tmp2 * tmp3);
+	return tmp3;
+#else
+	return 1.0f/sqrtf(arg);
+#endif
+	}
+	else
+	{
+	return 1/sqrt(arg);
+	}
+}
+
+
+/*! \brief Function for calculating the square root.
+
+
+	\details Function for calculating the square root using the hardware multipliers if the precision used is float,
+	otherwise use the standard square root function.
+ */
+static inline precision sqrt_hf(precision arg){
+
+	if(sizeof(precision)==4)
+	{
+#if defined(NAV_KERNEL_AVR32)
+	return rsqrt_hf(arg)*arg;
+#elif defined(NAV_KERNEL_SSE)
+	return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(arg)));
+#else
+	return sqrtf(arg);
+#endif
+	}
+	else
+	{
+	return sqrt(arg);
+	}
+}
+
+
+/// Sine of the argument [rad].
+static inline precision sin_hf(precision arg){
+#if defined(NAV_KERNEL_AVR32)
+	return sin(arg);
+#else
+	return (sizeof(precision)==4) ? sinf(arg) : sin(arg);
+#endif
+}
+
+/// Cosine of the argument [rad].
+static inline precision cos_hf(precision arg){
+#if defined(NAV_KERNEL_AVR32)
+	return cos(arg);
+#else
+	return (sizeof(precision)==4) ? cosf(arg) : cos(arg);
+#endif
+}
+
+/// Four quadrant inverse tangent of y/x [rad].
+static inline precision atan2_hf(precision y, precision x){
+#if defined(NAV_KERNEL_AVR32)
+	return atan2(y,x);
+#else
+	return (sizeof(precision)==4) ? atan2f(y,x) : atan2(y,x);
+#endif
+}
+
+/// Inverse sine of the argument [rad].
+static inline precision asin_hf(precision arg){
+#if defined(NAV_KERNEL_AVR32)
+	return asin(arg);
+#else
+	return (sizeof(precision)==4) ? asinf(arg) : asin(arg);
+#endif
+}
+
+
+//************* Vector kernels *************//
+
+/*! \brief Function that calculates the squared Euclidean norm of a vector.
+
+	 @param[out] norm2				The squared Euclidean norm of the input vector.
+	 @param[in] arg_vec				The input vectors
+	 @param[in] len					The length of the input vector.
+ */
+static inline precision vecnorm2(const precision *arg_vec, uint8_t len)
+{
+#if defined(NAV_KERNEL_SSE) && defined(__SSE4_1__)
+	if(sizeof(precision)==4 && (len==3 || len==4))
+	{
+	const float *v = (const float*)arg_vec;
+	__m128 x = (len==4) ? _mm_loadu_ps(v) : _mm_set_ps(0.0f,v[2],v[1],v[0]);
+	return _mm_cvtss_f32(_mm_dp_ps(x,x,0xF1));
+	}
+#endif
+precision norm2=0;
+uint8_t ctr;
+
+	for (ctr=0; ctr<len; ctr++){
+	norm2=norm2+arg_vec[ctr]*arg_vec[ctr];
+	}
+
+return norm2;
+}
+
+
+/*! \brief Function that multiplies a 3 by 3 matrix with a 3 element vector.
+
+	 @param[out] out				The resulting vector (must not alias \a in_vec).
+	 @param[in] rotmat				Vector (row major) representation of the matrix.
+	 @param[in] in_vec				The input vector.
+ */
+static inline void mat3_vec3_mul(vec3 out, const mat3 rotmat, const vec3 in_vec)
+{
+	out[0]=rotmat[0]*in_vec[0]+rotmat[1]*in_vec[1]+rotmat[2]*in_vec[2];
+	out[1]=rotmat[3]*in_vec[0]+rotmat[4]*in_vec[1]+rotmat[5]*in_vec[2];
+	out[2]=rotmat[6]*in_vec[0]+rotmat[7]*in_vec[1]+rotmat[8]*in_vec[2];
+}
+
+
+#endif /* NAV_KERNELS_H_ */
+
+//@}
@@ -0,0 +1,119 @@
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%> @file read_imu_recording.m
+%>
+%> @brief Function for reading binary IMU recordings.
+%>
+%> @details Function for reading the binary IMU recording format written by
+%> write_imu_recording.m and by the converter imu_convert of the replay
+%> engine (Replay_engine/src/imu_recording.h holds the full description of
+%> the format). The file is little-endian and holds a 96 byte header, a
+%> number of chunks where the samples are stored channel by channel, and a
+%> chunk index.
+%>
+%> @authors Isaac Skog, John-Olof Nilsson
+%> @copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+
+
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  funtion [u info] = read_imu_recording(file_name)
+%
+%>
+%> @brief Function that reads a binary IMU recording.
+%>
+%> @param[out]  u          Matrix of IMU data in SI-units, [f_imu; omega_imu].
+%>                         Each column corresponds to the IMU data sampled
+%>                         at one time instant.
+%> @param[out]  info       Struct with the sample rate [Hz], the time of the
+%>                         first sample [s], the scale factors, the chunk
+%>                         index and, if recorded, the magnetic field [G].
+%> @param[in]   file_name  Name of the recording.
+%>
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+function [u info]=read_imu_recording(file_name)
+
+% Size of the header, alignment of chunks and channels [bytes]
+HEADER_SIZE=96;
+ALIGNMENT=64;
+
+fid=fopen(file_name,'r','l');
+if fid<0
+    error('Could not open %s',file_name);
+end
+
+% Read the header
+magic=fread(fid,[1 8],'*char');
+if ~strcmp(magic,'OSIMUREC')
+    fclose(fid);
+    error('%s is not an IMU recording',file_name);
+end
+info.version=fread(fid,1,'uint16');
+header_size=fread(fid,1,'uint16');
+sample_format=fread(fid,1,'uint8');
+nr_of_channels=fread(fid,1,'uint8');
+fread(fid,1,'uint16');
+nr_of_samples=fread(fid,1,'uint32');
+info.chunk_size=fread(fid,1,'uint32');
+nr_of_chunks=fread(fid,1,'uint32');
+info.sample_rate=fread(fid,1,'float32');
+info.start_time=fread(fid,1,'float64');
+index_offset=fread(fid,1,'uint64');
+info.scale=fread(fid,9,'float32');
+
+if info.version~=1 || header_size<HEADER_SIZE
+    fclose(fid);
+    error('%s has an unsupported format version',file_name);
+end
+
+% Sample format, 0 = float32, 1 = int16
+if sample_format==1
+    info.format='int16';
+    bytes_per_sample=2;
+else
+    info.format='float32';
+    bytes_per_sample=4;
+end
+
+% Read the chunk index
+fseek(fid,index_offset,'bof');
+info.chunks=zeros(nr_of_chunks,4);
+for k=1:nr_of_chunks
+    offset=fread(fid,1,'uint64');
+    first_sample=fread(fid,1,'uint32');
+    n=fread(fid,1,'uint32');
+    start_time=fread(fid,1,'float64');
+    info.chunks(k,:)=[offset first_sample n start_time];
+end
+
+% Read the samples, channel by channel within each chunk
+data=zeros(nr_of_channels,nr_of_samples);
+for k=1:nr_of_chunks
+    offset=info.chunks(k,1);
+    first_sample=info.chunks(k,2);
+    n=info.chunks(k,3);
+    channel_stride=ceil(n*bytes_per_sample/ALIGNMENT)*ALIGNMENT;
+    for ch=1:nr_of_channels
+        fseek(fid,offset+(ch-1)*channel_stride,'bof');
+        samples=fread(fid,[1 n],[info.format '=>double']);
+        if sample_format==1
+            samples=info.scale(ch)*samples;
+        end
+        data(ch,first_sample+1:first_sample+n)=samples;
+    end
+end
+fclose(fid);
+
+u=data(1:6,:);
+if nr_of_channels>6
+    info.magnetic_field=data(7:9,:);
+else
+    info.magnetic_field=[];
+end
+
+end
@@ -190,7 +190,9 @@ end
 %>
 %> @details Function that loads the IMU data set stored in the specfied 
 %> folder. The file should be named ''data_inert.txt''. The data is scaled
-%> to SI-units. 
+%> to SI-units. If the folder also holds the binary recording 
+%> ''data_inert.bin'' (see read_imu_recording.m), that file is read 
+%> instead, which is much faster than parsing the text file.
 %>
 %> @param[out]  u          Matrix of IMU data. Each column corresponed to
 %> the IMU data sampled at one time instant.    
@@ -202,6 +204,12 @@ function [u]=load_dataset()
 
 global simdata;
 
+% Use the binary recording if it exists
+if exist([simdata.path 'data_inert.bin'],'file')
+    u=read_imu_recording([simdata.path 'data_inert.bin']);
+    return;
+end
+
 % Load inertial data
 data_inert_file = fopen( [simdata.path 'data_inert.txt'], 'r');
 
@@ -0,0 +1,135 @@
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%> @file write_imu_recording.m
+%>
+%> @brief Function for writing binary IMU recordings.
+%>
+%> @details Function for writing IMU data in the binary IMU recording
+%> format read by read_imu_recording.m and by the replay engine
+%> (Replay_engine/src/imu_recording.h holds the full description of the
+%> format). Example, converting the data set of the current settings:
+%>
+%> \code
+%> u=settings();
+%> write_imu_recording([simdata.path 'data_inert.bin'],u,1/simdata.Ts);
+%> \endcode
+%>
+%> @authors Isaac Skog, John-Olof Nilsson
+%> @copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+
+
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  funtion write_imu_recording(file_name,u,sample_rate,format,chunk_size,start_time)
+%
+%>
+%> @brief Function that writes a binary IMU recording.
+%>
+%> @param[in]   file_name   Name of the recording.
+%> @param[in]   u           Matrix of IMU data in SI-units, [f_imu; omega_imu]
+%>                          (6 rows) or [f_imu; omega_imu; magnetic_field]
+%>                          (9 rows).
+%> @param[in]   sample_rate Sample rate [Hz].
+%> @param[in]   format      'float32' (default) or 'int16'.
+%> @param[in]   chunk_size  Number of samples per chunk (default 65536).
+%> @param[in]   start_time  Time of the first sample [s] (default 0).
+%>
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+function write_imu_recording(file_name,u,sample_rate,format,chunk_size,start_time)
+
+% Size of the header, alignment of chunks and channels [bytes]
+HEADER_SIZE=96;
+ALIGNMENT=64;
+
+if nargin<4 || isempty(format)
+    format='float32';
+end
+if nargin<5 || isempty(chunk_size)
+    chunk_size=65536;
+end
+if nargin<6 || isempty(start_time)
+    start_time=0;
+end
+
+[nr_of_channels nr_of_samples]=size(u);
+if nr_of_channels~=6 && nr_of_channels~=9
+    error('The IMU data must have 6 or 9 rows');
+end
+
+% Sample format and scale factors. The int16 scale factors are chosen such
+% that the largest magnitude of each channel uses the full range.
+scale=ones(9,1);
+if strcmp(format,'int16')
+    sample_format=1;
+    bytes_per_sample=2;
+    max_abs=max(abs(u),[],2);
+    max_abs(max_abs==0)=1;
+    scale(1:nr_of_channels)=single(max_abs/32767);
+elseif strcmp(format,'float32')
+    sample_format=0;
+    bytes_per_sample=4;
+else
+    error('Unknown sample format %s',format);
+end
+
+fid=fopen(file_name,'w','l');
+if fid<0
+    error('Could not open %s',file_name);
+end
+
+% Write the chunks, channel by channel
+nr_of_chunks=ceil(nr_of_samples/chunk_size);
+chunks=zeros(nr_of_chunks,4);
+position=HEADER_SIZE;
+for k=1:nr_of_chunks
+    first_sample=(k-1)*chunk_size;
+    n=min(chunk_size,nr_of_samples-first_sample);
+    position=ceil(position/ALIGNMENT)*ALIGNMENT;
+    chunks(k,:)=[position first_sample n start_time+first_sample/sample_rate];
+    channel_stride=ceil(n*bytes_per_sample/ALIGNMENT)*ALIGNMENT;
+    for ch=1:nr_of_channels
+        samples=u(ch,first_sample+1:first_sample+n);
+        if sample_format==1
+            samples=max(min(round(samples/double(scale(ch))),32767),-32768);
+        end
+        fseek(fid,0,'eof');
+        fwrite(fid,zeros(1,chunks(k,1)+(ch-1)*channel_stride-ftell(fid)),'uint8');
+        fwrite(fid,samples,format);
+    end
+    position=ftell(fid);
+end
+
+% Write the chunk index
+index_offset=ceil(position/ALIGNMENT)*ALIGNMENT;
+fwrite(fid,zeros(1,index_offset-position),'uint8');
+for k=1:nr_of_chunks
+    fwrite(fid,chunks(k,1),'uint64');
+    fwrite(fid,chunks(k,2),'uint32');
+    fwrite(fid,chunks(k,3),'uint32');
+    fwrite(fid,chunks(k,4),'float64');
+end
+
+% Write the header
+fseek(fid,0,'bof');
+fwrite(fid,'OSIMUREC','char');
+fwrite(fid,1,'uint16');
+fwrite(fid,HEADER_SIZE,'uint16');
+fwrite(fid,sample_format,'uint8');
+fwrite(fid,nr_of_channels,'uint8');
+fwrite(fid,0,'uint16');
+fwrite(fid,nr_of_samples,'uint32');
+fwrite(fid,chunk_size,'uint32');
+fwrite(fid,nr_of_chunks,'uint32');
+fwrite(fid,sample_rate,'float32');
+fwrite(fid,start_time,'float64');
+fwrite(fid,index_offset,'uint64');
+fwrite(fid,scale,'float32');
+fwrite(fid,zeros(1,HEADER_SIZE-84),'uint8');
+fclose(fid);
+
+end
@@ -44,6 +44,10 @@ src\asf\common\services\usb\class\cdc\device\udi_cdc_desc.c
 
 src\asf\common\services\usb\udc\udc.c
 
+src\calibration_record.c
+
+src\flash_log.c
+
 src\interfaces\external_interface.c
 
 src\interfaces\imu_interface.c
@@ -52,6 +56,8 @@ src\main.c
 
 src\process_sequence.c
 
+src\state_checkpoint.c
+
 src\tables\commands.c
 
 src\tables\processing_functions.c
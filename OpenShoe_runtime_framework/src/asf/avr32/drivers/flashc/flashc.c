@@ -284,9 +284,37 @@ unsigned int flashc_get_page_number(void)
 }
 
 
+/*! \brief Writes a command to the FLASHC and waits until it is done, running
+ *         from RAM.
+ *
+ * The CPU stalls on any fetch from the flash until a page erase or write is
+ * done, whereas this function and the NMI of the IMU (exception.S) run from
+ * RAM, so the IMU interrupts keep being served during the operation.
+ *
+ * \param fcmd The value written to the Flash Command Register, key included.
+ *
+ * \return The error status, see \ref flashc_get_error_status.
+ */
+static COMPILER_RAMFUNC unsigned int flashc_ram_issue_command(unsigned int fcmd)
+{
+	unsigned int error_status;
+
+	while (!(AVR32_FLASHC.fsr & AVR32_FLASHC_FSR_FRDY_MASK));
+	AVR32_FLASHC.fcmd = fcmd;
+	error_status = AVR32_FLASHC.fsr & (AVR32_FLASHC_FSR_LOCKE_MASK |
+			AVR32_FLASHC_FSR_PROGE_MASK);
+	while (!(AVR32_FLASHC.fsr & AVR32_FLASHC_FSR_FRDY_MASK));
+	return error_status;
+}
+
+//! Pointer to \ref flashc_ram_issue_command, which is out of reach of a relative call.
+static unsigned int (*const volatile flashc_ram_issue)(unsigned int) = flashc_ram_issue_command;
+
+
 void flashc_issue_command(unsigned int command, int page_number)
 {
 	u_avr32_flashc_fcmd_t u_avr32_flashc_fcmd;
+	irqflags_t flags;
 
 	flashc_wait_until_ready();
 	u_avr32_flashc_fcmd.fcmd = AVR32_FLASHC.fcmd;
@@ -295,9 +323,11 @@ void flashc_issue_command(unsigned int command, int page_number)
 		u_avr32_flashc_fcmd.FCMD.pagen = page_number;
 	}
 	u_avr32_flashc_fcmd.FCMD.key = AVR32_FLASHC_FCMD_KEY_KEY;
-	AVR32_FLASHC.fcmd = u_avr32_flashc_fcmd.fcmd;
-	flashc_error_status = flashc_get_error_status();
-	flashc_wait_until_ready();
+	// The interrupts would stall on their handlers in the flash, only the NMI
+	// is served until the command is done.
+	flags = cpu_irq_save();
+	flashc_error_status = flashc_ram_issue(u_avr32_flashc_fcmd.fcmd);
+	cpu_irq_restore(flags);
 }
 
 
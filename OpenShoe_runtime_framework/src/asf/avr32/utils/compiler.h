@@ -131,6 +131,19 @@
 #define COMPILER_WORD_ALIGNED    COMPILER_PRAGMA(data_alignment = 4)
 #endif
 
+/**
+ * \brief Place a function in RAM, such that it runs while the flash is busy.
+ *
+ * The function is copied to RAM with the initialized data at start-up and is
+ * never inlined into code in the flash. RAM is out of reach of the relative
+ * calls from the flash, so code in the flash must call it through a pointer.
+ */
+#if (defined __GNUC__)
+#define COMPILER_RAMFUNC    __attribute__((__section__(".data.ramfunc"), __noinline__))
+#elif (defined __ICCAVR32__)
+#define COMPILER_RAMFUNC    __ramfunc
+#endif
+
 /**
  * \name System Register Access
  * @{
@@ -648,6 +648,31 @@ udi_cdc_read_buf_loop_wait:
 }
 
 
+iram_size_t udi_cdc_read_buf_nonblocking(void* buf, iram_size_t size)
+{
+	uint8_t *ptr_buf = (uint8_t *)buf;
+	iram_size_t copy_nb;
+	uint16_t pos;
+	uint8_t buf_sel;
+
+	// At most the current buffer and the other one when the current is empty
+	while (size && udi_cdc_is_rx_ready()) {
+		pos = udi_cdc_rx_pos;
+		buf_sel = udi_cdc_rx_buf_sel;
+		copy_nb = udi_cdc_rx_buf_nb[buf_sel] - pos;
+		if (copy_nb>size) {
+			copy_nb = size;
+		}
+		memcpy(ptr_buf, &udi_cdc_rx_buf[buf_sel][pos], copy_nb);
+		udi_cdc_rx_pos += copy_nb;
+		ptr_buf += copy_nb;
+		size -= copy_nb;
+		udi_cdc_rx_start();
+	}
+	return size;
+}
+
+
 bool udi_cdc_is_tx_ready(void)
 {
 	irqflags_t flags;
@@ -746,4 +771,32 @@ udi_cdc_write_buf_loop_wait:
 }
 
 
+iram_size_t udi_cdc_write_buf_nonblocking(const void* buf, iram_size_t size)
+{
+	irqflags_t flags;
+	uint8_t buf_sel;
+	uint16_t buf_nb;
+	iram_size_t copy_nb;
+	const uint8_t *ptr_buf = (const uint8_t *)buf;
+
+	// At most the current buffer and the other one when the current is full
+	while (size && udi_cdc_is_tx_ready()) {
+		flags = cpu_irq_save();
+		buf_sel = udi_cdc_tx_buf_sel;
+		buf_nb = udi_cdc_tx_buf_nb[buf_sel];
+		copy_nb = UDI_CDC_TX_BUFFERS - buf_nb;
+		if (copy_nb>size) {
+			copy_nb = size;
+		}
+		memcpy(&udi_cdc_tx_buf[buf_sel][buf_nb], ptr_buf, copy_nb);
+		udi_cdc_tx_buf_nb[buf_sel] = buf_nb + copy_nb;
+		cpu_irq_restore(flags);
+
+		ptr_buf += copy_nb;
+		size -= copy_nb;
+	}
+	return size;
+}
+
+
 //@}
@@ -273,6 +273,17 @@ int udi_cdc_getc(void);
  */
 iram_size_t udi_cdc_read_buf(int* buf, iram_size_t size);
 
+/**
+ * \brief Reads as much as possible of the received data into a RAM buffer, without waiting
+ * The values are bytes, also if the line coding has 9 data bits.
+ *
+ * \param buf       Values readed
+ * \param size      Size of the buffer
+ *
+ * \return the number of data not read, i.e. the room left in the buffer
+ */
+iram_size_t udi_cdc_read_buf_nonblocking(void* buf, iram_size_t size);
+
 /**
  * \brief This function checks if a new character sent is possible
  * The type int is used to support scanf redirection from compiler LIB.
@@ -301,6 +312,18 @@ int udi_cdc_putc(int value);
  */
 iram_size_t udi_cdc_write_buf(const int* buf, iram_size_t size);
 
+/**
+ * \brief Writes as much as possible of a RAM buffer on CDC line, without waiting
+ * The values are copied with at most one memcpy per transmit buffer.
+ * The values are bytes, also if the line coding has 9 data bits.
+ *
+ * \param buf       Values to write
+ * \param size      Number of value to write
+ *
+ * \return the number of data not written
+ */
+iram_size_t udi_cdc_write_buf_nonblocking(const void* buf, iram_size_t size);
+
 //@}
 
 //@}
@@ -0,0 +1,131 @@
+
+/** \file
+	\brief Storage of the calibration record in the internal flash.
+	
+	\details The record is kept in the first bytes of the flash user page,
+	which is neither erased by a chip erase nor by programming a new
+	firmware. The last two words of the user page hold the configuration of
+	the bootloader and are left untouched, since flashc_memcpy() rewrites
+	the rest of the page with its current content. However, if the page has
+	to be erased, a reset or power loss between the erase and the write
+	leaves the bootloader configuration erased, after which the bootloader
+	may not start the firmware. The page is therefore only erased if the new
+	record sets a bit which is cleared in the current one; storing the first
+	record on an erased page, or the same record again, is a plain write.
+	
+	A record is written as a whole with a CRC-32 over all its bytes. Since
+	its header holds a magic number, the layout version and the size of the
+	record, a record written by a firmware with another layout is not
+	loaded, but the defaults are kept.
+	
+	Writing the flash stalls the CPU for a few milliseconds, so the record
+	should only be stored when the system is idle.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+///	\addtogroup calibration_record
+///	@{
+
+#include <stddef.h>
+#include <string.h>
+
+#include "calibration_record.h"
+#include "flashc.h"
+#include "imu_interface.h"
+
+///\name Location of the calibration record
+//@{
+#define CALIBRATION_RECORD_ADDRESS AVR32_FLASHC_USER_PAGE
+/// Bytes at the end of the user page used by the bootloader
+#define BOOTLOADER_CONFIG_BYTES 8
+//@}
+
+///\cond
+// The record must not overlap the bootloader configuration
+typedef char calibration_record_fits_in_user_page[sizeof(calibration_record) <= AVR32_FLASHC_USER_PAGE_SIZE-BOOTLOADER_CONFIG_BYTES ? 1 : -1];
+
+// Calibrated and set values of the system
+extern vec3 accelerometer_biases;
+extern uint8_t imu_log2_nr_filter_taps;
+///\endcond
+
+/// Calculates the CRC-32 (IEEE 802.3, reflected) of a number of bytes. Also used for the state checkpoints.
+uint32_t calc_crc32(const uint8_t* data, int nrb){
+	uint32_t crc = 0xFFFFFFFF;
+	while(nrb-- > 0){
+		crc ^= *data++;
+		for(int bit=0;bit<8;bit++){
+			crc = (crc>>1) ^ (0xEDB88320 & -(crc & 1));}
+	}
+	return ~crc;
+}
+
+/// Checks the header and the CRC of a record.
+static bool is_valid_record(const calibration_record* record){
+	return record->magic==CALIBRATION_RECORD_MAGIC &&
+		   record->version==CALIBRATION_RECORD_VERSION &&
+		   record->size==sizeof(calibration_record) &&
+		   record->crc==calc_crc32((const uint8_t*)record,offsetof(calibration_record,crc));
+}
+
+/// True if programming the record over the current content of the flash only clears bits, such that no erase is needed.
+static bool only_clears_bits(const calibration_record* record){
+	const uint8_t* current = (const uint8_t*)CALIBRATION_RECORD_ADDRESS;
+	const uint8_t* bytes = (const uint8_t*)record;
+	for(int i=0;i<sizeof(calibration_record);i++){
+		if((current[i] & bytes[i])!=bytes[i]){
+			return false;}}
+	return true;
+}
+
+/**
+	\brief Stores the current calibration results and settings in the calibration record.
+	
+	\details The accelerometer biases, the filter and detector parameters of
+	the global filter context and the IMU low pass filter setting are copied
+	to a record which is written to the flash and read back. The user page
+	is only erased if the record can not be programmed over the current one.
+	
+	\return True if the record was written and read back correctly.
+*/
+bool store_calibration_record(void){
+	calibration_record record;
+	memset(&record,0,sizeof(calibration_record));
+	record.magic = CALIBRATION_RECORD_MAGIC;
+	record.version = CALIBRATION_RECORD_VERSION;
+	record.size = sizeof(calibration_record);
+	memcpy(record.accelerometer_biases,accelerometer_biases,sizeof(vec3));
+	record.nav_params = nav_filter.params;
+	record.imu_log2_nr_filter_taps = imu_log2_nr_filter_taps;
+	record.crc = calc_crc32((const uint8_t*)&record,offsetof(calibration_record,crc));
+	
+	flashc_memcpy((volatile void*)CALIBRATION_RECORD_ADDRESS,&record,sizeof(calibration_record),!only_clears_bits(&record));
+	return !flashc_is_lock_error() && !flashc_is_programming_error() &&
+		   memcmp((const void*)CALIBRATION_RECORD_ADDRESS,&record,sizeof(calibration_record))==0;
+}
+
+/**
+	\brief Loads the calibration record, if there is a valid one.
+	
+	\details Copies the accelerometer biases and the filter and detector
+	parameters of the record to the system and sets the IMU low pass filter.
+	Nothing is changed if there is no valid record. Must be called after
+	the IMU interface is initialized.
+	
+	\return True if a valid record was loaded.
+*/
+bool load_calibration_record(void){
+	const calibration_record* record = (const calibration_record*)CALIBRATION_RECORD_ADDRESS;
+	if(!is_valid_record(record)){
+		return false;}
+	
+	memcpy(accelerometer_biases,record->accelerometer_biases,sizeof(vec3));
+	nav_filter.params = record->nav_params;
+	if(record->imu_log2_nr_filter_taps!=IMU_FILTER_TAPS_NOT_SET){
+		low_pass_filter_setting(record->imu_log2_nr_filter_taps);}
+	return true;
+}
+
+//@}
@@ -0,0 +1,64 @@
+
+/** \file
+	\brief Header file for the calibration record stored in the internal flash.
+	
+	\details The calibration record holds the results of the calibrations and
+	the settings of the system which should survive a power cycle.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+/**
+	\ingroup openshoe_runtime_framework
+	
+	\defgroup calibration_record Calibration record
+	\brief This group contains the storage of the calibration results in flash.
+	@{
+*/
+
+#ifndef CALIBRATION_RECORD_H_
+#define CALIBRATION_RECORD_H_
+
+#include "compiler.h"
+#include "nav_eq.h"
+
+/// Identifies a calibration record ("OSCR")
+#define CALIBRATION_RECORD_MAGIC 0x4F534352
+/// Layout version of the calibration record. Must be incremented when the layout is changed.
+#define CALIBRATION_RECORD_VERSION 1
+
+/// Value of the error signal if the calibration record could not be stored or loaded.
+#define CALIBRATION_RECORD_ERROR 7
+
+/// Calibration record as stored in flash. The record is only used if all header fields and the CRC match.
+typedef struct {
+	///\name Header
+	//@{
+	/// \#CALIBRATION_RECORD_MAGIC
+	uint32_t magic;
+	/// \#CALIBRATION_RECORD_VERSION
+	uint16_t version;
+	/// Size of the record in bytes
+	uint16_t size;
+	//@}
+	/// Accelerometer biases (x,y,z-axis) [\f$m/s^2\f$]
+	vec3 accelerometer_biases;
+	/// Filter and detector parameters
+	nav_params_t nav_params;
+	/// Log2 of the number of taps of the IMU internal low pass filter, \#IMU_FILTER_TAPS_NOT_SET if not set
+	uint8_t imu_log2_nr_filter_taps;
+	///\cond
+	uint8_t reserved[3];
+	///\endcond
+	/// CRC-32 of all preceding bytes of the record
+	uint32_t crc;
+} calibration_record;
+
+uint32_t calc_crc32(const uint8_t* data, int nrb);
+bool store_calibration_record(void);
+bool load_calibration_record(void);
+
+#endif /* CALIBRATION_RECORD_H_ */
+
+//@}
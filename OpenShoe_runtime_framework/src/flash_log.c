@@ -0,0 +1,315 @@
+
+/** \file
+	\brief Ring logger of raw IMU frames in the internal flash.
+	
+	\details When the system runs without USB, the raw burst read frames of the
+	IMU (\#imu_raw_data) are appended to a ring of \#FLASH_LOG_NR_PAGES flash
+	pages, such that the latest minutes of data can be read out when the USB is
+	attached again. The logger flash_log_frame() is called from the main loop
+	rather than from the process sequence, such that it keeps logging when the
+	sequence is replaced, e.g. by a reset of the navigation. It does not log
+	while the USB is attached.
+	
+	The frames are delta-encoded: each word is stored as the difference to the
+	same word of the previous frame, zigzag-mapped to an unsigned number
+	(0,-1,1,-2,... becomes 0,1,2,3,...) and written as a variable length
+	number of 7 bits per byte, least significant first, with the most
+	significant bit of a byte set if more bytes follow. A frame starts with
+	the number of interrupts since the previous frame, written the same way,
+	followed by the \#IMU_RAW_DATA_WORDS words. The interrupt counter also
+	counts the samples found missing from the time-stamps of the interrupts
+	(see interrupt_queue.c), so the gaps of lost samples are kept in the log.
+	The sensor noise keeps most differences within one byte, so a frame takes
+	about 13 bytes instead of 22.
+	
+	Each page starts with the header described in flash_log.h; all its fields
+	are big-endian and the checksum is the 16-bit sum of the frame bytes of the
+	page. The first frame of a page is encoded against a frame of zeros and
+	against the interrupt counter of the header, so every page can be decoded
+	on its own. Unused bytes at the end of a page are left erased (0xFF). The
+	page with the highest sequence number is the newest, which is how the
+	logger finds its place in the ring after a reset.
+	
+	Frames are collected in a RAM page buffer and a page is written to the
+	flash when it is full, the flash page erase and write being done in two
+	different calls. The CPU stalls on fetches from the flash while a page is
+	erased or written, so these two calls take a few milliseconds
+	(\#FLASH_PAGE_OPERATION_CYCLES). The flash command and the IMU interrupt
+	routine run from RAM, so the interrupts of the stall are queued with their
+	burst reads and the main loop catches up afterwards, logging every frame.
+	Frames which come while both page buffers are busy are counted in
+	\#flash_log_skipped_frames.
+	
+	The log is read out with a dump (command DUMP_FLASH_LOG), which streams
+	the dump header followed by the written pages, oldest first, as fast as
+	the USB takes them.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+///	\addtogroup flash_log
+///	@{
+
+#include <string.h>
+
+#include "flash_log.h"
+#include "flashc.h"
+#include "imu_interface.h"
+#include "external_interface.h"
+
+///\cond
+#define FLASH_PAGE_SIZE AVR32_FLASHC_PAGE_SIZE
+#define page_address(ring_page) ((const uint8_t*)(AVR32_FLASH_ADDRESS+(FLASH_LOG_FIRST_PAGE+(ring_page))*FLASH_PAGE_SIZE))
+// Largest encoded frame, 5 bytes for the interrupt counter and 3 bytes for each word
+#define MAX_FRAME_BYTES (5+3*IMU_RAW_DATA_WORDS)
+
+extern uint32_t interrupt_counter;
+extern uint16_t imu_raw_data[IMU_RAW_DATA_WORDS];
+///\endcond
+
+///\name Flash page operations of a full page
+//@{
+#define NO_PAGE_OPERATION 0
+#define ERASE_PAGE 1
+#define WRITE_PAGE 2
+//@}
+
+/// Number of frames not logged since both page buffers were busy
+uint32_t flash_log_skipped_frames = 0;
+
+///\name Logging state
+//@{
+/// Page buffer being filled and page buffer being written to the flash
+COMPILER_ALIGNED(8) static uint8_t page_buffers[2][FLASH_PAGE_SIZE];
+static uint8_t* fill_page = page_buffers[0];
+static uint8_t* full_page = NULL;
+static int fill_nrb;
+static uint16_t fill_nr_frames;
+/// Next flash page operation on \#full_page
+static uint8_t page_operation = NO_PAGE_OPERATION;
+/// Ring page to which the next full page is written
+static uint16_t write_page = 0;
+/// Sequence number of the next page
+static uint32_t next_sequence_number = 0;
+/// Words and interrupt counter against which the next frame is encoded
+static uint16_t previous_words[IMU_RAW_DATA_WORDS];
+static uint32_t previous_counter;
+/// Logging frequency divider, zero if not logging
+static uint16_t rate_divider = 0;
+static uint16_t rate_counter = 0;
+//@}
+
+///\name Dump state
+//@{
+static uint8_t dump_header[FLASH_LOG_DUMP_HEADER_BYTES];
+static uint16_t dump_page;
+static uint16_t dump_pages_left;
+/// Bytes of the dump header or the current page which have been sent
+static int dump_offset;
+static bool dump_header_sent;
+static bool dump_active = false;
+//@}
+
+///\cond
+static inline void put_uint32(uint8_t* p, uint32_t value){
+	p[0] = value>>24; p[1] = value>>16; p[2] = value>>8; p[3] = value;}
+
+static inline uint32_t get_uint32(const uint8_t* p){
+	return ((uint32_t)p[0]<<24) | ((uint32_t)p[1]<<16) | ((uint32_t)p[2]<<8) | p[3];}
+
+static inline int put_varint(uint8_t* p, uint32_t value){
+	int nrb = 0;
+	while(value>=0x80){
+		p[nrb++] = (value & 0x7F) | 0x80;
+		value >>= 7;}
+	p[nrb++] = value;
+	return nrb;}
+///\endcond
+
+/// Encodes the current raw IMU frame against the previous one. Returns the number of bytes.
+static int encode_frame(uint8_t* p){
+	int nrb = put_varint(p,interrupt_counter-previous_counter);
+	for(int i=0;i<IMU_RAW_DATA_WORDS;i++){
+		int16_t delta = (int16_t)(imu_raw_data[i]-previous_words[i]);
+		uint16_t zigzag = ((uint16_t)delta<<1) ^ (uint16_t)(delta>>15);
+		nrb += put_varint(p+nrb,zigzag);}
+	return nrb;
+}
+
+/// Starts a new page in \#fill_page at the current frame.
+static void start_page(void){
+	memset(fill_page,0xFF,FLASH_PAGE_SIZE);
+	put_uint32(fill_page+4,interrupt_counter);
+	fill_nrb = FLASH_LOG_PAGE_HEADER_BYTES;
+	fill_nr_frames = 0;
+	memset(previous_words,0,sizeof(previous_words));
+	previous_counter = interrupt_counter;
+}
+
+/// Completes the header of \#fill_page and hands it over to be written. The page buffer must be free.
+static void close_page(void){
+	uint16_t checksum = 0;
+	for(int i=FLASH_LOG_PAGE_HEADER_BYTES;i<fill_nrb;i++){
+		checksum += fill_page[i];}
+	put_uint32(fill_page,next_sequence_number++);
+	fill_page[8] = MSB(fill_nr_frames);
+	fill_page[9] = LSB(fill_nr_frames);
+	fill_page[10] = MSB(checksum);
+	fill_page[11] = LSB(checksum);
+	full_page = fill_page;
+	page_operation = ERASE_PAGE;
+	fill_page = fill_page==page_buffers[0] ? page_buffers[1] : page_buffers[0];
+	fill_nr_frames = 0;
+}
+
+/// Appends the current raw IMU frame to \#fill_page, handing the page over when it is full.
+static void append_frame(void){
+	uint8_t frame[MAX_FRAME_BYTES];
+	if(fill_nr_frames==0){
+		start_page();}
+	int nrb = encode_frame(frame);
+	if(fill_nrb+nrb>FLASH_PAGE_SIZE){
+		if(page_operation!=NO_PAGE_OPERATION){
+			flash_log_skipped_frames++;
+			return;}
+		close_page();
+		start_page();
+		nrb = encode_frame(frame);}
+	memcpy(fill_page+fill_nrb,frame,nrb);
+	fill_nrb += nrb;
+	fill_nr_frames++;
+	memcpy(previous_words,imu_raw_data,sizeof(previous_words));
+	previous_counter = interrupt_counter;
+}
+
+/// Does the next flash page operation on \#full_page.
+static void run_page_operation(void){
+	int page_number = FLASH_LOG_FIRST_PAGE+write_page;
+	switch(page_operation){
+		case ERASE_PAGE:
+			flashc_erase_page(page_number,false);
+			page_operation = WRITE_PAGE;
+			break;
+		case WRITE_PAGE:{
+			flashc_clear_page_buffer();
+			// Writes to the flash address space go to the page buffer
+			volatile uint64_t* dst = (volatile uint64_t*)page_address(write_page);
+			const uint64_t* src = (const uint64_t*)full_page;
+			for(int i=0;i<FLASH_PAGE_SIZE/sizeof(uint64_t);i++){
+				dst[i] = src[i];}
+			flashc_write_page(page_number);
+			page_operation = NO_PAGE_OPERATION;
+			full_page = NULL;
+			write_page = write_page+1<FLASH_LOG_NR_PAGES ? write_page+1 : 0;
+			break;}
+	}
+}
+
+/**
+	\brief Finds the newest page of the log, after which the logging continues.
+	
+	\details Must be called at start-up, before flash_log_frame() is called.
+*/
+void flash_log_init(void){
+	uint32_t newest = FLASH_LOG_ERASED_SEQUENCE;
+	for(int page=0;page<FLASH_LOG_NR_PAGES;page++){
+		uint32_t sequence_number = get_uint32(page_address(page));
+		if(sequence_number!=FLASH_LOG_ERASED_SEQUENCE && (newest==FLASH_LOG_ERASED_SEQUENCE || sequence_number>newest)){
+			newest = sequence_number;
+			write_page = page+1<FLASH_LOG_NR_PAGES ? page+1 : 0;}
+	}
+	next_sequence_number = newest==FLASH_LOG_ERASED_SEQUENCE ? 0 : newest+1;
+}
+
+/**
+	\brief Logs the raw IMU frame of the current interrupt to the flash, called once per main loop iteration.
+	
+	\details The frame is appended if the logging is on, its divider counter
+	has run out and the USB is not attached. When the logging is turned off or
+	the USB is attached, the page being filled is handed over to be written.
+	At most one flash page operation is done per call.
+*/
+void flash_log_frame(void){
+	if(rate_divider && !is_usb_attached()){
+		if(rate_counter==0){
+			rate_counter = rate_divider;
+			append_frame();}
+		rate_counter--;}
+	else if(fill_nr_frames>0 && page_operation==NO_PAGE_OPERATION){
+		close_page();}
+	if(page_operation!=NO_PAGE_OPERATION){
+		run_page_operation();}
+}
+
+/// Sets the logging frequency to the interrupt frequency divided by 2^(divider-1). Divider=0 turns off the logging.
+void set_flash_log_divider(uint8_t divider){
+	if(divider<=FLASH_LOG_MAX_LOG2_DIVIDER){
+		rate_divider = divider ? 1<<(divider-1) : 0;
+		rate_counter = 0;}
+}
+
+/**
+	\brief Starts a dump of the log.
+	
+	\details The dump consists of the dump header followed by the pages of the
+	log from the oldest to the newest. If the ring has not wrapped yet, only
+	the pages up to the newest are dumped.
+	
+	\return False if a dump is already running or the last page is still being written.
+*/
+bool flash_log_start_dump(void){
+	if(dump_active || fill_nr_frames>0 || page_operation!=NO_PAGE_OPERATION){
+		return false;}
+	bool has_wrapped = get_uint32(page_address(write_page))!=FLASH_LOG_ERASED_SEQUENCE;
+	dump_page = has_wrapped ? write_page : 0;
+	dump_pages_left = has_wrapped ? FLASH_LOG_NR_PAGES : write_page;
+	dump_header[0] = 'L';
+	dump_header[1] = 'G';
+	dump_header[2] = MSB(dump_pages_left);
+	dump_header[3] = LSB(dump_pages_left);
+	dump_offset = 0;
+	dump_header_sent = false;
+	dump_active = true;
+	return true;
+}
+
+/// Stops a running dump.
+void flash_log_stop_dump(void){
+	dump_active = false;}
+
+/// True while a dump is running.
+bool flash_log_dump_active(void){
+	return dump_active;}
+
+/**
+	\brief Next bytes of the dump.
+	
+	@param[out] data Set to the first byte.
+	\return The number of bytes which can be read from data, zero if the dump has ended.
+*/
+int flash_log_dump_data(const uint8_t** data){
+	if(!dump_active){
+		return 0;}
+	if(!dump_header_sent){
+		*data = dump_header+dump_offset;
+		return FLASH_LOG_DUMP_HEADER_BYTES-dump_offset;}
+	*data = page_address(dump_page)+dump_offset;
+	return FLASH_PAGE_SIZE-dump_offset;
+}
+
+/// Marks nrb bytes of those returned by flash_log_dump_data() as sent.
+void flash_log_dump_advance(int nrb){
+	dump_offset += nrb;
+	if(!dump_header_sent && dump_offset==FLASH_LOG_DUMP_HEADER_BYTES){
+		dump_header_sent = true;
+		dump_offset = 0;}
+	else if(dump_header_sent && dump_offset==FLASH_PAGE_SIZE){
+		dump_offset = 0;
+		dump_page = dump_page+1<FLASH_LOG_NR_PAGES ? dump_page+1 : 0;
+		dump_pages_left--;}
+	if(dump_header_sent && dump_pages_left==0){
+		dump_active = false;}
+}
+
+//@}
@@ -0,0 +1,60 @@
+
+/** \file
+	\brief Header file for the ring logger of raw IMU frames in the internal flash.
+	
+	\details See flash_log.c for the format of the log.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+/**
+	\ingroup openshoe_runtime_framework
+	
+	\defgroup flash_log Flash log
+	\brief This group contains the logging of raw IMU frames to the internal flash.
+	@{
+*/
+
+#ifndef FLASH_LOG_H_
+#define FLASH_LOG_H_
+
+#include "compiler.h"
+
+///\name Location of the log
+///  The log is a ring of flash pages in the upper half of the 512 kB flash. The
+///  firmware must stay below \#FLASH_LOG_FIRST_PAGE.
+//@{
+#define FLASH_LOG_FIRST_PAGE 512
+#define FLASH_LOG_NR_PAGES 480
+//@}
+
+///\name Page format
+//@{
+/// [sequence number (4)][interrupt counter (4)][number of frames (2)][checksum (2)]
+#define FLASH_LOG_PAGE_HEADER_BYTES 12
+/// Sequence number of an erased page
+#define FLASH_LOG_ERASED_SEQUENCE 0xFFFFFFFF
+/// Dump header: ["L"]["G"][number of pages (2)]
+#define FLASH_LOG_DUMP_HEADER_BYTES 4
+//@}
+
+/// Value of the error signal if a dump of the log could not be started.
+#define FLASH_LOG_ERROR 8
+
+/// Largest log2 of the divider of the logging frequency
+#define FLASH_LOG_MAX_LOG2_DIVIDER 14
+
+void flash_log_init(void);
+void flash_log_frame(void);
+void set_flash_log_divider(uint8_t divider);
+
+bool flash_log_start_dump(void);
+void flash_log_stop_dump(void);
+bool flash_log_dump_active(void);
+int flash_log_dump_data(const uint8_t** data);
+void flash_log_dump_advance(int nrb);
+
+#endif /* FLASH_LOG_H_ */
+
+//@}
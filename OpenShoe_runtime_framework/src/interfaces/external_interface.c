@@ -18,6 +18,7 @@
 
 #include "external_interface.h"
 #include "control_tables.h"
+#include "flash_log.h"
 
 // All USB include files (possibly not all needed)
 #include "conf_usb.h"
@@ -29,9 +30,14 @@
 ///\name Buffer settings
 //@{
 #define RX_BUFFER_SIZE 20
-#define TX_BUFFER_SIZE 60
-#define SINGLE_TX_BUFFER_SIZE 10
-#define MAX_RX_NRB 10
+/// Size of the receive ring. Must be a power of two.
+#define RX_RING_SIZE 128
+/// Clock cycles receive_command may spend on parsing and executing commands in one call
+#define RX_CYCLE_BUDGET FRAME_SHARE(5)
+/// Size of the transmit ring. Must be a power of two. Holds the output of a few interrupts with all states output.
+#define TX_RING_SIZE 1024
+/// Room for the acks of the commands handled in one call to receive_command
+#define SINGLE_TX_BUFFER_SIZE 64
 //@}
 
 ///\cond
@@ -40,15 +46,45 @@
 #define HEADER_BYTES 1
 #define MAX_COMMAND_ARGS 10
 #define NO_EXPECTED_BYTES 0
-#define SINGLE_BYTE_EXPECTED 1
+#define ACK_BYTES 4
 #define USB_TIMEOUT_COUNT 200000000
 #define NO_INITIATED_TRANSMISSION 0
 #define COUNTER_RESET_VALUE 0
-#define NO_BYTES_RECEIVED_YET 0
 
 #define STATE_OUTPUT_HEADER 0xAA
+#define STATE_OUTPUT_DESCRIPTION_HEADER 0xA2
 ///\endcond
 
+/**
+	\name State output frames
+	The state output of an interrupt is split over as few frames as possible. Each frame has the format
+	[0xAA][sequence number (2)][fragment][time stamp (4)][payload size][payload][checksum (2)] where
+	the sequence number is incremented for every frame, the high and low nibbles of the fragment byte
+	are the index of the frame and the number of frames of the output, and the time stamp is the
+	\#interrupt_counter of the output. Multi-byte fields are big-endian and the checksum is the 16-bit
+	sum of all preceding bytes of the frame. Gaps in the sequence numbers tell the user of lost frames.
+*/
+//@{
+#define FRAME_HEADER_BYTES 9
+#define FRAME_OVERHEAD (FRAME_HEADER_BYTES+CHECKSUM_BYTES)
+/// Largest payload of a frame, such that a frame fits in a full-speed USB bulk packet
+#define MAX_FRAME_PAYLOAD (64-FRAME_OVERHEAD)
+#define MAX_FRAGMENTS 15
+//@}
+
+/**
+	\name State output description
+	Reply of the command OUTPUT_STATE_ENCODED, following its ack, with the format
+	[0xA2][state ID][rate divider (2)][encoding][output size (2)][scale factor (4)][checksum (2)] where the rate
+	divider is the number of interrupts between two outputs of the state (0 if the state is not output), the output
+	size is the number of bytes of the state in the payload of the state output and the scale factor is the 32-bit
+	float of the fixed-point encodings (0 if the state is not made of floats). Multi-byte fields are big-endian and
+	the checksum is the 16-bit sum of all preceding bytes of the reply.
+*/
+//@{
+#define STATE_OUTPUT_DESCRIPTION_BYTES 13
+//@}
+
 /// Receive and transmit buffer
 static struct rxtx_buffer{
 	uint8_t* buffer;
@@ -63,16 +99,62 @@ static struct rxtx_buffer single_tx_buffer = {single_tx_buffer_array,single_tx_b
 
 // Error variables
 uint8_t error_signal=0;							//Error signaling vector. If zero no error has occurred.
+uint32_t tx_skipped_frames=0;					//Number of state outputs skipped since the USB did not take the earlier output.
+
+///\cond
+extern uint32_t interrupt_counter;
+///\endcond
+
+///\name Receive ring
+///  Free running write and read indexes, the number of bytes in the ring is their difference.
+//@{
+static uint8_t rx_ring[RX_RING_SIZE];
+static uint16_t rx_ring_head = 0;
+static uint16_t rx_ring_tail = 0;
+//@}
+
+///\name Transmit ring
+///  Free running write and read indexes, the number of bytes in the ring is their difference.
+//@{
+static uint8_t tx_ring[TX_RING_SIZE];
+static uint16_t tx_ring_head = 0;
+static uint16_t tx_ring_tail = 0;
+//@}
+/// Sequence number of the next state output frame
+static uint16_t frame_sequence_number = 0;
 
 ///\name State output divider limits
 //@{
 #define MAX_LOG2_DIVIDER 14
 #define MIN_LOG2_DIVIDER 0
 //@}
+/// Maximum number of states which can be output at the same time
+#define MAX_OUTPUT_STATES 32
+/// Largest state which can be output with another encoding than \#STATE_ENCODING_RAW
+#define MAX_ENCODED_STATE_SIZE 128
+
+/// Output rate control of a state which is output
+struct output_state{
+	/// Information struct of the state
+	state_t_info* info;
+	/// Divider of the state output frequency
+	uint16_t rate_divider;
+	/// Number of calls left until the state is output next
+	uint16_t rate_counter;
+	/// Encoding of the output, one of the STATE_ENCODING_* macros
+	uint8_t encoding;
+	/// Number of bytes of the encoded state
+	uint16_t output_size;
+};
+
+/// Buffer in which states are encoded before they are copied to the transmit ring
+static uint8_t encoded_state[MAX_ENCODED_STATE_SIZE];
+
 ///\name State output rate control variables
+///  The states which are output, ordered by state ID such that they are output in that order.
 //@{
-static uint16_t state_output_rate_divider[SID_LIMIT] = {0};
-static uint16_t state_output_rate_counter[SID_LIMIT] = {0};
+static struct output_state output_states[MAX_OUTPUT_STATES];
+static uint8_t nr_output_states = 0;
 //@}
 
 /// Initialization function for communication interface
@@ -80,25 +162,25 @@ void com_interface_init(void){
 	// Start usb controller	
 	udc_start();
 	
-	// These initialization functions should be replaced by a code generating script/preprocessors
-	// They only initialize constant arrays.
-	commands_init();	
-	system_states_init();
-	processing_functions_init();
+	// The command, state and processing function tables are generated at compile time (control_tables.h)
+	reset_processing_functions_timing();
 
 }
 
 // Define and inline functions for improved readability of code
 ///\cond
-#define receive_limit_not_reached(rx_nrb_counter) ((rx_nrb_counter)<MAX_RX_NRB)
+#define within_rx_budget(start) ((uint32_t)(Get_system_register(AVR32_COUNT)-(start)) < RX_CYCLE_BUDGET)
+// Room for an ack and the largest reply of a command response
+#define has_room_for_ack() (single_tx_buffer.write_position+ACK_BYTES+STATE_OUTPUT_DESCRIPTION_BYTES <= single_tx_buffer.buffer+SINGLE_TX_BUFFER_SIZE)
 #define reset_timer(timer) ((timer) = Get_system_register(AVR32_COUNT))
 #define is_new_header(exp_nrb) ((exp_nrb) == NO_EXPECTED_BYTES)
-#define is_end_of_command(exp_nrb) (exp_nrb) == SINGLE_BYTE_EXPECTED
+#define is_end_of_command(exp_nrb) ((exp_nrb) == NO_EXPECTED_BYTES)
 #define has_timed_out(timeout_counter, exp_nrb) ((timeout_counter) + USB_TIMEOUT_COUNT < Get_system_register(AVR32_COUNT) && (exp_nrb) > 0)
 #define increment_counter(counter) ((counter)++)
 #define decrement_counter(counter) ((counter)--)
-#define FIRST_PAYLOAD_BYTE (state_output_header_p+2)
-#define PAYLOAD_SIZE_BYTE (state_output_header_p+1)
+#define rx_ring_nrb() ((uint16_t)(rx_ring_head-rx_ring_tail))
+#define tx_ring_nrb() ((uint16_t)(tx_ring_head-tx_ring_tail))
+#define tx_ring_free() (TX_RING_SIZE-tx_ring_nrb())
 ///\endcond
 
 static inline void reset_buffer(struct rxtx_buffer* buffer){
@@ -106,15 +188,10 @@ static inline void reset_buffer(struct rxtx_buffer* buffer){
 	buffer->read_position = buffer->buffer;
 	buffer->nrb = NO_INITIATED_TRANSMISSION;}
 
-static inline bool is_usb_attached(void){
+/// True if the USB is attached (vbus is high).
+bool is_usb_attached(void){
 	return !Is_udd_detached();}
 
-static inline bool is_data_available(void){
-	return udi_cdc_is_rx_ready();}
-
-static inline void get_byte_from_usb(uint8_t* write_position){
-	*write_position = udi_cdc_getc();}
-	
 inline static int get_payload_size(command_structure* cmd_info){
 	return cmd_info->nrb_payload;}
 
@@ -130,8 +207,8 @@ static inline uint16_t calc_checksum(uint8_t* first, uint8_t* last){
 	return checksum;}
 
 static inline bool has_valid_checksum(struct rxtx_buffer* buffer){
-	uint16_t checksum = calc_checksum(buffer->buffer,buffer->write_position-2);
-	return (MSB(checksum)==*(buffer->write_position-1) && LSB(checksum)==*buffer->write_position);}
+	uint16_t checksum = calc_checksum(buffer->buffer,buffer->write_position-CHECKSUM_BYTES-1);
+	return (MSB(checksum)==*(buffer->write_position-2) && LSB(checksum)==*(buffer->write_position-1));}
 
 static inline void send_ak(struct rxtx_buffer* buffer){
 	*single_tx_buffer.write_position = 0xa0;
@@ -163,109 +240,257 @@ static inline void parse_and_execute_command(struct rxtx_buffer* buffer,command_
 	cmd_info->cmd_response(command_arg);}
 
 
-/*! \brief This functions collect the data which is to be transmitted and stores it in the argument buffer.
+/// Copies bytes to the transmit ring and adds them to a checksum. The caller makes sure there is room.
+static inline void tx_ring_write(const uint8_t* data, int nrb, uint16_t* checksum){
+	for(int i=0;i<nrb;i++){
+		*checksum += data[i];}
+	int position = tx_ring_head & (TX_RING_SIZE-1);
+	int first_part = nrb < TX_RING_SIZE-position ? nrb : TX_RING_SIZE-position;
+	memcpy(&tx_ring[position],data,first_part);
+	memcpy(tx_ring,data+first_part,nrb-first_part);
+	tx_ring_head += nrb;}
+
+/// Writes the header of a state output frame to the transmit ring and restarts the checksum.
+static inline void begin_frame(uint8_t fragment, uint8_t nr_fragments, uint8_t payload_size, uint16_t* checksum){
+	uint8_t header[FRAME_HEADER_BYTES] = {STATE_OUTPUT_HEADER,
+										  MSB(frame_sequence_number), LSB(frame_sequence_number),
+										  (fragment<<4) | nr_fragments,
+										  interrupt_counter>>24, interrupt_counter>>16, interrupt_counter>>8, interrupt_counter,
+										  payload_size};
+	frame_sequence_number++;
+	*checksum = 0;
+	tx_ring_write(header,FRAME_HEADER_BYTES,checksum);}
+
+/// Writes the checksum ending a state output frame to the transmit ring.
+static inline void end_frame(uint16_t checksum){
+	uint8_t checksum_bytes[CHECKSUM_BYTES] = {MSB(checksum), LSB(checksum)};
+	tx_ring_write(checksum_bytes,CHECKSUM_BYTES,&checksum);}
+
+/// Converts a float to an IEEE 754 half precision float, rounding to nearest. Too large values become infinity.
+static inline uint16_t float_to_half(float x){
+	union {float f; uint32_t u;} bits = {x};
+	uint16_t sign = (bits.u>>16) & 0x8000;
+	int exponent = (int)((bits.u>>23) & 0xFF)-127+15;
+	uint32_t mantissa = bits.u & 0x007FFFFF;
+	uint16_t half;
+	if(exponent==0xFF-127+15){
+		// Infinity or NaN
+		return sign | 0x7C00 | (mantissa ? 0x0200 : 0);}
+	if(exponent>=0x1F){
+		return sign | 0x7C00;}
+	if(exponent<=0){
+		// Subnormal half precision float, or zero
+		if(exponent<-10){
+			return sign;}
+		mantissa |= 0x00800000;
+		half = mantissa>>(14-exponent);
+		if(mantissa & (1<<(13-exponent))){
+			half++;}
+		return sign | half;}
+	half = (exponent<<10) | (mantissa>>13);
+	// A carry from the rounding correctly increments the exponent
+	if(mantissa & 0x00001000){
+		half++;}
+	return sign | half;}
+
+/// Scales a float, rounds it and saturates it to +-limit.
+static inline int32_t to_fixed_point(float x, float scale, int32_t limit){
+	float y = x*scale;
+	if(y!=y){
+		return 0;}
+	if(y >= (float)limit){
+		return limit;}
+	if(y <= -(float)limit){
+		return -limit;}
+	return y<0 ? (int32_t)(y-0.5f) : (int32_t)(y+0.5f);}
+
+/// Encodes the elements of a state made of floats in \#encoded_state. The elements are written big-endian.
+static inline void encode_state(struct output_state* state){
+	const float* elements = state->info->state_p;
+	int nr_elements = state->info->state_size/sizeof(float);
+	float scale = state->info->scale;
+	uint8_t* data = encoded_state;
+	for(int i=0;i<nr_elements;i++){
+		switch(state->encoding){
+			case STATE_ENCODING_INT16:{
+				int16_t value = to_fixed_point(elements[i],scale,INT16_MAX);
+				*data++ = MSB(value);
+				*data++ = LSB(value);
+				break;}
+			case STATE_ENCODING_INT32:{
+				int32_t value = to_fixed_point(elements[i],scale,INT32_MAX);
+				*data++ = value>>24;
+				*data++ = value>>16;
+				*data++ = value>>8;
+				*data++ = value;
+				break;}
+			case STATE_ENCODING_HALF:{
+				uint16_t value = float_to_half(elements[i]);
+				*data++ = MSB(value);
+				*data++ = LSB(value);
+				break;}
+		}
+	}
+}
+
+/*! \brief This functions collect the data which is to be transmitted and stores it in the transmit ring.
 
 	\details This function collect single output data (e.g. acks) from the \#single_tx_buffer and continual output data
-	from the state variables based on the values of the \#state_output_rate_divider and the \#state_output_rate_counter.
-	The output data (single output data followed by state outputs) is stored in the argument buffer.
-	The argument buffer is reset before any data is written to it.
+	from the state variables in \#output_states based on their rate dividers and counters. Only the states which are
+	output are visited, so the cost does not depend on the size of the state ID space. States with another
+	encoding than \#STATE_ENCODING_RAW are encoded in \#encoded_state before they are copied.
+	The single output data is followed by the state outputs, split over as many frames of at most \#MAX_FRAME_PAYLOAD
+	bytes of payload as needed. If the ring has no room for the whole output, nothing is written, the counters
+	are left as they are and the output is counted in \#tx_skipped_frames. Hence, a frame is never truncated.
 	
-	@param[out] buffer						The buffer in which that output data is stored in.
 	@param[in]  single_tx_buffer			Buffer containing the data to be output once.
-	@param[in]  state_output_rate_divider	Array containing the dividers of the state output frequencies (and if they are to be output at all)
-	@param[in]  state_output_rate_counter	Array for keeping track of when to output data next
+	@param[in]  output_states				The states to output with their dividers and counters.
 */
-static inline void assemble_output_data(struct rxtx_buffer* buffer){
-	// Clear buffer
-	reset_buffer(buffer);
+static inline void assemble_output_data(void){
+	int single_nrb = single_tx_buffer.write_position-single_tx_buffer.buffer;
 	
-	// Copy one time transmit data to buffer
-	if(single_tx_buffer.write_position!=single_tx_buffer.buffer){
-		memcpy(buffer->write_position,single_tx_buffer.buffer,single_tx_buffer.write_position-single_tx_buffer.buffer);
-		buffer->write_position+=single_tx_buffer.write_position-single_tx_buffer.buffer;
+	// Size of the state output
+	int payload_nrb = 0;
+	for(struct output_state* state = output_states; state<output_states+nr_output_states; state++){
+		if( state->rate_counter == 0){
+			payload_nrb += state->output_size;}}
+	int nr_fragments = (payload_nrb+MAX_FRAME_PAYLOAD-1)/MAX_FRAME_PAYLOAD;
+	
+	// Skip the output if it does not fit
+	if(nr_fragments>MAX_FRAGMENTS || single_nrb+payload_nrb+nr_fragments*FRAME_OVERHEAD > tx_ring_free()){
+		tx_skipped_frames++;
+		return;}
+	
+	// Copy one time transmit data to ring
+	uint16_t checksum = 0;
+	if(single_nrb){
+		tx_ring_write(single_tx_buffer.buffer,single_nrb,&checksum);
 		reset_buffer(&single_tx_buffer);
 	}
 
-	// Save position of header
-	uint8_t* state_output_header_p = buffer->write_position;
-	// Add header for state data output
-	*buffer->write_position = STATE_OUTPUT_HEADER;
-	increment_counter(buffer->write_position);
-	increment_counter(buffer->write_position);
-	// Copy all enabled states to buffer	
-	for(int i = 0; i<SID_LIMIT; i++){
-		if( state_output_rate_divider[i] ){
-			if( state_output_rate_counter[i] == 0){
-				state_output_rate_counter[i] = state_output_rate_divider[i];
-				//TODO: ensure no buffer overflow occur
-				memcpy(buffer->write_position,state_info_access_by_id[i]->state_p,state_info_access_by_id[i]->state_size);
-				buffer->write_position+=state_info_access_by_id[i]->state_size;
+	// Copy all enabled states to the ring, starting a new frame whenever the current one is full
+	int fragment = 0;
+	int frame_room = 0;
+	for(struct output_state* state = output_states; state<output_states+nr_output_states; state++){
+		if( state->rate_counter == 0){
+			state->rate_counter = state->rate_divider;
+			const uint8_t* data = state->info->state_p;
+			if(state->encoding!=STATE_ENCODING_RAW){
+				encode_state(state);
+				data = encoded_state;}
+			int nrb = state->output_size;
+			while(nrb>0){
+				if(frame_room==0){
+					if(fragment>0){
+						end_frame(checksum);}
+					frame_room = payload_nrb-fragment*MAX_FRAME_PAYLOAD;
+					if(frame_room>MAX_FRAME_PAYLOAD){
+						frame_room = MAX_FRAME_PAYLOAD;}
+					begin_frame(fragment,nr_fragments,frame_room,&checksum);
+					fragment++;}
+				int chunk = nrb < frame_room ? nrb : frame_room;
+				tx_ring_write(data,chunk,&checksum);
+				data += chunk;
+				nrb -= chunk;
+				frame_room -= chunk;
 			}
-			// The counter counts down since then the comparison at each proceedure call can be done with a constant (0)
-			state_output_rate_counter[i]--;
 		}
+		// The counter counts down since then the comparison at each proceedure call can be done with a constant (0)
+		state->rate_counter--;
 	}
-	// If any data was added, add payload size and calculate and add checksum
-	if(FIRST_PAYLOAD_BYTE!=buffer->write_position){
-		*PAYLOAD_SIZE_BYTE=buffer->write_position-FIRST_PAYLOAD_BYTE;
-		uint16_t checksum = calc_checksum(state_output_header_p,buffer->write_position-1);
-		*buffer->write_position = MSB(checksum);
-		increment_counter(buffer->write_position);
-		*buffer->write_position = LSB(checksum);
-		increment_counter(buffer->write_position);}
-	else {
-		buffer->write_position = state_output_header_p;
+	if(fragment>0){
+		end_frame(checksum);}
+}
+
+/// Copies the one time transmit data (acks) to the transmit ring, as long as a flash log dump replaces the state output.
+static inline void assemble_single_output_data(void){
+	int single_nrb = single_tx_buffer.write_position-single_tx_buffer.buffer;
+	uint16_t checksum;
+	if(single_nrb && single_nrb <= tx_ring_free()){
+		tx_ring_write(single_tx_buffer.buffer,single_nrb,&checksum);
+		reset_buffer(&single_tx_buffer);}
+}
+
+/// Sends as much of a running flash log dump as the USB output buffers can take.
+static inline void transmit_flash_log_dump(void){
+	const uint8_t* data;
+	int nrb;
+	while((nrb = flash_log_dump_data(&data))>0){
+		int nrb_left = udi_cdc_write_buf_nonblocking(data,nrb);
+		flash_log_dump_advance(nrb-nrb_left);
+		if(nrb_left){
+			break;}
+	}
+}
+
+/// Copies the bytes received by the USB to the receive ring, as far as there is room.
+static inline void read_usb_to_rx_ring(void){
+	while(rx_ring_nrb()<RX_RING_SIZE){
+		int position = rx_ring_head & (RX_RING_SIZE-1);
+		int room = RX_RING_SIZE-rx_ring_nrb();
+		if(room > RX_RING_SIZE-position){
+			room = RX_RING_SIZE-position;}
+		int nrb = room-udi_cdc_read_buf_nonblocking(&rx_ring[position],room);
+		rx_ring_head += nrb;
+		if(nrb<room){
+			break;}
 	}
 }
 
 /**
 	\brief Main function for receiving commands from user.
 
-	\details In case the USB is attached (vbus is high) and there is data available the function
-	reads in at most MAX_RX_NRB number of bytes, parses the commands, and execute the command
-	response. In case the functions encounters a invalid header or checksum, it resets the
-	buffer and starts over reading a new command assuming the next byte is a header. The
-	function can split commands over different calls to the function.
+	\details In case the USB is attached (vbus is high), all bytes received by the
+	USB are read with a single non-blocking read into the receive ring. The bytes are
+	then parsed one by one by a state machine which executes the command response of
+	every complete command. In case the parser encounters a invalid header or checksum,
+	it resets the command buffer and starts over reading a new command assuming the next
+	byte is a header. The state of the parser is kept between calls, so commands can be
+	split over different calls to the function, and several commands can be handled in
+	one call. Parsing stops when \#RX_CYCLE_BUDGET clock cycles have been spent or the
+	\#single_tx_buffer has no room for another ack; the remaining bytes stay in the ring.
 */
 void receive_command(void){
 	static uint8_t rx_buffer_array[RX_BUFFER_SIZE];
 	static struct rxtx_buffer rx_buffer = {rx_buffer_array,rx_buffer_array,rx_buffer_array,0};
 	static int command_tx_timer;
 	static command_structure* info_last_command;
-	int rx_nrb_counter = NO_BYTES_RECEIVED_YET;
+	uint32_t start = Get_system_register(AVR32_COUNT);
 	
-	//If USB is attached and data is available, receive data (command)
+	//If USB is attached, receive data (commands)
 	if(is_usb_attached()){
-		while(is_data_available() && receive_limit_not_reached(rx_nrb_counter)){
-			
-			get_byte_from_usb(rx_buffer.write_position);
-			increment_counter(rx_nrb_counter);
-			reset_timer(command_tx_timer);
+		uint16_t rx_ring_head_before = rx_ring_head;
+		read_usb_to_rx_ring();
+		if(rx_ring_head!=rx_ring_head_before){
+			reset_timer(command_tx_timer);}
+		
+		while(rx_ring_nrb()>0 && within_rx_budget(start) && has_room_for_ack()){
+			uint8_t byte = rx_ring[rx_ring_tail & (RX_RING_SIZE-1)];
+			increment_counter(rx_ring_tail);
 			
 			// Do we have a potential new header?
 			if(is_new_header(rx_buffer.nrb)){
-				if(is_valid_header(*rx_buffer.write_position)){
-					info_last_command = get_command_info(*rx_buffer.write_position);
+				if(is_valid_header(byte) && get_expected_nrb(get_command_info(byte))<RX_BUFFER_SIZE){
+					info_last_command = get_command_info(byte);
 					rx_buffer.nrb = get_expected_nrb(info_last_command);
+					*rx_buffer.write_position = byte;
 					increment_counter(rx_buffer.write_position);}
-				else{
-					reset_buffer(&rx_buffer);}
 				continue;}
 				
+			// Otherwise we are in the middle of a command transmission
+			*rx_buffer.write_position = byte;
+			increment_counter(rx_buffer.write_position);
+			decrement_counter(rx_buffer.nrb);
+			
 			// Or a full command?
-			else if(is_end_of_command(rx_buffer.nrb)){
+			if(is_end_of_command(rx_buffer.nrb)){
 				if(has_valid_checksum(&rx_buffer)){
 					send_ak(&rx_buffer);
 					parse_and_execute_command(&rx_buffer,info_last_command);}
 				else{
 					send_nak();
 				}
-				reset_buffer(&rx_buffer);
-				continue;}
-				
-			// Otherwise we are in the middle of a command transmission
-			increment_counter(rx_buffer.write_position);
-			decrement_counter(rx_buffer.nrb);
+				reset_buffer(&rx_buffer);}
 		}
 		// Reset buffer if initiated command transmission do not complete within timeout limit
 		if(has_timed_out(command_tx_timer,rx_buffer.nrb)){
@@ -274,56 +499,136 @@ void receive_command(void){
 	// If USB detached, reset buffers
 	else{
 		reset_buffer(&rx_buffer);
+		rx_ring_tail = rx_ring_head;
 	}
-	// Return if: USB detached, no more data available, or receive-limit reached
+	// Return if: USB detached, no more data available, or the budget is spent
 	return;	
 }
 
 /**
 	\brief Main function to output data to user.
 	
-	\details The function calls /#assemble_output_data with its internal output buffer as an argument.
-	This stores the relevant data (single output messages and continual state output) in the buffer.
-	Subsequently the data is written over byte by byte to the USB output buffer.
+	\details The function calls \#assemble_output_data which stores the relevant data (single output
+	messages and continual state output frames) in the transmit ring. Subsequently as much of the
+	ring as the USB output buffers can take is copied to them without waiting. The rest stays in the
+	ring and is sent first in the next call.
+	
+	While a flash log dump is running, it replaces the state output. The dump is sent whenever the
+	ring is empty, such that acks are not sent in the middle of a page.
 */
 void transmit_data(void){
-	static uint8_t tx_buffer_array[TX_BUFFER_SIZE];
-	static struct rxtx_buffer tx_buffer = {tx_buffer_array,tx_buffer_array,tx_buffer_array,0};
-	static uint8_t downsampling_tx_counter = 0;
-
 	if(is_usb_attached()){
 		// Generate output
-		assemble_output_data(&tx_buffer);
-		// Transmit output
-		while(tx_buffer.read_position<tx_buffer.write_position && udi_cdc_is_tx_ready()){
-			udi_cdc_putc(*tx_buffer.read_position);
-			tx_buffer.read_position++;
+		if(flash_log_dump_active()){
+			assemble_single_output_data();}
+		else{
+			assemble_output_data();}
+		// Transmit output, the part up to the end of the ring first
+		while(tx_ring_nrb()>0){
+			int position = tx_ring_tail & (TX_RING_SIZE-1);
+			int nrb = tx_ring_nrb() < TX_RING_SIZE-position ? tx_ring_nrb() : TX_RING_SIZE-position;
+			int nrb_left = udi_cdc_write_buf_nonblocking(&tx_ring[position],nrb);
+			tx_ring_tail += nrb-nrb_left;
+			if(nrb_left){
+				break;}
 		}
-		// This does not work cause it will hang if user does not clear his buffers sufficiently fast.
-		// Equivalent but non-blocking function should be written.
-//		udi_cdc_write_buf((int*)tx_buffer.buffer,tx_buffer.write_position-tx_buffer.buffer);
-	}	
+		if(tx_ring_nrb()==0){
+			transmit_flash_log_dump();}
+	}
+	else{
+		tx_ring_tail = tx_ring_head;
+		flash_log_stop_dump();
+	}
 }
 
 /**
-	\brief Sets state_id state to be output with interrupt frequency divided by 2^(divider-1). Divider=0 turns off output.
+	\brief Sets state_id state to be output with interrupt frequency divided by 2^(divider-1) in the given encoding. Divider=0 turns off output.
 	
-	\details The function checks that state_id is a valid state ID and that
-	divider is within the allowable range.
+	\details The function checks that state_id is a valid state ID, that
+	divider is within the allowable range and that the encoding is
+	\#STATE_ENCODING_RAW or the state is made of floats (has a scale factor)
+	and is at most \#MAX_ENCODED_STATE_SIZE bytes. The state is inserted in,
+	updated in, or removed from the ordered list \#output_states.
 */
-void set_state_output(uint8_t state_id, uint8_t divider){
-	if(state_id<=SID_LIMIT && divider<=MAX_LOG2_DIVIDER){
+void set_state_output_encoded(uint8_t state_id, uint8_t divider, uint8_t encoding){
+	if(state_id<SID_LIMIT && divider<=MAX_LOG2_DIVIDER && encoding<=STATE_ENCODING_HALF){
+		// Find the state, or where it should be inserted
+		uint8_t i = 0;
+		while(i<nr_output_states && output_states[i].info->id<state_id){
+			i++;}
+		bool is_output = i<nr_output_states && output_states[i].info->id==state_id;
+		
 		if (divider>MIN_LOG2_DIVIDER){
-			state_output_rate_divider[state_id] = 1<<(divider-1);
-			state_output_rate_counter[state_id] = 0;
-		} else {
-			state_output_rate_divider[state_id] = 0;
-			state_output_rate_counter[state_id] = 0;
+			state_t_info* info = is_output ? output_states[i].info : state_info_access_by_id[state_id];
+			if(!info || (encoding!=STATE_ENCODING_RAW && (info->scale<=0 || info->state_size>MAX_ENCODED_STATE_SIZE))){
+				return;}
+			if(!is_output){
+				if(nr_output_states==MAX_OUTPUT_STATES){
+					return;}
+				memmove(&output_states[i+1],&output_states[i],(nr_output_states-i)*sizeof(struct output_state));
+				nr_output_states++;
+				output_states[i].info = info;}
+			output_states[i].rate_divider = 1<<(divider-1);
+			output_states[i].rate_counter = 0;
+			output_states[i].encoding = encoding;
+			switch(encoding){
+				case STATE_ENCODING_INT16:
+				case STATE_ENCODING_HALF:
+					output_states[i].output_size = info->state_size/2;
+					break;
+				default:
+					output_states[i].output_size = info->state_size;}
+		} else if(is_output){
+			nr_output_states--;
+			memmove(&output_states[i],&output_states[i+1],(nr_output_states-i)*sizeof(struct output_state));
 		}
 	}
 	// TODO: Set some error state if the above does not hold
 }
 
+/// Sets state_id state to be output with interrupt frequency divided by 2^(divider-1) as stored (\#STATE_ENCODING_RAW). Divider=0 turns off output.
+void set_state_output(uint8_t state_id, uint8_t divider){
+	set_state_output_encoded(state_id,divider,STATE_ENCODING_RAW);}
+
+/**
+	\brief Sends the description of the output of state_id, see \#STATE_OUTPUT_DESCRIPTION_BYTES.
+	
+	\details The description tells the user how the state is output, such that
+	the state output can be decoded without knowing the state table. An unknown
+	state, or one which is not output, is described with a rate divider of 0.
+	Called from command responses, after the ack has been put in the
+	\#single_tx_buffer.
+*/
+void send_state_output_description(uint8_t state_id){
+	uint16_t rate_divider = 0;
+	uint8_t encoding = STATE_ENCODING_RAW;
+	uint16_t output_size = 0;
+	union {precision f; uint32_t u;} scale = {0.0f};
+	if(state_id<SID_LIMIT && state_info_access_by_id[state_id]){
+		scale.f = state_info_access_by_id[state_id]->scale;}
+	for(int i=0;i<nr_output_states;i++){
+		if(output_states[i].info->id==state_id){
+			rate_divider = output_states[i].rate_divider;
+			encoding = output_states[i].encoding;
+			output_size = output_states[i].output_size;}}
+	uint8_t* reply = single_tx_buffer.write_position;
+	reply[0] = STATE_OUTPUT_DESCRIPTION_HEADER;
+	reply[1] = state_id;
+	reply[2] = MSB(rate_divider);
+	reply[3] = LSB(rate_divider);
+	reply[4] = encoding;
+	reply[5] = MSB(output_size);
+	reply[6] = LSB(output_size);
+	reply[7] = scale.u>>24;
+	reply[8] = scale.u>>16;
+	reply[9] = scale.u>>8;
+	reply[10] = scale.u;
+	uint16_t checksum = calc_checksum(reply,reply+STATE_OUTPUT_DESCRIPTION_BYTES-CHECKSUM_BYTES-1);
+	reply[11] = MSB(checksum);
+	reply[12] = LSB(checksum);
+	single_tx_buffer.write_position += STATE_OUTPUT_DESCRIPTION_BYTES;
+}
+
 /**
 	\brief Reset the output counter such that the output become synchronized.
 	
@@ -332,8 +637,8 @@ void set_state_output(uint8_t state_id, uint8_t divider){
 	synchronized independent of their dividers.
 */
 void reset_output_counters(void){
-	for(int i=0;i<SID_LIMIT;i++){
-		state_output_rate_counter[i] = 0;
+	for(int i=0;i<nr_output_states;i++){
+		output_states[i].rate_counter = 0;
 	}
 }
 
@@ -22,13 +22,29 @@
 #include "compiler.h"
 
 void com_interface_init(void);
+bool is_usb_attached(void);
 
 // These are the two main functions used by the interface.
 void transmit_data(void);
 void receive_command(void);
 
+///\name State output encodings
+///  Encodings of the elements of states made of floats, see set_state_output_encoded().
+//@{
+/// 32-bit floats, as stored
+#define STATE_ENCODING_RAW 0
+/// Elements times the scale factor of the state, rounded and saturated to int16
+#define STATE_ENCODING_INT16 1
+/// Elements times the scale factor of the state, rounded and saturated to int32
+#define STATE_ENCODING_INT32 2
+/// IEEE 754 half precision floats
+#define STATE_ENCODING_HALF 3
+//@}
+
 // These functions are used by command response functions in commands.c
 void set_state_output(uint8_t state_id, uint8_t divider);
+void set_state_output_encoded(uint8_t state_id, uint8_t divider, uint8_t encoding);
+void send_state_output_description(uint8_t state_id);
 void reset_output_counters(void);
 
 
@@ -10,6 +10,18 @@
  * (imu_interface_init()) must be called to set up the SPI interface. The SPI
  * interface settings are found in conf_spi_master.h.
  *
+ * The burst read is done by two PDCA (DMA) channels, one feeding the SPI
+ * transmit register with the burst read command and dummy words and one
+ * storing the received words in a frame buffer. The transfer is started with
+ * imu_burst_read_start(), typically from the IMU interrupt, and runs without
+ * the CPU. When imu_burst_read_busy() returns false, the frame is converted
+ * with imu_convert_burst_read(). Single SPI commands reserve the SPI such
+ * that no burst read is started while they are sent.
+ *
+ * In the raw passthrough mode (\#imu_raw_passthrough) the frame is instead
+ * copied as it is with imu_copy_burst_read(), status bits included, and the
+ * conversion to SI units is left to the user.
+ *
  * \authors John-Olof Nilsson, Isaac Skog
  * \copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
  */
@@ -21,6 +33,7 @@
 #include "conf_spi_master.h"
 #include "nav_types.h"
 
+#include <string.h>
 #include <gpio.h>
 #include <spi.h>
 #include <spi_master.h>
@@ -42,9 +55,30 @@
 
 #define MAX_LOG2_NR_FILTER_TAPS 4
 
+///\name PDCA channels of the burst read
+//@{
+#define IMU_PDCA_CHANNEL_RX 0
+#define IMU_PDCA_CHANNEL_TX 1
+//@}
+
+///\name Word positions in a burst read frame
+///  The word received while the command is sent carries no data.
+//@{
+#define FRAME_SUPPLY 1
+#define FRAME_XGYRO 2
+#define FRAME_YGYRO 3
+#define FRAME_ZGYRO 4
+#define FRAME_XACC 5
+#define FRAME_YACC 6
+#define FRAME_ZACC 7
+#define FRAME_XTEMP 8
+#define FRAME_YTEMP 9
+#define FRAME_ZTEMP 10
+#define FRAME_AUX_ADC 11
+//@}
+
 ///\name Scaling of IMU raw data
 //@{
-#define SUPPLY_SCALE 0.002418f
 #define GYRO_SCALE 0.00087266f
 #define ACC_SCALE 0.0081643275f
 #define TEMP_SCALE 0.0085f
@@ -71,6 +105,16 @@ static int16_t ytemp;
 static int16_t ztemp;
 static int16_t aux_adc;
 
+// Words sent in a burst read, the command followed by dummy words clocking out the data.
+// Kept in RAM since it is read by the PDCA.
+static uint16_t burst_read_tx[IMU_BURST_READ_WORDS] = {BURST_READ,
+													   CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY,
+													   CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY,
+													   CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY,
+													   CONFIG_SPI_MASTER_DUMMY,CONFIG_SPI_MASTER_DUMMY};
+// Set while a single command is sent, no burst read may be started then
+static volatile bool spi_reserved = false;
+
 /** \name Global IMU output variables
  * Global variable used for making sensor readings available to other parts of
  * the program. The variables will contain the latest read out sensor readings.
@@ -84,6 +128,19 @@ vec3 imu_temperaturs;			///< \f$[^circ C]\f$
 precision imu_supply_voltage;	///< \f$[V]\f$
 //@}
 
+/** \name Raw IMU passthrough
+ * In the raw passthrough mode, the raw data words of the latest burst read
+ * (supply, x/y/z gyro, x/y/z accelerometer, x/y/z temperature, aux ADC) are
+ * held unconverted with their status bits in \#imu_raw_data.
+ */
+//@{
+bool imu_raw_passthrough = false;				///< True if the frames are copied instead of converted
+uint16_t imu_raw_data[IMU_RAW_DATA_WORDS];		///< Raw words of the latest burst read
+
+/// Log2 of the number of taps last set by low_pass_filter_setting()
+uint8_t imu_log2_nr_filter_taps = IMU_FILTER_TAPS_NOT_SET;
+//@}
+
 /**
  * /brief Initialization routine for the IMU to MCU interface
  *
@@ -91,12 +148,38 @@ precision imu_supply_voltage;	///< \f$[V]\f$
  * and setup routines with arguments defined by setting macros found in
  * conf_spi_master.h. The routine selects the IMU SPI for communication and
  * the interface functions will assume that the IMU SPI is still selected.
+ * The PDCA channels of the burst read are set up for 16-bit transfers between
+ * the SPI and memory.
  */
 void imu_interface_init(void){	
+	volatile avr32_pdca_channel_t* rx = &AVR32_PDCA.channel[IMU_PDCA_CHANNEL_RX];
+	volatile avr32_pdca_channel_t* tx = &AVR32_PDCA.channel[IMU_PDCA_CHANNEL_TX];
+	
 	spi_master_init(SPI_IMU);
 	spi_master_setup_device(SPI_IMU, &SPI_DEVICE_IMU, 3, SPI_IMU_BAUDRATE, 0);
 	spi_enable(SPI_IMU);
 	spi_select_device(SPI_IMU,&SPI_DEVICE_IMU);
+	
+	rx->cr = AVR32_PDCA_TDIS_MASK;
+	rx->idr = 0xFFFFFFFF;
+	rx->psr = AVR32_PDCA_PID_SPI0_RX;
+	rx->mr = AVR32_PDCA_HALF_WORD << AVR32_PDCA_SIZE_OFFSET;
+	tx->cr = AVR32_PDCA_TDIS_MASK;
+	tx->idr = 0xFFFFFFFF;
+	tx->psr = AVR32_PDCA_PID_SPI0_TX;
+	tx->mr = AVR32_PDCA_HALF_WORD << AVR32_PDCA_SIZE_OFFSET;
+}
+
+/// Waits until no burst read is running and reserves the SPI for a single command.
+static void reserve_spi(void){
+	spi_reserved = true;
+	while (imu_burst_read_busy()) {;}
+}
+
+/// Waits until a single command has been sent and releases the SPI.
+static void release_spi(void){
+	while (!spi_is_tx_empty(SPI_IMU)) {;}
+	spi_reserved = false;
 }
 
 /// Converts raw (integer) inertial readings to float SI units.
@@ -132,74 +215,84 @@ void convert_auxiliary_data(void){
 }
 
 
-/*! \brief Request and reads all sensor output data from IMU.
+/*! \brief Starts a burst read of all sensor output data from the IMU.
 
 	\details This function uses the IMU burst read functionallity in which all
 	IMU sensor data (rotation, specific force, temperature, and supply voltage)
 	is output by the IMU after a single request. This way only two clock
 	cycles are required between each read operation. This is faster than only
 	reading out rotation and specific force.
-	The functions first reads in the values in 16-bit intermediate variables
-	and then call the help functions convert_inert_readings() and
+	The transfer is done by the PDCA and the function returns immediately, so
+	it may be called from the IMU interrupt. It runs from RAM, as the IMU
+	interrupt, and the PDCA reads the command words from RAM.
+	
+	@param[out] frame	Buffer of \#IMU_BURST_READ_WORDS words receiving the raw frame.
+	\return False if no transfer was started, since a burst read is already running or the SPI is reserved.
+*/
+COMPILER_RAMFUNC bool imu_burst_read_start(uint16_t* frame){
+	volatile avr32_pdca_channel_t* rx = &AVR32_PDCA.channel[IMU_PDCA_CHANNEL_RX];
+	volatile avr32_pdca_channel_t* tx = &AVR32_PDCA.channel[IMU_PDCA_CHANNEL_TX];
+	
+	if(spi_reserved || rx->tcr || tx->tcr){
+		return false;}
+	// Discard any word left in the receive data register
+	(void)spi_get(SPI_IMU);
+	rx->mar = (uint32_t)frame;
+	rx->tcr = IMU_BURST_READ_WORDS;
+	tx->mar = (uint32_t)burst_read_tx;
+	tx->tcr = IMU_BURST_READ_WORDS;
+	// Receive channel first such that no received word is missed
+	rx->cr = AVR32_PDCA_TEN_MASK;
+	tx->cr = AVR32_PDCA_TEN_MASK;
+	return true;
+}
+
+/// Returns true while a burst read started with imu_burst_read_start() has not landed in its frame.
+bool imu_burst_read_busy(void){
+	return AVR32_PDCA.channel[IMU_PDCA_CHANNEL_RX].tcr != 0;
+}
+
+/*! \brief Converts a raw burst read frame to the global IMU output variables.
+
+	\details Reads the values of the frame into 16-bit intermediate variables
+	and then calls the help functions convert_inert_readings() and
 	convert_auxiliary_data() to shift out status bits and scale to SI units.
 	
+	@param[in]  frame					Frame filled by a burst read.
 	@param[out] angular_rates_in		Vector containing the 3 (x,y,z) angular rates in [rad/sec].
 	@param[out] accelerations_in		Vector containing the 3 (x,y,z) specific force in [m/s^2].
 	@param[out] imu_temperatures		Vector containing the 3 (x,y,z) temperatur readings in [C].
 	@param[out] imu_supply_voltage		Supply voltage measurement in [V].
 */
-void imu_burst_read(void){
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,BURST_READ);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	supply = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	xgyro = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	ygyro = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	zgyro = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	xacc = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	yacc = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	zacc = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	xtemp = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	ytemp = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	ztemp = spi_get(SPI_IMU);
-	while (!spi_is_tx_ready(SPI_IMU)) {;}
-	spi_put(SPI_IMU,CONFIG_SPI_MASTER_DUMMY);
-	while (!spi_is_rx_ready(SPI_IMU)) {;}
-	aux_adc = spi_get(SPI_IMU);
+void imu_convert_burst_read(const uint16_t* frame){
+	supply = frame[FRAME_SUPPLY];
+	xgyro = frame[FRAME_XGYRO];
+	ygyro = frame[FRAME_YGYRO];
+	zgyro = frame[FRAME_ZGYRO];
+	xacc = frame[FRAME_XACC];
+	yacc = frame[FRAME_YACC];
+	zacc = frame[FRAME_ZACC];
+	xtemp = frame[FRAME_XTEMP];
+	ytemp = frame[FRAME_YTEMP];
+	ztemp = frame[FRAME_ZTEMP];
+	aux_adc = frame[FRAME_AUX_ADC];
 	
 	convert_inert_readings();
 	convert_auxiliary_data();
 }
 
+/*! \brief Copies the raw data words of a burst read frame to \#imu_raw_data.
+
+	\details No status bits are shifted out and no conversion is done, so
+	this is much cheaper than imu_convert_burst_read(). Used in the raw
+	passthrough mode.
+	
+	@param[in]  frame					Frame filled by a burst read.
+*/
+void imu_copy_burst_read(const uint16_t* frame){
+	memcpy(imu_raw_data,&frame[FRAME_SUPPLY],sizeof(imu_raw_data));
+}
+
 /*
 #warning If this function is used the CONFIG_SPI_MASTER_DELAY_BCT macro must be set to >=9
 // Todo: above
@@ -243,8 +336,10 @@ void imu_read_acc_and_gyro(void){
 	statinarry.
 */
 void precision_gyro_bias_null_calibration(void){
+	reserve_spi();
 	while (!spi_is_tx_ready(SPI_IMU)) {;}
 	spi_put(SPI_IMU,PRECISION_GYRO_BIAS_CALIBRATION);
+	release_spi();
 	// After this the IMU will be off-line for ~15s
 }
 
@@ -257,8 +352,11 @@ void low_pass_filter_setting(uint8_t nr_filter_taps){
 	if (log2_nr_filter_taps>MAX_LOG2_NR_FILTER_TAPS){
 		log2_nr_filter_taps=MAX_LOG2_NR_FILTER_TAPS;}
 	uint16_t tx_word = log2_nr_filter_taps + (1<<8)*SET_NR_FILTER_TAPS;
+	reserve_spi();
 	while (!spi_is_tx_ready(SPI_IMU)) {;}
 	spi_put(SPI_IMU,tx_word);
+	release_spi();
+	imu_log2_nr_filter_taps = log2_nr_filter_taps;
 }
 
 //@}
\ No newline at end of file
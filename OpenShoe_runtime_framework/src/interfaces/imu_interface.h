@@ -21,12 +21,22 @@
 
 #include "compiler.h"
 
+/// Number of 16-bit words of a burst read frame (the command word followed by 11 data words)
+#define IMU_BURST_READ_WORDS 12
+/// Number of raw data words of a burst read frame (supply, gyros, accelerometers, temperatures, aux ADC)
+#define IMU_RAW_DATA_WORDS (IMU_BURST_READ_WORDS-1)
+/// Value of \#imu_log2_nr_filter_taps before the low pass filter has been set
+#define IMU_FILTER_TAPS_NOT_SET 0xFF
+
 //void imu_interupt_init(void);
 
 /// Initialization routine for the IMU to MCU interface
 void imu_interface_init(void);
-// Routine for fast reading of vcc, acc, gyro, and temp from IMU
-void imu_burst_read(void);
+// Routines for burst reads done by the PDCA
+bool imu_burst_read_start(uint16_t* frame);
+bool imu_burst_read_busy(void);
+void imu_convert_burst_read(const uint16_t* frame);
+void imu_copy_burst_read(const uint16_t* frame);
 // Routine for setting number of filter taps in the IMU
 void low_pass_filter_setting(uint8_t nr_filter_taps);
 
@@ -0,0 +1,137 @@
+/** \file
+	\brief Queue of IMU interrupts between the interrupt routine and the main loop.
+
+	\details The IMU interrupt routine calls queue_imu_interrupt(), which
+	puts a time-stamp in the queue and starts a burst read of the IMU into the
+	frame of the queue entry. The burst read is done by the PDCA (DMA), so the
+	transfer overlaps whatever the main loop is doing. The main loop waits for
+	an entry with wait_for_interrupt() and converts its frame and releases it
+	with read_imu_data().
+
+	The queue is a single-producer/single-consumer ring. The interrupt routine
+	is the only writer of the head index and the main loop the only writer of
+	the tail index, so no locking is needed. If the main loop is late, e.g.
+	during a long USB transmission or ZUPT update, the interrupts are kept in
+	the queue and the main loop catches up by running once per interrupt,
+	such that the number of filter steps matches the number of IMU samples.
+	Since every entry has its own frame, a caught up iteration processes the
+	sample of its own interrupt. Interrupts arriving when the queue is full, or
+	when the SPI is busy with a command to the IMU, are dropped. Both cases are
+	counted in \#imu_sample_counters.
+	
+	The interrupt routine and the functions it calls run from RAM, such that
+	the interrupts are served and queued also while the CPU is stalled on the
+	flash by a page erase or write of the flash log or a state checkpoint.
+	Interrupts which still never reach the interrupt routine, e.g. since
+	interrupts were disabled for longer than an IMU frame and the EIC only
+	latches one edge, can not be counted by the routine. Instead, wait_for_interrupt() finds the
+	number of missing samples from the time between the time-stamps of two
+	handled interrupts, which is counted in \#imu_sample_counters and added to
+	\#interrupt_counter, such that the interrupt counter stays a time stamp.
+
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+///	\addtogroup interrupt_queue
+///	@{
+
+#include "interrupt_queue.h"
+#include "imu_interface.h"
+#include "process_sequence.h"
+
+///\cond
+#define IMU_INTERRUPT_QUEUE_MASK (IMU_INTERRUPT_QUEUE_SIZE-1)
+
+extern uint32_t interrupt_counter;
+extern uint32_t imu_interrupt_ts;
+extern sample_queue_counters imu_sample_counters;
+extern bool imu_raw_passthrough;
+///\endcond
+
+///\name Queue state
+//@{
+/// Time-stamps of the interrupts not yet handled by the main loop.
+static volatile uint32_t imu_interrupt_queue[IMU_INTERRUPT_QUEUE_SIZE];
+/// Raw burst read frames of the interrupts, filled by the PDCA.
+static uint16_t imu_frame_queue[IMU_INTERRUPT_QUEUE_SIZE][IMU_BURST_READ_WORDS];
+/// Number of interrupts put in the queue (modulo 256), only written by the interrupt routine.
+static volatile uint8_t imu_interrupt_queue_head = 0;
+/// Number of interrupts taken out of the queue (modulo 256), only written by the main loop.
+static volatile uint8_t imu_interrupt_queue_tail = 0;
+/// False until the first interrupt has been handled
+static bool has_handled_interrupt = false;
+//@}
+
+/// Number of samples missing between two handled interrupts, from their time-stamps (COUNT) rounded to whole IMU frames.
+static inline uint32_t missing_samples(uint32_t previous_ts, uint32_t ts){
+	uint32_t frames = (ts-previous_ts+IMU_FRAME_CYCLES/2)/IMU_FRAME_CYCLES;
+	return frames>1 ? frames-1 : 0;
+}
+
+/**
+	\brief Puts an IMU interrupt in the queue and starts the burst read of its frame, called from the interrupt routine.
+
+	\details The interrupt is dropped if the queue is full or if the burst
+	read could not be started. Runs from RAM, as the interrupt routine.
+*/
+COMPILER_RAMFUNC void queue_imu_interrupt(void){
+	uint8_t head = imu_interrupt_queue_head;
+	if((uint8_t)(head-imu_interrupt_queue_tail) < IMU_INTERRUPT_QUEUE_SIZE &&
+	   imu_burst_read_start(imu_frame_queue[head & IMU_INTERRUPT_QUEUE_MASK])){
+		// Write the time-stamp before the head index is published
+		imu_interrupt_queue[head & IMU_INTERRUPT_QUEUE_MASK] = Get_system_register(AVR32_COUNT);
+		imu_interrupt_queue_head = head+1;
+	}
+	else{
+		imu_sample_counters.dropped_samples++;
+	}
+}
+
+/// Number of interrupts in the queue which have not been released by read_imu_data().
+uint8_t nr_of_queued_interrupts(void){
+	return (uint8_t)(imu_interrupt_queue_head-imu_interrupt_queue_tail);
+}
+
+/**
+	\brief Wait for an interrupt in the queue and for its burst read to land, increase interrupt counter, and return.
+
+	\details Only the burst read of the newest queued interrupt can still be
+	running, since a new one is not started before the previous has finished.
+	The queue entry is released by read_imu_data(). The interrupt counter is
+	increased by one plus the number of samples missing since the previous
+	interrupt.
+*/
+void wait_for_interrupt(void){
+	uint8_t tail = imu_interrupt_queue_tail;
+	uint8_t queued;
+	while((queued = (uint8_t)(imu_interrupt_queue_head-tail)) == 0){;}
+	if(queued==1){
+		while(imu_burst_read_busy()){;}}
+	// More than one queued interrupt means the main loop is catching up
+	if(queued>1){
+		imu_sample_counters.late_samples++;}
+	if(queued>imu_sample_counters.max_queued){
+		imu_sample_counters.max_queued = queued;}
+	uint32_t ts = imu_interrupt_queue[tail & IMU_INTERRUPT_QUEUE_MASK];
+	if(has_handled_interrupt){
+		uint32_t missing = missing_samples(imu_interrupt_ts,ts);
+		imu_sample_counters.missed_samples += missing;
+		interrupt_counter += missing;}
+	has_handled_interrupt = true;
+	imu_interrupt_ts = ts;
+	interrupt_counter++;
+}
+
+/// Copies the IMU frame of the current interrupt, converts it (except in the raw passthrough mode) and releases its queue entry.
+void read_imu_data(void){
+	uint8_t tail = imu_interrupt_queue_tail;
+	// The raw words are also used by the flash log
+	imu_copy_burst_read(imu_frame_queue[tail & IMU_INTERRUPT_QUEUE_MASK]);
+	if(!imu_raw_passthrough){
+		imu_convert_burst_read(imu_frame_queue[tail & IMU_INTERRUPT_QUEUE_MASK]);}
+	// Release the entry after the frame has been read
+	imu_interrupt_queue_tail = tail+1;
+}
+
+//@}
@@ -0,0 +1,33 @@
+/** \file
+	\brief Header file for the queue of IMU interrupts of the main loop.
+
+	\details See interrupt_queue.c.
+
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+/**
+	\ingroup openshoe_runtime_framework
+
+	\defgroup interrupt_queue IMU interrupt queue
+	\brief This group contains the queue between the IMU interrupt and the main loop.
+	@{
+*/
+
+#ifndef INTERRUPT_QUEUE_H_
+#define INTERRUPT_QUEUE_H_
+
+#include "compiler.h"
+
+/// Number of interrupts the queue can hold, must be a power of two.
+#define IMU_INTERRUPT_QUEUE_SIZE 16
+
+void queue_imu_interrupt(void);
+uint8_t nr_of_queued_interrupts(void);
+void wait_for_interrupt(void);
+void read_imu_data(void);
+
+#endif /* INTERRUPT_QUEUE_H_ */
+
+//@}
@@ -5,12 +5,14 @@
 	
 	\details This file contains the main function and interrupt control.
 	The main function control the execution of the program. The single
-	interrupt routine only toggles a flag which the main function is polling.
-	Each time the flag is toggled, the following will be executed in the main
-	loop: 1) data is read from the IMU 2) functions in the process sequence
-	are executed 3) commands are received from the user 4) data are
-	transmitted back 5) and it is checked that a new interrupt did not arrived
-	while the program was executing the main loop.
+	interrupt routine only puts the interrupt in the queue of interrupt_queue.c,
+	which starts a burst read of the IMU into the frame of the queue entry, and
+	the main function is polling the queue. For each queued interrupt, the
+	following will be executed in the main loop: 1) the frame is converted as
+	soon as it has landed 2) functions in the process sequence are executed 3)
+	commands are received from the user 4) data are transmitted back 5) and it
+	is checked that a new interrupt did not arrived while the program was
+	executing the main loop.
 	
 	\authors John-Olof Nilsson, Isaac Skog
 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
@@ -33,13 +35,24 @@
 #include "process_sequence.h"
 #include "external_interface.h"
 #include "imu_interface.h"
+#include "calibration_record.h"
+#include "flash_log.h"
+#include "state_checkpoint.h"
+#include "interrupt_queue.h"
 
 // Interrupt counter (essentially a time stamp)
 uint32_t interrupt_counter = 0;
-// Global IMU interrupt (data) time-stamp variable
+// Number of main loop iterations which were not finished before the next interrupt
+uint32_t deadline_miss_counter = 0;
+// Interrupt counter value of the last main loop iteration which missed its deadline
+uint32_t last_deadline_miss = 0;
+// Global IMU interrupt (data) time-stamp variable, time-stamp of the interrupt handled by the main loop
 uint32_t imu_interrupt_ts;
-// Variable that used to signal if an external interrupt occurs.
-static volatile bool imu_interrupt_flag = false;
+// Profile of the main loop (external state)
+loop_profile system_profile = {0};
+// Counters of late, dropped and missed IMU samples (external state)
+sample_queue_counters imu_sample_counters = {0};
+
 // Structure holding the configuration parameters of the EIC module.
 static eic_options_t eic_options;
 
@@ -63,15 +76,18 @@ __attribute__((__naked__))
 #elif __ICCAVR32__
 #pragma shadow_registers = full
 #endif
-// This handler is connected to the interrupt in "exception.S"
-void eic_nmi_handler( void )
+// This handler is connected to the interrupt in "exception.S". It runs from
+// RAM, as does everything it calls, such that it is served while the CPU is
+// stalled on the flash by a page erase or write.
+COMPILER_RAMFUNC void eic_nmi_handler( void )
 {
 	// Save registers not saved upon NMI exception.
 	__asm__ __volatile__ ("pushm   r0-r12, lr\n\t");
 	
-	eic_clear_interrupt_line(&AVR32_EIC, IMU_INTERUPT_LINE1);
-	imu_interrupt_ts = Get_system_register(AVR32_COUNT);
-	imu_interrupt_flag = true;
+	// As eic_clear_interrupt_line(), which is in the flash
+	AVR32_EIC.icr = 1 << IMU_INTERUPT_LINE1;
+	AVR32_EIC.isr;
+	queue_imu_interrupt();
 	
 	// Significant amount of processing should not be done inside this routine
 	// since the USB communication will be blocked for its duration.
@@ -90,28 +106,76 @@ void system_init(void){
 	com_interface_init();
 	imu_interupt_init();
 	imu_interface_init();
+	// Warm start with the calibration results stored in flash, if any
+	load_calibration_record();
+	flash_log_init();
+	state_checkpoint_init();
 	// Any new initialization function of the system should be added here or
 	// under any of the above initialization functions.
 }
 
-/// Wait for the interrupt flag to be set, toggle it, increase interrupt counter, and return.
-void wait_for_interrupt(void){
-	while(true){
-		if(imu_interrupt_flag==true){
-			imu_interrupt_flag=false;
-			interrupt_counter++;
-			return;
-		}
-	}	
-}
+///\cond
+extern uint8_t error_signal;
+///\endcond
 
-/// Checks that the main loop has finished before next interrupt
+/**
+	\brief Checks that the main loop has finished before next interrupt
+	
+	\details If the next interrupt has already arrived, the miss is counted and
+	signaled with \#DEADLINE_MISSED_ERROR. The interrupt stays in the queue and
+	is handled in the next main loop iteration. The processing function which blew
+	the frame can then be found from the overruns in the execution time records
+	of the processing functions (control_tables.h).
+*/
 void within_time_limit(void){
-	if (imu_interrupt_flag!=false){
-		// Todo: Set some error state
+	if (nr_of_queued_interrupts()!=0){
+		deadline_miss_counter++;
+		last_deadline_miss = interrupt_counter;
+		error_signal = DEADLINE_MISSED_ERROR;
 	}
 }
 
+///\cond
+static inline uint16_t saturate_u16(uint32_t value){
+	return value>0xFFFF ? 0xFFFF : value;}
+///\endcond
+
+/**
+	\brief Updates the profile of the main loop
+	
+	\details Updates the loop fields of \#system_profile and reports the next
+	process sequence element. The overhead field holds the cycles of this
+	function plus those spent on recording the execution times in the process
+	sequence, i.e. what the profiling costs per loop iteration.
+*/
+void update_system_profile(void){
+	static uint8_t elem_nr = 0;
+	uint32_t start = Get_system_register(AVR32_COUNT);
+	proc_func_info* info = get_process_sequence_info(elem_nr);
+	
+	system_profile.loop_time = saturate_u16(start-imu_interrupt_ts);
+	if(system_profile.loop_time > system_profile.max_loop_time){
+		system_profile.max_loop_time = system_profile.loop_time;}
+	system_profile.missed_interrupts = deadline_miss_counter;
+	
+	system_profile.elem_nr = elem_nr;
+	if(info){
+		system_profile.func_id = info->id;
+		system_profile.min_proc_time = saturate_u16(info->timing->min_proc_time);
+		system_profile.max_proc_time = saturate_u16(info->timing->peak_proc_time);
+		system_profile.mean_proc_time = saturate_u16(get_mean_proc_time(info->timing));
+		system_profile.nr_of_overruns = saturate_u16(info->timing->nr_of_overruns);}
+	else{
+		system_profile.func_id = 0;
+		system_profile.min_proc_time = 0;
+		system_profile.max_proc_time = 0;
+		system_profile.mean_proc_time = 0;
+		system_profile.nr_of_overruns = 0;}
+	elem_nr = (elem_nr+1)%PROCESS_SEQUENCE_SIZE;
+	
+	system_profile.overhead = saturate_u16(get_process_sequence_overhead() + Get_system_register(AVR32_COUNT)-start);
+}
+
 int main (void) {
 	
 	// Initialize system
@@ -124,10 +188,13 @@ int main (void) {
 		wait_for_interrupt();
 
 		// Read data from IMU			
-		imu_burst_read();
+		read_imu_data();
 
 		// Execute all processing functions (filtering)
 		run_process_sequence();
+		
+		// Log the raw IMU data to the flash
+		flash_log_frame();
 
 		// Check if any command has been sent and respond accordingly
 		receive_command();
@@ -137,6 +204,9 @@ int main (void) {
 		
 		// Ensure the loop was finished within time limit
 		within_time_limit();
+		
+		// Update the execution time profile
+		update_system_profile();
 	}
 }
 
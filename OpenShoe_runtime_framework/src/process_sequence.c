@@ -8,6 +8,15 @@
 	that they have to communicate via some global or c-file internal variables.
 	The functions in this file are used for manipulating the \#process_sequence
 	and to execute the whole processing function sequence.
+	
+	Functions inserted with set_proc_func_in_process_sequence() are timed with
+	the COUNT register when the sequence is run. The clock cycles of each call
+	are recorded in the proc_func_timing struct of the function, and calls
+	exceeding the max_proc_time budget of the function are counted as overruns.
+	The cycles spent on recording the times are summed up per run, such that
+	the cost of the instrumentation itself can be reported (see loop_profile).
+	Functions inserted with set_elem_in_process_sequence() have no information
+	struct and are not timed individually.
 		
 	\authors John-Olof Nilsson, Isaac Skog
 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
@@ -20,26 +29,87 @@
 
 /// Process sequence
 static processing_function_p process_sequence[PROCESS_SEQUENCE_SIZE] = {NULL};	
+/// Information structs of the functions in the process sequence (NULL for functions without one).
+static proc_func_info* process_sequence_info[PROCESS_SEQUENCE_SIZE] = {NULL};
 /// Temporary storage for copy of processing sequence.
 static processing_function_p process_sequence_storage[PROCESS_SEQUENCE_SIZE] = {NULL};
+/// Temporary storage for copy of the information structs of the processing sequence.
+static proc_func_info* process_sequence_info_storage[PROCESS_SEQUENCE_SIZE] = {NULL};
+/// Clock cycles of the last run of the whole processing sequence.
+static uint32_t process_sequence_proc_time = 0;
+/// Clock cycles spent on recording the execution times in the last run of the processing sequence.
+static uint32_t process_sequence_overhead = 0;
+
+/// Updates the execution time record of a processing function with the clock cycles of a call.
+static inline void record_proc_time(proc_func_info* info, uint32_t cycles){
+	proc_func_timing* timing = info->timing;
+	timing->last_proc_time = cycles;
+	if(cycles < timing->min_proc_time){
+		timing->min_proc_time = cycles;}
+	if(cycles > timing->peak_proc_time){
+		timing->peak_proc_time = cycles;}
+	// Exponentially weighted mean, started at the first call
+	if(timing->nr_of_calls == 0){
+		timing->mean_proc_time_acc = cycles<<PROC_TIME_MEAN_SHIFT;}
+	else{
+		timing->mean_proc_time_acc += cycles - (timing->mean_proc_time_acc>>PROC_TIME_MEAN_SHIFT);}
+	timing->nr_of_calls++;
+	if(info->max_proc_time > 0 && cycles > (uint32_t)info->max_proc_time){
+		timing->nr_of_overruns++;}}
 
-/// Execute all non-NULL functions in the processing sequence.
+/**
+	\brief Execute all non-NULL functions in the processing sequence.
+	
+	\details Each call is timed with the COUNT register. The information struct
+	is picked up before the call since the function may change the sequence.
+	Wrap-around of the COUNT register is handled by the unsigned subtraction.
+*/
 void run_process_sequence(void){
+	uint32_t sequence_start = Get_system_register(AVR32_COUNT);
+	uint32_t overhead = 0;
 	for(int i=0;i<(sizeof(process_sequence)/sizeof(processing_function_p));i++){
 		if(process_sequence[i]){		// If function point not NULL 
-			process_sequence[i]();}}	// Call function
+			proc_func_info* info = process_sequence_info[i];
+			uint32_t start = Get_system_register(AVR32_COUNT);
+			process_sequence[i]();		// Call function
+			if(info){
+				uint32_t stop = Get_system_register(AVR32_COUNT);
+				record_proc_time(info,stop-start);
+				overhead += Get_system_register(AVR32_COUNT)-stop;}}}
+	process_sequence_proc_time = Get_system_register(AVR32_COUNT)-sequence_start;
+	process_sequence_overhead = overhead;
 }
 
+/// Clock cycles of the last run of the whole processing sequence.
+uint32_t get_process_sequence_proc_time(void){
+	return process_sequence_proc_time;}
+
+/// Clock cycles spent on recording the execution times in the last run of the processing sequence.
+uint32_t get_process_sequence_overhead(void){
+	return process_sequence_overhead;}
+
+/**
+	\brief Information struct of a process sequence element
+	
+	@param[in] elem_nr \#process_sequence element index
+	\return The information struct, or NULL if the element is empty, has no information struct or elem_nr is invalid.
+*/
+proc_func_info* get_process_sequence_info(uint8_t elem_nr){
+	return elem_nr<PROCESS_SEQUENCE_SIZE ? process_sequence_info[elem_nr] : NULL;}
+
 /// Sets alla elements in processing sequence to NULL.
 void empty_process_sequence(void){
 	for(int i = 0;i<PROCESS_SEQUENCE_SIZE;i++){
-		process_sequence[i]=NULL;}}
+		process_sequence[i]=NULL;
+		process_sequence_info[i]=NULL;}}
 
 /// Copy processing sequence to temporary storage and sets all elements to NULL.
 void store_and_empty_process_sequence(void){
 	for(int i = 0;i<PROCESS_SEQUENCE_SIZE;i++){
 		process_sequence_storage[i] = process_sequence[i];
-		process_sequence[i]=NULL;}}
+		process_sequence_info_storage[i] = process_sequence_info[i];
+		process_sequence[i]=NULL;
+		process_sequence_info[i]=NULL;}}
 
 
 /**	
@@ -50,7 +120,8 @@ void store_and_empty_process_sequence(void){
 */
 void restore_process_sequence(void){
 	for(int i = 0;i<PROCESS_SEQUENCE_SIZE;i++){
-		process_sequence[i] = process_sequence_storage[i];}}
+		process_sequence[i] = process_sequence_storage[i];
+		process_sequence_info[i] = process_sequence_info_storage[i];}}
 	
 		
 /**	
@@ -63,7 +134,8 @@ void restore_process_sequence(void){
 	@param[in] elem_value Function pointer to insert into \#process_sequence.
 */
 void set_last_process_sequence_element(processing_function_p elem_value){
-	process_sequence[PROCESS_SEQUENCE_SIZE-1] = elem_value;}
+	process_sequence[PROCESS_SEQUENCE_SIZE-1] = elem_value;
+	process_sequence_info[PROCESS_SEQUENCE_SIZE-1] = NULL;}
 
 /**
 	\brief Sets process sequence element number to elem_value
@@ -79,8 +151,26 @@ void set_last_process_sequence_element(processing_function_p elem_value){
 void set_elem_in_process_sequence(processing_function_p elem_value, uint8_t elem_nr){
 	if(elem_nr<PROCESS_SEQUENCE_SIZE){
 		process_sequence[elem_nr] = elem_value;
+		process_sequence_info[elem_nr] = NULL;
 	}
 	// TODO: set some error state if condition above is not fullfilled.
 }
 
+/**
+	\brief Sets process sequence element number to the processing function of an information struct
+	
+	\details As set_elem_in_process_sequence() but the function will be timed
+	against its max_proc_time budget when the sequence is run. If info is NULL
+	the element is cleared.
+	
+	@param[in] info    Information struct of the processing function, or NULL.
+	@param[in] elem_nr \#process_sequence element index
+*/
+void set_proc_func_in_process_sequence(proc_func_info* info, uint8_t elem_nr){
+	if(elem_nr<PROCESS_SEQUENCE_SIZE){
+		process_sequence[elem_nr] = info ? info->func_p : NULL;
+		process_sequence_info[elem_nr] = info;
+	}
+}
+
 //@}
\ No newline at end of file
@@ -20,9 +20,56 @@
 #define PROCESS_SEQUENCE_H_
 
 #include "compiler.h"
+#include "control_tables.h"
 
 /// Size of process sequence
 #define PROCESS_SEQUENCE_SIZE 10
+
+/// Value of the error signal if the main loop did not finish before the next IMU interrupt.
+#define DEADLINE_MISSED_ERROR 6
+
+/**
+	\brief Profile of the main loop, output as the \#SYSTEM_PROFILE_SID state.
+	
+	\details The loop fields are updated at every iteration of the main loop.
+	The processing function fields report one process sequence element at a
+	time, cycling through all elements, such that the state stays small enough
+	for the output buffer. All times are in clock cycles (COUNT register),
+	saturated at 0xFFFF.
+*/
+typedef struct {
+	/// Time from the IMU interrupt to the end of the last main loop iteration
+	uint16_t loop_time;
+	/// Largest loop_time
+	uint16_t max_loop_time;
+	/// Number of main loop iterations which were not finished before the next interrupt
+	uint32_t missed_interrupts;
+	/// Time spent on the profiling itself in the last main loop iteration
+	uint16_t overhead;
+	/// Reported process sequence element
+	uint8_t elem_nr;
+	/// ID of the processing function of the element, 0 if there is none or it is not timed
+	uint8_t func_id;
+	///\name Execution times of the processing function
+	//@{
+	uint16_t min_proc_time;
+	uint16_t max_proc_time;
+	uint16_t mean_proc_time;
+	uint16_t nr_of_overruns;
+	//@}
+} loop_profile;
+
+/// Counters of the IMU interrupt queue of the main loop, output as the \#IMU_SAMPLE_COUNTERS_SID state.
+typedef struct {
+	/// Number of samples handled after the next interrupt had arrived (caught up)
+	uint32_t late_samples;
+	/// Number of samples lost since the interrupt queue was full
+	uint32_t dropped_samples;
+	/// Number of samples missing between the time-stamps of the handled interrupts, the dropped ones included
+	uint32_t missed_samples;
+	/// Largest number of queued interrupts seen by the main loop
+	uint32_t max_queued;
+} sample_queue_counters;
 /// Typedefinition for functions in the process sequence
 typedef void (*processing_function_p)(void);
 
@@ -38,6 +85,14 @@ void set_last_process_sequence_element(processing_function_p element_value);
 
 void set_elem_in_process_sequence(processing_function_p elem_value, uint8_t elem_nr);
 
+void set_proc_func_in_process_sequence(proc_func_info* info, uint8_t elem_nr);
+
+uint32_t get_process_sequence_proc_time(void);
+
+uint32_t get_process_sequence_overhead(void);
+
+proc_func_info* get_process_sequence_info(uint8_t elem_nr);
+
 #endif /* PROCESS_SEQUENCE_H_ */
 
 //@}
\ No newline at end of file
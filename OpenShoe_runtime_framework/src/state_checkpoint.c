@@ -0,0 +1,193 @@
+
+/** \file
+	\brief Checkpoints of the navigation states and the covariance in the internal flash.
+	
+	\details While the ZUPT aided INS is running, the processing function
+	save_state_checkpoint() periodically writes the position, velocity,
+	attitude and covariance of \#nav_filter to the flash. After a reset of the
+	system (e.g. a brown-out or a watchdog reset), the INS can be resumed from
+	the latest checkpoint with resume_from_state_checkpoint(), which takes one
+	frame instead of a new initial alignment. The checkpoints are off until
+	they are turned on with set_state_checkpoint_divider() (command
+	STATE_CHECKPOINTING).
+	
+	The checkpoints are written to the \#CHECKPOINT_SLOT_SIZE byte slots of
+	\#CHECKPOINT_NR_PAGES flash pages in turn, such that the pages are worn
+	evenly. A page is erased when the first of its slots is written, which
+	never affects the latest checkpoint. Each checkpoint has a sequence number
+	and a CRC-32, such that the latest complete one is found after a reset even
+	if the system was reset while a checkpoint was written.
+	
+	The erase and the write of a checkpoint are done in two different calls,
+	each stalling the CPU for a few milliseconds (\#FLASH_PAGE_OPERATION_CYCLES),
+	i.e. several IMU interrupts. The IMU interrupt routine runs from RAM and
+	keeps queueing the interrupts meanwhile, see interrupt_queue.c, but the
+	main loop is late by as much and catches up from the queue, which is
+	signalled as a missed deadline. To keep the stalls out of
+	the steps, a checkpoint is only taken at standstill, i.e. when the ZUPT
+	detector is set, once the checkpoint period has passed.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+///	\addtogroup state_checkpoint
+///	@{
+
+#include <stddef.h>
+
+#include "state_checkpoint.h"
+#include "calibration_record.h"
+#include "flashc.h"
+#include "nav_eq.h"
+
+/// Checkpoint as stored in a slot.
+typedef struct {
+	/// \#CHECKPOINT_MAGIC
+	uint32_t magic;
+	/// Incremented for every checkpoint, the highest is the latest
+	uint32_t sequence_number;
+	/// Navigation states and covariance
+	nav_checkpoint_t checkpoint;
+	/// CRC-32 of all preceding bytes
+	uint32_t crc;
+} checkpoint_record;
+
+///\cond
+#define SLOTS_PER_PAGE (AVR32_FLASHC_PAGE_SIZE/CHECKPOINT_SLOT_SIZE)
+#define NR_SLOTS (CHECKPOINT_NR_PAGES*SLOTS_PER_PAGE)
+#define NO_SLOT (-1)
+#define slot_page(slot) (CHECKPOINT_FIRST_PAGE+(slot)/SLOTS_PER_PAGE)
+#define slot_address(slot) ((const checkpoint_record*)(AVR32_FLASH_ADDRESS+CHECKPOINT_FIRST_PAGE*AVR32_FLASHC_PAGE_SIZE+(slot)*CHECKPOINT_SLOT_SIZE))
+
+// A checkpoint must fit in a slot and the checkpoints must fit in the 512 kB flash
+typedef char checkpoint_fits_in_slot[sizeof(checkpoint_record) <= CHECKPOINT_SLOT_SIZE ? 1 : -1];
+typedef char checkpoints_fit_in_flash[CHECKPOINT_FIRST_PAGE+CHECKPOINT_NR_PAGES <= 1024 ? 1 : -1];
+///\endcond
+
+///\name Steps of saving a checkpoint
+//@{
+#define NO_SAVE 0
+#define WRITE_SLOT 1
+//@}
+
+///\name Checkpoint state
+//@{
+/// Slot of the latest checkpoint, \#NO_SLOT if there is none
+static int latest_slot = NO_SLOT;
+/// Slot to which the next checkpoint is written
+static int next_slot = 0;
+/// Sequence number of the next checkpoint
+static uint32_t next_sequence_number = 0;
+/// Checkpoint being saved
+static checkpoint_record record;
+static uint8_t save_step = NO_SAVE;
+/// Checkpoint period divider, zero if not saving checkpoints
+static uint32_t rate_divider = 0;
+static uint32_t rate_counter = 0;
+//@}
+
+/// Checks the magic number and the CRC of a checkpoint.
+static bool is_valid_checkpoint(const checkpoint_record* checkpoint){
+	return checkpoint->magic==CHECKPOINT_MAGIC &&
+		   checkpoint->crc==calc_crc32((const uint8_t*)checkpoint,offsetof(checkpoint_record,crc));
+}
+
+/// Checks that a slot is erased, i.e., that it can be written without erasing its page.
+static bool is_erased_slot(int slot){
+	const uint32_t* word = (const uint32_t*)slot_address(slot);
+	for(int i=0;i<CHECKPOINT_SLOT_SIZE/sizeof(uint32_t);i++){
+		if(word[i]!=0xFFFFFFFF){
+			return false;}}
+	return true;
+}
+
+/**
+	\brief Finds the latest valid checkpoint, after which the next one is written.
+	
+	\details Must be called at start-up. Checks the CRC of all slots, which
+	takes some milliseconds. If the slot after the latest checkpoint is not
+	erased, e.g. since it holds a checkpoint which was torn by a reset, the
+	next checkpoint is written to the first slot of the next page instead.
+*/
+void state_checkpoint_init(void){
+	latest_slot = NO_SLOT;
+	for(int slot=0;slot<NR_SLOTS;slot++){
+		const checkpoint_record* checkpoint = slot_address(slot);
+		if(is_valid_checkpoint(checkpoint) &&
+		   (latest_slot==NO_SLOT || checkpoint->sequence_number>slot_address(latest_slot)->sequence_number)){
+			latest_slot = slot;}
+	}
+	next_slot = latest_slot==NO_SLOT || latest_slot+1==NR_SLOTS ? 0 : latest_slot+1;
+	if(next_slot%SLOTS_PER_PAGE!=0 && !is_erased_slot(next_slot)){
+		next_slot = next_slot-next_slot%SLOTS_PER_PAGE+SLOTS_PER_PAGE;
+		if(next_slot==NR_SLOTS){
+			next_slot = 0;}}
+	next_sequence_number = latest_slot==NO_SLOT ? 0 : slot_address(latest_slot)->sequence_number+1;
+}
+
+/**
+	\brief Processing function periodically saving a checkpoint of the navigation states.
+	
+	\details No checkpoints are saved during the initial alignment. The
+	states are copied at the first standstill after the divider counter has
+	run out, and the page of the slot is erased if the slot is the first of
+	its page; the copy is written in the next call.
+*/
+void save_state_checkpoint(void){
+	int slot = next_slot;
+	switch(save_step){
+		case NO_SAVE:
+			if(!rate_divider || nav_filter.initialize_flag){
+				return;}
+			if(rate_counter){
+				rate_counter--;
+				return;}
+			// Wait for a standstill
+			if(!nav_filter.zupt){
+				return;}
+			rate_counter = rate_divider-1;
+			record.magic = CHECKPOINT_MAGIC;
+			record.sequence_number = next_sequence_number;
+			nav_save_checkpoint(&nav_filter,&record.checkpoint);
+			record.crc = calc_crc32((const uint8_t*)&record,offsetof(checkpoint_record,crc));
+			if(slot%SLOTS_PER_PAGE==0){
+				flashc_erase_page(slot_page(slot),false);}
+			save_step = WRITE_SLOT;
+			break;
+		case WRITE_SLOT:
+			flashc_memcpy((volatile void*)slot_address(slot),&record,sizeof(checkpoint_record),false);
+			if(!flashc_is_lock_error() && !flashc_is_programming_error() && is_valid_checkpoint(slot_address(slot))){
+				latest_slot = slot;
+				next_sequence_number++;}
+			// A slot which failed is skipped, since it can not be written again before its page is erased
+			next_slot = slot+1<NR_SLOTS ? slot+1 : 0;
+			save_step = NO_SAVE;
+			break;
+	}
+}
+
+/// Sets the checkpoint period to 2^(divider-1) interrupts. Divider=0 turns off the checkpoints.
+void set_state_checkpoint_divider(uint8_t divider){
+	if(divider<=CHECKPOINT_MAX_LOG2_DIVIDER){
+		rate_divider = divider ? 1UL<<(divider-1) : 0;
+		rate_counter = 0;}
+}
+
+/**
+	\brief Resumes \#nav_filter from the latest checkpoint.
+	
+	\details The initial alignment is ended, so the ZUPT aided INS can be run
+	from the next interrupt. Nothing is changed if there is no valid
+	checkpoint.
+	
+	\return True if the filter was resumed.
+*/
+bool resume_from_state_checkpoint(void){
+	if(latest_slot==NO_SLOT || !is_valid_checkpoint(slot_address(latest_slot))){
+		return false;}
+	nav_resume_from_checkpoint(&nav_filter,&slot_address(latest_slot)->checkpoint);
+	return true;
+}
+
+//@}
@@ -0,0 +1,55 @@
+
+/** \file
+	\brief Header file for the checkpoints of the navigation states in the internal flash.
+	
+	\details See state_checkpoint.c.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+/**
+	\ingroup openshoe_runtime_framework
+	
+	\defgroup state_checkpoint State checkpoints
+	\brief This group contains the checkpoints from which the ZUPT aided INS can be resumed after a reset.
+	@{
+*/
+
+#ifndef STATE_CHECKPOINT_H_
+#define STATE_CHECKPOINT_H_
+
+#include "compiler.h"
+#include "flash_log.h"
+
+///\name Location of the checkpoints
+///  The checkpoints are written to the slots of the flash pages above the flash log in turn.
+//@{
+#define CHECKPOINT_FIRST_PAGE (FLASH_LOG_FIRST_PAGE+FLASH_LOG_NR_PAGES)
+#define CHECKPOINT_NR_PAGES 32
+/// Size of a slot, a power of two not larger than the flash page size
+#define CHECKPOINT_SLOT_SIZE 256
+//@}
+
+/// Identifies a checkpoint ("OSCP")
+#define CHECKPOINT_MAGIC 0x4F534350
+
+/// Value of the error signal if there is no valid checkpoint to resume from.
+#define CHECKPOINT_ERROR 9
+
+///\name Checkpoint period
+///  Log2 of the divider of the interrupt frequency, such that checkpoints are taken every 2^(divider-1) interrupts.
+///  The checkpoints are off by default. At divider 14 (about every 10 s) each page of the checkpoints is worn
+///  once every 11 minutes.
+//@{
+#define CHECKPOINT_MAX_LOG2_DIVIDER 20
+//@}
+
+void state_checkpoint_init(void);
+void save_state_checkpoint(void);
+void set_state_checkpoint_divider(uint8_t divider);
+bool resume_from_state_checkpoint(void);
+
+#endif /* STATE_CHECKPOINT_H_ */
+
+//@}
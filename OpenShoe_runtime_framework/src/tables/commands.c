@@ -4,9 +4,10 @@
 	\brief Definition of user commands and command response functions.
 	
 	\details This file contains definition of user commands used to control
-	the OpenShoe system. Each command is defined in a command info struct
+	the OpenShoe system. Each command is defined by an entry in \ref COMMAND_TABLE
 	containing an ID, a pointer to a response function, and information about
-	the arguemetns of the command.
+	the arguemetns of the command. The command info structs and the table to
+	find them by header are generated from the list.
 	
 	The command response functions are the functions which will be exectued as
 	a response to the command being called. These functions are also declared
@@ -27,6 +28,10 @@
 #include "process_sequence.h"
 #include "imu_interface.h"
 #include "udi_cdc.h"
+#include "nav_eq.h"
+#include "calibration_record.h"
+#include "flash_log.h"
+#include "state_checkpoint.h"
 
 
 ///  \name Command response functions
@@ -45,55 +50,55 @@ void acc_calibration(uint8_t**);
 void set_low_pass_imu(uint8_t**);
 void add_sync_output(uint8_t**);
 void sync_output(uint8_t**);
+void output_state_encoded(uint8_t**);
+void raw_imu_logging(uint8_t**);
+void store_calibration(uint8_t**);
+void load_calibration(uint8_t**);
+void flash_logging(uint8_t**);
+void dump_flash_log(uint8_t**);
+void state_checkpointing(uint8_t**);
+void resume_zupt_aided_ins(uint8_t**);
 //@}
 
 ///  \name Command definitions
-///  Structs containing the information/definitions of the commands.
+///  The information/definitions of the commands.
 //@{
-static command_structure only_ack = {ONLY_ACK,NULL,0,0,{0}};
-static command_structure mcu_id = {MCU_ID,&get_mcu_serial,0,0,{0}};
-static command_structure output_onoff_state = {OUTPUT_STATE,&output_state,2,2,{1,1}};
-static command_structure output_all_off = {OUTPUT_ALL_OFF,&turn_off_output,0,0,{0}};
-static command_structure output_onoff_inert = {OUTPUT_ONOFF_INERT,&toggle_inertial_output,1,1,{1}};
-static command_structure output_position_plus_zupt = {OUTPUT_POSITION_PLUS_ZUPT,&position_plus_zupt,1,1,{1}};
-static command_structure output_navigational_states_cmd = {OUTPUT_NAVIGATIONAL_STATES,&output_navigational_states,1,1,{1}};
-static command_structure processing_function_onoff = {PROCESSING_FUNCTION_ONOFF,&processing_onoff,3,3,{1,1,1}};
-static command_structure reset_system_cmd = {RESET_ZUPT_AIDED_INS,&reset_zupt_aided_ins,0,0,{0}};
-static command_structure gyro_calibration_cmd = {GYRO_CALIBRATION_INIT,&gyro_self_calibration,0,0,{0}};
-static command_structure acc_calibration_cmd = {ACC_CALIBRATION_INIT,&acc_calibration,1,1,{1}};
-static command_structure set_low_pass_imu_cmd = {SET_LOWPASS_FILTER_IMU,&set_low_pass_imu,1,1,{1}};
-static command_structure add_sync_output_cmd = {ADD_SYNC_OUTPUT,&add_sync_output,2,2,{1,1}};
-static command_structure sync_output_cmd = {SYNC_OUTPUT,&sync_output,0,0,{0}};
+/// X(command ID, name of info struct, response function, payload size, number of fields, field widths...)
+#define COMMAND_TABLE(X) \
+	X(ONLY_ACK, only_ack, NULL, 0, 0, 0) \
+	X(MCU_ID, mcu_id, &get_mcu_serial, 0, 0, 0) \
+	X(OUTPUT_STATE, output_onoff_state, &output_state, 2, 2, 1, 1) \
+	X(OUTPUT_ALL_OFF, output_all_off, &turn_off_output, 0, 0, 0) \
+	X(OUTPUT_ONOFF_INERT, output_onoff_inert, &toggle_inertial_output, 1, 1, 1) \
+	X(OUTPUT_POSITION_PLUS_ZUPT, output_position_plus_zupt, &position_plus_zupt, 1, 1, 1) \
+	X(OUTPUT_NAVIGATIONAL_STATES, output_navigational_states_cmd, &output_navigational_states, 1, 1, 1) \
+	X(PROCESSING_FUNCTION_ONOFF, processing_function_onoff, &processing_onoff, 3, 3, 1, 1, 1) \
+	X(RESET_ZUPT_AIDED_INS, reset_system_cmd, &reset_zupt_aided_ins, 0, 0, 0) \
+	X(GYRO_CALIBRATION_INIT, gyro_calibration_cmd, &gyro_self_calibration, 0, 0, 0) \
+	X(ACC_CALIBRATION_INIT, acc_calibration_cmd, &acc_calibration, 1, 1, 1) \
+	X(SET_LOWPASS_FILTER_IMU, set_low_pass_imu_cmd, &set_low_pass_imu, 1, 1, 1) \
+	X(ADD_SYNC_OUTPUT, add_sync_output_cmd, &add_sync_output, 2, 2, 1, 1) \
+	X(SYNC_OUTPUT, sync_output_cmd, &sync_output, 0, 0, 0) \
+	X(OUTPUT_STATE_ENCODED, output_state_encoded_cmd, &output_state_encoded, 3, 3, 1, 1, 1) \
+	X(RAW_IMU_LOGGING, raw_imu_logging_cmd, &raw_imu_logging, 1, 1, 1) \
+	X(STORE_CALIBRATION, store_calibration_cmd, &store_calibration, 0, 0, 0) \
+	X(LOAD_CALIBRATION, load_calibration_cmd, &load_calibration, 0, 0, 0) \
+	X(FLASH_LOGGING, flash_logging_cmd, &flash_logging, 1, 1, 1) \
+	X(DUMP_FLASH_LOG, dump_flash_log_cmd, &dump_flash_log, 0, 0, 0) \
+	X(STATE_CHECKPOINTING, state_checkpointing_cmd, &state_checkpointing, 1, 1, 1) \
+	X(RESUME_ZUPT_AIDED_INS, resume_system_cmd, &resume_zupt_aided_ins, 0, 0, 0)
 //@}
 
-// Arrays/tables to find appropriate commands
-static const command_structure* commands[] = {&only_ack,
-											  &mcu_id,
-											  &output_onoff_state,
-											  &output_all_off,
-											  &output_onoff_inert,
-											  &output_position_plus_zupt,
-											  &output_navigational_states_cmd,
-											  &processing_function_onoff,
-											  &reset_system_cmd,
-											  &gyro_calibration_cmd,
-											  &acc_calibration_cmd,
-											  &set_low_pass_imu_cmd,
-											  &add_sync_output_cmd,
-											  &sync_output_cmd};
-												  
-// Arrays/tables for commands
-uint8_t command_header_table[32]={0};
-command_structure* command_info_array[256]={NULL};
-												  
-void commands_init(void){
-	// Initialize tables
-	for(int i = 0;i<(sizeof(commands)/sizeof(commands[0]));i++){
-		command_header_table[ (commands[i]->header) >> 3 ] |= 1<<( (commands[i]->header) & 7);}
-		
-	for(int i = 0;i<(sizeof(commands)/sizeof(commands[0]));i++){
-		command_info_array[commands[i]->header] = commands[i];}
-}
+///\cond
+#define COMMAND_STRUCT(id, name, response, nrb_payload, nr_fields, ...) \
+	static command_structure name = {id, response, nrb_payload, nr_fields, {__VA_ARGS__}};
+#define COMMAND_BY_HEADER(id, name, ...) [id] = &name,
+COMMAND_TABLE(COMMAND_STRUCT)
+CHECK_UNIQUE_TABLE_IDS(COMMAND_TABLE)
+///\endcond
+
+// Table to find the commands by header
+command_structure* const command_info_array[256] = {COMMAND_TABLE(COMMAND_BY_HEADER)};
 
 void get_mcu_serial(uint8_t** arg){
 //	udi_cdc_write_buf((int*)0x80800284,0x80800292-0x80800284);
@@ -102,7 +107,7 @@ void get_mcu_serial(uint8_t** arg){
 void output_state(uint8_t** cmd_arg){
 	uint8_t state_id = cmd_arg[0][0];
 	uint8_t output_divider    = cmd_arg[1][0];
-	if(state_info_access_by_id[state_id]){  // Valid state?
+	if(state_id<SID_LIMIT && state_info_access_by_id[state_id]){  // Valid state?
 		set_state_output(state_id,output_divider);}}
 
 void toggle_inertial_output(uint8_t** cmd_arg){
@@ -130,40 +135,58 @@ void processing_onoff(uint8_t** cmd_arg){
 	uint8_t function_id = cmd_arg[0][0];
 	uint8_t onoff    = cmd_arg[1][0];
 	uint8_t array_location = cmd_arg[2][0];	
-	processing_function_p process_sequence_elem_value = onoff ? (processing_functions_by_id[function_id]->func_p) : NULL;
-	set_elem_in_process_sequence(process_sequence_elem_value,array_location);
+	proc_func_info* process_sequence_elem_value = onoff ? processing_functions_by_id[function_id] : NULL;
+	set_proc_func_in_process_sequence(process_sequence_elem_value,array_location);
+}
+
+/// Replaces the process sequence with the ZUPT aided INS, which saves state checkpoints if they are turned on.
+static void start_zupt_aided_ins(void){
+	empty_process_sequence();
+	set_proc_func_in_process_sequence(processing_functions_by_id[UPDATE_BUFFER],0);
+	set_proc_func_in_process_sequence(processing_functions_by_id[MECHANIZATION],1);
+	set_proc_func_in_process_sequence(processing_functions_by_id[TIME_UPDATE],2);
+	set_proc_func_in_process_sequence(processing_functions_by_id[ZUPT_DETECTOR],3);
+	set_proc_func_in_process_sequence(processing_functions_by_id[ZUPT_UPDATE],4);
+	set_proc_func_in_process_sequence(processing_functions_by_id[SAVE_STATE_CHECKPOINT],5);
 }
 
-///\cond
-extern bool initialize_flag;
-///\endcond
 void stop_initial_alignement(void){
-	if(initialize_flag==false){
-		// Stop initial alignement
-		empty_process_sequence();
-		// Start ZUPT aided INS
-		set_elem_in_process_sequence(processing_functions_by_id[UPDATE_BUFFER]->func_p,0);
-		set_elem_in_process_sequence(processing_functions_by_id[MECHANIZATION]->func_p,1);
-		set_elem_in_process_sequence(processing_functions_by_id[TIME_UPDATE]->func_p,2);
-		set_elem_in_process_sequence(processing_functions_by_id[ZUPT_DETECTOR]->func_p,3);
-		set_elem_in_process_sequence(processing_functions_by_id[ZUPT_UPDATE]->func_p,4);
+	if(nav_filter.initialize_flag==false){
+		// Stop initial alignement and start ZUPT aided INS
+		start_zupt_aided_ins();
 	}
 }
 
 void reset_zupt_aided_ins(uint8_t** no_arg){
 	// Stop whatever was going on
 	empty_process_sequence();
-	initialize_flag=true;
+	nav_filter.initialize_flag=true;
 	// Start initial alignment
-	set_elem_in_process_sequence(processing_functions_by_id[UPDATE_BUFFER]->func_p,0);
-	set_elem_in_process_sequence(processing_functions_by_id[INITIAL_ALIGNMENT]->func_p,1);
+	set_proc_func_in_process_sequence(processing_functions_by_id[UPDATE_BUFFER],0);
+	set_proc_func_in_process_sequence(processing_functions_by_id[INITIAL_ALIGNMENT],1);
 	// Set termination function of initial alignment which will also start INS
 	set_last_process_sequence_element(&stop_initial_alignement);
 }
 
+///\cond
+extern uint8_t error_signal;
+///\endcond
+/**
+	\brief Resumes the ZUPT aided INS from the latest state checkpoint, skipping the initial alignment.
+	
+	\details Sets the error signal to \#CHECKPOINT_ERROR, and leaves the
+	process sequence as it is, if there is no valid checkpoint.
+*/
+void resume_zupt_aided_ins(uint8_t** no_arg){
+	if(resume_from_state_checkpoint()){
+		start_zupt_aided_ins();}
+	else{
+		error_signal = CHECKPOINT_ERROR;}
+}
+
 void gyro_self_calibration(uint8_t** no_arg){
 	store_and_empty_process_sequence();
-	set_elem_in_process_sequence(processing_functions_by_id[GYRO_CALIBRATION]->func_p,0);
+	set_proc_func_in_process_sequence(processing_functions_by_id[GYRO_CALIBRATION],0);
 	set_last_process_sequence_element(&restore_process_sequence);
 }
 	
@@ -194,7 +217,7 @@ void acc_calibration(uint8_t ** cmd_arg){
 	nr_of_calibration_orientations = nr_orientations;
 	
 	store_and_empty_process_sequence();
-	set_elem_in_process_sequence(processing_functions_by_id[ACCELEROMETER_CALIBRATION]->func_p,0);
+	set_proc_func_in_process_sequence(processing_functions_by_id[ACCELEROMETER_CALIBRATION],0);
 	set_last_process_sequence_element(&new_calibration_orientation);
 }
 
@@ -205,10 +228,82 @@ void set_low_pass_imu(uint8_t ** cmd_arg){
 	// Todo: set error state if above does not hold.
 }
 
+///\cond
+extern bool imu_raw_passthrough;
+///\endcond
+/**
+	\brief Starts (divider>0) or stops (divider=0) logging of raw IMU data.
+	
+	\details While logging, the IMU frames are not converted, the process
+	sequence is stored and emptied, and the raw IMU words are output with the
+	divider. When logging is stopped the process sequence is restored.
+*/
+void raw_imu_logging(uint8_t** cmd_arg){
+	uint8_t output_divider = cmd_arg[0][0];
+	if(output_divider && !imu_raw_passthrough){
+		store_and_empty_process_sequence();
+		imu_raw_passthrough = true;}
+	else if(!output_divider && imu_raw_passthrough){
+		imu_raw_passthrough = false;
+		restore_process_sequence();}
+	set_state_output(IMU_RAW_DATA_SID,output_divider);
+}
+
+/**
+	\brief Stores the current calibration results and settings in flash.
+	
+	\details Stalls the main loop for a few milliseconds while the flash is
+	written, so it should be called when the system is idle. Sets the error
+	signal to \#CALIBRATION_RECORD_ERROR if the record could not be written.
+	
+	\warning The record shares the flash user page with the configuration of
+	the bootloader. When a changed record is stored, the whole page is erased
+	and rewritten, and if the system is reset or loses power in between, the
+	bootloader configuration is lost and the bootloader may not start the
+	firmware anymore, until it is restored with a programmer. Do not store
+	the calibration on a low battery.
+*/
+void store_calibration(uint8_t** no_arg){
+	if(!store_calibration_record()){
+		error_signal = CALIBRATION_RECORD_ERROR;}
+}
+
+/**
+	\brief Reloads the calibration results and settings stored in flash.
+	
+	\details Sets the error signal to \#CALIBRATION_RECORD_ERROR if there is
+	no valid record, in which case the current values are kept.
+*/
+void load_calibration(uint8_t** no_arg){
+	if(!load_calibration_record()){
+		error_signal = CALIBRATION_RECORD_ERROR;}
+}
+
+/**
+	\brief Sets the frequency divider of the flash logging of raw IMU frames (0 turns it off).
+	
+	\details The logger runs in the main loop, independent of the process
+	sequence. It only logs while the USB is detached.
+*/
+void flash_logging(uint8_t** cmd_arg){
+	set_flash_log_divider(cmd_arg[0][0]);
+}
+
+/// Starts a dump of the flash log, which replaces the state output until it is done.
+void dump_flash_log(uint8_t** no_arg){
+	if(!flash_log_start_dump()){
+		error_signal = FLASH_LOG_ERROR;}
+}
+
+/// Sets the period of the state checkpoints of the ZUPT aided INS to 2^(divider-1) interrupts (0 turns them off).
+void state_checkpointing(uint8_t** cmd_arg){
+	set_state_checkpoint_divider(cmd_arg[0][0]);
+}
+
 void add_sync_output(uint8_t** cmd_arg){
 	uint8_t state_id = cmd_arg[0][0];
 	uint8_t output_divider    = cmd_arg[1][0];
-	if(state_info_access_by_id[state_id]){  // Valid state?
+	if(state_id<SID_LIMIT && state_info_access_by_id[state_id]){  // Valid state?
 		set_state_output(state_id,output_divider);}
 	reset_output_counters();
 }
@@ -217,4 +312,14 @@ void sync_output(uint8_t** no_arg){
 	reset_output_counters();
 }
 
+/// Sets the output of a state in an encoding and replies with the resulting output of the state, such that the user can decode it.
+void output_state_encoded(uint8_t** cmd_arg){
+	uint8_t state_id = cmd_arg[0][0];
+	uint8_t output_divider = cmd_arg[1][0];
+	uint8_t encoding = cmd_arg[2][0];
+	if(state_id<SID_LIMIT && state_info_access_by_id[state_id]){  // Valid state?
+		set_state_output_encoded(state_id,output_divider,encoding);}
+	send_state_output_description(state_id);
+}
+
 //@}
\ No newline at end of file
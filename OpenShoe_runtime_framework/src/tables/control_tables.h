@@ -8,7 +8,8 @@
 	commands. It also contains struct typedefs of structs containing such
 	information for individual states, functions, and commands, together
 	with ID macros for the same.
-	Delcarations of initialization functions for the arrays are also found.
+	The arrays are generated at compile time from X-macro lists, see
+	\ref CHECK_UNIQUE_TABLE_IDS.
 	
 	\authors John-Olof Nilsson, Isaac Skog
 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
@@ -39,11 +40,30 @@ typedef const struct {
 	uint8_t field_widths[];
 } command_structure;
 
+/// Execution time record of a processing function, updated by run_process_sequence()
+typedef struct {
+	/// Clock cycles (COUNT register) of the last call
+	uint32_t last_proc_time;
+	/// Smallest number of clock cycles of a call
+	uint32_t min_proc_time;
+	/// Largest number of clock cycles of a call
+	uint32_t peak_proc_time;
+	/// Exponentially weighted mean of the clock cycles, scaled with 2^\#PROC_TIME_MEAN_SHIFT
+	uint32_t mean_proc_time_acc;
+	/// Number of calls
+	uint32_t nr_of_calls;
+	/// Number of calls which exceeded the max_proc_time of the function
+	uint32_t nr_of_overruns;
+} proc_func_timing;
+
 /// Information struct for processing functions
 typedef const struct {
 	uint8_t id;
 	void (*func_p)(void);
-	int max_proc_time; 
+	/// Cycle budget of a call, 0 if the function has no budget
+	int max_proc_time;
+	/// Execution time record of the function
+	proc_func_timing* timing;
 } proc_func_info;
 
 /// State data type information struct
@@ -51,6 +71,8 @@ typedef const struct {
 	uint8_t id;
 	void* state_p;
 	int state_size;
+	/// Scale factor of the fixed-point output encodings of a state made of floats, 0 if the state is not made of floats
+	precision scale;
 } state_t_info;
 
 
@@ -63,8 +85,27 @@ typedef const struct {
 #define TIME_UPDATE 0x07
 #define ZUPT_DETECTOR 0x08
 #define ZUPT_UPDATE 0x09
+#define MV_DETECTOR 0x0A
+#define MAG_DETECTOR 0x0B
+#define ARE_DETECTOR 0x0C
+#define TIME_UPDATE_UD 0x0D
+#define ZUPT_UPDATE_UD 0x0E
 #define GYRO_CALIBRATION 0x10
 #define ACCELEROMETER_CALIBRATION 0x11
+#define SAVE_STATE_CHECKPOINT 0x13
+//@}
+
+///  \name Processing time budgets
+///  Macros for the cycle budgets (max_proc_time) of the processing functions
+//@{
+/// Clock cycles between two IMU interrupts (48 MHz CPU clock and 819.2 Hz IMU sample rate)
+#define IMU_FRAME_CYCLES 58593
+/// Budget of a processing function as a share (in percent) of the time between two IMU interrupts
+#define FRAME_SHARE(percent) ((IMU_FRAME_CYCLES/100)*(percent))
+/// Clock cycles the CPU stalls for a flash page erase or write (about 5 ms)
+#define FLASH_PAGE_OPERATION_CYCLES 240000
+/// The mean execution time is weighted over about 2^PROC_TIME_MEAN_SHIFT calls
+#define PROC_TIME_MEAN_SHIFT 4
 //@}
 
 ///  \name External state IDs
@@ -78,6 +119,7 @@ typedef const struct {
 #define ANGULAR_RATE_SID 0x02
 #define IMU_TEMPERATURS_SID 0x03
 #define IMU_SUPPLY_VOLTAGE_SID 0x04
+#define IMU_RAW_DATA_SID 0x05
 // Filtering states
 #define POSITION_SID 0x11
 #define VELOCITY_SID 0x12
@@ -85,6 +127,10 @@ typedef const struct {
 #define ZUPT_SID 0x14
 // System states
 #define INTERRUPT_COUNTER_SID 0x21
+#define SYSTEM_PROFILE_SID 0x22
+#define IMU_SAMPLE_COUNTERS_SID 0x23
+#define TX_SKIPPED_FRAMES_SID 0x24
+#define FLASH_LOG_SKIPPED_FRAMES_SID 0x25
 // "Other" states
 #define ACCELEROMETER_BIASES_SID 0x35
 //@}
@@ -104,30 +150,52 @@ typedef const struct {
 #define GYRO_CALIBRATION_INIT 0x11
 #define ACC_CALIBRATION_INIT 0x12
 #define SET_LOWPASS_FILTER_IMU 0x13
+#define RAW_IMU_LOGGING 0x14
+#define STORE_CALIBRATION 0x15
+#define LOAD_CALIBRATION 0x16
+#define FLASH_LOGGING 0x17
+#define DUMP_FLASH_LOG 0x18
+#define STATE_CHECKPOINTING 0x19
+#define RESUME_ZUPT_AIDED_INS 0x1A
 #define ADD_SYNC_OUTPUT 0x25
 #define SYNC_OUTPUT 0x26
+#define OUTPUT_STATE_ENCODED 0x27
+//@}
+
+///  \name Table generation
+///  The tables below are const (flash resident) arrays indexed by ID. Each is generated with designated
+///  initializers from an X-macro list of its entries, e.g. COMMAND_TABLE in commands.c, such that no
+///  initialization code and no RAM is needed. An ID outside of a table does not compile (array index in
+///  initializer exceeds array bounds) and neither does an ID used twice in a list (duplicate case value).
+//@{
+///\cond
+#define TABLE_ID_CASE(id, ...) case (id):
+///\endcond
+/// Defines a function which does not compile if two entries of the X-macro list table have the same ID
+#define CHECK_UNIQUE_TABLE_IDS(table) \
+	static inline void check_unique_ids_##table(void){ switch(0){ table(TABLE_ID_CASE) break;} }
 //@}
 
 // Global variables used to access command information
-extern uint8_t command_header_table[32];
-extern command_structure* command_info_array[256];
-void commands_init(void);
+extern command_structure* const command_info_array[256];
 
 inline bool is_valid_header(uint8_t header){
-	return command_header_table[header>>3] & (1<<(header & 7));}
+	return command_info_array[header]!=NULL;}
 	
 inline command_structure* get_command_info(uint8_t header){
 	return command_info_array[header];}
 
 
 // Array containing the processing functions to run
-extern proc_func_info* processing_functions_by_id[256];
-void processing_functions_init(void);
+extern proc_func_info* const processing_functions_by_id[256];
+void reset_processing_functions_timing(void);
+
+inline uint32_t get_mean_proc_time(proc_func_timing* timing){
+	return timing->mean_proc_time_acc>>PROC_TIME_MEAN_SHIFT;}
 
 
 // Global variables used to access information about states
-extern state_t_info* state_info_access_by_id[SID_LIMIT];
-void system_states_init(void);
+extern state_t_info* const state_info_access_by_id[SID_LIMIT];
 
 
 #endif /* CONTROL_TABLES_H_ */
@@ -11,10 +11,9 @@
 	Any function which should be inserted in to the process sequence should be
 	added to this file.
 	
-	The file also contain an initialization function to fill up some arrays of
-	states structs. This initialization function must be called before the
-	arrays are used. This should eventually be replaced by some code generating
-	script which explicitly declear the arrays.
+	The functions are listed in \ref PROCESSING_FUNCTION_TABLE from which their
+	execution time records, information structs and the table to find them by
+	ID are generated at compile time.
 	
 	\authors John-Olof Nilsson, Isaac Skog
 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
@@ -33,36 +32,63 @@ extern void initialize_navigation_algorithm(void);
 extern void strapdown_mechanisation_equations(void);
 extern void time_up_data(void);
 extern void ZUPT_detector(void);
+extern void MV_detector(void);
+extern void MAG_detector(void);
+extern void ARE_detector(void);
+extern void time_up_data_UD(void);
+extern void zupt_update_UD(void);
 extern void zupt_update(void);
 extern void precision_gyro_bias_null_calibration(void);
 extern void calibrate_accelerometers(void);
+extern void save_state_checkpoint(void);
 
 ///  \name Processing functions information
-///  Structs containing information and pointers to functions intended for the process sequence
+///  Information and pointers to functions intended for the process sequence
 //@{
-static proc_func_info update_imu_data_buffers_info = {UPDATE_BUFFER,&update_imu_data_buffers,0};
-static proc_func_info initialize_navigation_algorithm_info = {INITIAL_ALIGNMENT,&initialize_navigation_algorithm,0};
-static proc_func_info strapdown_mechanisation_equations_info = {MECHANIZATION,&strapdown_mechanisation_equations,0};
-static proc_func_info time_up_data_info = {TIME_UPDATE,&time_up_data,0};
-static proc_func_info ZUPT_detector_info = {ZUPT_DETECTOR,&ZUPT_detector,0};
-static proc_func_info zupt_update_info = {ZUPT_UPDATE,&zupt_update,0};
-static proc_func_info precision_gyro_bias_null_calibration_info = {GYRO_CALIBRATION,&precision_gyro_bias_null_calibration,0};
-static proc_func_info calibrate_accelerometers_info = {ACCELEROMETER_CALIBRATION,&calibrate_accelerometers,0};
+/// X(function ID, function, cycle budget of a call)
+#define PROCESSING_FUNCTION_TABLE(X) \
+	X(UPDATE_BUFFER, update_imu_data_buffers, FRAME_SHARE(5)) \
+	X(INITIAL_ALIGNMENT, initialize_navigation_algorithm, FRAME_SHARE(10)) \
+	X(MECHANIZATION, strapdown_mechanisation_equations, FRAME_SHARE(10)) \
+	X(TIME_UPDATE, time_up_data, FRAME_SHARE(25)) \
+	X(ZUPT_DETECTOR, ZUPT_detector, FRAME_SHARE(10)) \
+	X(ZUPT_UPDATE, zupt_update, FRAME_SHARE(30)) \
+	X(MV_DETECTOR, MV_detector, FRAME_SHARE(10)) \
+	X(MAG_DETECTOR, MAG_detector, FRAME_SHARE(10)) \
+	X(ARE_DETECTOR, ARE_detector, FRAME_SHARE(10)) \
+	X(TIME_UPDATE_UD, time_up_data_UD, FRAME_SHARE(50)) \
+	X(ZUPT_UPDATE_UD, zupt_update_UD, FRAME_SHARE(30)) \
+	X(GYRO_CALIBRATION, precision_gyro_bias_null_calibration, 0) \
+	X(ACCELEROMETER_CALIBRATION, calibrate_accelerometers, 0) \
+	X(SAVE_STATE_CHECKPOINT, save_state_checkpoint, FLASH_PAGE_OPERATION_CYCLES+FRAME_SHARE(25))
 //@}
 
-static const proc_func_info* processing_functions[] = {&update_imu_data_buffers_info,
-													   &initialize_navigation_algorithm_info,
-													   &strapdown_mechanisation_equations_info,
-													   &time_up_data_info,
-													   &ZUPT_detector_info,
-													   &zupt_update_info,
-													   &precision_gyro_bias_null_calibration_info,
-													   &calibrate_accelerometers_info};
+///\cond
+// Execution time records of the processing functions, see run_process_sequence()
+#define PROC_FUNC_TIMING(id, func, max_proc_time) static proc_func_timing func##_timing;
+#define PROC_FUNC_INFO(id, func, max_proc_time) \
+	static proc_func_info func##_info = {id, &func, max_proc_time, &func##_timing};
+#define PROC_FUNC_BY_ID(id, func, ...) [id] = &func##_info,
+#define PROC_FUNC_RESET_TIMING(id, func, ...) reset_timing(&func##_timing);
+PROCESSING_FUNCTION_TABLE(PROC_FUNC_TIMING)
+PROCESSING_FUNCTION_TABLE(PROC_FUNC_INFO)
+CHECK_UNIQUE_TABLE_IDS(PROCESSING_FUNCTION_TABLE)
+///\endcond
 
 // Array containing the processing functions to run
-proc_func_info* processing_functions_by_id[256];
+proc_func_info* const processing_functions_by_id[256] = {PROCESSING_FUNCTION_TABLE(PROC_FUNC_BY_ID)};
 
-void processing_functions_init(void){
-	for(int i = 0;i<(sizeof(processing_functions)/sizeof(processing_functions[0])); i++){
-		processing_functions_by_id[processing_functions[i]->id] = processing_functions[i];}
-}
\ No newline at end of file
+///\cond
+static inline void reset_timing(proc_func_timing* timing){
+	timing->last_proc_time = 0;
+	timing->min_proc_time = UINT32_MAX;
+	timing->peak_proc_time = 0;
+	timing->mean_proc_time_acc = 0;
+	timing->nr_of_calls = 0;
+	timing->nr_of_overruns = 0;}
+///\endcond
+
+/// Clears the execution time records of all processing functions.
+void reset_processing_functions_timing(void){
+	PROCESSING_FUNCTION_TABLE(PROC_FUNC_RESET_TIMING)
+}
@@ -7,10 +7,8 @@
 	might be requested from the system. Consequently, if any states are to be
 	output from the system, they should be added here.
 	
-	The file also contain an initialization function to fill up some arrays of
-	states structs. This initialization function must be called before the
-	arrays are used. This should eventually be replaced by some code generating
-	script which explicitly declear the arrays.
+	The states are listed in \ref STATE_TABLE from which the state structs and
+	the table to find them by ID are generated at compile time.
 	
 	\authors John-Olof Nilsson, Isaac Skog
 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
@@ -22,6 +20,9 @@
 */
 
 #include "control_tables.h"
+#include "process_sequence.h"
+#include "nav_eq.h"
+#include "imu_interface.h"
 
 ///\cond
 // IMU measurements
@@ -29,55 +30,56 @@ extern vec3 accelerations_in;
 extern vec3 angular_rates_in;
 extern vec3 imu_temperaturs;
 extern precision imu_supply_voltage;
+extern uint16_t imu_raw_data[IMU_RAW_DATA_WORDS];
 	
-// Filtering states
-extern vec3 position;
-extern vec3 velocity;
-extern quat_vec quaternions;
-extern bool zupt;
+// Filtering states are held in the global filter context nav_filter (nav_eq.h)
 
 // System states
 extern uint32_t interrupt_counter;
+extern loop_profile system_profile;
+extern sample_queue_counters imu_sample_counters;
+extern uint32_t tx_skipped_frames;
+extern uint32_t flash_log_skipped_frames;
 
 // "Other" states
 extern vec3 accelerometer_biases;
 ///\endcond
 
 ///  \name External state information
-///  Structs containing information and pointers to the externally accessible system states.
+///  Information and pointers to the externally accessible system states.
+///  The scale factors of the fixed-point encodings are chosen such that the int16 encoding covers the normal range
+///  of the states and are sent to the user in the reply of OUTPUT_STATE_ENCODED. The position is in centimeters,
+///  such that int16 covers a walk of +-327 m from the start and int32 any walk.
 //@{
-static state_t_info specific_force_sti = {SPECIFIC_FORCE_SID, (void*) accelerations_in, sizeof(vec3)};
-static state_t_info angular_rate_sti = {ANGULAR_RATE_SID, (void*) angular_rates_in, sizeof(vec3)};
-static state_t_info imu_temperaturs_sti = {IMU_TEMPERATURS_SID, (void*) imu_temperaturs, sizeof(vec3)};
-static state_t_info imu_supply_voltage_sti = {IMU_SUPPLY_VOLTAGE_SID, (void*) &imu_supply_voltage, sizeof(precision)};
-static state_t_info position_sti = {POSITION_SID, (void*) position, sizeof(vec3)};
-static state_t_info velocity_sti = {VELOCITY_SID, (void*) velocity, sizeof(vec3)};
-static state_t_info quaternions_sti = {QUATERNION_SID, (void*) quaternions, sizeof(quat_vec)};
-static state_t_info zupt_sti = {ZUPT_SID, (void*) &zupt, sizeof(bool)};
-static state_t_info interrupt_counter_sti = {INTERRUPT_COUNTER_SID, (void*) &interrupt_counter, sizeof(uint32_t)};
-	
-static state_t_info accelerometer_biases_sti = {ACCELEROMETER_BIASES_SID, (void*) &accelerometer_biases, sizeof(vec3)};
+/// X(state ID, name, pointer to the state, size of the state, fixed-point scale factor)
+#define STATE_TABLE(X) \
+	X(SPECIFIC_FORCE_SID, specific_force, accelerations_in, sizeof(vec3), 128) \
+	X(ANGULAR_RATE_SID, angular_rate, angular_rates_in, sizeof(vec3), 1024) \
+	X(IMU_TEMPERATURS_SID, imu_temperaturs, imu_temperaturs, sizeof(vec3), 100) \
+	X(IMU_SUPPLY_VOLTAGE_SID, imu_supply_voltage, &imu_supply_voltage, sizeof(precision), 1000) \
+	X(IMU_RAW_DATA_SID, imu_raw_data, imu_raw_data, sizeof(imu_raw_data), 0) \
+	X(POSITION_SID, position, nav_filter.position, sizeof(vec3), 100) \
+	X(VELOCITY_SID, velocity, nav_filter.velocity, sizeof(vec3), 1000) \
+	X(QUATERNION_SID, quaternions, nav_filter.quaternions, sizeof(quat_vec), 16384) \
+	X(ZUPT_SID, zupt, &nav_filter.zupt, sizeof(bool), 0) \
+	X(INTERRUPT_COUNTER_SID, interrupt_counter, &interrupt_counter, sizeof(uint32_t), 0) \
+	X(SYSTEM_PROFILE_SID, system_profile, &system_profile, sizeof(loop_profile), 0) \
+	X(IMU_SAMPLE_COUNTERS_SID, imu_sample_counters, &imu_sample_counters, sizeof(sample_queue_counters), 0) \
+	X(TX_SKIPPED_FRAMES_SID, tx_skipped_frames, &tx_skipped_frames, sizeof(uint32_t), 0) \
+	X(FLASH_LOG_SKIPPED_FRAMES_SID, flash_log_skipped_frames, &flash_log_skipped_frames, sizeof(uint32_t), 0) \
+	X(ACCELEROMETER_BIASES_SID, accelerometer_biases, &accelerometer_biases, sizeof(vec3), 1000)
 //@}
 	
-// Array of state data type struct pointers
-const static state_t_info* state_struct_array[] = {&interrupt_counter_sti,
-												   &specific_force_sti,
-												   &angular_rate_sti,
-												   &imu_temperaturs_sti,
-												   &imu_supply_voltage_sti,
-												   &position_sti,
-								 	               &velocity_sti,
-												   &quaternions_sti,
-												   &zupt_sti,
-												   &accelerometer_biases_sti};
-
-
-state_t_info* state_info_access_by_id[SID_LIMIT];
+///\cond
+#define STATE_STRUCT(id, name, state_p, state_size, scale) \
+	static state_t_info name##_sti = {id, (void*) state_p, state_size, scale};
+#define STATE_BY_ID(id, name, ...) [id] = &name##_sti,
+STATE_TABLE(STATE_STRUCT)
+CHECK_UNIQUE_TABLE_IDS(STATE_TABLE)
+///\endcond
 
-void system_states_init(void){
-	for(int i = 0;i<(sizeof(state_struct_array)/sizeof(state_struct_array[0])); i++){
-		state_info_access_by_id[state_struct_array[i]->id] = state_struct_array[i];}
-}	
+// Table to find the states by ID
+state_t_info* const state_info_access_by_id[SID_LIMIT] = {STATE_TABLE(STATE_BY_ID)};
 
 
-//@}
\ No newline at end of file
+//@}
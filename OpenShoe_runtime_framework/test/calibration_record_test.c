@@ -0,0 +1,75 @@
+/** \file
+	\brief Host test of the calibration record in the flash user page, see calibration_record.c.
+	
+	\details Stores records in the simulated user page and checks that they
+	are loaded again, that the page is only erased when a stored record sets
+	bits which are cleared in the current one, and that the bootloader
+	configuration at the end of the page is kept.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include "calibration_record.c"
+#include "test.h"
+
+///\cond
+// Variables of the void(void) functions of nav_eq.c and of the calibration record
+vec3 accelerations_in;
+vec3 angular_rates_in;
+uint8_t error_signal;
+uint8_t imu_log2_nr_filter_taps = IMU_FILTER_TAPS_NOT_SET;
+static uint8_t low_pass_filter_taps = IMU_FILTER_TAPS_NOT_SET;
+void low_pass_filter_setting(uint8_t nr_filter_taps){
+	low_pass_filter_taps = nr_filter_taps;}
+///\endcond
+
+/// Bootloader configuration words, as at the end of the user page of a programmed board
+static const uint8_t bootloader_config[BOOTLOADER_CONFIG_BYTES] = {0x92,0x9E,0x0D,0x6B,0xE1,0x1E,0xFF,0x7F};
+
+static bool has_bootloader_config(void){
+	return memcmp(sim_user_page+AVR32_FLASHC_USER_PAGE_SIZE-BOOTLOADER_CONFIG_BYTES,bootloader_config,BOOTLOADER_CONFIG_BYTES)==0;}
+
+int main(void){
+	sim_flash_erase_all();
+	memcpy(sim_user_page+AVR32_FLASHC_USER_PAGE_SIZE-BOOTLOADER_CONFIG_BYTES,bootloader_config,BOOTLOADER_CONFIG_BYTES);
+	
+	// Nothing is loaded from an erased page
+	TEST_CHECK(!load_calibration_record());
+	
+	// The first record is written to the erased page without an erase
+	accelerometer_biases[0] = 0.1f;
+	accelerometer_biases[1] = -0.2f;
+	accelerometer_biases[2] = 0.05f;
+	imu_log2_nr_filter_taps = 3;
+	TEST_CHECK(store_calibration_record());
+	TEST_CHECK(sim_user_page_erases==0);
+	TEST_CHECK(has_bootloader_config());
+	
+	// The same record again is written without an erase
+	TEST_CHECK(store_calibration_record());
+	TEST_CHECK(sim_user_page_erases==0);
+	
+	// The record is loaded
+	memset(accelerometer_biases,0,sizeof(vec3));
+	TEST_CHECK(load_calibration_record());
+	TEST_CHECK(accelerometer_biases[0]==0.1f && accelerometer_biases[1]==-0.2f && accelerometer_biases[2]==0.05f);
+	TEST_CHECK(low_pass_filter_taps==3);
+	
+	// A changed record needs an erase, which keeps the bootloader configuration
+	accelerometer_biases[1] = 0.3f;
+	TEST_CHECK(store_calibration_record());
+	TEST_CHECK(sim_user_page_erases==1);
+	TEST_CHECK(has_bootloader_config());
+	memset(accelerometer_biases,0,sizeof(vec3));
+	TEST_CHECK(load_calibration_record());
+	TEST_CHECK(accelerometer_biases[1]==0.3f);
+	
+	// A corrupt record is not loaded
+	sim_user_page[offsetof(calibration_record,accelerometer_biases)] &= 0x7F;
+	accelerometer_biases[1] = 0;
+	TEST_CHECK(!load_calibration_record());
+	TEST_CHECK(accelerometer_biases[1]==0);
+	
+	return test_result("calibration_record_test");
+}
@@ -0,0 +1,323 @@
+/** \file
+	\brief Host test of the ring logger of raw IMU frames, see flash_log.c.
+	
+	\details Logs a long run of random-walk IMU frames to the simulated flash,
+	such that the ring wraps several times, with a reset of the system near
+	the end. The log is then dumped and decoded, and the frames are compared
+	with those that were logged.
+	
+	The time is simulated with the cycle counter: the IMU has a new sample
+	every \#IMU_FRAME_CYCLES, a main loop iteration takes \#LOOP_CYCLES and
+	each page erase and write of the simulated flash stalls the CPU. The
+	interrupts are served by a model of the interrupt routine and its queue
+	(interrupt_queue.c), and the interrupt counter is increased from their
+	time-stamps as by wait_for_interrupt(). As in the firmware, where the
+	interrupt routine runs from RAM, the interrupts of a stall are first
+	served while the CPU is stalled, and the main loop must catch up without
+	losing frames. The run is then repeated with the interrupts blocked
+	during the stalls, as if the interrupt routine was in the flash, where
+	only the edge latched by the EIC is served after a stall, and the samples
+	lost must show as gaps of the interrupt counter in the log.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include <stdlib.h>
+
+#include "flash_log.c"
+#include "interrupt_queue.h"
+#include "control_tables.h"
+#include "test.h"
+
+/// Number of interrupts of the run
+#define NR_FRAMES 200000
+/// Interrupt at which the system is reset
+#define RESET_FRAME (NR_FRAMES-5000)
+/// Number of interrupts of the run with blocked interrupts
+#define BLOCKED_NR_FRAMES 10000
+/// Clock cycles of a main loop iteration
+#define LOOP_CYCLES (IMU_FRAME_CYCLES/2)
+
+uint32_t interrupt_counter;
+uint16_t imu_raw_data[IMU_RAW_DATA_WORDS];
+
+static bool usb_attached = false;
+bool is_usb_attached(void){
+	return usb_attached;}
+
+/// Logged frames by interrupt counter
+static uint16_t logged_words[NR_FRAMES+1][IMU_RAW_DATA_WORDS];
+
+///\name Simulated IMU and interrupt queue
+//@{
+/// Interrupt served by the interrupt routine and not yet handled by the main loop
+typedef struct{
+	uint32_t ts;
+	uint16_t words[IMU_RAW_DATA_WORDS];
+} served_interrupt;
+static served_interrupt queue[IMU_INTERRUPT_QUEUE_SIZE];
+static uint32_t queue_head = 0;
+static uint32_t queue_tail = 0;
+static uint32_t max_queued = 0;
+static uint32_t dropped_samples = 0;
+/// False if the interrupts are blocked during a stall
+static bool nmi_live = true;
+/// Next IMU sample whose interrupt has not come yet
+static uint32_t next_sample = 1;
+/// IMU sample of \#imu_words
+static uint32_t imu_sample = 0;
+static uint16_t imu_words[IMU_RAW_DATA_WORDS];
+/// Samples whose interrupts were never served
+static uint32_t lost_samples = 0;
+/// Time-stamp of the previous handled interrupt
+static uint32_t previous_ts = 0;
+/// Samples added to the interrupt counter from the time-stamps
+static uint32_t counter_gaps = 0;
+//@}
+
+/// Cycle counter at a sample of the IMU, wrapping around as the COUNT register.
+static inline uint32_t sample_time(uint32_t sample){
+	return sample*IMU_FRAME_CYCLES;}
+
+/// Random walk of the IMU up to a sample.
+static void advance_imu(uint32_t sample){
+	while(imu_sample<sample){
+		imu_sample++;
+		for(int i=0;i<IMU_RAW_DATA_WORDS;i++){
+			imu_words[i] += rand()%9-4;}
+		if(imu_sample%97==0){
+			imu_words[0] ^= 0xC000;}}
+}
+
+/// Serves an interrupt, whose burst read gets the newest sample of the IMU.
+static void serve_interrupt(uint32_t ts, uint32_t sample){
+	advance_imu(sample);
+	if(queue_head-queue_tail==IMU_INTERRUPT_QUEUE_SIZE){
+		dropped_samples++;
+		return;}
+	served_interrupt* entry = &queue[queue_head%IMU_INTERRUPT_QUEUE_SIZE];
+	entry->ts = ts;
+	memcpy(entry->words,imu_words,sizeof(imu_words));
+	queue_head++;
+	if(queue_head-queue_tail>max_queued){
+		max_queued = queue_head-queue_tail;}
+}
+
+/// Serves the interrupts which have come up to the current time.
+static void serve_interrupts(void){
+	while((int32_t)(sim_count-sample_time(next_sample))>=0){
+		serve_interrupt(sample_time(next_sample),next_sample);
+		next_sample++;}
+}
+
+/// Serves the interrupts of a stall of the flash.
+static void flash_stall(uint32_t start){
+	if(nmi_live){
+		serve_interrupts();}
+	else if((int32_t)(sim_count-sample_time(next_sample))>=0){
+		// Only the latched edge is served, at the end of the stall
+		uint32_t newest = next_sample+(sim_count-sample_time(next_sample))/IMU_FRAME_CYCLES;
+		lost_samples += newest-next_sample;
+		serve_interrupt(sim_count,newest);
+		next_sample = newest+1;}
+}
+
+/// Waits for the next interrupt and reads its frame, as the first steps of the main loop.
+static void handle_interrupt(void){
+	if(queue_head==queue_tail){
+		sim_count = sample_time(next_sample);
+		serve_interrupts();}
+	served_interrupt* entry = &queue[queue_tail%IMU_INTERRUPT_QUEUE_SIZE];
+	uint32_t frames = (entry->ts-previous_ts+IMU_FRAME_CYCLES/2)/IMU_FRAME_CYCLES;
+	if(frames>1){
+		counter_gaps += frames-1;}
+	interrupt_counter += frames>1 ? frames : 1;
+	previous_ts = entry->ts;
+	memcpy(imu_raw_data,entry->words,sizeof(imu_raw_data));
+	memcpy(logged_words[interrupt_counter],imu_raw_data,sizeof(imu_raw_data));
+	queue_tail++;
+}
+
+/// Ends a main loop iteration.
+static void end_main_loop_iteration(void){
+	sim_count += LOOP_CYCLES;
+	serve_interrupts();
+}
+
+/// Sets the state of the logger to that after a reset and initializes it.
+static void reset_system(void){
+	fill_page = page_buffers[0];
+	full_page = NULL;
+	fill_nr_frames = 0;
+	page_operation = NO_PAGE_OPERATION;
+	write_page = 0;
+	next_sequence_number = 0;
+	rate_divider = 0;
+	rate_counter = 0;
+	dump_active = false;
+	flash_log_init();
+}
+
+static uint32_t get_varint(const uint8_t** p){
+	uint32_t value = 0;
+	int shift = 0;
+	uint8_t byte;
+	do{
+		byte = *(*p)++;
+		value |= (uint32_t)(byte&0x7F)<<shift;
+		shift += 7;
+	}while(byte&0x80);
+	return value;
+}
+
+/// Samples skipped by the interrupt counter of the decoded frames
+static uint32_t decoded_gaps;
+
+/// Decodes a page of the dump and checks its frames. Returns the interrupt counter of the last frame.
+static uint32_t check_page(const uint8_t* page, uint32_t previous_frame){
+	uint32_t counter = get_uint32(page+4);
+	int nr_frames = (page[8]<<8) | page[9];
+	uint16_t checksum = (page[10]<<8) | page[11];
+	uint16_t words[IMU_RAW_DATA_WORDS] = {0};
+	const uint8_t* p = page+FLASH_LOG_PAGE_HEADER_BYTES;
+	
+	TEST_CHECK(nr_frames>0);
+	for(int f=0;f<nr_frames;f++){
+		counter += get_varint(&p);
+		for(int i=0;i<IMU_RAW_DATA_WORDS;i++){
+			uint16_t zigzag = get_varint(&p);
+			words[i] += (uint16_t)((zigzag>>1) ^ -(zigzag&1));}
+		TEST_CHECK(counter>previous_frame && counter<=NR_FRAMES);
+		TEST_CHECK(memcmp(words,logged_words[counter],sizeof(words))==0);
+		decoded_gaps += counter-previous_frame-1;
+		previous_frame = counter;
+	}
+	TEST_CHECK(p-page<=FLASH_PAGE_SIZE);
+	uint16_t sum = 0;
+	for(const uint8_t* q=page+FLASH_LOG_PAGE_HEADER_BYTES;q<p;q++){
+		sum += *q;}
+	TEST_CHECK(sum==checksum);
+	return previous_frame;
+}
+
+int main(void){
+	static uint8_t dump[FLASH_LOG_DUMP_HEADER_BYTES+FLASH_LOG_NR_PAGES*FLASH_PAGE_SIZE];
+	int dump_nrb = 0;
+	const uint8_t* data;
+	int nrb;
+	
+	// An empty log gives an empty dump
+	sim_flash_erase_all();
+	reset_system();
+	TEST_CHECK(flash_log_start_dump());
+	while((nrb = flash_log_dump_data(&data))>0){
+		flash_log_dump_advance(nrb);}
+	TEST_CHECK(!flash_log_dump_active());
+	
+	// Log with a reset near the end, the interrupts being served during the stalls
+	sim_flash_stall_hook = flash_stall;
+	set_flash_log_divider(1);
+	srand(1);
+	while(interrupt_counter<NR_FRAMES){
+		handle_interrupt();
+		if(interrupt_counter==RESET_FRAME){
+			// The page being written when the system is reset is lost, the pages written before are found again
+			uint32_t expected_sequence_number = next_sequence_number-(page_operation!=NO_PAGE_OPERATION);
+			reset_system();
+			TEST_CHECK(next_sequence_number==expected_sequence_number);
+			set_flash_log_divider(1);}
+		flash_log_frame();
+		end_main_loop_iteration();
+	}
+	TEST_CHECK(next_sequence_number>2*FLASH_LOG_NR_PAGES);
+	TEST_CHECK(sim_flash_stalls>4*FLASH_LOG_NR_PAGES);
+	// The main loop catches up after the stalls, every sample is handled and logged
+	TEST_CHECK(max_queued>SIM_FLASH_STALL_CYCLES/IMU_FRAME_CYCLES && max_queued<IMU_INTERRUPT_QUEUE_SIZE);
+	TEST_CHECK(dropped_samples==0 && counter_gaps==0);
+	TEST_CHECK(interrupt_counter==NR_FRAMES && next_sample==NR_FRAMES+(queue_head-queue_tail)+1);
+	TEST_CHECK(flash_log_skipped_frames==0);
+	
+	// A dump is refused until the USB is attached and the last page has been written
+	TEST_CHECK(!flash_log_start_dump());
+	usb_attached = true;
+	for(int i=0;i<3;i++){
+		flash_log_frame();}
+	TEST_CHECK(sim_flash_write_errors==0);
+	for(int page=0;page<SIM_FLASH_NR_PAGES;page++){
+		if(page<FLASH_LOG_FIRST_PAGE || page>=FLASH_LOG_FIRST_PAGE+FLASH_LOG_NR_PAGES){
+			TEST_CHECK(sim_flash_erases[page]==0);}}
+	
+	// Read the dump in chunks which do not divide the page size
+	TEST_CHECK(flash_log_start_dump());
+	TEST_CHECK(!flash_log_start_dump());
+	while((nrb = flash_log_dump_data(&data))>0){
+		if(nrb>100){
+			nrb = 100;}
+		TEST_CHECK(dump_nrb+nrb<=(int)sizeof(dump));
+		memcpy(dump+dump_nrb,data,nrb);
+		dump_nrb += nrb;
+		flash_log_dump_advance(nrb);}
+	TEST_CHECK(dump_nrb==(int)sizeof(dump));
+	TEST_CHECK(dump[0]=='L' && dump[1]=='G');
+	TEST_CHECK(((dump[2]<<8) | dump[3])==FLASH_LOG_NR_PAGES);
+	
+	// The pages are consecutive, oldest first, and hold the logged frames up to the last one
+	uint32_t last_frame = 0;
+	uint32_t pages_after_reset = 0;
+	for(int page=0;page<FLASH_LOG_NR_PAGES;page++){
+		const uint8_t* p = dump+FLASH_LOG_DUMP_HEADER_BYTES+page*FLASH_PAGE_SIZE;
+		if(page>0){
+			TEST_CHECK(get_uint32(p)==get_uint32(p-FLASH_PAGE_SIZE)+1);}
+		last_frame = check_page(p,page>0 ? last_frame : 0);
+		if(last_frame>=RESET_FRAME){
+			pages_after_reset++;}
+	}
+	TEST_CHECK(last_frame==NR_FRAMES);
+	TEST_CHECK(pages_after_reset>0 && pages_after_reset<FLASH_LOG_NR_PAGES);
+	
+	// After the next reset the logging continues after the newest page
+	uint32_t newest = get_uint32(dump+FLASH_LOG_DUMP_HEADER_BYTES+(FLASH_LOG_NR_PAGES-1)*FLASH_PAGE_SIZE);
+	uint16_t next_page = write_page;
+	reset_system();
+	TEST_CHECK(next_sequence_number==newest+1);
+	TEST_CHECK(write_page==next_page);
+	
+	// With the interrupts blocked during the stalls the lost samples show as gaps in the log
+	sim_flash_erase_all();
+	reset_system();
+	usb_attached = false;
+	nmi_live = false;
+	set_flash_log_divider(1);
+	queue_tail = queue_head;
+	previous_ts = sample_time(next_sample-1);
+	interrupt_counter = 0;
+	counter_gaps = 0;
+	while(interrupt_counter<BLOCKED_NR_FRAMES){
+		handle_interrupt();
+		flash_log_frame();
+		end_main_loop_iteration();
+	}
+	TEST_CHECK(lost_samples>(uint32_t)sim_flash_stalls);
+	TEST_CHECK(counter_gaps+sim_flash_stalls>=lost_samples && counter_gaps<=lost_samples+sim_flash_stalls);
+	TEST_CHECK(dropped_samples==0 && flash_log_skipped_frames==0);
+	usb_attached = true;
+	for(int i=0;i<3;i++){
+		flash_log_frame();}
+	TEST_CHECK(flash_log_start_dump());
+	dump_nrb = 0;
+	while((nrb = flash_log_dump_data(&data))>0){
+		memcpy(dump+dump_nrb,data,nrb);
+		dump_nrb += nrb;
+		flash_log_dump_advance(nrb);}
+	int nr_pages = (dump[2]<<8) | dump[3];
+	TEST_CHECK(nr_pages==write_page && dump_nrb==FLASH_LOG_DUMP_HEADER_BYTES+nr_pages*FLASH_PAGE_SIZE);
+	last_frame = 0;
+	decoded_gaps = 0;
+	for(int page=0;page<nr_pages;page++){
+		last_frame = check_page(dump+FLASH_LOG_DUMP_HEADER_BYTES+page*FLASH_PAGE_SIZE,last_frame);}
+	TEST_CHECK(last_frame==interrupt_counter);
+	TEST_CHECK(decoded_gaps==counter_gaps);
+	
+	return test_result("flash_log_test");
+}
@@ -0,0 +1,113 @@
+/** \file
+	\brief Host test of the PDCA burst read of the IMU interface, see imu_interface.c.
+	
+	\details Runs the burst reads on the simulated SPI, PDCA and IMU of
+	stubs/spi.c. Checks that a frame only lands after the transfer, that no
+	burst read is started while one is running or while the SPI is reserved
+	for a single command, and the positions of the data words in the frame.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include <math.h>
+
+#include "imu_interface.c"
+#include "test.h"
+
+/// Data words of the simulated IMU, each with status bits set above the data bits
+static const uint16_t imu_words[SIM_IMU_BURST_WORDS] = {
+	0x8000 | 0x0C80,				// supply, 12 bits
+	0x4000 | 0x0010,				// x gyro, 14 bits
+	0x8000 | (uint16_t)(-8 & 0x3FFF),	// y gyro
+	0xC000 | 0x0100,				// z gyro
+	0x4000 | 0x0020,				// x accelerometer
+	0x0000 | (uint16_t)(-16 & 0x3FFF),	// y accelerometer
+	0x8000 | 0x0200,				// z accelerometer
+	0x1000 | 0x0040,				// x temperature, 12 bits
+	0x2000 | (uint16_t)(-32 & 0x0FFF),	// y temperature
+	0x4000 | 0x0080,				// z temperature
+	0x0123};						// aux ADC
+
+/// Frame of the burst reads, static such that its address fits the 32 bit address registers of the PDCA
+static uint16_t frame[IMU_BURST_READ_WORDS];
+
+/// Result of a burst read start from the put hook
+static int hook_start = -1;
+
+/// Tries to start a burst read while a single command is sent, as the IMU interrupt could.
+static void start_during_single_command(uint16_t word){
+	hook_start = imu_burst_read_start(frame);
+}
+
+static bool near(float a, float b){
+	return fabsf(a-b)<=1e-5f*(1+fabsf(b));
+}
+
+int main(void){
+	sim_spi_reset();
+	memcpy(sim_imu_burst_words,imu_words,sizeof(imu_words));
+	imu_interface_init();
+	TEST_CHECK(AVR32_PDCA.channel[IMU_PDCA_CHANNEL_RX].psr==AVR32_PDCA_PID_SPI0_RX);
+	TEST_CHECK(AVR32_PDCA.channel[IMU_PDCA_CHANNEL_TX].psr==AVR32_PDCA_PID_SPI0_TX);
+	TEST_CHECK(!imu_burst_read_busy());
+	
+	// A started burst read is busy until the transfer has run, and no second one is started meanwhile
+	memset(frame,0,sizeof(frame));
+	AVR32_SPI0.rdr = 0xDEAD;
+	TEST_CHECK(imu_burst_read_start(frame));
+	TEST_CHECK(AVR32_SPI0.rdr!=0xDEAD);
+	TEST_CHECK(imu_burst_read_busy());
+	TEST_CHECK(!imu_burst_read_start(frame));
+	TEST_CHECK(frame[FRAME_SUPPLY]==0);
+	sim_pdca_transfer();
+	TEST_CHECK(!imu_burst_read_busy());
+	
+	// The command is sent first, followed by dummy words
+	TEST_CHECK(sim_spi_nr_sent==IMU_BURST_READ_WORDS);
+	TEST_CHECK(sim_spi_sent[0]==BURST_READ);
+	for(int i=1;i<IMU_BURST_READ_WORDS;i++){
+		TEST_CHECK(sim_spi_sent[i]==CONFIG_SPI_MASTER_DUMMY);}
+	
+	// The word received with the command carries no data, the data words follow from FRAME_SUPPLY
+	TEST_CHECK(FRAME_SUPPLY==1);
+	TEST_CHECK(frame[0]==SIM_SPI_NO_DATA);
+	for(int i=0;i<SIM_IMU_BURST_WORDS;i++){
+		TEST_CHECK(frame[FRAME_SUPPLY+i]==imu_words[i]);}
+	
+	// The raw copy keeps the status bits
+	imu_copy_burst_read(frame);
+	TEST_CHECK(memcmp(imu_raw_data,imu_words,sizeof(imu_raw_data))==0);
+	
+	// The conversion shifts out the status bits (the scales are for the shifted words)
+	imu_convert_burst_read(frame);
+	TEST_CHECK(near(imu_supply_voltage,SUPPLY_SCALE*(0x0C80<<4)));
+	TEST_CHECK(near(angular_rates_in[0],GYRO_SCALE*(0x0010<<2)));
+	TEST_CHECK(near(angular_rates_in[1],GYRO_SCALE*(-8*4)));
+	TEST_CHECK(near(angular_rates_in[2],GYRO_SCALE*(0x0100<<2)));
+	TEST_CHECK(near(accelerations_in[0],ACC_SCALE*(0x0020<<2)));
+	TEST_CHECK(near(accelerations_in[1],ACC_SCALE*(-16*4)));
+	TEST_CHECK(near(accelerations_in[2],ACC_SCALE*(0x0200<<2)));
+	TEST_CHECK(near(imu_temperaturs[0],TEMP_SCALE*(0x0040<<4)+25.0f));
+	TEST_CHECK(near(imu_temperaturs[1],TEMP_SCALE*(-32*16)+25.0f));
+	TEST_CHECK(near(imu_temperaturs[2],TEMP_SCALE*(0x0080<<4)+25.0f));
+	
+	// No burst read is started while a single command reserves the SPI
+	sim_spi_nr_sent = 0;
+	sim_spi_put_hook = start_during_single_command;
+	low_pass_filter_setting(3);
+	sim_spi_put_hook = NULL;
+	TEST_CHECK(hook_start==0);
+	TEST_CHECK(!imu_burst_read_busy());
+	TEST_CHECK(AVR32_PDCA.channel[IMU_PDCA_CHANNEL_TX].tcr==0);
+	TEST_CHECK(sim_spi_nr_sent==1 && sim_spi_sent[0]==((SET_NR_FILTER_TAPS<<8) | 3));
+	TEST_CHECK(imu_log2_nr_filter_taps==3);
+	
+	// The SPI is released after the command
+	TEST_CHECK(imu_burst_read_start(frame));
+	sim_pdca_transfer();
+	TEST_CHECK(!imu_burst_read_busy());
+	TEST_CHECK(frame[FRAME_AUX_ADC]==imu_words[SIM_IMU_BURST_WORDS-1]);
+	
+	return test_result("imu_interface_test");
+}
@@ -0,0 +1,201 @@
+/** \file
+	\brief Host test of the queue of IMU interrupts, see interrupt_queue.c.
+
+	\details The burst read functions of the IMU interface are replaced by
+	fakes, such that the test controls when a burst read is refused and for
+	how many polls it stays busy. Each started burst read marks its frame with
+	the number of the interrupt, such that the frames handed to the conversion
+	can be traced back to their interrupts. The time-stamps are taken from the
+	simulated cycle counter, which the test sets before each interrupt.
+
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include "interrupt_queue.c"
+#include "test.h"
+
+uint32_t interrupt_counter;
+uint32_t imu_interrupt_ts;
+sample_queue_counters imu_sample_counters;
+bool imu_raw_passthrough;
+
+/// Number of busy polls of a started burst read before its frame has landed
+#define TRANSFER_POLLS 3
+
+///\name State of the fake burst reads
+//@{
+/// Set to refuse burst reads, as while a single command reserves the SPI
+static bool spi_reserved = false;
+/// Busy polls left of the running burst read, zero if none is running
+static int transfer_polls = 0;
+/// Number of started burst reads, used to mark the frames
+static uint16_t nr_started = 0;
+static int nr_busy_polls = 0;
+/// Marks of the frames passed to the copy and the conversion, zero if none
+static uint16_t copied = 0;
+static uint16_t converted = 0;
+//@}
+
+bool imu_burst_read_start(uint16_t* frame){
+	if(spi_reserved || transfer_polls){
+		return false;}
+	frame[0] = ++nr_started;
+	transfer_polls = TRANSFER_POLLS;
+	return true;
+}
+
+bool imu_burst_read_busy(void){
+	nr_busy_polls++;
+	if(transfer_polls==0){
+		return false;}
+	transfer_polls--;
+	return true;
+}
+
+void imu_copy_burst_read(const uint16_t* frame){
+	copied = frame[0];}
+
+void imu_convert_burst_read(const uint16_t* frame){
+	converted = frame[0];}
+
+/// Queues an interrupt and lets its burst read land, as if the main loop was busy meanwhile.
+static void queue_landed_interrupt(void){
+	queue_imu_interrupt();
+	transfer_polls = 0;
+}
+
+/// Runs the first two steps of the main loop and returns the number of busy polls.
+static int handle_interrupt(void){
+	nr_busy_polls = 0;
+	copied = 0;
+	converted = 0;
+	wait_for_interrupt();
+	read_imu_data();
+	return nr_busy_polls;
+}
+
+int main(void){
+	TEST_CHECK(nr_of_queued_interrupts()==0);
+
+	// The main loop waits until the burst read of a single queued interrupt has landed
+	queue_imu_interrupt();
+	TEST_CHECK(nr_started==1 && imu_frame_queue[0][0]==1);
+	TEST_CHECK(nr_of_queued_interrupts()==1);
+	TEST_CHECK(handle_interrupt()==TRANSFER_POLLS+1);
+	TEST_CHECK(transfer_polls==0);
+	TEST_CHECK(copied==1 && converted==1);
+	TEST_CHECK(interrupt_counter==1);
+	TEST_CHECK(imu_sample_counters.late_samples==0 && imu_sample_counters.max_queued==1);
+	// The entry is released after the frame has been read
+	TEST_CHECK(nr_of_queued_interrupts()==0);
+
+	// In the raw passthrough mode the frame is only copied
+	imu_raw_passthrough = true;
+	queue_imu_interrupt();
+	handle_interrupt();
+	TEST_CHECK(copied==2 && converted==0);
+	imu_raw_passthrough = false;
+
+	// A late main loop catches up without polling, and handles every interrupt with its own frame
+	queue_landed_interrupt();
+	queue_landed_interrupt();
+	queue_landed_interrupt();
+	TEST_CHECK(nr_of_queued_interrupts()==3);
+	TEST_CHECK(handle_interrupt()==0);
+	TEST_CHECK(copied==3 && converted==3);
+	TEST_CHECK(imu_sample_counters.late_samples==1 && imu_sample_counters.max_queued==3);
+	TEST_CHECK(handle_interrupt()==0);
+	TEST_CHECK(converted==4);
+	// The last entry is the newest, whose burst read is polled even if it has landed
+	TEST_CHECK(handle_interrupt()==1);
+	TEST_CHECK(converted==5);
+	TEST_CHECK(imu_sample_counters.late_samples==2);
+	TEST_CHECK(interrupt_counter==5);
+
+	// An interrupt is dropped if the burst read is refused, since the SPI is reserved or a burst read is running
+	spi_reserved = true;
+	queue_imu_interrupt();
+	spi_reserved = false;
+	TEST_CHECK(imu_sample_counters.dropped_samples==1);
+	TEST_CHECK(nr_of_queued_interrupts()==0);
+	queue_imu_interrupt();
+	queue_imu_interrupt();
+	TEST_CHECK(imu_sample_counters.dropped_samples==2);
+	TEST_CHECK(nr_of_queued_interrupts()==1);
+	TEST_CHECK(handle_interrupt()==TRANSFER_POLLS+1);
+	TEST_CHECK(converted==6);
+
+	// An interrupt is dropped if the queue is full, without starting a burst read
+	for(int i=0;i<IMU_INTERRUPT_QUEUE_SIZE;i++){
+		queue_landed_interrupt();}
+	TEST_CHECK(nr_of_queued_interrupts()==IMU_INTERRUPT_QUEUE_SIZE);
+	queue_imu_interrupt();
+	TEST_CHECK(imu_sample_counters.dropped_samples==3);
+	TEST_CHECK(nr_started==6+IMU_INTERRUPT_QUEUE_SIZE);
+	for(int i=0;i<IMU_INTERRUPT_QUEUE_SIZE;i++){
+		handle_interrupt();
+		TEST_CHECK(converted==7+i);}
+	TEST_CHECK(imu_sample_counters.max_queued==IMU_INTERRUPT_QUEUE_SIZE);
+	TEST_CHECK(nr_of_queued_interrupts()==0);
+
+	// The indexes wrap around
+	for(int i=0;i<600;i++){
+		uint8_t head = imu_interrupt_queue_head;
+		queue_imu_interrupt();
+		TEST_CHECK(imu_frame_queue[head & IMU_INTERRUPT_QUEUE_MASK][0]==nr_started);
+		handle_interrupt();
+		TEST_CHECK(converted==nr_started);}
+	TEST_CHECK(interrupt_counter==nr_started);
+	TEST_CHECK(imu_sample_counters.dropped_samples==3);
+	TEST_CHECK(imu_sample_counters.missed_samples==0);
+
+	// Regular interrupts with some jitter miss no samples, also when the cycle counter wraps around
+	uint32_t ts = -3*IMU_FRAME_CYCLES;
+	sim_count = ts;
+	queue_imu_interrupt();
+	handle_interrupt();
+	imu_sample_counters.missed_samples = 0;
+	uint32_t counter = interrupt_counter;
+	for(int i=0;i<10;i++){
+		ts += IMU_FRAME_CYCLES;
+		sim_count = ts + (i%2 ? 2000 : -2000);
+		queue_imu_interrupt();
+		handle_interrupt();}
+	TEST_CHECK(imu_interrupt_ts==ts+2000 && ts<IMU_FRAME_CYCLES*10);
+	TEST_CHECK(imu_sample_counters.missed_samples==0);
+	TEST_CHECK(interrupt_counter==counter+10);
+
+	// Interrupts lost during a stall are found from the time-stamps, the one latched by the EIC is served late
+	ts += 5*IMU_FRAME_CYCLES+IMU_FRAME_CYCLES/3;
+	sim_count = ts;
+	queue_imu_interrupt();
+	handle_interrupt();
+	TEST_CHECK(imu_interrupt_ts==ts);
+	TEST_CHECK(imu_sample_counters.missed_samples==4);
+	TEST_CHECK(interrupt_counter==counter+15);
+
+	// A dropped interrupt is missing as well
+	spi_reserved = true;
+	sim_count = ts += IMU_FRAME_CYCLES;
+	queue_imu_interrupt();
+	spi_reserved = false;
+	sim_count = ts += IMU_FRAME_CYCLES;
+	queue_imu_interrupt();
+	handle_interrupt();
+	TEST_CHECK(imu_sample_counters.dropped_samples==4);
+	TEST_CHECK(imu_sample_counters.missed_samples==5);
+	TEST_CHECK(interrupt_counter==counter+17);
+
+	// Late interrupts handled in a burst keep their own time-stamps and miss no samples
+	for(int i=0;i<4;i++){
+		sim_count = ts += IMU_FRAME_CYCLES;
+		queue_landed_interrupt();}
+	for(int i=0;i<4;i++){
+		handle_interrupt();}
+	TEST_CHECK(imu_interrupt_ts==ts);
+	TEST_CHECK(imu_sample_counters.missed_samples==5);
+	TEST_CHECK(interrupt_counter==counter+21);
+
+	return test_result("interrupt_queue_test");
+}
@@ -0,0 +1,157 @@
+/** \file
+	\brief Host test of the checkpoints of the navigation states, see state_checkpoint.c.
+	
+	\details Saves checkpoints to the simulated flash until the slots have
+	been used several times, and checks which checkpoint is resumed after a
+	reset, also when the latest one is corrupt or a page was erased just
+	before the reset, and that the pages are worn evenly. Also checks that
+	the checkpoints are off by default and only taken at standstill.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include <string.h>
+
+#include "state_checkpoint.c"
+#include "imu_interface.h"
+#include "test.h"
+
+/// Number of calls of save_state_checkpoint(), which saves a checkpoint every second call at divider 1 and standstill
+#define NR_CALLS 1000
+
+///\cond
+// Variables of the void(void) functions of nav_eq.c and of the calibration record
+vec3 accelerations_in;
+vec3 angular_rates_in;
+uint8_t error_signal;
+uint8_t imu_log2_nr_filter_taps = IMU_FILTER_TAPS_NOT_SET;
+void low_pass_filter_setting(uint8_t nr_filter_taps){
+}
+///\endcond
+
+/// Sets the state of the checkpoints and the filter to that after a reset and initializes the checkpoints.
+static void reset_system(void){
+	latest_slot = NO_SLOT;
+	next_slot = 0;
+	next_sequence_number = 0;
+	save_step = NO_SAVE;
+	rate_divider = 0;
+	rate_counter = 0;
+	nav_filter_init(&nav_filter);
+	state_checkpoint_init();
+}
+
+/// Runs the ZUPT aided INS for one call at standstill, with the position telling the calls apart.
+static void save_call(int call){
+	nav_filter.position[0] = call;
+	nav_filter.zupt = true;
+	nav_filter.cov_vector[call%45] += 1;
+	save_state_checkpoint();
+}
+
+int main(void){
+	nav_checkpoint_t resumed;
+	
+	// Nothing to resume from an erased flash
+	sim_flash_erase_all();
+	reset_system();
+	TEST_CHECK(!resume_from_state_checkpoint());
+	TEST_CHECK(nav_filter.initialize_flag);
+	
+	// No checkpoints by default
+	nav_filter.initialize_flag = false;
+	for(int call=0;call<10;call++){
+		save_call(call);}
+	TEST_CHECK(latest_slot==NO_SLOT);
+	
+	// No checkpoints during the initial alignment
+	nav_filter.initialize_flag = true;
+	set_state_checkpoint_divider(1);
+	for(int call=0;call<10;call++){
+		save_call(call);}
+	TEST_CHECK(latest_slot==NO_SLOT);
+	for(int page=0;page<SIM_FLASH_NR_PAGES;page++){
+		TEST_CHECK(sim_flash_erases[page]==0);}
+	
+	// Save checkpoints until the slots have been used several times
+	nav_filter.initialize_flag = false;
+	for(int call=0;call<NR_CALLS;call++){
+		save_call(call);}
+	TEST_CHECK(next_sequence_number==NR_CALLS/2);
+	TEST_CHECK(NR_CALLS/2>4*NR_SLOTS);
+	
+	// The pages are worn evenly and no other page is touched
+	int min_erases = NR_CALLS, max_erases = 0;
+	for(int page=0;page<SIM_FLASH_NR_PAGES;page++){
+		if(page<CHECKPOINT_FIRST_PAGE || page>=CHECKPOINT_FIRST_PAGE+CHECKPOINT_NR_PAGES){
+			TEST_CHECK(sim_flash_erases[page]==0);
+			continue;}
+		if(sim_flash_erases[page]<min_erases){
+			min_erases = sim_flash_erases[page];}
+		if(sim_flash_erases[page]>max_erases){
+			max_erases = sim_flash_erases[page];}
+	}
+	TEST_CHECK(min_erases>0 && max_erases-min_erases<=1);
+	// After a reset the latest checkpoint is resumed and the next one goes to the following slot
+	int last_slot = latest_slot;
+	reset_system();
+	TEST_CHECK(latest_slot==last_slot);
+	TEST_CHECK(next_slot==(last_slot+1)%NR_SLOTS);
+	TEST_CHECK(next_sequence_number==NR_CALLS/2);
+	TEST_CHECK(resume_from_state_checkpoint());
+	TEST_CHECK(!nav_filter.initialize_flag);
+	TEST_CHECK(nav_filter.position[0]==NR_CALLS-2);
+	nav_save_checkpoint(&nav_filter,&resumed);
+	TEST_CHECK(memcmp(&resumed,&slot_address(latest_slot)->checkpoint,sizeof(resumed))==0);
+	
+	// A corrupt latest checkpoint falls back to the one before it
+	((uint8_t*)slot_address(last_slot))[offsetof(checkpoint_record,checkpoint)] ^= 0x01;
+	reset_system();
+	TEST_CHECK(latest_slot==(last_slot+NR_SLOTS-1)%NR_SLOTS);
+	TEST_CHECK(resume_from_state_checkpoint());
+	TEST_CHECK(nav_filter.position[0]==NR_CALLS-4);
+	
+	// The next checkpoint is not written over the corrupt one, which can not be programmed without an erase
+	TEST_CHECK(next_slot!=last_slot);
+	set_state_checkpoint_divider(1);
+	save_call(NR_CALLS);
+	save_call(NR_CALLS);
+	TEST_CHECK(latest_slot!=last_slot && is_valid_checkpoint(slot_address(latest_slot)));
+	reset_system();
+	TEST_CHECK(resume_from_state_checkpoint());
+	TEST_CHECK(nav_filter.position[0]==NR_CALLS);
+	
+	// A reset between the erase of a page and the write of its first slot keeps the latest checkpoint
+	set_state_checkpoint_divider(1);
+	while(next_slot%SLOTS_PER_PAGE!=0){
+		save_call(NR_CALLS+1);
+		save_call(NR_CALLS+1);}
+	last_slot = latest_slot;
+	save_call(NR_CALLS+2);
+	TEST_CHECK(save_step==WRITE_SLOT);
+	reset_system();
+	TEST_CHECK(latest_slot==last_slot);
+	TEST_CHECK(resume_from_state_checkpoint());
+	TEST_CHECK(nav_filter.position[0]==NR_CALLS+1);
+	
+	// A checkpoint is only taken at standstill, at the first one after the period has passed
+	set_state_checkpoint_divider(3);
+	uint32_t sequence_number = next_sequence_number;
+	for(int call=0;call<20;call++){
+		nav_filter.zupt = false;
+		save_state_checkpoint();}
+	TEST_CHECK(next_sequence_number==sequence_number && save_step==NO_SAVE);
+	save_call(NR_CALLS+3);
+	TEST_CHECK(save_step==WRITE_SLOT);
+	save_call(NR_CALLS+3);
+	TEST_CHECK(next_sequence_number==sequence_number+1);
+	for(int call=0;call<3;call++){
+		save_call(NR_CALLS+3);}
+	TEST_CHECK(next_sequence_number==sequence_number+1);
+	save_call(NR_CALLS+3);
+	save_call(NR_CALLS+3);
+	TEST_CHECK(next_sequence_number==sequence_number+2);
+	
+	return test_result("state_checkpoint_test");
+}
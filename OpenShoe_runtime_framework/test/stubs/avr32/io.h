@@ -0,0 +1,64 @@
+/** \file
+	\brief Host stand-in for the register definitions of the UC3C, with the SPI and PDCA registers in RAM.
+	
+	\details Only the registers and fields used by the modules under test are
+	defined. The registers are plain variables, see spi.c for the simulation
+	of the transfers.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef AVR32_IO_H_
+#define AVR32_IO_H_
+
+#include <stdint.h>
+
+///\name PDCA
+//@{
+typedef struct {
+	uint32_t mar;
+	uint32_t psr;
+	uint32_t tcr;
+	uint32_t marr;
+	uint32_t tcrr;
+	/// Last value written to the (write only) control register
+	uint32_t cr;
+	uint32_t mr;
+	uint32_t sr;
+	uint32_t ier;
+	uint32_t idr;
+	uint32_t imr;
+	uint32_t isr;
+} avr32_pdca_channel_t;
+
+typedef struct {
+	avr32_pdca_channel_t channel[16];
+} avr32_pdca_t;
+
+extern volatile avr32_pdca_t AVR32_PDCA;
+
+#define AVR32_PDCA_TEN_MASK 0x00000001
+#define AVR32_PDCA_TDIS_MASK 0x00000002
+#define AVR32_PDCA_SIZE_OFFSET 0
+#define AVR32_PDCA_HALF_WORD 0x00000001
+#define AVR32_PDCA_PID_SPI0_RX 4
+#define AVR32_PDCA_PID_SPI0_TX 13
+//@}
+
+///\name SPI
+//@{
+typedef struct {
+	uint32_t cr;
+	uint32_t mr;
+	uint32_t rdr;
+	uint32_t tdr;
+	uint32_t sr;
+} avr32_spi_t;
+
+extern volatile avr32_spi_t AVR32_SPI0;
+
+#define AVR32_SPI0_NPCS_0_PIN 0
+//@}
+
+#endif /* AVR32_IO_H_ */
@@ -0,0 +1,10 @@
+/** \file
+	\brief System registers of the host tests, see compiler.h.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include "compiler.h"
+
+uint32_t sim_count = 0;
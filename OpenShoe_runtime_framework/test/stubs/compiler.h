@@ -0,0 +1,34 @@
+/** \file
+	\brief Host stand-in for the compiler.h of the AVR32 software framework.
+	
+	\details Only provides what the modules under test use.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef COMPILER_H_
+#define COMPILER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <avr32/io.h>
+
+typedef unsigned char Bool;
+
+#define MSB(u16) ((uint8_t)((u16)>>8))
+#define LSB(u16) ((uint8_t)(u16))
+
+#define COMPILER_ALIGNED(a) __attribute__((__aligned__(a)))
+/// The host tests run everything from RAM
+#define COMPILER_RAMFUNC
+
+/// Simulated cycle counter (COUNT register), which only advances when a test sets it
+extern uint32_t sim_count;
+
+#define AVR32_COUNT 0
+static inline uint32_t Get_system_register(int reg){
+	return sim_count;}
+
+#endif /* COMPILER_H_ */
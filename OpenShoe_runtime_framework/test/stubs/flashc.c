@@ -0,0 +1,87 @@
+/** \file
+	\brief Simulated flash of the host tests, see flashc.h.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include <string.h>
+
+#include "flashc.h"
+
+uint8_t sim_flash[SIM_FLASH_NR_PAGES*AVR32_FLASHC_PAGE_SIZE];
+uint8_t sim_user_page[AVR32_FLASHC_USER_PAGE_SIZE];
+int sim_flash_erases[SIM_FLASH_NR_PAGES];
+int sim_flash_write_errors = 0;
+int sim_user_page_erases = 0;
+int sim_flash_stalls = 0;
+void (*sim_flash_stall_hook)(uint32_t start) = NULL;
+
+/// Page erased by the last erase, -1 if it has been written since
+static int erased_page = -1;
+
+/// Stalls the CPU for a page operation.
+static void stall(void){
+	uint32_t start = sim_count;
+	sim_count += SIM_FLASH_STALL_CYCLES;
+	sim_flash_stalls++;
+	if(sim_flash_stall_hook){
+		sim_flash_stall_hook(start);}
+}
+
+/// Erases the whole flash and the user page and clears the counters.
+void sim_flash_erase_all(void){
+	memset(sim_flash,0xFF,sizeof(sim_flash));
+	memset(sim_user_page,0xFF,sizeof(sim_user_page));
+	memset(sim_flash_erases,0,sizeof(sim_flash_erases));
+	sim_flash_write_errors = 0;
+	sim_user_page_erases = 0;
+	sim_flash_stalls = 0;
+	erased_page = -1;
+}
+
+bool flashc_erase_page(int page_number, bool check){
+	memset(sim_flash+page_number*AVR32_FLASHC_PAGE_SIZE,0xFF,AVR32_FLASHC_PAGE_SIZE);
+	sim_flash_erases[page_number]++;
+	erased_page = page_number;
+	stall();
+	return true;
+}
+
+void flashc_clear_page_buffer(void){
+}
+
+void flashc_write_page(int page_number){
+	if(page_number!=erased_page){
+		sim_flash_write_errors++;}
+	erased_page = -1;
+	stall();
+}
+
+volatile void* flashc_memcpy(volatile void* dst, const void* src, size_t nbytes, bool erase){
+	uint8_t* d = (uint8_t*)dst;
+	const uint8_t* s = src;
+	if(erase){
+		if(d>=sim_user_page && d<sim_user_page+sizeof(sim_user_page)){
+			// The rest of the page is written back with its content
+			uint8_t page[AVR32_FLASHC_USER_PAGE_SIZE];
+			memcpy(page,sim_user_page,sizeof(page));
+			memset(sim_user_page,0xFF,sizeof(sim_user_page));
+			for(size_t i=0;i<sizeof(page);i++){
+				if(sim_user_page+i<d || sim_user_page+i>=d+nbytes){
+					sim_user_page[i] = page[i];}}
+			sim_user_page_erases++;
+			stall();}
+		else{
+			for(size_t offset=(d-sim_flash)/AVR32_FLASHC_PAGE_SIZE*AVR32_FLASHC_PAGE_SIZE;offset<(size_t)(d-sim_flash)+nbytes;offset+=AVR32_FLASHC_PAGE_SIZE){
+				flashc_erase_page(offset/AVR32_FLASHC_PAGE_SIZE,false);}}
+	}
+	// Programming can only clear bits
+	for(size_t i=0;i<nbytes;i++){
+		d[i] &= s[i];}
+	// One page write per page
+	size_t offset = d>=sim_user_page && d<sim_user_page+sizeof(sim_user_page) ? d-sim_user_page : (d-sim_flash)%AVR32_FLASHC_PAGE_SIZE;
+	for(size_t written=0;written<offset+nbytes;written+=AVR32_FLASHC_PAGE_SIZE){
+		stall();}
+	return dst;
+}
@@ -0,0 +1,61 @@
+/** \file
+	\brief Host stand-in for the flash controller driver, simulating the 512 kB flash and the user page in RAM.
+	
+	\details Erasing a page sets its bytes to 0xFF and programming can only
+	clear bits, as on the flash. Writes to the flash address space go
+	straight to the simulated flash, so flashc_write_page() only checks that
+	the page was erased before. The simulation counts the erases of every
+	page. As the driver, flashc_memcpy() keeps the bytes of the user page
+	outside the copied ones when it erases the page.
+	
+	Every page erase and page write stalls the CPU, as on the flash: the
+	simulated cycle counter (\#sim_count) is advanced by
+	\#SIM_FLASH_STALL_CYCLES and \#sim_flash_stall_hook, if set, is called
+	such that a test can serve the interrupts of the stall.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef FLASHC_H_
+#define FLASHC_H_
+
+#include "compiler.h"
+
+#define AVR32_FLASHC_PAGE_SIZE 512
+#define AVR32_FLASHC_USER_PAGE_SIZE 512
+#define SIM_FLASH_NR_PAGES 1024
+
+extern uint8_t sim_flash[SIM_FLASH_NR_PAGES*AVR32_FLASHC_PAGE_SIZE];
+extern uint8_t sim_user_page[AVR32_FLASHC_USER_PAGE_SIZE];
+/// Number of erases of each page
+extern int sim_flash_erases[SIM_FLASH_NR_PAGES];
+/// Number of page writes of pages which were not erased just before
+extern int sim_flash_write_errors;
+/// Number of erases of the user page
+extern int sim_user_page_erases;
+
+/// Clock cycles of a page erase or write, as \#FLASH_PAGE_OPERATION_CYCLES of the firmware
+#define SIM_FLASH_STALL_CYCLES 240000
+/// Number of page erases and writes
+extern int sim_flash_stalls;
+/// Called after each stall with the cycle counter at its start, NULL if not used
+extern void (*sim_flash_stall_hook)(uint32_t start);
+
+#define AVR32_FLASH_ADDRESS ((uintptr_t)sim_flash)
+#define AVR32_FLASHC_USER_PAGE ((uintptr_t)sim_user_page)
+
+void sim_flash_erase_all(void);
+
+bool flashc_erase_page(int page_number, bool check);
+void flashc_clear_page_buffer(void);
+void flashc_write_page(int page_number);
+volatile void* flashc_memcpy(volatile void* dst, const void* src, size_t nbytes, bool erase);
+
+static inline bool flashc_is_lock_error(void){
+	return false;}
+
+static inline bool flashc_is_programming_error(void){
+	return false;}
+
+#endif /* FLASHC_H_ */
@@ -0,0 +1,13 @@
+/** \file
+	\brief Host stand-in for the GPIO driver, which the modules under test include but do not use.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef GPIO_H_
+#define GPIO_H_
+
+#include "compiler.h"
+
+#endif /* GPIO_H_ */
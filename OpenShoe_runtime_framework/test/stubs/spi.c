@@ -0,0 +1,99 @@
+/** \file
+	\brief Simulated SPI, PDCA and IMU of the host tests, see spi.h.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#include <string.h>
+
+#include "spi_master.h"
+
+volatile avr32_pdca_t AVR32_PDCA;
+volatile avr32_spi_t AVR32_SPI0;
+
+uint16_t sim_imu_burst_words[SIM_IMU_BURST_WORDS];
+uint16_t sim_spi_sent[SIM_SPI_MAX_SENT];
+int sim_spi_nr_sent = 0;
+void (*sim_spi_put_hook)(uint16_t word) = NULL;
+
+/// Next burst read data word of the IMU, -1 if no burst read is running
+static int burst_word = -1;
+
+/// Clears the registers and the recorded words.
+void sim_spi_reset(void){
+	memset((void*)&AVR32_PDCA,0,sizeof(AVR32_PDCA));
+	memset((void*)&AVR32_SPI0,0,sizeof(AVR32_SPI0));
+	sim_spi_nr_sent = 0;
+	sim_spi_put_hook = NULL;
+	burst_word = -1;
+}
+
+/// Sends a word to the IMU and returns the word received at the same time.
+static uint16_t transfer(uint16_t word){
+	uint16_t received = SIM_SPI_NO_DATA;
+	if(burst_word>=0 && burst_word<SIM_IMU_BURST_WORDS){
+		received = sim_imu_burst_words[burst_word++];}
+	if(word==SIM_IMU_BURST_READ){
+		burst_word = 0;}
+	if(sim_spi_nr_sent<SIM_SPI_MAX_SENT){
+		sim_spi_sent[sim_spi_nr_sent++] = word;}
+	return received;
+}
+
+static bool channel_enabled(volatile avr32_pdca_channel_t* channel){
+	return (channel->cr & AVR32_PDCA_TEN_MASK) && !(channel->cr & AVR32_PDCA_TDIS_MASK);
+}
+
+/**
+	Runs the enabled transfers of PDCA channel 1 (transmit) and 0 (receive).
+	The received words go to the receive data register when the receive
+	channel is not running.
+*/
+void sim_pdca_transfer(void){
+	volatile avr32_pdca_channel_t* rx = &AVR32_PDCA.channel[0];
+	volatile avr32_pdca_channel_t* tx = &AVR32_PDCA.channel[1];
+	while(channel_enabled(tx) && tx->tcr){
+		uint16_t received = transfer(*(const uint16_t*)(uintptr_t)tx->mar);
+		tx->mar += sizeof(uint16_t);
+		tx->tcr--;
+		if(channel_enabled(rx) && rx->tcr){
+			*(uint16_t*)(uintptr_t)rx->mar = received;
+			rx->mar += sizeof(uint16_t);
+			rx->tcr--;}
+		else{
+			AVR32_SPI0.rdr = received;}
+	}
+}
+
+void spi_master_init(volatile avr32_spi_t *spi){
+}
+
+void spi_master_setup_device(volatile avr32_spi_t *spi, struct spi_device *device, uint8_t flags, uint32_t baud_rate, uint32_t sel_id){
+}
+
+void spi_select_device(volatile avr32_spi_t *spi, struct spi_device *device){
+}
+
+void spi_enable(volatile avr32_spi_t *spi){
+}
+
+void spi_put(volatile avr32_spi_t *spi, uint16_t data){
+	spi->rdr = transfer(data);
+	if(sim_spi_put_hook){
+		sim_spi_put_hook(data);}
+}
+
+uint16_t spi_get(volatile avr32_spi_t *spi){
+	uint16_t data = spi->rdr;
+	spi->rdr = SIM_SPI_NO_DATA;
+	return data;
+}
+
+bool spi_is_tx_empty(volatile avr32_spi_t *spi){
+	return true;
+}
+
+bool spi_is_tx_ready(volatile avr32_spi_t *spi){
+	return true;
+}
@@ -0,0 +1,41 @@
+/** \file
+	\brief Host stand-in for the SPI driver, simulating the SPI, the PDCA and the IMU on the other end.
+	
+	\details The words written with spi_put() and the words read by the PDCA
+	transmit channel are recorded. sim_pdca_transfer() runs the enabled
+	transfers of the PDCA at once, as the hardware does in the background.
+	The simulated IMU answers a word with the data word that the previous
+	burst read command asked for, and with \#SIM_SPI_NO_DATA otherwise.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef SPI_H_
+#define SPI_H_
+
+#include "compiler.h"
+
+/// Burst read command of the IMU
+#define SIM_IMU_BURST_READ 0x3E00
+/// Number of data words of a burst read
+#define SIM_IMU_BURST_WORDS 11
+/// Word received when the IMU has no data to send
+#define SIM_SPI_NO_DATA 0x5A5A
+/// Maximum number of recorded words
+#define SIM_SPI_MAX_SENT 64
+
+/// Data words of the next burst read (supply, x/y/z gyro, x/y/z accelerometer, x/y/z temperature, aux ADC)
+extern uint16_t sim_imu_burst_words[SIM_IMU_BURST_WORDS];
+/// Words sent on the SPI, by spi_put() or by the PDCA
+extern uint16_t sim_spi_sent[SIM_SPI_MAX_SENT];
+extern int sim_spi_nr_sent;
+/// Called by spi_put() after the word is sent, e.g. to act as an interrupt during a single command. May be NULL.
+extern void (*sim_spi_put_hook)(uint16_t word);
+
+void sim_spi_reset(void);
+void sim_pdca_transfer(void);
+
+void spi_enable(volatile avr32_spi_t *spi);
+
+#endif /* SPI_H_ */
@@ -0,0 +1,25 @@
+/** \file
+	\brief Host stand-in for the SPI master service, see spi.h.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef SPI_MASTER_H_
+#define SPI_MASTER_H_
+
+#include "spi.h"
+
+struct spi_device {
+	uint8_t id;
+};
+
+void spi_master_init(volatile avr32_spi_t *spi);
+void spi_master_setup_device(volatile avr32_spi_t *spi, struct spi_device *device, uint8_t flags, uint32_t baud_rate, uint32_t sel_id);
+void spi_select_device(volatile avr32_spi_t *spi, struct spi_device *device);
+void spi_put(volatile avr32_spi_t *spi, uint16_t data);
+uint16_t spi_get(volatile avr32_spi_t *spi);
+bool spi_is_tx_empty(volatile avr32_spi_t *spi);
+bool spi_is_tx_ready(volatile avr32_spi_t *spi);
+
+#endif /* SPI_MASTER_H_ */
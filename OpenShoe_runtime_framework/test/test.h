@@ -0,0 +1,32 @@
+/** \file
+	\brief Checks of the host tests of the runtime framework.
+	
+	\details A failed check is reported with its location and counted; a
+	test program returns non-zero if any check failed.
+	
+	\authors John-Olof Nilsson, Isaac Skog
+	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+*/
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+/// Checks that cond holds.
+#define TEST_CHECK(cond) do{ \
+	test_checks++; \
+	if(!(cond)){ \
+		test_failures++; \
+		fprintf(stderr,"%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond);} \
+	}while(0)
+
+/// Prints the result of a test program and returns its exit status.
+static inline int test_result(const char* name){
+	printf("%s: %d checks, %d failed\n",name,test_checks,test_failures);
+	return test_failures ? 1 : 0;}
+
+#endif /* TEST_H_ */
@@ -0,0 +1,145 @@
+/*! \file imu_convert.c
+	\brief Converter from the text IMU data files (data_inert.txt) to the binary IMU recording format.
+
+	\details For a session directory the binary recording is written to \a data_inert.bin in the same directory,
+	where it is picked up by the replay engine and by settings.m. For a file \a name.txt it is written to
+	\a name.bin, unless an output file is given with -o.
+
+	\verbatim
+	Usage: imu_convert [-f float32|int16] [-c chunk_size] [-m] [-o output] session ...
+	\endverbatim
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup imu_recording
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "imu_recording.h"
+#include "session.h"
+
+/// Builds the name of the binary recording of a session directory or text file.
+static void output_name(char *name, size_t size, const char *path){
+	struct stat st;
+	if(stat(path,&st)==0 && S_ISDIR(st.st_mode)){
+		snprintf(name,size,"%s/%s",path,SESSION_BINARY_FILE);
+		return;
+	}
+	snprintf(name,size,"%s",path);
+	char *dot=strrchr(name,'.');
+	char *slash=strrchr(name,'/');
+	if(dot && (!slash || dot>slash))
+		*dot='\0';
+	strncat(name,".bin",size-strlen(name)-1);
+}
+
+/// Converts one session. Returns zero on success, otherwise -1.
+static int convert(const char *path, const char *output, uint8_t sample_format, uint32_t chunk_size, int magnetometer){
+	char input[4096];
+	struct stat st;
+	session_data_t data;
+	imu_rec_writer_t w;
+	float scale[IMU_REC_MAX_CHANNELS];
+	uint8_t nr_of_channels;
+
+	if(stat(path,&st)==0 && S_ISDIR(st.st_mode))
+		snprintf(input,sizeof(input),"%s/%s",path,SESSION_DATA_FILE);
+	else
+		snprintf(input,sizeof(input),"%s",path);
+	if(session_load_text(&data,input)!=0)
+		return -1;
+
+	nr_of_channels=(magnetometer && data.nr_of_channels==IMU_REC_MAX_CHANNELS) ? IMU_REC_MAX_CHANNELS : IMU_REC_IMU_CHANNELS;
+
+	// int16 scale factors are chosen such that the largest magnitude of each channel uses the full range.
+	for(int ch=0; ch<nr_of_channels; ch++){
+		float max_abs=0;
+		for(uint32_t i=0; i<data.nr_of_samples; i++)
+			if(fabsf(data.channels[ch][i])>max_abs)
+				max_abs=fabsf(data.channels[ch][i]);
+		scale[ch]=(max_abs>0 ? max_abs : 1.0f)/32767;
+	}
+
+	if(imu_rec_create(&w,output,sample_format,nr_of_channels,data.sample_rate,data.start_time,scale,chunk_size)!=0 ||
+	   imu_rec_write(&w,data.channels,data.nr_of_samples)!=0 ||
+	   imu_rec_finish(&w)!=0){
+		fprintf(stderr,"Could not write %s\n",output);
+		if(w.file)
+			imu_rec_finish(&w);
+		session_free(&data);
+		return -1;
+	}
+	printf("%s: %u samples, %u channels, %.3f Hz -> %s\n",input,data.nr_of_samples,nr_of_channels,data.sample_rate,output);
+	session_free(&data);
+	return 0;
+}
+
+static void usage(const char *prog){
+	fprintf(stderr,"Usage: %s [-f float32|int16] [-c chunk_size] [-m] [-o output] session ...\n"
+				   "  session        Directory holding a " SESSION_DATA_FILE " file, or the file itself.\n"
+				   "  -f format      Sample format (default: float32).\n"
+				   "  -c chunk_size  Samples per chunk (default: %u).\n"
+				   "  -m             Include the magnetometer channels.\n"
+				   "  -o output      Output file (only with a single session).\n",prog,IMU_REC_DEFAULT_CHUNK_SIZE);
+}
+
+int main(int argc, char **argv){
+	uint8_t sample_format=IMU_REC_FLOAT32;
+	uint32_t chunk_size=0;
+	int magnetometer=0;
+	const char *output=NULL;
+	int opt;
+	int ret=0;
+
+	while((opt=getopt(argc,argv,"f:c:mo:h"))!=-1){
+		switch(opt){
+			case 'f':
+				if(strcmp(optarg,"float32")==0)
+					sample_format=IMU_REC_FLOAT32;
+				else if(strcmp(optarg,"int16")==0)
+					sample_format=IMU_REC_INT16;
+				else{
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'c':
+				chunk_size=(uint32_t)strtoul(optarg,NULL,0);
+				break;
+			case 'm':
+				magnetometer=1;
+				break;
+			case 'o':
+				output=optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return opt=='h' ? 0 : 1;
+		}
+	}
+	if(optind>=argc || (output && argc-optind>1)){
+		usage(argv[0]);
+		return 1;
+	}
+
+	for(int i=optind; i<argc; i++){
+		char name[4096];
+		if(!output)
+			output_name(name,sizeof(name),argv[i]);
+		if(convert(argv[i],output ? output : name,sample_format,chunk_size,magnetometer)!=0)
+			ret=1;
+	}
+	return ret;
+}
+
+//@}
@@ -0,0 +1,348 @@
+/*! \file imu_recording.c
+	\brief Reading and writing of the binary IMU recording format.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup imu_recording
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "imu_recording.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//******************* Little-endian encoding ******************************//
+
+static inline int host_is_little_endian(void){
+	const uint16_t one=1;
+	return *(const uint8_t*)&one==1;
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v){ p[0]=v; p[1]=v>>8; }
+static inline void put_u32(uint8_t *p, uint32_t v){ for(int i=0;i<4;i++) p[i]=v>>(8*i); }
+static inline void put_u64(uint8_t *p, uint64_t v){ for(int i=0;i<8;i++) p[i]=v>>(8*i); }
+static inline void put_f32(uint8_t *p, float v){ uint32_t u; memcpy(&u,&v,4); put_u32(p,u); }
+static inline void put_f64(uint8_t *p, double v){ uint64_t u; memcpy(&u,&v,8); put_u64(p,u); }
+
+static inline uint16_t get_u16(const uint8_t *p){ return p[0]|(p[1]<<8); }
+static inline uint32_t get_u32(const uint8_t *p){ uint32_t v=0; for(int i=3;i>=0;i--) v=(v<<8)|p[i]; return v; }
+static inline uint64_t get_u64(const uint8_t *p){ uint64_t v=0; for(int i=7;i>=0;i--) v=(v<<8)|p[i]; return v; }
+static inline float get_f32(const uint8_t *p){ uint32_t u=get_u32(p); float v; memcpy(&v,&u,4); return v; }
+static inline double get_f64(const uint8_t *p){ uint64_t u=get_u64(p); double v; memcpy(&v,&u,8); return v; }
+
+/// Rounds \a v up to a multiple of IMU_REC_ALIGNMENT.
+static inline uint64_t align(uint64_t v){
+	return (v+IMU_REC_ALIGNMENT-1)/IMU_REC_ALIGNMENT*IMU_REC_ALIGNMENT;
+}
+
+/// Size of one sample of one channel [bytes].
+static inline uint32_t sample_size(const imu_rec_header_t *h){
+	return h->sample_format==IMU_REC_INT16 ? 2 : 4;
+}
+
+static void encode_header(uint8_t *buf, const imu_rec_header_t *h){
+	memset(buf,0,IMU_REC_HEADER_SIZE);
+	memcpy(buf,IMU_REC_MAGIC,8);
+	put_u16(buf+8,h->version);
+	put_u16(buf+10,h->header_size);
+	buf[12]=h->sample_format;
+	buf[13]=h->nr_of_channels;
+	put_u32(buf+16,h->nr_of_samples);
+	put_u32(buf+20,h->chunk_size);
+	put_u32(buf+24,h->nr_of_chunks);
+	put_f32(buf+28,h->sample_rate);
+	put_f64(buf+32,h->start_time);
+	put_u64(buf+40,h->index_offset);
+	for(int i=0; i<IMU_REC_MAX_CHANNELS; i++)
+		put_f32(buf+48+4*i,h->scale[i]);
+}
+
+static void decode_header(imu_rec_header_t *h, const uint8_t *buf){
+	h->version=get_u16(buf+8);
+	h->header_size=get_u16(buf+10);
+	h->sample_format=buf[12];
+	h->nr_of_channels=buf[13];
+	h->nr_of_samples=get_u32(buf+16);
+	h->chunk_size=get_u32(buf+20);
+	h->nr_of_chunks=get_u32(buf+24);
+	h->sample_rate=get_f32(buf+28);
+	h->start_time=get_f64(buf+32);
+	h->index_offset=get_u64(buf+40);
+	for(int i=0; i<IMU_REC_MAX_CHANNELS; i++)
+		h->scale[i]=get_f32(buf+48+4*i);
+}
+
+
+//******************* Writer ******************************//
+
+/// Writes zero bytes up to the next aligned position.
+static int write_padding(imu_rec_writer_t *w){
+	static const uint8_t zeros[IMU_REC_ALIGNMENT];
+	uint64_t pad=align(w->position)-w->position;
+	if(pad && fwrite(zeros,1,pad,w->file)!=pad)
+		return -1;
+	w->position+=pad;
+	return 0;
+}
+
+int imu_rec_create(imu_rec_writer_t *w, const char *file_name, uint8_t sample_format, uint8_t nr_of_channels,
+				   float sample_rate, double start_time, const float *scale, uint32_t chunk_size){
+	uint8_t buf[IMU_REC_HEADER_SIZE];
+
+	memset(w,0,sizeof(imu_rec_writer_t));
+	if((sample_format!=IMU_REC_FLOAT32 && sample_format!=IMU_REC_INT16) ||
+	   (nr_of_channels!=IMU_REC_IMU_CHANNELS && nr_of_channels!=IMU_REC_MAX_CHANNELS))
+		return -1;
+
+	w->file=fopen(file_name,"wb");
+	if(!w->file)
+		return -1;
+
+	w->header.version=IMU_REC_VERSION;
+	w->header.header_size=IMU_REC_HEADER_SIZE;
+	w->header.sample_format=sample_format;
+	w->header.nr_of_channels=nr_of_channels;
+	w->header.chunk_size=chunk_size ? chunk_size : IMU_REC_DEFAULT_CHUNK_SIZE;
+	w->header.sample_rate=sample_rate;
+	w->header.start_time=start_time;
+	for(int i=0; i<IMU_REC_MAX_CHANNELS; i++)
+		w->header.scale[i]=(sample_format==IMU_REC_INT16 && scale && i<nr_of_channels) ? scale[i] : 1.0f;
+
+	// Preliminary header, rewritten with the sample count and index offset by imu_rec_finish().
+	encode_header(buf,&w->header);
+	if(fwrite(buf,1,IMU_REC_HEADER_SIZE,w->file)!=IMU_REC_HEADER_SIZE){
+		fclose(w->file);
+		w->file=NULL;
+		return -1;
+	}
+	w->position=IMU_REC_HEADER_SIZE;
+	return 0;
+}
+
+/// Writes one chunk of at most chunk_size samples.
+static int write_chunk(imu_rec_writer_t *w, const float *const *channels, uint32_t offset, uint32_t n){
+	imu_rec_header_t *h=&w->header;
+	uint8_t buf[4096];
+
+	if(h->nr_of_chunks==w->chunk_capacity){
+		uint32_t capacity=w->chunk_capacity ? 2*w->chunk_capacity : 16;
+		imu_rec_chunk_t *chunks=realloc(w->chunks,capacity*sizeof(imu_rec_chunk_t));
+		if(!chunks)
+			return -1;
+		w->chunks=chunks;
+		w->chunk_capacity=capacity;
+	}
+	if(write_padding(w)!=0)
+		return -1;
+
+	imu_rec_chunk_t *c=&w->chunks[h->nr_of_chunks];
+	c->offset=w->position;
+	c->first_sample=h->nr_of_samples;
+	c->nr_of_samples=n;
+	c->start_time=h->start_time+(h->sample_rate>0 ? h->nr_of_samples/(double)h->sample_rate : 0.0);
+
+	for(uint8_t ch=0; ch<h->nr_of_channels; ch++){
+		const float *src=channels[ch]+offset;
+		uint32_t per_buf=sizeof(buf)/sample_size(h);
+
+		if(write_padding(w)!=0)
+			return -1;
+		for(uint32_t i=0; i<n; i+=per_buf){
+			uint32_t m=(n-i<per_buf) ? n-i : per_buf;
+			for(uint32_t j=0; j<m; j++){
+				if(h->sample_format==IMU_REC_INT16){
+					float v=roundf(src[i+j]/h->scale[ch]);
+					v=v>32767 ? 32767 : (v<-32768 ? -32768 : v);
+					put_u16(buf+2*j,(uint16_t)(int16_t)v);
+				}
+				else{
+					put_f32(buf+4*j,src[i+j]);
+				}
+			}
+			if(fwrite(buf,sample_size(h),m,w->file)!=m)
+				return -1;
+		}
+		w->position+=(uint64_t)n*sample_size(h);
+	}
+
+	h->nr_of_chunks++;
+	h->nr_of_samples+=n;
+	return 0;
+}
+
+int imu_rec_write(imu_rec_writer_t *w, const float *const *channels, uint32_t nr_of_samples){
+	if(!w->file)
+		return -1;
+	for(uint32_t offset=0; offset<nr_of_samples; offset+=w->header.chunk_size){
+		uint32_t n=nr_of_samples-offset;
+		if(n>w->header.chunk_size)
+			n=w->header.chunk_size;
+		if(write_chunk(w,channels,offset,n)!=0)
+			return -1;
+	}
+	return 0;
+}
+
+int imu_rec_finish(imu_rec_writer_t *w){
+	uint8_t buf[IMU_REC_HEADER_SIZE];
+	int ret=0;
+
+	if(!w->file)
+		return -1;
+
+	// Chunk index
+	if(write_padding(w)!=0)
+		ret=-1;
+	w->header.index_offset=w->position;
+	for(uint32_t i=0; i<w->header.nr_of_chunks && ret==0; i++){
+		uint8_t entry[IMU_REC_INDEX_ENTRY_SIZE];
+		put_u64(entry,w->chunks[i].offset);
+		put_u32(entry+8,w->chunks[i].first_sample);
+		put_u32(entry+12,w->chunks[i].nr_of_samples);
+		put_f64(entry+16,w->chunks[i].start_time);
+		if(fwrite(entry,1,IMU_REC_INDEX_ENTRY_SIZE,w->file)!=IMU_REC_INDEX_ENTRY_SIZE)
+			ret=-1;
+	}
+
+	// Final header
+	encode_header(buf,&w->header);
+	if(ret==0 && (fseek(w->file,0,SEEK_SET)!=0 || fwrite(buf,1,IMU_REC_HEADER_SIZE,w->file)!=IMU_REC_HEADER_SIZE))
+		ret=-1;
+	if(fclose(w->file)!=0)
+		ret=-1;
+	w->file=NULL;
+	free(w->chunks);
+	w->chunks=NULL;
+	return ret;
+}
+
+
+//******************* Reader ******************************//
+
+int imu_rec_is_recording(const char *file_name){
+	char magic[8];
+	FILE *f=fopen(file_name,"rb");
+	int ret=0;
+	if(f){
+		ret=(fread(magic,1,8,f)==8 && memcmp(magic,IMU_REC_MAGIC,8)==0);
+		fclose(f);
+	}
+	return ret;
+}
+
+int imu_rec_open(imu_rec_reader_t *r, const char *file_name){
+	struct stat st;
+	imu_rec_header_t *h=&r->header;
+	int fd;
+	void *base;
+
+	memset(r,0,sizeof(imu_rec_reader_t));
+	fd=open(file_name,O_RDONLY);
+	if(fd<0 || fstat(fd,&st)!=0 || st.st_size<IMU_REC_HEADER_SIZE){
+		fprintf(stderr,"Could not read %s\n",file_name);
+		if(fd>=0)
+			close(fd);
+		return -1;
+	}
+	base=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(base==MAP_FAILED){
+		fprintf(stderr,"Could not map %s\n",file_name);
+		return -1;
+	}
+	r->base=base;
+	r->size=st.st_size;
+
+	decode_header(h,r->base);
+	if(memcmp(r->base,IMU_REC_MAGIC,8)!=0 || h->version!=IMU_REC_VERSION || h->header_size<IMU_REC_HEADER_SIZE ||
+	   (h->sample_format!=IMU_REC_FLOAT32 && h->sample_format!=IMU_REC_INT16) ||
+	   h->nr_of_channels<IMU_REC_IMU_CHANNELS || h->nr_of_channels>IMU_REC_MAX_CHANNELS ||
+	   h->index_offset+(uint64_t)h->nr_of_chunks*IMU_REC_INDEX_ENTRY_SIZE>r->size){
+		fprintf(stderr,"%s is not a valid IMU recording\n",file_name);
+		imu_rec_close(r);
+		return -1;
+	}
+
+	// Decode and check the chunk index
+	r->chunks=malloc((h->nr_of_chunks ? h->nr_of_chunks : 1)*sizeof(imu_rec_chunk_t));
+	if(!r->chunks){
+		imu_rec_close(r);
+		return -1;
+	}
+	uint64_t nr_of_samples=0;
+	for(uint32_t i=0; i<h->nr_of_chunks; i++){
+		const uint8_t *entry=r->base+h->index_offset+(uint64_t)i*IMU_REC_INDEX_ENTRY_SIZE;
+		imu_rec_chunk_t *c=&r->chunks[i];
+		c->offset=get_u64(entry);
+		c->first_sample=get_u32(entry+8);
+		c->nr_of_samples=get_u32(entry+12);
+		c->start_time=get_f64(entry+16);
+
+		uint64_t end=c->offset+(h->nr_of_channels-1)*align((uint64_t)c->nr_of_samples*sample_size(h))+(uint64_t)c->nr_of_samples*sample_size(h);
+		if(c->first_sample!=nr_of_samples || end>r->size || c->offset%IMU_REC_ALIGNMENT){
+			fprintf(stderr,"%s has a corrupt chunk index\n",file_name);
+			imu_rec_close(r);
+			return -1;
+		}
+		nr_of_samples+=c->nr_of_samples;
+	}
+	if(nr_of_samples!=h->nr_of_samples){
+		fprintf(stderr,"%s has a corrupt chunk index\n",file_name);
+		imu_rec_close(r);
+		return -1;
+	}
+	return 0;
+}
+
+void imu_rec_close(imu_rec_reader_t *r){
+	if(r->base)
+		munmap((void*)r->base,r->size);
+	free(r->chunks);
+	memset(r,0,sizeof(imu_rec_reader_t));
+}
+
+/// Start of the samples of channel \a ch of chunk \a c.
+static inline const uint8_t* chunk_channel(const imu_rec_reader_t *r, const imu_rec_chunk_t *c, uint8_t ch){
+	return r->base+c->offset+ch*align((uint64_t)c->nr_of_samples*sample_size(&r->header));
+}
+
+const float* imu_rec_channel(const imu_rec_reader_t *r, uint8_t channel){
+	if(r->header.sample_format!=IMU_REC_FLOAT32 || r->header.nr_of_chunks!=1 ||
+	   channel>=r->header.nr_of_channels || !host_is_little_endian())
+		return NULL;
+	return (const float*)chunk_channel(r,&r->chunks[0],channel);
+}
+
+void imu_rec_read_channel(const imu_rec_reader_t *r, uint8_t channel, float *out){
+	const imu_rec_header_t *h=&r->header;
+	const float scale=h->scale[channel];
+
+	for(uint32_t i=0; i<h->nr_of_chunks; i++){
+		const imu_rec_chunk_t *c=&r->chunks[i];
+		const uint8_t *src=chunk_channel(r,c,channel);
+		float *dst=out+c->first_sample;
+
+		if(h->sample_format==IMU_REC_INT16){
+			for(uint32_t j=0; j<c->nr_of_samples; j++)
+				dst[j]=scale*(int16_t)get_u16(src+2*j);
+		}
+		else if(host_is_little_endian()){
+			memcpy(dst,src,(size_t)c->nr_of_samples*4);
+		}
+		else{
+			for(uint32_t j=0; j<c->nr_of_samples; j++)
+				dst[j]=get_f32(src+4*j);
+		}
+	}
+}
+
+//@}
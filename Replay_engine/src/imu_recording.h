@@ -0,0 +1,189 @@
+/*! \file imu_recording.h
+	\brief Header file for the binary IMU recording format.
+
+	\details Binary container for recorded IMU data which replaces the 17 column text files (data_inert.txt)
+	written by the Matlab logging scripts. The files are designed to be memory mapped, such that a session can be
+	processed without any parsing. All fields are little-endian. A file consists of:
+
+	\li A header of \a IMU_REC_HEADER_SIZE bytes, see imu_rec_header_t.
+	\li A number of chunks holding the samples. Within a chunk the data is stored channel by channel (structure of
+		arrays), i.e., all the x-axis specific force samples of the chunk, followed by all the y-axis samples etc. The
+		samples are either float32 in SI units, or int16 which are multiplied with the scale factor of the channel to
+		get SI units. Every chunk and every channel within a chunk starts at a multiple of \a IMU_REC_ALIGNMENT bytes.
+	\li A chunk index with one entry (\a IMU_REC_INDEX_ENTRY_SIZE bytes) per chunk, see imu_rec_chunk_t. The offset of
+		the index is given in the header. The index is written last, hence a file can be written as a stream.
+
+	The channels are, in order: specific force x,y,z [\f$m/s^2\f$], angular rates x,y,z [\f$rad/s\f$] and,
+	optionally, magnetic field x,y,z [\f$G\f$].
+
+	The Matlab counterparts are read_imu_recording.m and write_imu_recording.m in OpenShoe_Matlab_Implementation.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/**
+	\defgroup imu_recording Binary IMU recordings
+	\brief Reading and writing of the binary, memory mappable, IMU recording format.
+	\ingroup replay
+	@{
+*/
+
+#ifndef IMU_RECORDING_H_
+#define IMU_RECORDING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+///\name Format constants
+//@{
+/// File identifier, the first 8 bytes of a recording.
+#define IMU_REC_MAGIC "OSIMUREC"
+/// Version of the format written by this implementation.
+#define IMU_REC_VERSION 1
+/// Size of the header [bytes].
+#define IMU_REC_HEADER_SIZE 96
+/// Size of a chunk index entry [bytes].
+#define IMU_REC_INDEX_ENTRY_SIZE 24
+/// Alignment of chunks and channels [bytes].
+#define IMU_REC_ALIGNMENT 64
+/// Default number of samples per chunk (~4.4 minutes at 250 Hz).
+#define IMU_REC_DEFAULT_CHUNK_SIZE 65536
+//@}
+
+///\name Sample formats
+//@{
+#define IMU_REC_FLOAT32 0
+#define IMU_REC_INT16	1
+//@}
+
+///\name Channels
+//@{
+#define IMU_REC_ACC_X	0
+#define IMU_REC_ACC_Y	1
+#define IMU_REC_ACC_Z	2
+#define IMU_REC_GYRO_X	3
+#define IMU_REC_GYRO_Y	4
+#define IMU_REC_GYRO_Z	5
+#define IMU_REC_MAG_X	6
+#define IMU_REC_MAG_Y	7
+#define IMU_REC_MAG_Z	8
+/// Number of channels of a recording without magnetometer data.
+#define IMU_REC_IMU_CHANNELS 6
+/// Maximum number of channels of a recording.
+#define IMU_REC_MAX_CHANNELS 9
+//@}
+
+/// Header of a recording. Stored little-endian at offset 0 with the byte offsets given below.
+typedef struct {
+	/// [8] Format version (the magic occupies bytes 0-7).
+	uint16_t version;
+	/// [10] Size of the header [bytes].
+	uint16_t header_size;
+	/// [12] Sample format, IMU_REC_FLOAT32 or IMU_REC_INT16.
+	uint8_t sample_format;
+	/// [13] Number of channels, IMU_REC_IMU_CHANNELS or IMU_REC_MAX_CHANNELS.
+	uint8_t nr_of_channels;
+	/// [16] Total number of samples.
+	uint32_t nr_of_samples;
+	/// [20] Maximum number of samples per chunk.
+	uint32_t chunk_size;
+	/// [24] Number of chunks.
+	uint32_t nr_of_chunks;
+	/// [28] Sample rate [Hz].
+	float sample_rate;
+	/// [32] Time of the first sample [s] (host time stamp of the logging computer).
+	double start_time;
+	/// [40] Byte offset of the chunk index.
+	uint64_t index_offset;
+	/// [48] Scale factors of the channels (SI unit per LSB for int16, 1 for float32).
+	float scale[IMU_REC_MAX_CHANNELS];
+} imu_rec_header_t;
+
+/// Entry of the chunk index. Stored little-endian with the byte offsets given below.
+typedef struct {
+	/// [0] Byte offset of the chunk.
+	uint64_t offset;
+	/// [8] Index of the first sample of the chunk.
+	uint32_t first_sample;
+	/// [12] Number of samples in the chunk.
+	uint32_t nr_of_samples;
+	/// [16] Time of the first sample of the chunk [s].
+	double start_time;
+} imu_rec_chunk_t;
+
+/// Memory mapped recording opened for reading.
+typedef struct {
+	/// Start of the mapped file.
+	const uint8_t *base;
+	/// Size of the mapped file [bytes].
+	size_t size;
+	imu_rec_header_t header;
+	/// Chunk index (decoded to host byte order).
+	imu_rec_chunk_t *chunks;
+} imu_rec_reader_t;
+
+/// Recording opened for writing.
+typedef struct {
+	FILE *file;
+	imu_rec_header_t header;
+	imu_rec_chunk_t *chunks;
+	uint32_t chunk_capacity;
+	/// Current write position [bytes].
+	uint64_t position;
+} imu_rec_writer_t;
+
+
+/*! \brief Creates a recording.
+
+	 @param[out] w				The writer.
+	 @param[in]	 file_name		Name of the file.
+	 @param[in]	 sample_format	IMU_REC_FLOAT32 or IMU_REC_INT16.
+	 @param[in]	 nr_of_channels	IMU_REC_IMU_CHANNELS or IMU_REC_MAX_CHANNELS.
+	 @param[in]	 sample_rate	Sample rate [Hz].
+	 @param[in]	 start_time		Time of the first sample [s].
+	 @param[in]	 scale			Scale factors of the channels for IMU_REC_INT16, ignored for IMU_REC_FLOAT32.
+	 @param[in]	 chunk_size		Maximum number of samples per chunk, or 0 for IMU_REC_DEFAULT_CHUNK_SIZE.
+	 \return Zero on success, otherwise -1.
+*/
+int imu_rec_create(imu_rec_writer_t *w, const char *file_name, uint8_t sample_format, uint8_t nr_of_channels,
+				   float sample_rate, double start_time, const float *scale, uint32_t chunk_size);
+
+/*! \brief Appends samples to a recording. The samples are split into chunks of at most \a chunk_size samples.
+
+	 @param[in] w				The writer.
+	 @param[in] channels		Array of \a nr_of_channels pointers to the samples of each channel in SI units.
+	 @param[in] nr_of_samples	Number of samples.
+	 \return Zero on success, otherwise -1.
+*/
+int imu_rec_write(imu_rec_writer_t *w, const float *const *channels, uint32_t nr_of_samples);
+
+/// Writes the chunk index and the final header and closes the file. Returns zero on success, otherwise -1.
+int imu_rec_finish(imu_rec_writer_t *w);
+
+/*! \brief Opens and memory maps a recording.
+
+	\return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int imu_rec_open(imu_rec_reader_t *r, const char *file_name);
+
+/// Unmaps a recording.
+void imu_rec_close(imu_rec_reader_t *r);
+
+/// Returns non-zero if \a file_name starts with the recording magic.
+int imu_rec_is_recording(const char *file_name);
+
+/*! \brief Returns a pointer to the float32 samples of a channel of the whole recording within the mapped file.
+
+	\return The pointer, or NULL if the samples can not be used in place, i.e., if the recording is not in float32,
+	has more than one chunk or if the host is not little-endian. Use imu_rec_read_channel() in that case.
+*/
+const float* imu_rec_channel(const imu_rec_reader_t *r, uint8_t channel);
+
+/// Decodes all samples of a channel to SI units into \a out, which must hold \a nr_of_samples elements.
+void imu_rec_read_channel(const imu_rec_reader_t *r, uint8_t channel, float *out);
+
+#endif /* IMU_RECORDING_H_ */
+
+//@}
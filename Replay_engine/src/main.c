@@ -0,0 +1,368 @@
+/*! \file main.c
+	\brief The main file of the OpenShoe replay engine.
+
+	\details The replay engine reprocesses recorded sessions (e.g. the OpenShoe_Matlab_Implementation/Measurement_*
+	directories) with the C implementation of the ZUPT aided INS in nav_eq.c. The sessions are spread over the
+	cores of the host with a work-stealing thread pool, each worker using its own filter context. For every
+	session the trajectory is written to \a \<output directory\>/\<session\>.txt and a summary with the timings and
+	the throughput of the filter is printed and written to \a \<output directory\>/summary.txt.
+
+	With -s the trajectories are also post-processed with the fixed-interval RTS smoother of smoother.h, and the
+	smoothed trajectory of each session is written to \a \<output directory\>/\<session\>_smoothed.txt. The
+	records of the smoother are kept in a temporary file \a \<output directory\>/\<session\>.rts, such that
+	recordings of any length can be smoothed in bounded memory.
+
+	With -u the filter uses the UD factorized covariance of nav_eq.c (time_up_data_UD() and zupt_update_UD()) instead
+	of the covariance matrix. The smoother always runs with the covariance matrix.
+
+	With -c the filter is reset at the given sample and resumed from a checkpoint of its states and covariance taken
+	just before, which shows how the trajectory continues after a reset of the system. It does not apply to -s.
+
+	\verbatim
+	Usage: replay_engine [-c sample] [-j workers] [-o output_directory] [-r repeats] [-s] [-u] session ...
+	\endverbatim
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup replay
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nav_kernels.h"
+#include "replay.h"
+#include "session.h"
+#include "smoother.h"
+#include "work_pool.h"
+
+///\cond
+// Variables used by the void(void) functions of nav_eq.c. The replay engine itself only uses the filter contexts.
+vec3 accelerations_in;
+vec3 angular_rates_in;
+uint8_t error_signal;
+///\endcond
+
+/// Result of one replay task.
+typedef struct {
+	/// Number of IMU samples of the session.
+	uint32_t nr_of_samples;
+	/// Number of trajectory points, i.e., samples processed after the initial alignment.
+	uint32_t nr_of_points;
+	/// Final position of the trajectory [m].
+	vec3 final_position;
+	/// Time spent reading the session [s].
+	double load_time;
+	/// Time spent in the filter [s].
+	double filter_time;
+	/// Time spent writing the trajectory [s].
+	double write_time;
+	/// Time spent in the backward pass of the smoother [s].
+	double smooth_time;
+	/// Worker that processed the task.
+	unsigned worker;
+	/// Error signaled by the filter if the solution diverged, or -1 if the session could not be processed.
+	int error;
+} replay_result_t;
+
+/// Settings and results of a run shared with the tasks.
+typedef struct {
+	char **sessions;
+	size_t nr_of_sessions;
+	const char *output_directory;
+	/// Non-zero if the trajectories should be smoothed.
+	int smoother;
+	/// Representation of the covariance of the filter.
+	replay_covariance_t covariance;
+	/// Sample at which the filter is resumed from a checkpoint, 0 for none.
+	uint32_t resume_sample;
+	nav_params_t params;
+	replay_result_t *results;
+} replay_job_t;
+
+
+/// Builds the name of an output file of a session, \a \<output directory\>/\<session\>\<suffix\>.
+static void output_file_name(char *file_name, size_t size, const replay_job_t *job, const char *path, const char *suffix){
+	char name[256];
+	session_name(name,sizeof(name),path);
+	snprintf(file_name,size,"%s/%s%s",job->output_directory,name,suffix);
+}
+
+/**
+  \brief	Sets the error of a session from the state of the filter after the run.
+
+  \details	The error signal of the filter is sticky and is also raised by
+  single ill-conditioned updates which the filter recovers from. Only a
+  solution which has diverged is reported as a failure, other signaled
+  errors are reported as warnings.
+
+  @param[out] result		Result of the session.
+  @param[in] filter		Filter after the run.
+  @param[in] path		Path of the session.
+*/
+static void filter_result(replay_result_t *result, const nav_filter_t *filter, const char *path){
+	bool diverged=false;
+	for(int i=0; i<3; i++)
+		if(!isfinite(filter->position[i]) || !isfinite(filter->velocity[i]))
+			diverged=true;
+
+	result->error=0;
+	if(diverged)
+		result->error=filter->error_signal ? filter->error_signal : -1;
+	else if(filter->error_signal)
+		fprintf(stderr,"%s: the filter signaled error %d but recovered\n",path,filter->error_signal);
+}
+
+/// Runs the forward filter and the smoother over a session and writes both trajectories.
+static void smooth_session(replay_job_t *job, replay_result_t *result, const session_data_t *data, const char *path){
+	char store_name[4096], forward_name[4096], smoothed_name[4096];
+	smoother_store_t store;
+	nav_filter_t filter;
+	double t0;
+
+	output_file_name(store_name,sizeof(store_name),job,path,".rts");
+	output_file_name(forward_name,sizeof(forward_name),job,path,".txt");
+	output_file_name(smoothed_name,sizeof(smoothed_name),job,path,"_smoothed.txt");
+	if(smoother_store_open(&store,store_name,0)!=0){
+		result->error=-1;
+		return;
+	}
+
+	t0=work_pool_time();
+	if(smoother_forward(&store,&filter,&job->params,data)!=0){
+		smoother_store_close(&store);
+		result->error=-1;
+		return;
+	}
+	result->filter_time=work_pool_time()-t0;
+	result->nr_of_points=(uint32_t)store.nr_of_records;
+	filter_result(result,&filter,path);
+	memcpy(result->final_position,filter.position,sizeof(vec3));
+
+	t0=work_pool_time();
+	if(smoother_backward(&store,&job->params)!=0)
+		result->error=-1;
+	result->smooth_time=work_pool_time()-t0;
+	if(store.nr_of_restarts)
+		fprintf(stderr,"%s: the smoother was restarted at %u samples\n",path,store.nr_of_restarts);
+
+	t0=work_pool_time();
+	if(result->error>=0 && smoother_write_trajectories(&store,forward_name,smoothed_name)!=0)
+		result->error=-1;
+	result->write_time=work_pool_time()-t0;
+	smoother_store_close(&store);
+}
+
+/// Processes one repetition of one session. Only the first repetition writes (and smooths) the trajectory.
+static void replay_task(void *arg, size_t task, unsigned worker){
+	replay_job_t *job=(replay_job_t*)arg;
+	replay_result_t *result=&job->results[task];
+	const char *path=job->sessions[task%job->nr_of_sessions];
+	int write_trajectory=(task<job->nr_of_sessions) && job->output_directory;
+	session_data_t data;
+	nav_filter_t filter;
+	trajectory_point_t *trajectory=NULL;
+	double t0;
+
+	result->worker=worker;
+
+	t0=work_pool_time();
+	if(session_load(&data,path)!=0){
+		result->error=-1;
+		return;
+	}
+	result->load_time=work_pool_time()-t0;
+	result->nr_of_samples=data.nr_of_samples;
+
+	if(write_trajectory && job->smoother){
+		smooth_session(job,result,&data,path);
+		session_free(&data);
+		return;
+	}
+
+	if(write_trajectory){
+		trajectory=malloc(data.nr_of_samples*sizeof(trajectory_point_t));
+		if(!trajectory){
+			fprintf(stderr,"Out of memory processing %s\n",path);
+			session_free(&data);
+			result->error=-1;
+			return;
+		}
+	}
+
+	t0=work_pool_time();
+	result->nr_of_points=replay_run(trajectory,&filter,&job->params,job->covariance,&data,job->resume_sample);
+	result->filter_time=work_pool_time()-t0;
+	filter_result(result,&filter,path);
+	memcpy(result->final_position,filter.position,sizeof(vec3));
+
+	if(write_trajectory){
+		char file_name[4096];
+		output_file_name(file_name,sizeof(file_name),job,path,".txt");
+		t0=work_pool_time();
+		if(session_write_trajectory(file_name,trajectory,result->nr_of_points)!=0)
+			result->error=-1;
+		result->write_time=work_pool_time()-t0;
+		free(trajectory);
+	}
+	session_free(&data);
+}
+
+/// Prints the summary of a run.
+static void print_summary(FILE *f, const replay_job_t *job, size_t nr_of_tasks, unsigned nr_of_workers, const work_pool_stats_t *stats, double wall_time){
+	uint64_t total_samples=0;
+	double total_filter_time=0;
+	double total_busy_time=0;
+
+	fprintf(f,"%-24s %9s %9s %10s %10s %10s %10s %10s %10s %6s\n","session","samples","repeats","load[ms]","filter[ms]","smooth[ms]","write[ms]","Msamples/s","end err[m]","error");
+	for(size_t s=0; s<job->nr_of_sessions; s++){
+		char name[256];
+		uint32_t repeats=0;
+		double load_time=0, filter_time=0;
+		int error=0;
+		const replay_result_t *first=&job->results[s];
+
+		for(size_t t=s; t<nr_of_tasks; t+=job->nr_of_sessions){
+			const replay_result_t *r=&job->results[t];
+			if(r->error)
+				error=r->error;
+			if(r->error<0)
+				continue;
+			repeats++;
+			load_time+=r->load_time;
+			filter_time+=r->filter_time;
+			total_samples+=r->nr_of_samples;
+			total_filter_time+=r->filter_time;
+		}
+
+		session_name(name,sizeof(name),job->sessions[s]);
+		if(repeats==0){
+			fprintf(f,"%-24s %9s %9u %10s %10s %10s %10s %10s %10s %6d\n",name,"-",0u,"-","-","-","-","-","-",error);
+			continue;
+		}
+		fprintf(f,"%-24s %9u %9u %10.3f %10.3f %10.3f %10.3f %10.3f %10.4f %6d\n",name,first->nr_of_samples,repeats,
+				1e3*load_time/repeats,1e3*filter_time/repeats,1e3*first->smooth_time,1e3*first->write_time,
+				filter_time>0 ? 1e-6*repeats*first->nr_of_samples/filter_time : 0.0,
+				sqrt_hf(vecnorm2(first->final_position,3)),error);
+	}
+
+	fprintf(f,"\n%-8s %9s %9s %10s\n","worker","tasks","steals","busy[s]");
+	for(unsigned w=0; w<nr_of_workers; w++){
+		fprintf(f,"%-8u %9u %9u %10.3f\n",w,stats[w].nr_of_tasks,stats[w].nr_of_steals,stats[w].busy_time);
+		total_busy_time+=stats[w].busy_time;
+	}
+
+	fprintf(f,"\nWorkers:                      %u (kernel %s)\n",nr_of_workers,NAV_KERNEL_NAME);
+	fprintf(f,"Samples processed:            %llu\n",(unsigned long long)total_samples);
+	fprintf(f,"Wall time:                    %.3f s\n",wall_time);
+	fprintf(f,"Worker utilization:           %.1f %%\n",wall_time>0 ? 100*total_busy_time/(wall_time*nr_of_workers) : 0.0);
+	fprintf(f,"Filter throughput per core:   %.0f samples/s\n",total_filter_time>0 ? total_samples/total_filter_time : 0.0);
+	fprintf(f,"End-to-end throughput:        %.0f samples/s (%.0f samples/s/core)\n",
+			wall_time>0 ? total_samples/wall_time : 0.0,wall_time>0 ? total_samples/wall_time/nr_of_workers : 0.0);
+}
+
+
+static void usage(const char *prog){
+	fprintf(stderr,"Usage: %s [-c sample] [-j workers] [-o output_directory] [-r repeats] [-s] [-u] session ...\n"
+				   "  session             Directory holding a " SESSION_DATA_FILE " file, or the file itself.\n"
+				   "  -c sample           Reset the filter at this sample and resume it from a checkpoint (not with -s).\n"
+				   "  -j workers          Number of worker threads (default: number of online cores).\n"
+				   "  -o output_directory Directory for the trajectories and summary.txt (default: replay_output).\n"
+				   "  -r repeats          Process every session this many times, for throughput measurements (default: 1).\n"
+				   "  -s                  Also write the trajectories smoothed with the RTS smoother.\n"
+				   "  -u                  Use the UD factorized covariance in the filter (not in the smoother).\n",prog);
+}
+
+int main(int argc, char **argv){
+	long cores=sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned nr_of_workers=cores>0 ? (unsigned)cores : 1;
+	unsigned repeats=1;
+	replay_job_t job;
+	int opt;
+
+	memset(&job,0,sizeof(job));
+	job.output_directory="replay_output";
+	replay_default_params(&job.params);
+
+	while((opt=getopt(argc,argv,"c:j:o:r:suh"))!=-1){
+		switch(opt){
+			case 'c':
+				job.resume_sample=(uint32_t)strtoul(optarg,NULL,10);
+				break;
+			case 'j':
+				nr_of_workers=(unsigned)atoi(optarg);
+				break;
+			case 'o':
+				job.output_directory=optarg;
+				break;
+			case 'r':
+				repeats=(unsigned)atoi(optarg);
+				break;
+			case 's':
+				job.smoother=1;
+				break;
+			case 'u':
+				job.covariance=REPLAY_COVARIANCE_UD;
+				break;
+			default:
+				usage(argv[0]);
+				return opt=='h' ? 0 : 1;
+		}
+	}
+	if(optind>=argc || nr_of_workers<1 || nr_of_workers>WORK_POOL_MAX_WORKERS || repeats<1){
+		usage(argv[0]);
+		return 1;
+	}
+	job.sessions=argv+optind;
+	job.nr_of_sessions=argc-optind;
+
+	if(mkdir(job.output_directory,0777)!=0 && errno!=EEXIST){
+		fprintf(stderr,"Could not create %s: %s\n",job.output_directory,strerror(errno));
+		return 1;
+	}
+
+	size_t nr_of_tasks=job.nr_of_sessions*repeats;
+	work_pool_stats_t *stats=calloc(nr_of_workers,sizeof(work_pool_stats_t));
+	job.results=calloc(nr_of_tasks,sizeof(replay_result_t));
+	if(!stats || !job.results){
+		fprintf(stderr,"Out of memory\n");
+		return 1;
+	}
+
+	double t0=work_pool_time();
+	if(work_pool_run(nr_of_workers,nr_of_tasks,replay_task,&job,stats)!=0)
+		fprintf(stderr,"Warning: not all worker threads could be started\n");
+	double wall_time=work_pool_time()-t0;
+
+	print_summary(stdout,&job,nr_of_tasks,nr_of_workers,stats,wall_time);
+
+	char file_name[4096];
+	snprintf(file_name,sizeof(file_name),"%s/summary.txt",job.output_directory);
+	FILE *f=fopen(file_name,"w");
+	if(f){
+		print_summary(f,&job,nr_of_tasks,nr_of_workers,stats,wall_time);
+		fclose(f);
+	}
+	else{
+		fprintf(stderr,"Could not write %s\n",file_name);
+	}
+
+	int ret=0;
+	for(size_t t=0; t<nr_of_tasks; t++)
+		if(job.results[t].error)
+			ret=1;
+	free(stats);
+	free(job.results);
+	return ret;
+}
+
+//@}
@@ -0,0 +1,101 @@
+/*! \file replay.c
+	\brief Running the ZUPT aided INS over a recorded session.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup replay
+//@{
+
+#include "replay.h"
+#include <math.h>
+#include <string.h>
+
+void replay_default_params(nav_params_t *params){
+	*params=nav_default_params;
+
+	// General settings
+	params->latitude=58;
+	params->altitude=100;
+	params->dt=1.0/250;
+
+	// Initial alignment, the Matlab implementation uses the 20 first samples.
+	params->nr_of_inital_alignment_samples=20;
+	params->initial_heading=0;
+	for(int i=0; i<3; i++){
+		params->initial_pos[i]=0;
+		params->sigma_initial_position[i]=1e-5;
+		params->sigma_initial_velocity[i]=1e-5;
+		params->sigma_initial_attitude[i]=0.1*M_PI/180;
+	}
+
+	// Filter settings
+	params->sigma_acceleration=0.5;
+	params->sigma_gyroscope=0.5*M_PI/180;
+	for(int i=0; i<3; i++)
+		params->sigma_velocity[i]=0.01;
+
+	// Detector settings
+	params->sigma_acc_det=0.01;
+	params->sigma_gyro_det=0.1*M_PI/180;
+	params->detector_Window_size=3;
+	params->detector_threshold=0.3e5;
+
+	// Thresholds of the alternative detectors, chosen to agree with the GLRT decisions on the recorded sessions.
+	params->detector_threshold_MV=200;
+	params->detector_threshold_MAG=2500;
+	params->detector_threshold_ARE=0.3e5;
+}
+
+uint32_t replay_run(trajectory_point_t *trajectory, nav_filter_t *filter, const nav_params_t *params,
+					replay_covariance_t covariance, const session_data_t *data, uint32_t resume_sample){
+	uint32_t nr_of_points=0;
+
+	nav_filter_init(filter);
+	filter->params=*params;
+
+	const float *const *ch=data->channels;
+
+	for(uint32_t k=0; k<data->nr_of_samples; k++){
+		const vec3 acc={ch[IMU_REC_ACC_X][k],ch[IMU_REC_ACC_Y][k],ch[IMU_REC_ACC_Z][k]};
+		const vec3 gyro={ch[IMU_REC_GYRO_X][k],ch[IMU_REC_GYRO_Y][k],ch[IMU_REC_GYRO_Z][k]};
+
+		if(k==resume_sample && k>0 && !filter->initialize_flag){
+			nav_checkpoint_t checkpoint;
+			nav_save_checkpoint(filter,&checkpoint);
+			nav_filter_init(filter);
+			filter->params=*params;
+			nav_resume_from_checkpoint(filter,&checkpoint);
+		}
+		nav_update_imu_data_buffers(filter,acc,gyro);
+		if(filter->initialize_flag){
+			nav_initialize_navigation_algorithm(filter,acc);
+			continue;
+		}
+		nav_strapdown_mechanisation_equations(filter);
+		if(covariance==REPLAY_COVARIANCE_UD){
+			nav_time_up_data_UD(filter);
+			nav_ZUPT_detector(filter);
+			nav_zupt_update_UD(filter);
+		}
+		else{
+			nav_time_up_data(filter);
+			nav_ZUPT_detector(filter);
+			nav_zupt_update(filter);
+		}
+
+		if(trajectory){
+			trajectory_point_t *tp=&trajectory[nr_of_points];
+			tp->sample=k;
+			memcpy(tp->position,filter->position,sizeof(vec3));
+			memcpy(tp->velocity,filter->velocity,sizeof(vec3));
+			memcpy(tp->quaternions,filter->quaternions,sizeof(quat_vec));
+			tp->zupt=filter->zupt;
+		}
+		nr_of_points++;
+	}
+	return nr_of_points;
+}
+
+//@}
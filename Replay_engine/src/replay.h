@@ -0,0 +1,57 @@
+/*! \file replay.h
+	\brief Header file for running the ZUPT aided INS over a recorded session.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup replay
+//@{
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "nav_eq.h"
+#include "session.h"
+
+/// Representation of the Kalman filter covariance used by replay_run().
+typedef enum {
+	/// Covariance matrix, time_up_data() and zupt_update().
+	REPLAY_COVARIANCE_MATRIX,
+	/// UD factorized covariance, time_up_data_UD() and zupt_update_UD().
+	REPLAY_COVARIANCE_UD
+} replay_covariance_t;
+
+/*! \brief Sets \a params to the settings used for the recorded sessions.
+
+	\details The values are taken from OpenShoe_Matlab_Implementation/settings.m (250 Hz sampling, latitude 58
+	degrees, altitude 100 m, and the detector and filter tuning used for the Microstrain IMU), such that the
+	trajectories can be compared with the Matlab implementation.
+*/
+void replay_default_params(nav_params_t *params);
+
+/*! \brief Runs the ZUPT aided INS over the IMU data of a session.
+
+	\details The filter is reset with the parameters \a params and then processed in the same order as the process
+	sequence of the runtime framework: initial alignment until the \a initialize_flag is cleared, then IMU data
+	buffer update, mechanization, time update, zero-velocity detection and zero-velocity update for every sample.
+
+	If \a resume_sample is non-zero, a checkpoint is taken before that sample and the filter is reset and resumed
+	from it, as the runtime framework does after a reset of the system (command RESUME_ZUPT_AIDED_INS). The IMU data
+	buffers are cleared by the reset as well.
+
+	 @param[out] trajectory	Array of at least \a data->nr_of_samples points receiving the navigation solution after
+							each processed sample, or NULL if the trajectory is not needed.
+	 @param[in]	 filter		Filter context used for the processing.
+	 @param[in]	 params		Parameters of the filter.
+	 @param[in]	 covariance	Representation of the covariance.
+	 @param[in]	 data		IMU data of the session.
+	 @param[in]	 resume_sample	Sample at which the filter is resumed from a checkpoint, 0 for none.
+	 \return The number of trajectory points, i.e., the number of samples processed after the initial alignment.
+*/
+uint32_t replay_run(trajectory_point_t *trajectory, nav_filter_t *filter, const nav_params_t *params,
+					replay_covariance_t covariance, const session_data_t *data, uint32_t resume_sample);
+
+#endif /* REPLAY_H_ */
+
+//@}
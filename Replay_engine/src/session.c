@@ -0,0 +1,264 @@
+/*! \file session.c
+	\brief Reading of recorded sessions and writing of trajectories in the replay engine.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup replay
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/// Reads a whole file into a zero terminated buffer.
+static char* read_file(const char *file_name, size_t *size){
+	FILE *f=fopen(file_name,"rb");
+	char *buf=NULL;
+	long len;
+
+	if(!f)
+		return NULL;
+	if(fseek(f,0,SEEK_END)==0 && (len=ftell(f))>=0 && fseek(f,0,SEEK_SET)==0){
+		buf=malloc(len+1);
+		if(buf && fread(buf,1,len,f)!=(size_t)len){
+			free(buf);
+			buf=NULL;
+		}
+		if(buf){
+			buf[len]='\0';
+			*size=len;
+		}
+	}
+	fclose(f);
+	return buf;
+}
+
+/// Returns non-zero if \a path is an existing directory.
+static int is_directory(const char *path){
+	struct stat st;
+	return stat(path,&st)==0 && S_ISDIR(st.st_mode);
+}
+
+/// Returns non-zero if \a path is an existing file.
+static int is_file(const char *path){
+	struct stat st;
+	return stat(path,&st)==0 && S_ISREG(st.st_mode);
+}
+
+int session_load_text(session_data_t *data, const char *file_name){
+	size_t size=0;
+	char *buf;
+	char *line;
+	char *next;
+	uint32_t capacity;
+	float *channels[IMU_REC_MAX_CHANNELS];
+	int has_magnetometer=1;
+
+	memset(data,0,sizeof(session_data_t));
+	buf=read_file(file_name,&size);
+	if(!buf){
+		fprintf(stderr,"Could not read %s\n",file_name);
+		return -1;
+	}
+
+	// Upper bound of the number of samples is the number of lines.
+	capacity=1;
+	for(size_t i=0; i<size; i++)
+		if(buf[i]=='\n')
+			capacity++;
+	data->buffer=malloc((size_t)capacity*IMU_REC_MAX_CHANNELS*sizeof(float));
+	if(!data->buffer){
+		fprintf(stderr,"Out of memory reading %s\n",file_name);
+		free(buf);
+		return -1;
+	}
+	for(int ch=0; ch<IMU_REC_MAX_CHANNELS; ch++)
+		channels[ch]=data->buffer+(size_t)ch*capacity;
+
+	// Data lines start with the hexadecimal IMU header byte (e.g. 0xcb), everything else is header text.
+	for(line=buf; line && *line; line=next){
+		next=strchr(line,'\n');
+		if(next)
+			*next++='\0';
+
+		char *p=line;
+		while(*p==' ' || *p=='\t')
+			p++;
+		if(p[0]!='0' || (p[1]!='x' && p[1]!='X'))
+			continue;
+
+		// Skip the header byte and parse the remaining 16 columns (the checksum is parsed as a hexadecimal float).
+		strtoul(p,&p,16);
+		double values[16];
+		int k;
+		for(k=0; k<16; k++){
+			char *end;
+			values[k]=strtod(p,&end);
+			if(end==p)
+				break;
+			p=end;
+		}
+		if(k<6)
+			continue;
+		if(k<16)
+			has_magnetometer=0;
+
+		uint32_t n=data->nr_of_samples;
+		channels[IMU_REC_ACC_X][n]=values[0]*SESSION_ACC_SCALE;
+		channels[IMU_REC_ACC_Y][n]=values[1]*SESSION_ACC_SCALE;
+		channels[IMU_REC_ACC_Z][n]=values[2]*SESSION_ACC_SCALE;
+		channels[IMU_REC_GYRO_X][n]=values[3];
+		channels[IMU_REC_GYRO_Y][n]=values[4];
+		channels[IMU_REC_GYRO_Z][n]=values[5];
+		if(has_magnetometer){
+			channels[IMU_REC_MAG_X][n]=values[13];
+			channels[IMU_REC_MAG_Y][n]=values[14];
+			channels[IMU_REC_MAG_Z][n]=values[15];
+		}
+		if(n==0 && k==16){
+			data->start_time=values[9];
+			data->sample_rate=values[12];
+		}
+		data->nr_of_samples++;
+	}
+	free(buf);
+
+	if(data->nr_of_samples==0){
+		fprintf(stderr,"No IMU data in %s\n",file_name);
+		session_free(data);
+		return -1;
+	}
+	data->nr_of_channels=has_magnetometer ? IMU_REC_MAX_CHANNELS : IMU_REC_IMU_CHANNELS;
+	for(int ch=0; ch<data->nr_of_channels; ch++)
+		data->channels[ch]=channels[ch];
+	return 0;
+}
+
+/// Reads the IMU data of a session from a binary recording. The samples are used in place if possible.
+static int session_load_binary(session_data_t *data, const char *file_name){
+	imu_rec_reader_t *r=&data->recording;
+	int in_place=1;
+
+	memset(data,0,sizeof(session_data_t));
+	if(imu_rec_open(r,file_name)!=0)
+		return -1;
+	if(r->header.nr_of_samples==0){
+		fprintf(stderr,"No IMU data in %s\n",file_name);
+		session_free(data);
+		return -1;
+	}
+	data->nr_of_samples=r->header.nr_of_samples;
+	data->nr_of_channels=r->header.nr_of_channels;
+	data->sample_rate=r->header.sample_rate;
+	data->start_time=r->header.start_time;
+
+	for(int ch=0; ch<data->nr_of_channels; ch++)
+		if(!imu_rec_channel(r,ch))
+			in_place=0;
+	if(in_place){
+		for(int ch=0; ch<data->nr_of_channels; ch++)
+			data->channels[ch]=imu_rec_channel(r,ch);
+		return 0;
+	}
+
+	// int16 or multi-chunk recording, decode the samples.
+	data->buffer=malloc((size_t)data->nr_of_samples*data->nr_of_channels*sizeof(float));
+	if(!data->buffer){
+		fprintf(stderr,"Out of memory reading %s\n",file_name);
+		session_free(data);
+		return -1;
+	}
+	for(int ch=0; ch<data->nr_of_channels; ch++){
+		float *dst=data->buffer+(size_t)ch*data->nr_of_samples;
+		imu_rec_read_channel(r,ch,dst);
+		data->channels[ch]=dst;
+	}
+	return 0;
+}
+
+int session_load(session_data_t *data, const char *path){
+	char file_name[4096];
+
+	if(is_directory(path)){
+		snprintf(file_name,sizeof(file_name),"%s/%s",path,SESSION_BINARY_FILE);
+		if(!is_file(file_name))
+			snprintf(file_name,sizeof(file_name),"%s/%s",path,SESSION_DATA_FILE);
+	}
+	else{
+		snprintf(file_name,sizeof(file_name),"%s",path);
+	}
+
+	if(imu_rec_is_recording(file_name))
+		return session_load_binary(data,file_name);
+	return session_load_text(data,file_name);
+}
+
+void session_free(session_data_t *data){
+	free(data->buffer);
+	imu_rec_close(&data->recording);
+	memset(data,0,sizeof(session_data_t));
+}
+
+void session_print_trajectory_point(FILE *f, const trajectory_point_t *tp){
+	fprintf(f,"%u %.6f %.6f %.6f %.6f %.6f %.6f %.7f %.7f %.7f %.7f %u",tp->sample,
+			tp->position[0],tp->position[1],tp->position[2],
+			tp->velocity[0],tp->velocity[1],tp->velocity[2],
+			tp->quaternions[0],tp->quaternions[1],tp->quaternions[2],tp->quaternions[3],
+			tp->zupt);
+}
+
+int session_write_trajectory(const char *file_name, const trajectory_point_t *trajectory, uint32_t nr_of_points){
+	FILE *f=fopen(file_name,"w");
+	if(!f){
+		fprintf(stderr,"Could not open %s for writing\n",file_name);
+		return -1;
+	}
+	for(uint32_t i=0; i<nr_of_points; i++){
+		session_print_trajectory_point(f,&trajectory[i]);
+		fputc('\n',f);
+	}
+	if(fclose(f)!=0){
+		fprintf(stderr,"Could not write %s\n",file_name);
+		return -1;
+	}
+	return 0;
+}
+
+void session_name(char *name, size_t size, const char *path){
+	char tmp[4096];
+	char *p;
+	char *base;
+
+	snprintf(tmp,sizeof(tmp),"%s",path);
+	// Strip trailing slashes.
+	for(p=tmp+strlen(tmp); p>tmp && (p[-1]=='/' || p[-1]=='\\'); )
+		*--p='\0';
+	p=strrchr(tmp,'/');
+	base=p ? p+1 : tmp;
+
+	if(is_file(tmp)){
+		// The standard data files are named after the session directory, other files after the file itself.
+		if(strcmp(base,SESSION_DATA_FILE)==0 || strcmp(base,SESSION_BINARY_FILE)==0){
+			if(p && p>tmp){
+				*p='\0';
+				p=strrchr(tmp,'/');
+				base=p ? p+1 : tmp;
+			}
+			else{
+				base=".";
+			}
+		}
+		else if((p=strrchr(base,'.'))!=NULL && p>base){
+			*p='\0';
+		}
+	}
+	snprintf(name,size,"%s",base);
+}
+
+//@}
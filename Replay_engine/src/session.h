@@ -0,0 +1,109 @@
+/*! \file session.h
+	\brief Header file for reading recorded sessions and writing trajectories in the replay engine.
+
+	\details A session is a recording from the foot-mounted IMU as logged by the Matlab control scripts, i.e., a
+	directory holding a \a data_inert.txt file (see OpenShoe_Matlab_Implementation/Measurement_*). The file has a
+	text header followed by one line per IMU sample with 17 columns, of which columns 2-4 hold the specific force
+	[g], columns 5-7 the angular rates [rad/s], column 11 the time stamp [s], column 14 the sample rate [Hz] and
+	columns 15-17 the magnetic field [G].
+
+	If the session directory also holds a binary recording \a data_inert.bin (see imu_recording.h), that file is
+	memory mapped instead and no parsing is needed.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/**
+	\defgroup replay Replay engine
+	\brief Host tool for reprocessing recorded sessions with the C implementation of the ZUPT aided INS.
+	@{
+*/
+
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "nav_types.h"
+#include "imu_recording.h"
+
+/// Name of the text IMU data file of a session directory.
+#define SESSION_DATA_FILE "data_inert.txt"
+
+/// Name of the binary IMU data file of a session directory.
+#define SESSION_BINARY_FILE "data_inert.bin"
+
+/// Scale factor from [g] to [\f$m/s^2\f$] used for the logged accelerometer data (Microstrain IMU data sheet).
+#define SESSION_ACC_SCALE 9.80665
+
+/// IMU data of one session, stored channel by channel in the order of the binary recording format.
+typedef struct {
+	/// Number of IMU samples.
+	uint32_t nr_of_samples;
+	/// Number of channels, IMU_REC_IMU_CHANNELS or IMU_REC_MAX_CHANNELS if magnetometer data is available.
+	uint8_t nr_of_channels;
+	/// Sample rate [Hz], or 0 if unknown.
+	float sample_rate;
+	/// Time of the first sample [s].
+	double start_time;
+	/// Samples of the channels (IMU_REC_ACC_X etc.) in SI units. Channels not available are NULL.
+	const float *channels[IMU_REC_MAX_CHANNELS];
+	///\cond
+	// Memory owned by the session, either the decoded samples or the mapped recording.
+	float *buffer;
+	imu_rec_reader_t recording;
+	///\endcond
+} session_data_t;
+
+/// Navigation solution at one sample instant.
+typedef struct {
+	/// Index of the IMU sample.
+	uint32_t sample;
+	vec3 position;
+	vec3 velocity;
+	quat_vec quaternions;
+	uint8_t zupt;
+} trajectory_point_t;
+
+/*! \brief Reads the IMU data of a session.
+
+	 @param[out] data	The IMU data. Must be released with session_free().
+	 @param[in]	 path	Session directory, or path to a text or binary data file.
+	 \return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int session_load(session_data_t *data, const char *path);
+
+/// Releases the memory held by \a data.
+void session_free(session_data_t *data);
+
+/*! \brief Reads the IMU data of a session from a text file (data_inert.txt format).
+
+	\return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int session_load_text(session_data_t *data, const char *file_name);
+
+/*! \brief Writes a trajectory to a text file with one line per point.
+
+	\details The columns are: sample index, position (N,E,D) [m], velocity (N,E,D) [m/s], quaternions and the
+	zero-velocity flag. The file can be read into Matlab with \a load.
+
+	\return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int session_write_trajectory(const char *file_name, const trajectory_point_t *trajectory, uint32_t nr_of_points);
+
+/// Prints the columns of session_write_trajectory() for one point, without the line break.
+void session_print_trajectory_point(FILE *f, const trajectory_point_t *point);
+
+/*! \brief Returns the name of a session, i.e., the last component of the session directory.
+
+	 @param[out] name	Buffer for the name.
+	 @param[in]	 size	Size of \a name.
+	 @param[in]	 path	Session directory, or path to a data file.
+*/
+void session_name(char *name, size_t size, const char *path);
+
+#endif /* SESSION_H_ */
+
+//@}
@@ -0,0 +1,442 @@
+/*! \file smoother.c
+	\brief The fixed-interval Rauch-Tung-Striebel smoother of the replay engine.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup smoother
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nav_kernels.h"
+#include "smoother.h"
+
+#define N SMOOTHER_NR_OF_STATES
+
+/// Dense 9 by 9 matrix used in the backward recursion.
+typedef double mat9[N][N];
+
+
+//******************* STORE ******************************//
+
+/// Writes or reads \a size bytes at \a offset, retrying on partial transfers. Returns zero on success.
+static int store_io(smoother_store_t *store, void *buf, size_t size, uint64_t offset, int write){
+	char *p=buf;
+	while(size>0){
+		ssize_t n=write ? pwrite(store->fd,p,size,(off_t)offset) : pread(store->fd,p,size,(off_t)offset);
+		if(n<0 && errno==EINTR)
+			continue;
+		if(n<=0){
+			fprintf(stderr,"Could not %s %s: %s\n",write ? "write" : "read",store->path,n<0 ? strerror(errno) : "end of file");
+			return -1;
+		}
+		p+=n;
+		size-=n;
+		offset+=n;
+	}
+	return 0;
+}
+
+/// Reads or writes \a n records starting with record \a first from or to the block.
+static int store_block_io(smoother_store_t *store, uint64_t first, uint32_t n, int write){
+	return store_io(store,store->block,n*sizeof(smoother_record_t),first*sizeof(smoother_record_t),write);
+}
+
+/// Writes the records of the block that have not been written yet.
+static int store_flush(smoother_store_t *store){
+	if(store->fill==0)
+		return 0;
+	if(store_block_io(store,store->nr_of_records-store->fill,store->fill,1)!=0)
+		return -1;
+	store->fill=0;
+	return 0;
+}
+
+int smoother_store_open(smoother_store_t *store, const char *path, uint32_t block_size){
+	memset(store,0,sizeof(smoother_store_t));
+	store->block_size=block_size ? block_size : SMOOTHER_DEFAULT_BLOCK_SIZE;
+	snprintf(store->path,sizeof(store->path),"%s",path);
+
+	store->fd=open(path,O_RDWR|O_CREAT|O_TRUNC,0666);
+	if(store->fd<0){
+		fprintf(stderr,"Could not create %s: %s\n",path,strerror(errno));
+		return -1;
+	}
+	store->block=malloc(store->block_size*sizeof(smoother_record_t));
+	if(!store->block){
+		fprintf(stderr,"Out of memory\n");
+		smoother_store_close(store);
+		return -1;
+	}
+	return 0;
+}
+
+void smoother_store_close(smoother_store_t *store){
+	if(store->fd>=0){
+		close(store->fd);
+		unlink(store->path);
+	}
+	free(store->block);
+	store->fd=-1;
+	store->block=NULL;
+}
+
+
+//******************* FORWARD PASS ******************************//
+
+int smoother_forward(smoother_store_t *store, nav_filter_t *filter, const nav_params_t *params, const session_data_t *data){
+	const float *const *ch=data->channels;
+
+	nav_filter_init(filter);
+	filter->params=*params;
+
+	for(uint32_t k=0; k<data->nr_of_samples; k++){
+		const vec3 acc={ch[IMU_REC_ACC_X][k],ch[IMU_REC_ACC_Y][k],ch[IMU_REC_ACC_Z][k]};
+		const vec3 gyro={ch[IMU_REC_GYRO_X][k],ch[IMU_REC_GYRO_Y][k],ch[IMU_REC_GYRO_Z][k]};
+		smoother_record_t *r;
+		vec3 velocity;
+
+		nav_update_imu_data_buffers(filter,acc,gyro);
+		if(filter->initialize_flag){
+			nav_initialize_navigation_algorithm(filter,acc);
+			continue;
+		}
+
+		if(store->fill==store->block_size && store_flush(store)!=0)
+			return -1;
+		r=&store->block[store->fill++];
+		store->nr_of_records++;
+		memset(r,0,sizeof(smoother_record_t));
+		r->sample=k;
+
+		nav_strapdown_mechanisation_equations(filter);
+		mat3_vec3_mul(r->s,filter->Rb2t,filter->accelerations_out);
+		nav_time_up_data(filter);
+		memcpy(r->cov_prior,filter->cov_vector,sizeof(mat9sym));
+		nav_ZUPT_detector(filter);
+
+		// The error state fed back by the measurement update is the Kalman gain times the velocity.
+		memcpy(velocity,filter->velocity,sizeof(vec3));
+		nav_zupt_update(filter);
+		if(filter->zupt){
+			r->zupt=1;
+			for(int i=0; i<N; i++)
+				r->correction[i]=filter->kalman_gain[3*i]*velocity[0]+filter->kalman_gain[3*i+1]*velocity[1]+filter->kalman_gain[3*i+2]*velocity[2];
+		}
+
+		memcpy(r->position,filter->position,sizeof(vec3));
+		memcpy(r->velocity,filter->velocity,sizeof(vec3));
+		memcpy(r->quaternions,filter->quaternions,sizeof(quat_vec));
+		memcpy(r->cov_posterior,filter->cov_vector,sizeof(mat9sym));
+	}
+	return store_flush(store);
+}
+
+
+//******************* BACKWARD PASS ******************************//
+
+/// Unpacks the vector representation of a covariance matrix.
+static void unpack_cov(mat9 p, const mat9sym cov_vector){
+	int ctr=0;
+	for(int i=0; i<N; i++)
+		for(int j=i; j<N; j++)
+			p[i][j]=p[j][i]=cov_vector[ctr++];
+}
+
+/*! \brief State transition matrix of the error states used in nav_time_up_data().
+
+	\f[ F = \begin{bmatrix} I & dt\,I & 0 \\ 0 & I & dt\,[s]_\times \\ 0 & 0 & I \end{bmatrix} \f]
+ */
+static void transition_matrix(mat9 f, const vec3 s, double dt){
+	memset(f,0,sizeof(mat9));
+	for(int i=0; i<N; i++)
+		f[i][i]=1;
+	for(int i=0; i<3; i++)
+		f[i][3+i]=dt;
+	f[3][7]=-dt*s[2];	f[3][8]=dt*s[1];
+	f[4][6]=dt*s[2];	f[4][8]=-dt*s[0];
+	f[5][6]=-dt*s[1];	f[5][7]=dt*s[0];
+}
+
+/// Cholesky factorization \f$P=LL^T\f$ in place (lower triangle). Returns zero if \a p is positive definite.
+static int cholesky(mat9 p){
+	for(int j=0; j<N; j++){
+		double d=p[j][j];
+		for(int k=0; k<j; k++)
+			d-=p[j][k]*p[j][k];
+		if(!(d>0))
+			return -1;
+		p[j][j]=sqrt(d);
+		for(int i=j+1; i<N; i++){
+			double v=p[i][j];
+			for(int k=0; k<j; k++)
+				v-=p[i][k]*p[j][k];
+			p[i][j]=v/p[j][j];
+		}
+	}
+	return 0;
+}
+
+/// Solves \f$LL^T X=B\f$ for the columns of \a b in place.
+static void cholesky_solve(const mat9 l, mat9 b){
+	for(int c=0; c<N; c++){
+		for(int i=0; i<N; i++){
+			double v=b[i][c];
+			for(int k=0; k<i; k++)
+				v-=l[i][k]*b[k][c];
+			b[i][c]=v/l[i][i];
+		}
+		for(int i=N-1; i>=0; i--){
+			double v=b[i][c];
+			for(int k=i+1; k<N; k++)
+				v-=l[k][i]*b[k][c];
+			b[i][c]=v/l[i][i];
+		}
+	}
+}
+
+/// Rotation matrix of the quaternions, see quat2rotation() in nav_eq.c.
+static void quat_to_rotation(double r[3][3], const quat_vec q){
+	double x=q[0], y=q[1], z=q[2], w=q[3];
+	double n=x*x+y*y+z*z+w*w;
+	double s=n>0 ? 2/n : 0;
+
+	r[0][0]=1-s*(y*y+z*z);	r[0][1]=s*(x*y-z*w);	r[0][2]=s*(x*z+y*w);
+	r[1][0]=s*(x*y+z*w);	r[1][1]=1-s*(x*x+z*z);	r[1][2]=s*(y*z-x*w);
+	r[2][0]=s*(x*z-y*w);	r[2][1]=s*(y*z+x*w);	r[2][2]=1-s*(x*x+y*y);
+}
+
+/// Normalized quaternions of a rotation matrix, see rotation2quat() in nav_eq.c.
+static void rotation_to_quat(quat_vec q, double r[3][3]){
+	double t=1+r[0][0]+r[1][1]+r[2][2];
+	double v[4];
+
+	if(t>0.00000001){
+		double s=0.5/sqrt(t);
+		v[3]=0.25/s;
+		v[0]=(r[2][1]-r[1][2])*s;
+		v[1]=(r[0][2]-r[2][0])*s;
+		v[2]=(r[1][0]-r[0][1])*s;
+	}
+	else if(r[0][0]>r[1][1] && r[0][0]>r[2][2]){
+		double s=sqrt(1+r[0][0]-r[1][1]-r[2][2])*2;
+		v[3]=(r[2][1]-r[1][2])/s;
+		v[0]=0.25*s;
+		v[1]=(r[0][1]+r[1][0])/s;
+		v[2]=(r[0][2]+r[2][0])/s;
+	}
+	else if(r[1][1]>r[2][2]){
+		double s=sqrt(1+r[1][1]-r[0][0]-r[2][2])*2;
+		v[3]=(r[0][2]-r[2][0])/s;
+		v[0]=(r[0][1]+r[1][0])/s;
+		v[1]=0.25*s;
+		v[2]=(r[1][2]+r[2][1])/s;
+	}
+	else{
+		double s=sqrt(1+r[2][2]-r[0][0]-r[1][1])*2;
+		v[3]=(r[1][0]-r[0][1])/s;
+		v[0]=(r[0][2]+r[2][0])/s;
+		v[1]=(r[1][2]+r[2][1])/s;
+		v[2]=0.25*s;
+	}
+
+	double n=sqrt(v[0]*v[0]+v[1]*v[1]+v[2]*v[2]+v[3]*v[3]);
+	for(int i=0; i<4; i++)
+		q[i]=v[i]/n;
+}
+
+/// Corrects the forward states of a record with the smoothed error state, see nav_correct_navigation_states().
+static void correct_states(smoother_record_t *r, const double dx[N], const mat9 p){
+	double rot[3][3], new_rot[3][3];
+	const double roll=dx[6], pitch=dx[7], yaw=dx[8];
+
+	for(int i=0; i<3; i++){
+		r->smoothed_position[i]=r->position[i]-dx[i];
+		r->smoothed_velocity[i]=r->velocity[i]-dx[3+i];
+		r->smoothed_position_sigma[i]=sqrt(fmax(p[i][i],0));
+	}
+
+	quat_to_rotation(rot,r->quaternions);
+	for(int j=0; j<3; j++){
+		new_rot[0][j]=rot[0][j]-yaw*rot[1][j]+pitch*rot[2][j];
+		new_rot[1][j]=yaw*rot[0][j]+rot[1][j]-roll*rot[2][j];
+		new_rot[2][j]=-pitch*rot[0][j]+roll*rot[1][j]+rot[2][j];
+	}
+	rotation_to_quat(r->smoothed_quaternions,new_rot);
+}
+
+int smoother_backward(smoother_store_t *store, const nav_params_t *params){
+	const double dt=params->dt;
+	smoother_record_t next;		// Record k+1
+	double dx[N]={0};			// Smoothed error state of record k+1
+	mat9 p_smoothed;			// Smoothed covariance of record k+1
+	mat9 p, p_prior, f, fp, a, tmp;
+
+	if(store->nr_of_records==0)
+		return 0;
+	if(store_flush(store)!=0)
+		return -1;
+	store->nr_of_restarts=0;
+
+	for(uint64_t end=store->nr_of_records; end>0; ){
+		uint32_t n=end>store->block_size ? store->block_size : (uint32_t)end;
+		uint64_t first=end-n;
+
+		if(store_block_io(store,first,n,0)!=0)
+			return -1;
+
+		for(int64_t i=n-1; i>=0; i--){
+			smoother_record_t *r=&store->block[i];
+
+			unpack_cov(p,r->cov_posterior);
+			if(first+i==store->nr_of_records-1){
+				// The last smoothed state is the filtered one.
+				memcpy(p_smoothed,p,sizeof(mat9));
+				correct_states(r,dx,p_smoothed);
+				next=*r;
+				continue;
+			}
+
+			// A = P(k|k) F(k+1)' P(k+1|k)^-1, i.e., A' = P(k+1|k)^-1 F(k+1) P(k|k)
+			unpack_cov(p_prior,next.cov_prior);
+			transition_matrix(f,next.s,dt);
+			for(int r1=0; r1<N; r1++)
+				for(int c=0; c<N; c++){
+					double v=0;
+					for(int k=0; k<N; k++)
+						v+=f[r1][k]*p[k][c];
+					fp[r1][c]=v;
+				}
+			memcpy(tmp,p_prior,sizeof(mat9));
+			if(cholesky(tmp)!=0){
+				// Restart the recursion from the filtered estimate.
+				store->nr_of_restarts++;
+				memset(dx,0,sizeof(dx));
+				memcpy(p_smoothed,p,sizeof(mat9));
+				correct_states(r,dx,p_smoothed);
+				next=*r;
+				continue;
+			}
+			cholesky_solve(tmp,fp);
+			for(int r1=0; r1<N; r1++)
+				for(int c=0; c<N; c++)
+					a[r1][c]=fp[c][r1];
+
+			// dx(k|N) = A (dx(k+1|N) + correction(k+1))
+			double d[N], dx_new[N];
+			for(int k=0; k<N; k++)
+				d[k]=dx[k]+next.correction[k];
+			for(int r1=0; r1<N; r1++){
+				double v=0;
+				for(int k=0; k<N; k++)
+					v+=a[r1][k]*d[k];
+				dx_new[r1]=v;
+			}
+			memcpy(dx,dx_new,sizeof(dx));
+
+			// P(k|N) = P(k|k) + A (P(k+1|N) - P(k+1|k)) A'
+			for(int r1=0; r1<N; r1++)
+				for(int c=0; c<N; c++)
+					p_smoothed[r1][c]-=p_prior[r1][c];
+			for(int r1=0; r1<N; r1++)
+				for(int c=0; c<N; c++){
+					double v=0;
+					for(int k=0; k<N; k++)
+						v+=a[r1][k]*p_smoothed[k][c];
+					tmp[r1][c]=v;
+				}
+			for(int r1=0; r1<N; r1++)
+				for(int c=r1; c<N; c++){
+					double v=0;
+					for(int k=0; k<N; k++)
+						v+=tmp[r1][k]*a[c][k];
+					p_smoothed[r1][c]=p_smoothed[c][r1]=p[r1][c]+v;
+				}
+
+			correct_states(r,dx,p_smoothed);
+			next=*r;
+		}
+
+		if(store_block_io(store,first,n,1)!=0)
+			return -1;
+		end=first;
+	}
+	return 0;
+}
+
+
+//******************* OUTPUT ******************************//
+
+/// Opens an output file, or returns NULL without a message if \a file_name is NULL.
+static FILE *open_output(const char *file_name, int *error){
+	FILE *f;
+	if(!file_name)
+		return NULL;
+	f=fopen(file_name,"w");
+	if(!f){
+		fprintf(stderr,"Could not open %s for writing\n",file_name);
+		*error=1;
+	}
+	return f;
+}
+
+/// Closes an output file opened with open_output().
+static void close_output(FILE *f, const char *file_name, int *error){
+	if(f && fclose(f)!=0){
+		fprintf(stderr,"Could not write %s\n",file_name);
+		*error=1;
+	}
+}
+
+int smoother_write_trajectories(smoother_store_t *store, const char *forward_file, const char *smoothed_file){
+	int error=0;
+	FILE *forward=open_output(forward_file,&error);
+	FILE *smoothed=open_output(smoothed_file,&error);
+
+	for(uint64_t first=0; first<store->nr_of_records && !error; first+=store->block_size){
+		uint64_t left=store->nr_of_records-first;
+		uint32_t n=left>store->block_size ? store->block_size : (uint32_t)left;
+
+		if(store_block_io(store,first,n,0)!=0){
+			error=1;
+			break;
+		}
+		for(uint32_t i=0; i<n; i++){
+			const smoother_record_t *r=&store->block[i];
+			trajectory_point_t tp;
+
+			tp.sample=r->sample;
+			tp.zupt=r->zupt;
+			if(forward){
+				memcpy(tp.position,r->position,sizeof(vec3));
+				memcpy(tp.velocity,r->velocity,sizeof(vec3));
+				memcpy(tp.quaternions,r->quaternions,sizeof(quat_vec));
+				session_print_trajectory_point(forward,&tp);
+				fputc('\n',forward);
+			}
+			if(smoothed){
+				memcpy(tp.position,r->smoothed_position,sizeof(vec3));
+				memcpy(tp.velocity,r->smoothed_velocity,sizeof(vec3));
+				memcpy(tp.quaternions,r->smoothed_quaternions,sizeof(quat_vec));
+				session_print_trajectory_point(smoothed,&tp);
+				fprintf(smoothed," %.6f %.6f %.6f\n",r->smoothed_position_sigma[0],r->smoothed_position_sigma[1],r->smoothed_position_sigma[2]);
+			}
+		}
+	}
+
+	close_output(forward,forward_file,&error);
+	close_output(smoothed,smoothed_file,&error);
+	return error ? -1 : 0;
+}
+
+//@}
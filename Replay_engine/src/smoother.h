@@ -0,0 +1,139 @@
+/*! \file smoother.h
+	\brief Header file for the fixed-interval Rauch-Tung-Striebel smoother of the replay engine.
+
+	\details The smoother post-processes a recorded session in two passes. The forward pass runs the ZUPT aided INS
+	of nav_eq.c and streams, for every sample after the initial alignment, the navigation states, the a-priori and
+	a-posteriori covariances, the specific force defining the state transition of the time update and the error
+	state fed back by the measurement update to a disk-backed store. The backward pass reads the store from the end
+	in blocks and runs the Rauch-Tung-Striebel recursion for the error states of the complementary (feedback)
+	filter,
+
+	\f[ A_k = P_{k|k} F_{k+1}^T P_{k+1|k}^{-1}, \quad
+		\delta x_{k|N} = A_k (\delta x_{k+1|N} + \delta \hat x_{k+1}), \quad
+		P_{k|N} = P_{k|k} + A_k (P_{k+1|N} - P_{k+1|k}) A_k^T, \f]
+
+	where \f$\delta \hat x_{k+1}\f$ is the error state that the forward filter fed back at sample \f$k+1\f$ (zero
+	if there was no ZUPT) and \f$\delta x_{N|N}=0\f$. The smoothed navigation states are the forward states corrected
+	with \f$\delta x_{k|N}\f$ in the same way as in nav_correct_navigation_states(). The smoothed states are written
+	back into the store, which is then streamed to the trajectory files.
+
+	Only one block of records is held in memory at a time, so the memory used is independent of the length of the
+	recording; the store needs about 0.5 kB of disk per sample.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/**
+	\defgroup smoother RTS smoother
+	\brief Offline fixed-interval smoothing of recorded sessions.
+	\ingroup replay
+	@{
+*/
+
+#ifndef SMOOTHER_H_
+#define SMOOTHER_H_
+
+#include <stdint.h>
+
+#include "nav_eq.h"
+#include "session.h"
+
+/// Default number of records per block of the store.
+#define SMOOTHER_DEFAULT_BLOCK_SIZE 4096
+
+/// Number of error states of the filter (position, velocity and attitude).
+#define SMOOTHER_NR_OF_STATES 9
+
+/// Record of the store, one per sample after the initial alignment.
+typedef struct {
+	/// Index of the IMU sample.
+	uint32_t sample;
+	/// Non-zero if the zero-velocity detector fired at the sample.
+	uint32_t zupt;
+	///\name Forward pass
+	//@{
+	/// Navigation states of the forward filter after the measurement update.
+	vec3 position;
+	vec3 velocity;
+	quat_vec quaternions;
+	/// Specific force in the n-frame used in the time update [\f$m/s^2\f$].
+	vec3 s;
+	/// Error state fed back by the measurement update, zero at samples without a ZUPT.
+	precision correction[SMOOTHER_NR_OF_STATES];
+	/// A-priori covariance, after the time update.
+	mat9sym cov_prior;
+	/// A-posteriori covariance, after the measurement update.
+	mat9sym cov_posterior;
+	//@}
+	///\name Backward pass
+	//@{
+	/// Smoothed navigation states.
+	vec3 smoothed_position;
+	vec3 smoothed_velocity;
+	quat_vec smoothed_quaternions;
+	/// Standard deviations of the smoothed position [m].
+	vec3 smoothed_position_sigma;
+	//@}
+} smoother_record_t;
+
+/// Disk-backed store of the records of one session.
+typedef struct {
+	///\cond
+	int fd;
+	char path[4096];
+	smoother_record_t *block;
+	uint32_t block_size;
+	uint32_t fill;
+	///\endcond
+	/// Number of records in the store.
+	uint64_t nr_of_records;
+	/// Number of samples where the backward recursion had to be restarted (covariance not positive definite).
+	uint32_t nr_of_restarts;
+} smoother_store_t;
+
+/*! \brief Creates a store.
+
+	 @param[out] store		The store. Must be released with smoother_store_close().
+	 @param[in]	 path		File backing the store. It is removed when the store is closed.
+	 @param[in]	 block_size	Number of records held in memory, 0 for \ref SMOOTHER_DEFAULT_BLOCK_SIZE.
+	 \return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int smoother_store_open(smoother_store_t *store, const char *path, uint32_t block_size);
+
+/// Closes a store and removes its file.
+void smoother_store_close(smoother_store_t *store);
+
+/*! \brief Forward pass, runs the filter over a session and fills the store.
+
+	 @param[in,out]	store		Empty store.
+	 @param[out]	filter		Filter context, holds the final state of the forward filter.
+	 @param[in]		params		Filter parameters.
+	 @param[in]		data		IMU data of the session.
+	 \return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int smoother_forward(smoother_store_t *store, nav_filter_t *filter, const nav_params_t *params, const session_data_t *data);
+
+/*! \brief Backward pass, calculates the smoothed states of all records of the store.
+
+	 @param[in,out]	store		Store filled by smoother_forward().
+	 @param[in]		params		Filter parameters, the same as in the forward pass.
+	 \return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int smoother_backward(smoother_store_t *store, const nav_params_t *params);
+
+/*! \brief Writes the forward and the smoothed trajectory of a store.
+
+	\details The forward trajectory has the format of session_write_trajectory(). The smoothed trajectory has the
+	same columns followed by the standard deviations of the smoothed position (N,E,D) [m].
+
+	 @param[in]	store				Store processed by smoother_backward().
+	 @param[in]	forward_file		File for the forward trajectory, or NULL.
+	 @param[in]	smoothed_file		File for the smoothed trajectory, or NULL.
+	 \return Zero on success, otherwise -1 (a message is printed on stderr).
+*/
+int smoother_write_trajectories(smoother_store_t *store, const char *forward_file, const char *smoothed_file);
+
+#endif /* SMOOTHER_H_ */
+
+//@}
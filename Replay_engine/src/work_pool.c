@@ -0,0 +1,181 @@
+/*! \file work_pool.c
+	\brief The work-stealing thread pool of the replay engine.
+
+	\details The queues are protected by one mutex each. The tasks of the replay engine (one recording each)
+	run for milliseconds to seconds, hence the locking cost is negligible compared to the task cost and a
+	lock-free deque is not motivated.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+///\addtogroup work_pool
+//@{
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "work_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Double ended queue of task indices owned by one worker.
+typedef struct {
+	pthread_mutex_t lock;
+	/// Task indices of the queue.
+	size_t *tasks;
+	/// Index of the first task in the queue (stealing end).
+	size_t head;
+	/// Index one past the last task in the queue (owner end).
+	size_t tail;
+} work_queue_t;
+
+/// State shared by all the workers of one run.
+typedef struct {
+	work_queue_t *queues;
+	unsigned nr_of_workers;
+	work_pool_task_fn fn;
+	void *arg;
+	work_pool_stats_t *stats;
+} work_pool_t;
+
+/// Argument of a worker thread.
+typedef struct {
+	work_pool_t *pool;
+	unsigned worker;
+} worker_arg_t;
+
+
+double work_pool_time(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+1e-9*ts.tv_nsec;
+}
+
+/// Takes a task from the back of the worker's own queue. Returns zero if the queue is empty.
+static int pop_own(work_queue_t *q, size_t *task){
+	int found=0;
+	pthread_mutex_lock(&q->lock);
+	if(q->head<q->tail){
+		*task=q->tasks[--q->tail];
+		found=1;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return found;
+}
+
+/// Takes a task from the front of the queue of another worker. Returns zero if the queue is empty.
+static int steal(work_queue_t *q, size_t *task){
+	int found=0;
+	pthread_mutex_lock(&q->lock);
+	if(q->head<q->tail){
+		*task=q->tasks[q->head++];
+		found=1;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return found;
+}
+
+static void* worker_main(void *varg){
+	worker_arg_t *warg=(worker_arg_t*)varg;
+	work_pool_t *pool=warg->pool;
+	unsigned me=warg->worker;
+	work_pool_stats_t *stats=&pool->stats[me];
+	size_t task;
+
+	for(;;){
+		int found=pop_own(&pool->queues[me],&task);
+
+		// Own queue empty, try to steal from the others starting with the next worker. Since no tasks are ever
+		// added, the worker is done when all queues are found empty.
+		for(unsigned i=1; !found && i<pool->nr_of_workers; i++){
+			found=steal(&pool->queues[(me+i)%pool->nr_of_workers],&task);
+			if(found)
+				stats->nr_of_steals++;
+		}
+		if(!found)
+			break;
+
+		double t0=work_pool_time();
+		pool->fn(pool->arg,task,me);
+		stats->busy_time+=work_pool_time()-t0;
+		stats->nr_of_tasks++;
+	}
+	return NULL;
+}
+
+int work_pool_run(unsigned nr_of_workers, size_t nr_of_tasks, work_pool_task_fn fn, void *arg, work_pool_stats_t *stats){
+
+	if(nr_of_workers<1)
+		nr_of_workers=1;
+	if(nr_of_workers>WORK_POOL_MAX_WORKERS)
+		nr_of_workers=WORK_POOL_MAX_WORKERS;
+
+	work_pool_t pool;
+	work_queue_t queues[WORK_POOL_MAX_WORKERS];
+	worker_arg_t wargs[WORK_POOL_MAX_WORKERS];
+	pthread_t threads[WORK_POOL_MAX_WORKERS];
+	work_pool_stats_t *own_stats=NULL;
+	size_t *task_mem=malloc((nr_of_tasks ? nr_of_tasks : 1)*sizeof(size_t));
+	int ret=0;
+
+	if(!stats)
+		stats=own_stats=malloc(nr_of_workers*sizeof(work_pool_stats_t));
+	if(!task_mem || !stats){
+		free(task_mem);
+		free(own_stats);
+		return -1;
+	}
+	memset(stats,0,nr_of_workers*sizeof(work_pool_stats_t));
+
+	pool.queues=queues;
+	pool.nr_of_workers=nr_of_workers;
+	pool.fn=fn;
+	pool.arg=arg;
+	pool.stats=stats;
+
+	// Deal the tasks round-robin. Queue w holds the tasks w, w+n, w+2n, ... in a contiguous part of task_mem.
+	size_t offset=0;
+	for(unsigned w=0; w<nr_of_workers; w++){
+		pthread_mutex_init(&queues[w].lock,NULL);
+		queues[w].tasks=task_mem+offset;
+		queues[w].head=0;
+		queues[w].tail=0;
+		for(size_t t=w; t<nr_of_tasks; t+=nr_of_workers)
+			queues[w].tasks[queues[w].tail++]=t;
+		offset+=queues[w].tail;
+
+		// The owner takes tasks from the back, reverse the queue such that tasks are started in order.
+		for(size_t i=0; i<queues[w].tail/2; i++){
+			size_t tmp=queues[w].tasks[i];
+			queues[w].tasks[i]=queues[w].tasks[queues[w].tail-1-i];
+			queues[w].tasks[queues[w].tail-1-i]=tmp;
+		}
+	}
+
+	// Worker 0 runs on the calling thread.
+	unsigned started=1;
+	for(unsigned w=0; w<nr_of_workers; w++){
+		wargs[w].pool=&pool;
+		wargs[w].worker=w;
+	}
+	for(unsigned w=1; w<nr_of_workers; w++){
+		if(pthread_create(&threads[w],NULL,worker_main,&wargs[w])!=0){
+			ret=-1;
+			break;
+		}
+		started++;
+	}
+	worker_main(&wargs[0]);
+	for(unsigned w=1; w<started; w++)
+		pthread_join(threads[w],NULL);
+
+	for(unsigned w=0; w<nr_of_workers; w++)
+		pthread_mutex_destroy(&queues[w].lock);
+	free(task_mem);
+	free(own_stats);
+	return ret;
+}
+
+//@}
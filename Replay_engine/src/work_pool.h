@@ -0,0 +1,61 @@
+/*! \file work_pool.h
+	\brief Header file for the work-stealing thread pool of the replay engine.
+
+	\details The pool runs a fixed number of independent tasks, identified by their index, on a number of worker
+	threads. Each worker owns a double ended queue of task indices. A worker takes tasks from the back of its own
+	queue, and when its queue is empty it steals tasks from the front of the queues of the other workers. Hence,
+	workers that get short tasks (e.g. short recordings) will help out the ones that got long tasks.
+
+	\authors John-Olof Nilsson, Isaac Skog
+ 	\copyright Copyright (c) 2011 OpenShoe, ISC License (open source)
+ */
+
+/**
+	\defgroup work_pool Work-stealing thread pool
+	\brief Thread pool used to spread the replay sessions across the cores of the host.
+	@{
+*/
+
+#ifndef WORK_POOL_H_
+#define WORK_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Maximum number of worker threads of the pool.
+#define WORK_POOL_MAX_WORKERS 256
+
+/*! \brief Function processing one task.
+
+	 @param[in] arg		The user argument given to work_pool_run().
+	 @param[in] task	The index of the task to be processed.
+	 @param[in] worker	The index of the worker thread processing the task.
+*/
+typedef void (*work_pool_task_fn)(void *arg, size_t task, unsigned worker);
+
+/// Statistics of one worker thread.
+typedef struct {
+	/// Number of tasks processed by the worker.
+	uint32_t nr_of_tasks;
+	/// Number of tasks the worker has stolen from other workers.
+	uint32_t nr_of_steals;
+	/// Time the worker has spent processing tasks [s].
+	double busy_time;
+} work_pool_stats_t;
+
+/*! \brief Runs \a nr_of_tasks tasks on \a nr_of_workers threads and returns when all tasks have been processed.
+
+	\details The tasks are initially dealt round-robin to the workers. If \a stats is not NULL, it must point to
+	an array of \a nr_of_workers elements which is filled with the statistics of the workers.
+
+	\return Zero on success, otherwise -1 if not all worker threads could be created. All tasks are processed also in
+	this case, but by fewer workers.
+*/
+int work_pool_run(unsigned nr_of_workers, size_t nr_of_tasks, work_pool_task_fn fn, void *arg, work_pool_stats_t *stats);
+
+/// Returns a monotonic time stamp [s].
+double work_pool_time(void);
+
+#endif /* WORK_POOL_H_ */
+
+//@}